@@ -0,0 +1,600 @@
+/**
+ * @file bench_link.cpp
+ * @brief Throughput and latency benchmarks for V4-link
+ *
+ * Drives Link through a loopback UART callback and reports:
+ * - feed:       receive path throughput for feed_byte() and bulk feed()
+ * - crc8:       every software CRC-8 backend over several block sizes
+ * - crc16/32c:  the linked CRC-16 and CRC-32C (V4LINK_WIDE_CRC_BACKEND)
+ * - relocate:   relocate_calls() and relocate_fixups() over generated word tables
+ * - lz:         compression ratio and streaming decode throughput on those tables
+ * - encode:     host-side FrameWriter vs one encode_frame() vector per frame
+ * - latency:    frame-to-ACK time for each command
+ *
+ * Usage: v4link_bench [--json] [--quick]
+ *
+ * With --json the results are printed as a single JSON document (one flat
+ * record per metric) so runs from different releases can be diffed.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "crc8.hpp"
+#include "crc_wide.hpp"
+#include "frame.hpp"
+#include "v4/vm_api.h"
+#include "v4link/internal/lz.hpp"
+#include "v4link/internal/relocation.hpp"
+#include "v4link/link.hpp"
+
+#if V4LINK_BENCH_HAVE_HOST
+#include "v4link/host.hpp"
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define V4LINK_BENCH_HAVE_CYCLES 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define V4LINK_BENCH_HAVE_CYCLES 1
+#else
+#define V4LINK_BENCH_HAVE_CYCLES 0
+#endif
+
+using namespace v4::link;
+
+// Per-backend CRC-8 entry points built from bench/crc8_variant.cpp
+namespace v4
+{
+namespace link
+{
+namespace internal
+{
+uint8_t calc_crc8_table(const uint8_t* data, size_t len);
+uint8_t calc_crc8_nibble(const uint8_t* data, size_t len);
+uint8_t calc_crc8_bitwise(const uint8_t* data, size_t len);
+}  // namespace internal
+}  // namespace link
+}  // namespace v4
+
+namespace
+{
+
+/* ========================================================================= */
+/* Timing and reporting                                                      */
+/* ========================================================================= */
+
+uint64_t now_ns()
+{
+  using namespace std::chrono;
+  return static_cast<uint64_t>(
+      duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t read_cycles()
+{
+#if V4LINK_BENCH_HAVE_CYCLES
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Keeps benchmarked results observable so the compiler cannot drop them
+volatile uint32_t g_sink;
+
+struct Timing
+{
+  double ns;      // Per call
+  double cycles;  // Per call (0 if no cycle counter)
+};
+
+/**
+ * @brief Time @p fn, doubling the iteration count until @p min_ns elapses
+ */
+template <typename Fn>
+Timing measure(Fn&& fn, uint64_t min_ns)
+{
+  for (size_t iters = 1;; iters *= 2)
+  {
+    const uint64_t c0 = read_cycles();
+    const uint64_t t0 = now_ns();
+    for (size_t i = 0; i < iters; ++i)
+    {
+      fn();
+    }
+    const uint64_t t1 = now_ns();
+    const uint64_t c1 = read_cycles();
+
+    if (t1 - t0 >= min_ns || iters >= (static_cast<size_t>(1) << 30))
+    {
+      return {static_cast<double>(t1 - t0) / static_cast<double>(iters),
+              static_cast<double>(c1 - c0) / static_cast<double>(iters)};
+    }
+  }
+}
+
+struct Record
+{
+  const char* group;
+  const char* name;
+  size_t size;  // Payload/block/table size the metric applies to (0: n/a)
+  const char* metric;
+  double value;
+};
+
+std::vector<Record> g_records;
+
+void report(const char* group, const char* name, size_t size, const char* metric,
+            double value)
+{
+  g_records.push_back({group, name, size, metric, value});
+}
+
+// Bytes/sec, ns/byte and cycles/byte for one call processing @p bytes bytes
+void report_throughput(const char* group, const char* name, size_t size, size_t bytes,
+                       const Timing& t)
+{
+  const double per_byte = t.ns / static_cast<double>(bytes);
+  report(group, name, size, "bytes_per_sec", 1e9 / per_byte);
+  report(group, name, size, "ns_per_byte", per_byte);
+  if (V4LINK_BENCH_HAVE_CYCLES)
+  {
+    report(group, name, size, "cycles_per_byte", t.cycles / static_cast<double>(bytes));
+  }
+}
+
+void print_text()
+{
+  std::printf("V4-link benchmark %s (%s, CRC-8 backend %s)\n\n", V4LINK_BENCH_VERSION,
+              V4LINK_BENCH_BUILD_TYPE, V4LINK_BENCH_CRC8_BACKEND);
+  std::printf("%-10s %-14s %6s  %-16s %14s\n", "group", "case", "size", "metric", "value");
+  for (const Record& r : g_records)
+  {
+    std::printf("%-10s %-14s %6zu  %-16s %14.3f\n", r.group, r.name, r.size, r.metric,
+                r.value);
+  }
+}
+
+void print_json()
+{
+  std::printf("{\n");
+  std::printf("  \"version\": \"%s\",\n", V4LINK_BENCH_VERSION);
+  std::printf("  \"build_type\": \"%s\",\n", V4LINK_BENCH_BUILD_TYPE);
+  std::printf("  \"crc8_backend\": \"%s\",\n", V4LINK_BENCH_CRC8_BACKEND);
+  std::printf("  \"wide_crc_backend\": \"%s\",\n", V4LINK_BENCH_WIDE_CRC_BACKEND);
+  std::printf("  \"results\": [\n");
+  for (size_t i = 0; i < g_records.size(); ++i)
+  {
+    const Record& r = g_records[i];
+    std::printf(
+        "    {\"group\": \"%s\", \"case\": \"%s\", \"size\": %zu, \"metric\": \"%s\", "
+        "\"value\": %.6g}%s\n",
+        r.group, r.name, r.size, r.metric, r.value, i + 1 < g_records.size() ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+}
+
+/* ========================================================================= */
+/* Loopback UART                                                             */
+/* ========================================================================= */
+
+struct Loopback
+{
+  size_t bytes;
+  size_t frames;
+  uint64_t last_write_ns;
+  uint8_t last_err;
+};
+
+void loopback_write(void* user, const uint8_t* data, size_t len)
+{
+  auto* lb = static_cast<Loopback*>(user);
+  lb->last_write_ns = now_ns();
+  lb->bytes += len;
+  lb->frames++;
+  lb->last_err = len > 3 ? data[3] : 0xFF;
+}
+
+std::vector<uint8_t> make_frame(Command cmd, const std::vector<uint8_t>& payload)
+{
+  std::vector<uint8_t> frame;
+  internal::encode_frame(cmd, payload.data(), payload.size(), frame);
+  return frame;
+}
+
+void put_u16(std::vector<uint8_t>& out, uint16_t v)
+{
+  out.push_back(static_cast<uint8_t>(v & 0xFF));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    out.push_back(static_cast<uint8_t>((v >> (i * 8)) & 0xFF));
+  }
+}
+
+/* ========================================================================= */
+/* Benchmarks                                                                */
+/* ========================================================================= */
+
+// Unassigned command: the frame is received and CRC-checked in full, then
+// rejected with a one-byte ACK, so the numbers isolate the receive path.
+constexpr Command kSinkCommand = static_cast<Command>(0x7F);
+
+constexpr size_t kStreamBytes = 16 * 1024;
+
+void bench_feed(Vm* vm, uint64_t min_ns)
+{
+  Loopback lb = {};
+  Link link(vm, loopback_write, &lb);
+
+  for (size_t size : {16, 64, 256, 512})
+  {
+    const std::vector<uint8_t> payload(size, 0x5A);
+    const std::vector<uint8_t> frame = make_frame(kSinkCommand, payload);
+
+    std::vector<uint8_t> stream;
+    while (stream.size() + frame.size() <= kStreamBytes)
+    {
+      stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+
+    const Timing per_byte = measure(
+        [&]
+        {
+          for (uint8_t byte : stream)
+          {
+            link.feed_byte(byte);
+          }
+        },
+        min_ns);
+    report_throughput("feed", "feed_byte", size, stream.size(), per_byte);
+
+    // DMA-style delivery in 64-byte blocks
+    const Timing chunked = measure(
+        [&]
+        {
+          for (size_t off = 0; off < stream.size(); off += 64)
+          {
+            link.feed(stream.data() + off, std::min<size_t>(64, stream.size() - off));
+          }
+        },
+        min_ns);
+    report_throughput("feed", "feed_64", size, stream.size(), chunked);
+
+    const Timing bulk = measure([&] { link.feed(stream.data(), stream.size()); }, min_ns);
+    report_throughput("feed", "feed_all", size, stream.size(), bulk);
+  }
+}
+
+void bench_crc8(uint64_t min_ns)
+{
+  struct Backend
+  {
+    const char* name;
+    uint8_t (*fn)(const uint8_t*, size_t);
+  };
+  const Backend backends[] = {
+      {"table", internal::calc_crc8_table},
+      {"nibble", internal::calc_crc8_nibble},
+      {"bitwise", internal::calc_crc8_bitwise},
+      {"linked", internal::calc_crc8},  // Backend selected by V4LINK_CRC8_BACKEND
+  };
+
+  std::vector<uint8_t> data(4096);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+
+  for (const Backend& backend : backends)
+  {
+    for (size_t size : {8, 64, 512, 4096})
+    {
+      const Timing t = measure([&] { g_sink = g_sink + backend.fn(data.data(), size); },
+                               min_ns);
+      report_throughput("crc8", backend.name, size, size, t);
+    }
+  }
+
+  // Wider checks for large frames, at the sizes where slicing pays off
+  for (size_t size : {8, 64, 512, 4096})
+  {
+    Timing t = measure([&] { g_sink = g_sink + internal::calc_crc16(data.data(), size); },
+                       min_ns);
+    report_throughput("crc16", "linked", size, size, t);
+    t = measure([&] { g_sink = g_sink + internal::calc_crc32c(data.data(), size); },
+                min_ns);
+    report_throughput("crc32c", "linked", size, size, t);
+  }
+}
+
+// Word body in the style of compiled Forth: literals, arithmetic, calls, RET
+std::vector<uint8_t> make_word(size_t index, std::vector<uint8_t>& fixups)
+{
+  std::vector<uint8_t> code;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    code.push_back(0x00);  // LIT
+    put_u32(code, static_cast<uint32_t>(index * 4 + i));
+    code.push_back(0x76);  // LIT_U8
+    code.push_back(static_cast<uint8_t>(i));
+    code.push_back(0x10);  // ADD
+    code.push_back(0x01);  // DUP
+    if (index > 0)
+    {
+      code.push_back(0x50);  // CALL earlier word
+      put_u16(fixups, static_cast<uint16_t>(code.size()));
+      put_u16(code, static_cast<uint16_t>((index + i) % index));
+    }
+    code.push_back(0x12);  // MUL
+    code.push_back(0x02);  // DROP
+  }
+  code.push_back(0x51);  // RET
+  return code;
+}
+
+void bench_relocate(uint64_t min_ns)
+{
+  for (size_t word_count : {8, 32, 128})
+  {
+    std::vector<std::vector<uint8_t>> words;
+    std::vector<std::vector<uint8_t>> fixups(word_count);
+    size_t total = 0;
+    for (size_t i = 0; i < word_count; ++i)
+    {
+      words.push_back(make_word(i, fixups[i]));
+      total += words.back().size();
+    }
+
+    // Alternate the offset sign so operands stay in range across iterations
+    int offset = 7;
+    const Timing t = measure(
+        [&]
+        {
+          for (auto& code : words)
+          {
+            internal::relocate_calls(code.data(), code.size(), offset);
+          }
+          offset = -offset;
+        },
+        min_ns);
+
+    report_throughput("relocate", "word_table", word_count, total, t);
+    report("relocate", "word_table", word_count, "ns_per_table", t.ns);
+
+    // Same table through the .v4b v0.3 relocation lists
+    const Timing f = measure(
+        [&]
+        {
+          for (size_t i = 0; i < word_count; ++i)
+          {
+            internal::relocate_fixups(words[i].data(), words[i].size(), fixups[i].data(),
+                                      fixups[i].size() / 2, offset);
+          }
+          offset = -offset;
+        },
+        min_ns);
+
+    report_throughput("relocate", "fixup_table", word_count, total, f);
+    report("relocate", "fixup_table", word_count, "ns_per_table", f.ns);
+  }
+}
+
+void bench_lz(uint64_t min_ns)
+{
+  for (size_t word_count : {8, 32, 128})
+  {
+    std::vector<uint8_t> table;
+    std::vector<uint8_t> fixups;
+    for (size_t i = 0; i < word_count; ++i)
+    {
+      const auto code = make_word(i, fixups);
+      table.insert(table.end(), code.begin(), code.end());
+    }
+
+    std::vector<uint8_t> packed;
+    internal::lz_compress(table.data(), table.size(), packed);
+    report("lz", "ratio", word_count, "packed_per_raw",
+           static_cast<double>(packed.size()) / static_cast<double>(table.size()));
+
+    // Decoded output is consumed the way the upload parser consumes it
+    internal::LzDecoder dec;
+    const Timing t = measure(
+        [&]
+        {
+          dec.reset();
+          dec.feed(packed.data(), packed.size(),
+                   [](const uint8_t* data, size_t len)
+                   {
+                     g_sink = g_sink + data[len - 1];
+                     return ErrorCode::OK;
+                   });
+        },
+        min_ns);
+    report_throughput("lz", "decode", word_count, table.size(), t);
+  }
+}
+
+struct LatencyCase
+{
+  const char* name;
+  std::vector<uint8_t> frame;
+  bool reset_before;  // Run RESET (untimed) before every sample
+};
+
+// Baseline state for the query cases: word 0 defined, a few stack values
+void prepare_latency(Link& link, Vm* vm, const std::vector<uint8_t>& define_frame)
+{
+  link.reset();
+  link.feed(define_frame.data(), define_frame.size());
+  for (int i = 0; i < 8; ++i)
+  {
+    vm_ds_push(vm, i);
+  }
+}
+
+#if V4LINK_BENCH_HAVE_HOST
+void bench_encode(uint64_t min_ns)
+{
+  for (size_t size : {16, 64, 256, 512})
+  {
+    const std::vector<uint8_t> payload(size, 0x5A);
+    const size_t frames = kStreamBytes / (size + internal::FRAME_OVERHEAD);
+
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> frame;
+    const Timing vector = measure(
+        [&]
+        {
+          stream.clear();
+          for (size_t i = 0; i < frames; ++i)
+          {
+            internal::encode_frame(Command::EXEC, payload.data(), payload.size(), frame);
+            stream.insert(stream.end(), frame.begin(), frame.end());
+          }
+          g_sink = stream.back();
+        },
+        min_ns);
+    report_throughput("encode", "encode_frame", size, frames * (size + 5), vector);
+
+    std::vector<uint8_t> buf(kStreamBytes);
+    FrameWriter writer(buf.data(), buf.size());
+    const Timing batched = measure(
+        [&]
+        {
+          writer.clear();
+          for (size_t i = 0; i < frames; ++i)
+          {
+            writer.add(Command::EXEC, payload.data(), payload.size());
+          }
+          g_sink = writer.data()[writer.size() - 1];
+        },
+        min_ns);
+    report_throughput("encode", "frame_writer", size, frames * (size + 5), batched);
+  }
+}
+#endif
+
+void bench_latency(Vm* vm, size_t samples)
+{
+  Loopback lb = {};
+  Link link(vm, loopback_write, &lb);
+
+  // EXEC payload: .v4b with one word "sq" (DUP MUL RET), main: LIT 3 CALL 0 DROP RET
+  std::vector<uint8_t> v4b = {'V', '4', 'B', 'C', 0x00, 0x02, 0x00, 0x00};
+  const std::vector<uint8_t> main_code = {0x00, 3, 0, 0, 0, 0x50, 0, 0, 0x02, 0x51};
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  put_u32(v4b, static_cast<uint32_t>(main_code.size()));
+  put_u32(v4b, 1);
+  v4b.insert(v4b.end(), main_code.begin(), main_code.end());
+  v4b.push_back(2);
+  v4b.push_back('s');
+  v4b.push_back('q');
+  put_u32(v4b, static_cast<uint32_t>(sq.size()));
+  v4b.insert(v4b.end(), sq.begin(), sq.end());
+
+  std::vector<uint8_t> query_memory;
+  put_u32(query_memory, 0);
+  put_u16(query_memory, 64);
+
+  const std::vector<LatencyCase> cases = {
+      {"PING", make_frame(Command::PING, {}), false},
+      {"EXEC_RAW", make_frame(Command::EXEC, {0x00, 1, 0, 0, 0, 0x02, 0x51}), true},
+      {"EXEC_V4B", make_frame(Command::EXEC, v4b), true},
+      {"QUERY_STACK", make_frame(Command::QUERY_STACK, {}), false},
+      {"QUERY_MEMORY", make_frame(Command::QUERY_MEMORY, query_memory), false},
+      {"QUERY_WORD", make_frame(Command::QUERY_WORD, {0, 0}), false},
+      {"RESET", make_frame(Command::RESET, {}), false},
+  };
+
+  std::vector<double> ns(samples);
+  for (const LatencyCase& c : cases)
+  {
+    prepare_latency(link, vm, cases[2].frame);
+    for (size_t i = 0; i < samples; ++i)
+    {
+      if (c.reset_before)
+      {
+        link.reset();
+      }
+      const uint64_t t0 = now_ns();
+      link.feed(c.frame.data(), c.frame.size());
+      ns[i] = static_cast<double>(lb.last_write_ns - t0);
+    }
+
+    std::sort(ns.begin(), ns.end());
+    report("latency", c.name, c.frame.size(), "min_ns", ns.front());
+    report("latency", c.name, c.frame.size(), "median_ns", ns[samples / 2]);
+    report("latency", c.name, c.frame.size(), "p99_ns", ns[samples * 99 / 100]);
+    report("latency", c.name, c.frame.size(), "ack_err", lb.last_err);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  bool json = false;
+  bool quick = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--json") == 0)
+    {
+      json = true;
+    }
+    else if (std::strcmp(argv[i], "--quick") == 0)
+    {
+      quick = true;
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--json] [--quick]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const uint64_t min_ns = quick ? 2000000 : 50000000;  // Per measurement
+  const size_t samples = quick ? 100 : 2000;           // Per latency case
+
+  uint8_t vm_memory[4096] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  if (vm == nullptr)
+  {
+    std::fprintf(stderr, "vm_create failed\n");
+    return 1;
+  }
+
+  bench_feed(vm, min_ns);
+  bench_crc8(min_ns);
+  bench_relocate(min_ns);
+  bench_lz(min_ns);
+#if V4LINK_BENCH_HAVE_HOST
+  bench_encode(min_ns);
+#endif
+  bench_latency(vm, samples);
+
+  vm_destroy(vm);
+
+  if (json)
+  {
+    print_json();
+  }
+  else
+  {
+    print_text();
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+/**
+ * @file crc8_variant.cpp
+ * @brief Build one CRC-8 backend under backend-specific symbol names
+ *
+ * The library links exactly one backend, but the benchmark compares all of
+ * them. This file is compiled once per backend with
+ * V4LINK_CRC8_BACKEND_<NAME> and V4LINK_BENCH_CRC8_SUFFIX=<name>, which
+ * renames calc_crc8() to calc_crc8_<name>() so the objects can coexist.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#define V4LINK_BENCH_PASTE_(a, b) a##_##b
+#define V4LINK_BENCH_PASTE(a, b) V4LINK_BENCH_PASTE_(a, b)
+
+#define calc_crc8 V4LINK_BENCH_PASTE(calc_crc8, V4LINK_BENCH_CRC8_SUFFIX)
+#define crc8_update V4LINK_BENCH_PASTE(crc8_update, V4LINK_BENCH_CRC8_SUFFIX)
+
+#include "crc8.cpp"
@@ -0,0 +1,563 @@
+/**
+ * @file host.hpp
+ * @brief Host-side encoders and decoders for talking to a V4-link device
+ *
+ * The framing used by host tools, shared with the device side:
+ * - FrameWriter:    encodes frames back to back into one caller-owned buffer
+ * - V4bBuilder:     builds .v4b images with relocation lists and word references
+ * - ResponseReader: splits a received byte stream into CRC-checked responses
+ * - decode_exec() / decode_stack(): structured EXEC/COMMIT and QUERY_STACK results
+ * - TraceDecoder / trace_to_chrome_json(): DUMP_TRACE timelines for chrome://tracing
+ * - decode_profile(): PROFILE_DUMP hot-word reports
+ *
+ * Not part of the firmware library: build with V4LINK_BUILD_HOST and link
+ * v4link_host.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "v4link/protocol.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+/* ========================================================================= */
+/* Frame encoding                                                            */
+/* ========================================================================= */
+
+/**
+ * @brief Encodes command frames into a caller-owned buffer
+ *
+ * Frames are appended back to back without allocation, so a whole upload
+ * (or one per device of a rack) can go out in a single write()/writev().
+ *
+ * Example usage:
+ * @code
+ * uint8_t buf[8192];
+ * FrameWriter writer(buf, sizeof(buf));
+ * writer.add(Command::PING);
+ * writer.add(Command::EXEC, image.data(), image.size());
+ * write(fd, writer.data(), writer.size());
+ * writer.clear();
+ * @endcode
+ */
+class FrameWriter
+{
+ public:
+  /**
+   * @brief Write into @p buffer
+   *
+   * @param buffer      Output buffer, owned by the caller
+   * @param capacity    Size of @p buffer in bytes
+   * @param max_payload Payload limit, e.g. MAX_PAYLOAD from the device's
+   *                    PING capability block (at most MAX_FRAME_PAYLOAD)
+   */
+  FrameWriter(uint8_t* buffer, size_t capacity, size_t max_payload = MAX_PAYLOAD_SIZE);
+
+  /**
+   * @brief Append [STX][LEN_L][LEN_H][CMD][DATA...][CRC]
+   *
+   * @return false (and nothing written) if the payload exceeds the limit
+   *         or the frame does not fit the remaining space
+   */
+  bool add(Command cmd, const uint8_t* data = nullptr, size_t len = 0);
+
+  /**
+   * @brief Append a windowed-mode frame [STX][LEN_L][LEN_H][CMD][SEQ][DATA...][CRC]
+   *
+   * SEQ counts towards the payload limit.
+   *
+   * @return false (and nothing written) if the frame does not fit
+   */
+  bool add_seq(Command cmd, uint8_t seq, const uint8_t* data = nullptr, size_t len = 0);
+
+  /**
+   * @brief Write later frames in COBS framing (after a PING_FLAG_COBS PING)
+   *
+   * Each frame then ends with a 0x00 delimiter; see PING_FLAG_COBS.
+   */
+  void set_cobs(bool cobs)
+  {
+    cobs_ = cobs;
+  }
+
+  /**
+   * @brief End later frames with @p check (after a PING selected it)
+   */
+  void set_check(CrcType check)
+  {
+    check_ = check;
+  }
+
+  /**
+   * @brief Drop every frame written so far
+   */
+  void clear()
+  {
+    size_ = 0;
+    frames_ = 0;
+  }
+
+  /**
+   * @brief Encoded bytes (the buffer passed at construction)
+   */
+  const uint8_t* data() const
+  {
+    return buffer_;
+  }
+
+  /**
+   * @brief Number of encoded bytes
+   */
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @brief Number of frames written since the last clear()
+   */
+  size_t frames() const
+  {
+    return frames_;
+  }
+
+  /**
+   * @brief Bytes left in the buffer
+   */
+  size_t remaining() const
+  {
+    return capacity_ - size_;
+  }
+
+ private:
+  /**
+   * @brief Where a frame of @p frame_len bytes is to be built
+   *
+   * @return nullptr if it does not fit the remaining space
+   */
+  uint8_t* reserve(size_t frame_len);
+
+  /**
+   * @brief Account for the frame built at reserve(), encoding it if needed
+   */
+  void commit(size_t frame_len);
+
+  uint8_t* buffer_;     ///< Caller-owned output buffer
+  size_t capacity_;     ///< Size of buffer_
+  size_t max_payload_;  ///< Payload limit per frame
+  size_t size_;         ///< Bytes written
+  size_t frames_;       ///< Frames written
+  bool cobs_;           ///< COBS framing
+  CrcType check_;       ///< Frame check
+};
+
+/* ========================================================================= */
+/* .v4b images                                                               */
+/* ========================================================================= */
+
+/**
+ * @brief Builds a .v4b image from main code and a word table
+ *
+ * CALL operands are file-relative word table indices, as compiled. The
+ * image is written as v0.3 with a relocation list for every block, so the
+ * device does not decode the code to find CALLs, or as v0.4 once a word
+ * reference has been added.
+ *
+ * Example usage:
+ * @code
+ * V4bBuilder v4b;
+ * v4b.add_word("sq", sq_code, sizeof(sq_code));  // Index 0
+ * v4b.set_main(main_code, sizeof(main_code));    // LIT 3 CALL 0 ...
+ * std::vector<uint8_t> image;
+ * v4b.build(image);
+ * @endcode
+ */
+class V4bBuilder
+{
+ public:
+  /**
+   * @brief Set the anonymous main code run after the words are loaded
+   */
+  void set_main(const uint8_t* code, size_t len);
+
+  /**
+   * @brief Append a word to the table
+   *
+   * @param name Word name (nullptr or "" for an anonymous word)
+   * @param code Bytecode of the word
+   * @param len  Bytecode length in bytes
+   * @return false if the name is longer than 254 bytes
+   */
+  bool add_word(const char* name, const uint8_t* code, size_t len);
+
+  /**
+   * @brief Append a reference to a word already resident on the device
+   *
+   * @param hash Chain hash of the resident word (see word_hash())
+   */
+  void add_word_ref(uint32_t hash);
+
+  /**
+   * @brief Chain hash of table entry @p index, as the device computes it
+   *
+   * A later image may reference the word with add_word_ref() once the
+   * device reports it resident (HAVE_WORDS).
+   */
+  uint32_t word_hash(size_t index) const
+  {
+    return words_[index].hash;
+  }
+
+  /**
+   * @brief Number of table entries
+   */
+  size_t word_count() const
+  {
+    return words_.size();
+  }
+
+  /**
+   * @brief Remove the main code and every word
+   */
+  void clear();
+
+  /**
+   * @brief Write the image to @p out (replacing its contents)
+   *
+   * @return false if a block contains an unknown opcode or a truncated
+   *         instruction, or is too long for 16-bit relocation offsets
+   */
+  bool build(std::vector<uint8_t>& out) const;
+
+ private:
+  /**
+   * @brief One word table entry
+   */
+  struct Entry
+  {
+    std::vector<uint8_t> bytes;  ///< [NAME_LEN][NAME][CODE_LEN][CODE], or a reference
+    uint32_t hash;               ///< Chain hash up to and including this entry
+    bool ref;                    ///< Word reference: no code, no relocation list
+  };
+
+  std::vector<uint8_t> main_;  ///< Main code
+  std::vector<Entry> words_;   ///< Word table in index order
+};
+
+/* ========================================================================= */
+/* Response decoding                                                         */
+/* ========================================================================= */
+
+/**
+ * @brief One response or event frame from the device
+ */
+struct Response
+{
+  uint8_t code;         ///< ERR_CODE, or an Event code for device-initiated frames
+  bool event;           ///< Device-initiated (code >= 0x80, never tagged with SEQ)
+  bool has_seq;         ///< SEQ present (windowed mode responses)
+  uint8_t seq;          ///< SEQ of the frame answered, if has_seq
+  const uint8_t* data;  ///< Response data after ERR_CODE (and SEQ)
+  size_t len;           ///< Response data length in bytes
+
+  /**
+   * @brief Response code as an ErrorCode (meaningless for events)
+   */
+  ErrorCode error() const
+  {
+    return static_cast<ErrorCode>(code);
+  }
+};
+
+/**
+ * @brief Splits a received byte stream into responses
+ *
+ * Bytes are pushed as they arrive, in pieces of any size. Frames whose
+ * CRC does not match are counted and skipped, resynchronizing on the next
+ * STX, or on the next delimiter in COBS framing.
+ *
+ * Example usage:
+ * @code
+ * ResponseReader reader;
+ * reader.push(rx, n);
+ * Response rsp;
+ * while (reader.next(rsp))
+ * {
+ *   ...
+ * }
+ * @endcode
+ */
+class ResponseReader
+{
+ public:
+  /**
+   * @brief Read responses of at most @p max_response bytes of LEN
+   *
+   * @param max_response Response limit, e.g. MAX_RESPONSE from the device's
+   *                     PING capability block (at most MAX_FRAME_PAYLOAD).
+   *                     A larger LEN marks a false STX.
+   */
+  explicit ResponseReader(size_t max_response = MAX_FRAME_PAYLOAD)
+      : max_response_(std::min(max_response, MAX_FRAME_PAYLOAD))
+  {
+  }
+
+  /**
+   * @brief Change the response limit (after a PING reported MAX_RESPONSE)
+   */
+  void set_max_response(size_t max_response)
+  {
+    max_response_ = std::min(max_response, MAX_FRAME_PAYLOAD);
+  }
+
+  /**
+   * @brief Expect SEQ-tagged responses (after a PING [WINDOW] was accepted)
+   */
+  void set_windowed(bool windowed)
+  {
+    windowed_ = windowed;
+  }
+
+  /**
+   * @brief Expect COBS framing (after a PING with PING_FLAG_COBS)
+   */
+  void set_cobs(bool cobs)
+  {
+    cobs_ = cobs;
+  }
+
+  /**
+   * @brief Expect frames ending with @p check (after a PING selected it)
+   */
+  void set_check(CrcType check)
+  {
+    check_ = check;
+  }
+
+  /**
+   * @brief Append received bytes (copied)
+   */
+  void push(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Take the next complete response
+   *
+   * @param out Filled on success; its data stays valid until the next
+   *            push() or next()
+   * @return false if no complete frame is buffered
+   */
+  bool next(Response& out);
+
+  /**
+   * @brief Bytes received and not yet returned as a response
+   */
+  size_t pending() const
+  {
+    return buffer_.size() - pos_;
+  }
+
+  /**
+   * @brief Frames dropped for a CRC mismatch or a LEN of zero or past the limit
+   */
+  size_t crc_errors() const
+  {
+    return crc_errors_;
+  }
+
+ private:
+  /**
+   * @brief next() for COBS framing
+   */
+  bool next_cobs(Response& out);
+
+  /**
+   * @brief Fill @p out from a checked frame with @p len bytes of LEN
+   */
+  void read_frame(const uint8_t* frame, size_t len, Response& out) const;
+
+  std::vector<uint8_t> buffer_;    ///< Received bytes
+  size_t pos_ = 0;                 ///< Start of the unparsed bytes
+  size_t crc_errors_ = 0;          ///< Dropped frames
+  bool windowed_ = false;          ///< Responses carry SEQ
+  bool cobs_ = false;              ///< COBS framing
+  CrcType check_ = CrcType::CRC8;  ///< Frame check
+  size_t max_response_;            ///< LEN limit (STX framing)
+};
+
+/**
+ * @brief Word indices reported by EXEC or COMMIT
+ */
+struct ExecResult
+{
+  std::vector<uint16_t> words;  ///< VM index per .v4b table entry, then the main code
+
+  /**
+   * @brief VM index of the main code (the last entry)
+   */
+  uint16_t main_word() const
+  {
+    return words.back();
+  }
+};
+
+/**
+ * @brief Stacks reported by QUERY_STACK, bottom first
+ */
+struct StackDump
+{
+  std::vector<int32_t> data;  ///< Data stack
+  std::vector<int32_t> ret;   ///< Return stack
+};
+
+/**
+ * @brief Decode a successful EXEC or COMMIT response
+ *
+ * @return false if @p rsp is an error or malformed
+ */
+bool decode_exec(const Response& rsp, ExecResult& out);
+
+/**
+ * @brief Decode a successful QUERY_STACK response
+ *
+ * @return false if @p rsp is an error or malformed
+ */
+bool decode_stack(const Response& rsp, StackDump& out);
+
+/**
+ * @brief Word profile reported by PROFILE_DUMP
+ */
+struct ProfileReport
+{
+  /**
+   * @brief Hits of one word
+   */
+  struct Entry
+  {
+    uint16_t word;     ///< VM word index
+    uint32_t hits;     ///< Samples or entries
+    std::string name;  ///< Dictionary name ("" for anonymous words)
+  };
+
+  bool active;                 ///< Device is still counting
+  ProfileMode mode;            ///< What a hit means
+  uint32_t total;              ///< All hits, including other and idle
+  uint32_t other;              ///< Hits of words without their own counter
+  uint32_t idle;               ///< Samples with no word running
+  std::vector<Entry> words;    ///< Hottest first
+};
+
+/**
+ * @brief Decode a successful PROFILE_DUMP response
+ *
+ * @return false if @p rsp is an error or malformed
+ */
+bool decode_profile(const Response& rsp, ProfileReport& out);
+
+/* ========================================================================= */
+/* Event trace                                                               */
+/* ========================================================================= */
+
+/**
+ * @brief One DUMP_TRACE record with its absolute time
+ */
+struct TraceRecord
+{
+  TraceEvent event;  ///< Record type
+  uint64_t time;     ///< Device timestamp, extended past 32-bit wraparound
+  uint32_t arg;      ///< Event argument (see TraceEvent)
+};
+
+/**
+ * @brief Collects the records of successive DUMP_TRACE responses
+ *
+ * Each response continues the timeline of the previous one, so records
+ * from repeated dumps form one sequence.
+ *
+ * Example usage:
+ * @code
+ * TraceDecoder trace;
+ * do
+ * {
+ *   ...  // Send DUMP_TRACE, read the response into rsp
+ * } while (trace.add(rsp) && trace.more());
+ * std::string json = trace_to_chrome_json(trace.records(), 48.0);  // 48 MHz cycles
+ * @endcode
+ */
+class TraceDecoder
+{
+ public:
+  /**
+   * @brief Append the records of a successful DUMP_TRACE response
+   *
+   * @return false if @p rsp is an error or malformed (nothing appended)
+   */
+  bool add(const Response& rsp);
+
+  /**
+   * @brief Records collected so far, oldest first
+   */
+  const std::vector<TraceRecord>& records() const
+  {
+    return records_;
+  }
+
+  /**
+   * @brief The last response left records on the device (TRACE_FLAG_MORE)
+   */
+  bool more() const
+  {
+    return more_;
+  }
+
+  /**
+   * @brief Records the device overwrote before they were dumped
+   */
+  uint64_t lost() const
+  {
+    return lost_;
+  }
+
+  /**
+   * @brief Drop the collected records
+   */
+  void clear()
+  {
+    records_.clear();
+    lost_ = 0;
+    more_ = false;
+  }
+
+ private:
+  std::vector<TraceRecord> records_;  ///< Decoded records
+  uint64_t time_ = 0;                 ///< Time of the newest record
+  uint64_t lost_ = 0;                 ///< Sum of LOST fields
+  bool started_ = false;              ///< time_ holds a device time
+  bool more_ = false;                 ///< TRACE_FLAG_MORE of the last response
+};
+
+/**
+ * @brief Convert trace records to Chrome trace event JSON
+ *
+ * Frames and VM runs become complete ("X") slices, named after the
+ * command; CRC checks, word registrations, relocations and responses
+ * become instant events. Load the output in chrome://tracing or Perfetto.
+ *
+ * @param records     Records in device order (TraceDecoder::records())
+ * @param ticks_per_us Device timestamp ticks per microsecond
+ */
+std::string trace_to_chrome_json(const std::vector<TraceRecord>& records, double ticks_per_us);
+
+}  // namespace link
+}  // namespace v4
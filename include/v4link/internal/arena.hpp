@@ -0,0 +1,125 @@
+/**
+ * @file arena.hpp
+ * @brief Internal bump allocator for persistent bytecode
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Bump allocator backing registered word bytecode
+ *
+ * Allocations are carved contiguously from a single region, either owned
+ * (allocated once at construction) or provided by the caller. Individual
+ * allocations cannot be freed; release() rolls back to an earlier mark()
+ * and clear() discards everything.
+ */
+class BytecodeArena
+{
+ public:
+  /**
+   * @brief Construct arena over a caller-provided region
+   *
+   * @param region Memory region to allocate from, or nullptr to allocate
+   *               @p size bytes internally
+   * @param size   Region size in bytes
+   */
+  BytecodeArena(uint8_t* region, size_t size);
+
+  /**
+   * @brief Allocate @p len bytes
+   *
+   * @param len Number of bytes
+   * @return Pointer to allocated bytes, or nullptr if the arena is full
+   */
+  uint8_t* alloc(size_t len);
+
+  /**
+   * @brief Current allocation watermark
+   */
+  size_t mark() const
+  {
+    return top_;
+  }
+
+  /**
+   * @brief Roll back all allocations made after @p mark
+   *
+   * @param mark Watermark previously returned by mark()
+   */
+  void release(size_t mark);
+
+  /**
+   * @brief Discard all allocations
+   */
+  void clear()
+  {
+    top_ = 0;
+  }
+
+  /**
+   * @brief Bytes currently allocated
+   */
+  size_t used() const
+  {
+    return top_;
+  }
+
+  /**
+   * @brief Highest used() since construction or reset_peak()
+   */
+  size_t peak() const
+  {
+    return peak_;
+  }
+
+  /**
+   * @brief Restart peak() from the current usage
+   */
+  void reset_peak()
+  {
+    peak_ = top_;
+  }
+
+  /**
+   * @brief Total arena size in bytes
+   */
+  size_t capacity() const
+  {
+    return size_;
+  }
+
+  /**
+   * @brief Check whether @p ptr points into the arena region
+   */
+  bool contains(const uint8_t* ptr) const
+  {
+    return ptr >= base_ && ptr < base_ + size_;
+  }
+
+  /**
+   * @brief Watermark just past @p len bytes at @p ptr (inside the arena)
+   */
+  size_t end_of(const uint8_t* ptr, size_t len) const
+  {
+    return static_cast<size_t>(ptr - base_) + len;
+  }
+
+ private:
+  std::vector<uint8_t> owned_;  ///< Backing storage when no region is provided
+  uint8_t* base_;               ///< Start of arena region
+  size_t size_;                 ///< Arena region size
+  size_t top_;                  ///< Current allocation offset
+  size_t peak_;                 ///< High-water mark of top_
+};
+
+}  // namespace v4::link::internal
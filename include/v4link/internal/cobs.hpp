@@ -0,0 +1,132 @@
+/**
+ * @file cobs.hpp
+ * @brief Internal COBS codec for the self-delimiting framing mode
+ *
+ * Consistent Overhead Byte Stuffing removes every 0x00 from a frame, so
+ * 0x00 can end frames unambiguously: a receiver resynchronizes at the
+ * next delimiter whatever it lost. The encoded data is a series of
+ * blocks [CODE][CODE - 1 bytes], each standing for its bytes followed by
+ * a zero; CODE 0xFF marks a full block of 254 bytes without the zero,
+ * and the zero after the last block is dropped. Encoding adds at most
+ * cobs_overhead() bytes.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Byte ending every COBS frame
+ */
+constexpr uint8_t COBS_DELIMITER = 0x00;
+
+/**
+ * @brief Largest number of bytes encoding adds to @p len bytes (delimiter excluded)
+ */
+constexpr size_t cobs_overhead(size_t len)
+{
+  return len / 254 + 1;
+}
+
+/**
+ * @brief Encode @p len bytes (without the delimiter)
+ *
+ * @p dst may overlap @p src if it starts at least cobs_overhead(len)
+ * bytes before it, so a frame can be encoded in place with headroom.
+ *
+ * @return Bytes written to @p dst
+ */
+size_t cobs_encode(const uint8_t* src, size_t len, uint8_t* dst);
+
+/**
+ * @brief How a CobsDecoder::feed() call ended
+ */
+enum class CobsStatus : uint8_t
+{
+  PARTIAL,    // All input consumed inside a frame
+  FRAME,      // A delimiter ended a well-formed frame
+  MALFORMED,  // A delimiter cut a block short
+};
+
+/**
+ * @brief Streaming decoder state
+ *
+ * Bytes of a block are handed to the sink as one run, so a frame
+ * delivered whole (e.g. by DMA with an idle-line interrupt) is decoded
+ * with one memchr() and one copy per block.
+ */
+class CobsDecoder
+{
+ public:
+  void reset()
+  {
+    left_ = 0;
+    zero_ = false;
+  }
+
+  /**
+   * @brief Decode input up to and including the next delimiter
+   *
+   * @param in     Encoded bytes
+   * @param len    Number of encoded bytes
+   * @param sink   Called as sink(const uint8_t* data, size_t len) with
+   *               decoded bytes
+   * @param status Set to how decoding stopped; after FRAME or MALFORMED
+   *               the decoder is ready for the next frame
+   * @return Bytes of @p in consumed
+   */
+  template <typename Sink>
+  size_t feed(const uint8_t* in, size_t len, Sink&& sink, CobsStatus* status)
+  {
+    static const uint8_t zero = 0;
+    size_t i = 0;
+    while (i < len)
+    {
+      if (left_ == 0)
+      {
+        const uint8_t code = in[i++];
+        if (code == COBS_DELIMITER)
+        {
+          reset();
+          *status = CobsStatus::FRAME;
+          return i;
+        }
+        if (zero_)
+        {
+          sink(&zero, 1);  // The previous block was followed by a zero
+        }
+        left_ = static_cast<uint8_t>(code - 1);
+        zero_ = code != 0xFF;
+        continue;
+      }
+
+      const size_t run = len - i < left_ ? len - i : left_;
+      const void* cut = std::memchr(in + i, COBS_DELIMITER, run);
+      if (cut != nullptr)
+      {
+        reset();
+        *status = CobsStatus::MALFORMED;
+        return static_cast<size_t>(static_cast<const uint8_t*>(cut) - in) + 1;
+      }
+      sink(in + i, run);
+      left_ = static_cast<uint8_t>(left_ - run);
+      i += run;
+    }
+    *status = CobsStatus::PARTIAL;
+    return i;
+  }
+
+ private:
+  uint8_t left_ = 0;   ///< Bytes left in the current block
+  bool zero_ = false;  ///< A zero follows the current block if another one does
+};
+
+}  // namespace v4::link::internal
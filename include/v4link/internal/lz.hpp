@@ -0,0 +1,172 @@
+/**
+ * @file lz.hpp
+ * @brief Internal LZ77 codec for compressed uploads
+ *
+ * Byte-oriented format, decodable as a stream with a fixed window:
+ *
+ * - 0x00-0x7F: literal run, (TOKEN + 1) bytes follow (1-128)
+ * - 0x80-0xFF: match of ((TOKEN & 0x7F) + LZ_MIN_MATCH) bytes (3-130),
+ *              followed by [DIST] copying from DIST + 1 bytes back (1-256)
+ *
+ * Matches may overlap their own output (DIST + 1 < length repeats a
+ * pattern). The decoder keeps only the last LZ_WINDOW_SIZE bytes of
+ * output, so RAM use is fixed regardless of the image size.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "v4link/protocol.hpp"
+
+namespace v4::link::internal
+{
+
+constexpr size_t LZ_WINDOW_SIZE = 256;  // Largest match distance
+constexpr size_t LZ_MIN_MATCH = 3;      // Shortest match worth a token
+constexpr size_t LZ_MAX_MATCH = 0x7F + LZ_MIN_MATCH;
+constexpr size_t LZ_MAX_LITERALS = 0x80;
+
+static_assert((LZ_WINDOW_SIZE & (LZ_WINDOW_SIZE - 1)) == 0, "window must be a power of 2");
+
+/**
+ * @brief Streaming decoder state
+ *
+ * Output is written into the window ring and handed to the sink in
+ * contiguous segments; no other buffer is used.
+ */
+class LzDecoder
+{
+ public:
+  void reset()
+  {
+    pos_ = 0;
+    produced_ = 0;
+    literals_ = 0;
+    match_ = 0;
+    want_dist_ = false;
+  }
+
+  /**
+   * @brief Decode the next @p len bytes of a compressed stream
+   *
+   * Tokens may be split across calls at any byte.
+   *
+   * @param in   Compressed bytes
+   * @param len  Number of compressed bytes
+   * @param sink Called as sink(const uint8_t* data, size_t len) with decoded
+   *             bytes; returns ErrorCode::OK to continue
+   * @return ErrorCode::OK, GENERAL_ERROR for a match reaching before the
+   *         start of the output, or the first error returned by @p sink
+   */
+  template <typename Sink>
+  ErrorCode feed(const uint8_t* in, size_t len, Sink&& sink)
+  {
+    size_t flushed = pos_;
+    size_t i = 0;
+    for (;;)
+    {
+      if (match_ > 0 && !want_dist_)
+      {
+        // Byte by byte: the source may overlap the bytes being written
+        while (match_ > 0 && pos_ < LZ_WINDOW_SIZE)
+        {
+          window_[pos_] = window_[(pos_ - dist_) & (LZ_WINDOW_SIZE - 1)];
+          ++pos_;
+          --match_;
+        }
+      }
+      else if (i == len)
+      {
+        break;
+      }
+      else if (literals_ > 0)
+      {
+        // Literal runs are copied up to the end of the ring at once
+        size_t run = literals_ < len - i ? literals_ : len - i;
+        if (run > LZ_WINDOW_SIZE - pos_)
+        {
+          run = LZ_WINDOW_SIZE - pos_;
+        }
+        std::memcpy(window_ + pos_, in + i, run);
+        pos_ += run;
+        literals_ -= run;
+        i += run;
+      }
+      else if (want_dist_)
+      {
+        dist_ = static_cast<size_t>(in[i++]) + 1;
+        want_dist_ = false;
+        if (dist_ > produced_ + (pos_ - flushed))
+        {
+          return ErrorCode::GENERAL_ERROR;
+        }
+      }
+      else
+      {
+        const uint8_t token = in[i++];
+        if (token < 0x80)
+        {
+          literals_ = static_cast<size_t>(token) + 1;
+        }
+        else
+        {
+          match_ = static_cast<size_t>(token & 0x7F) + LZ_MIN_MATCH;
+          want_dist_ = true;
+        }
+      }
+
+      if (pos_ == LZ_WINDOW_SIZE)
+      {
+        const ErrorCode err = flush(flushed, sink);
+        if (err != ErrorCode::OK)
+        {
+          return err;
+        }
+        pos_ = 0;
+        flushed = 0;
+      }
+    }
+
+    return flush(flushed, sink);
+  }
+
+ private:
+  template <typename Sink>
+  ErrorCode flush(size_t from, Sink& sink)
+  {
+    if (pos_ == from)
+    {
+      return ErrorCode::OK;
+    }
+    produced_ += pos_ - from;
+    return sink(static_cast<const uint8_t*>(window_ + from), pos_ - from);
+  }
+
+  uint8_t window_[LZ_WINDOW_SIZE];  ///< Last LZ_WINDOW_SIZE output bytes (ring)
+  size_t pos_ = 0;                  ///< Next write position in window_
+  size_t produced_ = 0;             ///< Output bytes handed to the sink so far
+  size_t literals_ = 0;             ///< Literal bytes still to copy
+  size_t match_ = 0;                ///< Match bytes still to produce
+  size_t dist_ = 0;                 ///< Distance of the current match
+  bool want_dist_ = false;          ///< Match token read, DIST byte pending
+};
+
+/**
+ * @brief Compress @p len bytes into the LzDecoder format
+ *
+ * Greedy encoder for hosts, tests and tools; not needed on the device.
+ *
+ * @param in  Uncompressed data
+ * @param len Number of bytes
+ * @param out Receives the compressed stream (replaced)
+ */
+void lz_compress(const uint8_t* in, size_t len, std::vector<uint8_t>& out);
+
+}  // namespace v4::link::internal
@@ -0,0 +1,166 @@
+/**
+ * @file profile.hpp
+ * @brief Internal per-word hit histogram for PROFILE_START/STOP/DUMP
+ *
+ * Hits are added from a timer interrupt (sampling) or a CALL hook (entry
+ * counting) while the main loop reads them, so each counter has a single
+ * writer and is updated with a plain atomic load and store, as in RxRing.
+ * With V4LINK_ENABLE_PROFILE=0 WordProfile keeps the same interface but
+ * does nothing.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "v4link/protocol.hpp"
+
+#ifndef V4LINK_ENABLE_PROFILE
+#define V4LINK_ENABLE_PROFILE 1
+#endif
+
+#ifndef V4LINK_PROFILE_WORDS
+#define V4LINK_PROFILE_WORDS 64
+#endif
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Word indices with their own counter; higher ones share OTHER
+ */
+constexpr size_t PROFILE_WORDS = V4LINK_PROFILE_WORDS;
+static_assert(PROFILE_WORDS > 0 && PROFILE_WORDS <= 0xFFFF, "WORD_IDX is 16-bit");
+
+#if V4LINK_ENABLE_PROFILE
+
+/**
+ * @brief Hit counters by word index
+ */
+class WordProfile
+{
+ public:
+  WordProfile() : hits_(), other_(0), idle_(0), active_(false), mode_(ProfileMode::SAMPLE)
+  {
+  }
+
+  /**
+   * @brief Zero the counters and start counting in @p mode
+   */
+  void start(ProfileMode mode)
+  {
+    active_.store(false, std::memory_order_relaxed);
+    clear();
+    mode_ = mode;
+    active_.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @brief Stop counting; the counters are kept for PROFILE_DUMP
+   */
+  void stop()
+  {
+    active_.store(false, std::memory_order_release);
+  }
+
+  /**
+   * @brief Zero the counters (e.g. once word indices are reused)
+   */
+  void clear()
+  {
+    for (auto& hits : hits_)
+    {
+      hits.store(0, std::memory_order_relaxed);
+    }
+    other_.store(0, std::memory_order_relaxed);
+    idle_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Count one hit of word @p wid (negative: no word running)
+   *
+   * Safe to call from one interrupt handler while the main loop reads.
+   */
+  void hit(int wid)
+  {
+    if (!active_.load(std::memory_order_acquire))
+    {
+      return;
+    }
+    std::atomic<uint32_t>& counter =
+        wid < 0 ? idle_ : (static_cast<size_t>(wid) < PROFILE_WORDS ? hits_[wid] : other_);
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  bool active() const
+  {
+    return active_.load(std::memory_order_relaxed);
+  }
+
+  ProfileMode mode() const
+  {
+    return mode_;
+  }
+
+  /**
+   * @brief Hits of word @p wid (wid < PROFILE_WORDS)
+   */
+  uint32_t hits(size_t wid) const
+  {
+    return hits_[wid].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Hits of words at or above PROFILE_WORDS
+   */
+  uint32_t other() const
+  {
+    return other_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Samples taken while no word was running
+   */
+  uint32_t idle() const
+  {
+    return idle_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint32_t> hits_[PROFILE_WORDS];  ///< Per word index
+  std::atomic<uint32_t> other_;                ///< Word indices beyond hits_
+  std::atomic<uint32_t> idle_;                 ///< Hits with no word
+  std::atomic<bool> active_;                   ///< Counting
+  ProfileMode mode_;                           ///< What a hit means
+};
+
+#else
+
+/**
+ * @brief Profiling compiled out: hits are dropped
+ */
+class WordProfile
+{
+ public:
+  void start(ProfileMode) {}
+  void stop() {}
+  void clear() {}
+  void hit(int) {}
+  static constexpr bool active()
+  {
+    return false;
+  }
+  static constexpr ProfileMode mode()
+  {
+    return ProfileMode::SAMPLE;
+  }
+};
+
+#endif
+
+}  // namespace v4::link::internal
@@ -14,6 +14,154 @@
 namespace v4::link::internal
 {
 
+/* ========================================================================= */
+/* Opcode table                                                              */
+/* ========================================================================= */
+
+/**
+ * @brief Opcode flags (OpcodeInfo::flags)
+ */
+enum OpcodeFlag : uint8_t
+{
+  OPCODE_KNOWN = 0x01,   // Opcode is defined in opcodes.def
+  OPCODE_CALL = 0x02,    // Operand is a u16 word index (relocated)
+  OPCODE_BRANCH = 0x04,  // Operand is a relative jump offset
+};
+
+/**
+ * @brief Encoding of one opcode
+ */
+struct OpcodeInfo
+{
+  uint8_t length;  ///< Instruction length including opcode (0: unknown opcode)
+  uint8_t flags;   ///< OpcodeFlag bits
+};
+
+struct OpcodeTable
+{
+  OpcodeInfo entries[256];
+};
+
+constexpr OpcodeTable make_opcode_table()
+{
+  OpcodeTable table{};
+#define OP(value, operand_bytes, flags) \
+  table.entries[value] = {1 + (operand_bytes), OPCODE_KNOWN | (flags)};
+#include "v4link/internal/opcodes.def"
+#undef OP
+  return table;
+}
+
+/**
+ * @brief Instruction length and flags for every opcode, built at compile time
+ */
+inline constexpr OpcodeTable kOpcodeTable = make_opcode_table();
+
+static_assert(kOpcodeTable.entries[0x50].length == 3, "CALL takes a u16 word index");
+static_assert(kOpcodeTable.entries[0x60].length == 17, "SYS takes a 16-byte operand");
+
+/* ========================================================================= */
+/* Relocation                                                                */
+/* ========================================================================= */
+
+/**
+ * @brief First .v4b minor version carrying relocation lists
+ *
+ * From v0.3 every code block (main code and each word) is followed by
+ * [RELOC_COUNT (u16)][OFFSET (u16)]*RELOC_COUNT, listing the offsets of
+ * CALL operands within that block, so loading does not decode the code.
+ */
+constexpr uint8_t V4B_MINOR_RELOC = 3;
+
+/**
+ * @brief Visit the operand of every CALL instruction in @p code
+ *
+ * @param code Pointer to bytecode buffer
+ * @param len Length of bytecode in bytes
+ * @param on_call Called with a pointer to each u16 CALL operand
+ * @return false if an unknown opcode or truncated instruction stopped the scan
+ */
+template <typename Fn>
+bool for_each_call(uint8_t* code, size_t len, Fn&& on_call)
+{
+  size_t pc = 0;
+  while (pc < len)
+  {
+    const OpcodeInfo info = kOpcodeTable.entries[code[pc]];
+
+    // Most instructions have no operand; taking this as a predicted branch
+    // keeps the next table lookup off the load-to-load dependency chain
+    if (info.length == 1)
+    {
+      ++pc;
+      continue;
+    }
+
+    // Stop rather than guess: skipping an unknown opcode as one byte could
+    // misread later operands as opcodes and corrupt them
+    if (info.length == 0 || info.length > len - pc)
+    {
+      return false;
+    }
+
+    if (info.flags & OPCODE_CALL)
+    {
+      if (!on_call(code + pc + 1))
+      {
+        return false;
+      }
+    }
+
+    pc += info.length;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Add @p offset to the little-endian u16 word index at @p operand
+ */
+inline void relocate_operand(uint8_t* operand, int offset)
+{
+  const uint16_t idx = static_cast<uint16_t>((operand[0] | (operand[1] << 8)) + offset);
+  operand[0] = idx & 0xFF;
+  operand[1] = (idx >> 8) & 0xFF;
+}
+
+/**
+ * @brief Replace the little-endian u16 word index at @p operand with
+ *        resolve(index)
+ */
+template <typename Fn>
+void relink_operand(uint8_t* operand, Fn&& resolve)
+{
+  const uint16_t idx = resolve(static_cast<uint16_t>(operand[0] | (operand[1] << 8)));
+  operand[0] = idx & 0xFF;
+  operand[1] = (idx >> 8) & 0xFF;
+}
+
+/**
+ * @brief Map every CALL operand in @p code through @p resolve
+ *
+ * Used when file-relative word indices do not map to VM indices by a
+ * single offset, e.g. when some words of an image are already resident.
+ *
+ * @param code Pointer to bytecode buffer (will be modified in-place)
+ * @param len Length of bytecode in bytes
+ * @param resolve Called as resolve(uint16_t file_index), returns the VM index
+ * @return false if an unknown opcode or truncated instruction stopped the scan
+ */
+template <typename Fn>
+bool relink_calls(uint8_t* code, size_t len, Fn&& resolve)
+{
+  return for_each_call(code, len,
+                       [&resolve](uint8_t* operand)
+                       {
+                         relink_operand(operand, resolve);
+                         return true;
+                       });
+}
+
 /**
  * @brief Relocate CALL instructions in bytecode by adding offset to word indices
  *
@@ -24,11 +172,81 @@ namespace v4::link::internal
  * @param code Pointer to bytecode buffer (will be modified in-place)
  * @param len Length of bytecode in bytes
  * @param offset Value to add to each CALL instruction's word index
+ * @return false if an unknown opcode or truncated instruction stopped the
+ *         scan (CALLs after that point are not relocated)
  *
  * @note This function modifies the bytecode in-place
  * @note If offset is 0, no changes are made
- * @note Handles all V4 opcode types to correctly skip operands
+ * @note Instruction lengths come from kOpcodeTable
+ */
+bool relocate_calls(uint8_t* code, size_t len, int offset);
+
+/**
+ * @brief Check that @p at is the offset of a complete CALL operand in @p code
  */
-void relocate_calls(uint8_t* code, size_t len, int offset);
+inline bool is_call_operand(const uint8_t* code, size_t len, size_t at)
+{
+  return at > 0 && at + 2 <= len && (kOpcodeTable.entries[code[at - 1]].flags & OPCODE_CALL);
+}
+
+/**
+ * @brief Relocate one CALL operand listed in a relocation table
+ *
+ * @param code Pointer to bytecode buffer (will be modified in-place)
+ * @param len Length of bytecode in bytes
+ * @param at Offset of the CALL operand within @p code
+ * @param offset Value to add to the word index
+ * @return false if @p at does not point at a complete CALL operand
+ */
+inline bool relocate_fixup(uint8_t* code, size_t len, size_t at, int offset)
+{
+  if (!is_call_operand(code, len, at))
+  {
+    return false;
+  }
+
+  relocate_operand(code + at, offset);
+  return true;
+}
+
+/**
+ * @brief Relocate CALL operands listed in a .v4b relocation table
+ *
+ * @param code Pointer to bytecode buffer (will be modified in-place)
+ * @param len Length of bytecode in bytes
+ * @param fixups Little-endian u16 operand offsets
+ * @param count Number of entries in @p fixups
+ * @param offset Value to add to each listed word index
+ * @return false if an entry does not point at a CALL operand
+ */
+bool relocate_fixups(uint8_t* code, size_t len, const uint8_t* fixups, size_t count,
+                     int offset);
+
+/**
+ * @brief Map the CALL operands listed in a .v4b relocation table through
+ *        @p resolve
+ *
+ * @param code Pointer to bytecode buffer (will be modified in-place)
+ * @param len Length of bytecode in bytes
+ * @param fixups Little-endian u16 operand offsets
+ * @param count Number of entries in @p fixups
+ * @param resolve Called as resolve(uint16_t file_index), returns the VM index
+ * @return false if an entry does not point at a CALL operand
+ */
+template <typename Fn>
+bool relink_fixups(uint8_t* code, size_t len, const uint8_t* fixups, size_t count,
+                   Fn&& resolve)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t at = fixups[2 * i] | (fixups[2 * i + 1] << 8);
+    if (!is_call_operand(code, len, at))
+    {
+      return false;
+    }
+    relink_operand(code + at, resolve);
+  }
+  return true;
+}
 
 }  // namespace v4::link::internal
@@ -0,0 +1,158 @@
+/**
+ * @file rx_ring.hpp
+ * @brief Internal single-producer/single-consumer receive ring
+ *
+ * The producer (UART interrupt or DMA callback) and the consumer (main
+ * loop) each own one index; the other side only reads it. No locks or
+ * interrupt masking are needed as long as there is exactly one of each.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Lock-free byte FIFO between an ISR and the main loop
+ *
+ * Indices run freely and are masked on access, so all @p capacity slots
+ * are usable and full and empty are told apart without a spare slot.
+ * Storage is allocated once at construction.
+ */
+class RxRing
+{
+ public:
+  /**
+   * @brief Construct ring of at least @p capacity bytes
+   *
+   * @param capacity Requested size, rounded up to a power of 2 (0: no ring)
+   */
+  explicit RxRing(size_t capacity);
+
+  /**
+   * @brief Append one byte (producer side)
+   *
+   * @return false if the ring is full (the byte is dropped and counted)
+   */
+  bool push(uint8_t byte)
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == data_.size())
+    {
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+      return false;
+    }
+    data_[head & mask_] = byte;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Append a block of bytes (producer side)
+   *
+   * Copies with at most two memcpy calls and publishes them at once.
+   *
+   * @return Number of bytes queued; the rest are dropped and counted
+   */
+  size_t push(const uint8_t* data, size_t len)
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t space = data_.size() - (head - tail_.load(std::memory_order_acquire));
+    const size_t n = len < space ? len : space;
+    if (n > 0)
+    {
+      const size_t at = head & mask_;
+      const size_t first = n < data_.size() - at ? n : data_.size() - at;
+      std::memcpy(data_.data() + at, data, first);
+      std::memcpy(data_.data(), data + first, n - first);
+      head_.store(head + n, std::memory_order_release);
+    }
+    if (n < len)
+    {
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + (len - n),
+                      std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  /**
+   * @brief Oldest contiguous run of received bytes (consumer side)
+   *
+   * @param len Receives the run length (0 when empty)
+   * @return Pointer to the run, valid until consume()
+   */
+  const uint8_t* peek(size_t& len) const
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t avail = head_.load(std::memory_order_acquire) - tail;
+    const size_t to_end = data_.size() - (tail & mask_);
+    len = avail < to_end ? avail : to_end;
+    return data_.data() + (tail & mask_);
+  }
+
+  /**
+   * @brief Release @p len bytes returned by peek() (consumer side)
+   */
+  void consume(size_t len)
+  {
+    tail_.store(tail_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+
+  /**
+   * @brief Bytes queued and not yet consumed (consumer side)
+   */
+  size_t available() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Ring size in bytes (0: no ring)
+   */
+  size_t capacity() const
+  {
+    return data_.size();
+  }
+
+  /**
+   * @brief Bytes dropped because the ring was full
+   */
+  size_t overruns() const
+  {
+    return overruns_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::vector<uint8_t> data_;     ///< Storage, a power of 2 in size
+  size_t mask_;                   ///< data_.size() - 1
+  std::atomic<size_t> head_;      ///< Total bytes pushed (written by producer)
+  std::atomic<size_t> tail_;      ///< Total bytes consumed (written by consumer)
+  std::atomic<size_t> overruns_;  ///< Bytes dropped (written by producer)
+};
+
+inline RxRing::RxRing(size_t capacity) : data_(), mask_(0), head_(0), tail_(0), overruns_(0)
+{
+  if (capacity == 0)
+  {
+    return;
+  }
+  size_t size = 1;
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+  data_.resize(size);
+  mask_ = size - 1;
+}
+
+}  // namespace v4::link::internal
@@ -0,0 +1,247 @@
+/**
+ * @file stats.hpp
+ * @brief Internal link statistics reported by QUERY_STATS
+ *
+ * Counters are updated on the receive, dispatch and transmit paths. With
+ * V4LINK_ENABLE_STATS=0 LinkStats keeps the same interface but every
+ * update is an empty inline function, so the hooks compile away.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "v4link/protocol.hpp"
+
+#ifndef V4LINK_ENABLE_STATS
+#define V4LINK_ENABLE_STATS 1
+#endif
+
+#ifndef V4LINK_STATS_COMMAND_SLOTS
+#define V4LINK_STATS_COMMAND_SLOTS 24
+#endif
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Number of ErrorCode values (entries in errors.def)
+ */
+constexpr size_t ERROR_CODE_COUNT =
+#define ERR(name, val, msg) 1 +
+#include "v4link/errors.def"
+#undef ERR
+    0;
+
+/**
+ * @brief Distinct command codes tracked; later ones count as untracked
+ */
+constexpr size_t STATS_COMMAND_SLOTS = V4LINK_STATS_COMMAND_SLOTS;
+static_assert(STATS_COMMAND_SLOTS <= 0xFF, "CMD_COUNT is one byte");
+
+/**
+ * @brief Per-command counters
+ *
+ * Times are in the units of the timestamp callback (see
+ * Link::set_timestamp()) and stay 0 without one.
+ */
+struct CommandStats
+{
+  uint64_t total_time;  ///< Sum of handler times
+  uint32_t frames;      ///< Frames handled (BATCH sub-commands included)
+  uint32_t max_time;    ///< Longest handler time
+};
+
+#if V4LINK_ENABLE_STATS
+
+/**
+ * @brief Link counters since construction or the last clear()
+ */
+class LinkStats
+{
+ public:
+  LinkStats()
+  {
+    clear(0, 0);
+  }
+
+  /**
+   * @brief Reset every counter to zero
+   *
+   * RX byte and ring overrun totals are kept by Link; their values now
+   * become the base that rx_bytes() and rx_overruns() count from.
+   */
+  void clear(size_t rx_total, size_t overrun_total)
+  {
+    std::memset(this, 0, sizeof(*this));
+    rx_base_ = static_cast<uint32_t>(rx_total);
+    overrun_base_ = static_cast<uint32_t>(overrun_total);
+  }
+
+  /**
+   * @brief Count @p n received bytes discarded while waiting for STX
+   */
+  void add_dropped(size_t n)
+  {
+    rx_dropped_ += static_cast<uint32_t>(n);
+  }
+
+  /**
+   * @brief Count a frame rejected for a CRC mismatch
+   */
+  void add_crc_error()
+  {
+    ++crc_errors_;
+  }
+
+  /**
+   * @brief Count a response with @p code (BATCH results included)
+   */
+  void add_response(ErrorCode code)
+  {
+    const size_t i = static_cast<size_t>(code);
+    if (i < ERROR_CODE_COUNT)
+    {
+      ++errors_[i];
+    }
+  }
+
+  /**
+   * @brief Count @p n bytes handed to the UART callback
+   */
+  void add_tx(size_t n)
+  {
+    tx_bytes_ += static_cast<uint32_t>(n);
+  }
+
+  /**
+   * @brief Count one handled @p cmd that took @p time
+   */
+  void add_command(uint8_t cmd, uint32_t time)
+  {
+    const void* hit = std::memchr(codes_, cmd, command_count_);
+    size_t i;
+    if (hit != nullptr)
+    {
+      i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - codes_);
+    }
+    else if (command_count_ < STATS_COMMAND_SLOTS)
+    {
+      i = command_count_++;
+      codes_[i] = cmd;
+    }
+    else
+    {
+      ++untracked_;
+      return;
+    }
+
+    CommandStats& c = commands_[i];
+    ++c.frames;
+    c.total_time += time;
+    if (time > c.max_time)
+    {
+      c.max_time = time;
+    }
+  }
+
+  uint32_t rx_bytes(size_t rx_total) const
+  {
+    return static_cast<uint32_t>(rx_total) - rx_base_;
+  }
+
+  uint32_t rx_overruns(size_t overrun_total) const
+  {
+    return static_cast<uint32_t>(overrun_total) - overrun_base_;
+  }
+
+  uint32_t rx_dropped() const
+  {
+    return rx_dropped_;
+  }
+
+  uint32_t crc_errors() const
+  {
+    return crc_errors_;
+  }
+
+  uint32_t tx_bytes() const
+  {
+    return tx_bytes_;
+  }
+
+  uint32_t untracked() const
+  {
+    return untracked_;
+  }
+
+  /**
+   * @brief Responses sent with error code @p code
+   */
+  uint32_t errors(ErrorCode code) const
+  {
+    const size_t i = static_cast<size_t>(code);
+    return i < ERROR_CODE_COUNT ? errors_[i] : 0;
+  }
+
+  /**
+   * @brief Number of command codes seen, in order of first appearance
+   */
+  size_t command_count() const
+  {
+    return command_count_;
+  }
+
+  /**
+   * @brief Command code of slot @p i (i < command_count())
+   */
+  uint8_t command_code(size_t i) const
+  {
+    return codes_[i];
+  }
+
+  /**
+   * @brief Counters of slot @p i (i < command_count())
+   */
+  const CommandStats& command(size_t i) const
+  {
+    return commands_[i];
+  }
+
+ private:
+  CommandStats commands_[STATS_COMMAND_SLOTS];  ///< Per command, by slot
+  uint32_t errors_[ERROR_CODE_COUNT];           ///< Responses per ErrorCode
+  uint32_t rx_base_;                            ///< Link RX byte total at clear()
+  uint32_t overrun_base_;                       ///< Link ring overrun total at clear()
+  uint32_t rx_dropped_;                         ///< Bytes skipped in WAIT_STX
+  uint32_t crc_errors_;                         ///< Frames with a bad CRC
+  uint32_t tx_bytes_;                           ///< Bytes written to the UART
+  uint32_t untracked_;                          ///< Frames of commands beyond the slots
+  uint8_t codes_[STATS_COMMAND_SLOTS];          ///< Command code per slot
+  uint8_t command_count_;                       ///< Slots in use
+};
+
+#else
+
+/**
+ * @brief Statistics compiled out: updates do nothing
+ */
+class LinkStats
+{
+ public:
+  void clear(size_t, size_t) {}
+  void add_dropped(size_t) {}
+  void add_crc_error() {}
+  void add_response(ErrorCode) {}
+  void add_tx(size_t) {}
+  void add_command(uint8_t, uint32_t) {}
+};
+
+#endif
+
+}  // namespace v4::link::internal
@@ -0,0 +1,137 @@
+/**
+ * @file trace.hpp
+ * @brief Internal event trace ring drained by DUMP_TRACE
+ *
+ * Records are [EVENT][DELTA][ARG], DELTA and ARG as unsigned LEB128, so a
+ * typical event takes 3 bytes. The ring lives in a caller-provided buffer;
+ * without one every record() is a single null check. With
+ * V4LINK_ENABLE_TRACE=0 TraceRing keeps the same interface but does
+ * nothing, so the hooks compile away.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "v4link/protocol.hpp"
+
+#ifndef V4LINK_ENABLE_TRACE
+#define V4LINK_ENABLE_TRACE 1
+#endif
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief Largest encoded record: EVENT plus two 5-byte LEB128 values
+ */
+constexpr size_t TRACE_RECORD_MAX = 1 + 5 + 5;
+
+#if V4LINK_ENABLE_TRACE
+
+/**
+ * @brief Byte ring of delta-encoded trace records
+ *
+ * When full, the oldest records are overwritten; their deltas are folded
+ * into the base time so the remaining timeline stays exact.
+ */
+class TraceRing
+{
+ public:
+  TraceRing()
+      : data_(nullptr), size_(0), tail_(0), used_(0), last_time_(0), base_time_(0), lost_(0)
+  {
+  }
+
+  /**
+   * @brief Use @p buffer for the ring, discarding any records
+   *
+   * @param buffer Storage owned by the caller (nullptr: tracing off)
+   * @param size   Size of @p buffer in bytes (at least TRACE_RECORD_MAX)
+   */
+  void set_buffer(uint8_t* buffer, size_t size);
+
+  /**
+   * @brief Whether a buffer is registered
+   */
+  bool enabled() const
+  {
+    return data_ != nullptr;
+  }
+
+  /**
+   * @brief Append one record at time @p now
+   */
+  void record(TraceEvent event, uint32_t now, uint32_t arg)
+  {
+    if (data_ != nullptr)
+    {
+      write(event, now, arg);
+    }
+  }
+
+  /**
+   * @brief Move the oldest whole records to @p out
+   *
+   * @param out       Destination for the records
+   * @param capacity  Size of @p out in bytes
+   * @param base_time Set to the time the first record's delta starts from
+   * @param lost      Set to the records overwritten since the last drain
+   * @return Bytes written to @p out
+   */
+  size_t drain(uint8_t* out, size_t capacity, uint32_t* base_time, uint32_t* lost);
+
+  /**
+   * @brief Bytes of records held
+   */
+  size_t used() const
+  {
+    return used_;
+  }
+
+ private:
+  void write(TraceEvent event, uint32_t now, uint32_t arg);
+
+  /**
+   * @brief Length and DELTA of the record at the tail
+   */
+  size_t peek(uint32_t* delta) const;
+
+  uint8_t at(size_t offset) const
+  {
+    const size_t i = tail_ + offset;
+    return data_[i < size_ ? i : i - size_];
+  }
+
+  uint8_t* data_;       ///< Caller-owned storage (nullptr: tracing off)
+  size_t size_;         ///< Size of data_
+  size_t tail_;         ///< Offset of the oldest record
+  size_t used_;         ///< Bytes of records held
+  uint32_t last_time_;  ///< Time of the newest record
+  uint32_t base_time_;  ///< Time the oldest record's delta starts from
+  uint32_t lost_;       ///< Records overwritten since the last drain
+};
+
+#else
+
+/**
+ * @brief Tracing compiled out: records are dropped
+ */
+class TraceRing
+{
+ public:
+  void set_buffer(uint8_t*, size_t) {}
+  static constexpr bool enabled()
+  {
+    return false;
+  }
+  void record(TraceEvent, uint32_t, uint32_t) {}
+};
+
+#endif
+
+}  // namespace v4::link::internal
@@ -0,0 +1,71 @@
+/**
+ * @file word_hash.hpp
+ * @brief Internal content hashes of .v4b words for the resident word cache
+ *
+ * Each word is identified by a chain hash: FNV-1a over the word table
+ * entry [NAME_LEN][NAME][CODE_LEN (4 bytes)][CODE], continued from the
+ * hash of the entry before it (the first entry starts from
+ * WORD_HASH_INIT). Relocation lists are not hashed, so v0.2 and v0.3
+ * images of the same words agree.
+ *
+ * CALL operands in a .v4b are file-relative. The chain covers every
+ * earlier word, so two words with the same hash that only call back (or
+ * themselves) behave the same once relocated, and a resident word can
+ * stand in for a new copy. Reuse applies to an image that starts with the
+ * same words in the same order as the one that uploaded them, which is how
+ * host tools send a shared vocabulary.
+ *
+ * A CALL to a later entry is resolved by its distance from the calling
+ * word, since chunked uploads link each word as it arrives. Loads refuse
+ * a forward CALL that reaches past a resident entry (VM_ERROR).
+ *
+ * From .v4b v0.4 an entry may be a reference [V4B_WORD_REF][HASH (4 bytes)]
+ * to a resident word instead of its code; the chain continues from HASH.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace v4::link::internal
+{
+
+/**
+ * @brief First .v4b minor version that may carry word references
+ */
+constexpr uint8_t V4B_MINOR_WORD_REF = 4;
+
+/**
+ * @brief NAME_LEN value marking a word reference entry (v0.4+)
+ */
+constexpr uint8_t V4B_WORD_REF = 0xFF;
+
+/**
+ * @brief Size of a word reference entry: [V4B_WORD_REF][HASH (4 bytes)]
+ */
+constexpr size_t V4B_WORD_REF_SIZE = 5;
+
+/**
+ * @brief Chain hash before the first word of an image (FNV-1a offset basis)
+ */
+constexpr uint32_t WORD_HASH_INIT = 0x811C9DC5u;
+
+/**
+ * @brief Continue a chain hash over @p len bytes of a word table entry
+ *
+ * Entries may be hashed in pieces; the result only depends on the bytes.
+ */
+inline uint32_t word_hash_update(uint32_t hash, const uint8_t* data, size_t len)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash = (hash ^ data[i]) * 0x01000193u;  // FNV-1a prime
+  }
+  return hash;
+}
+
+}  // namespace v4::link::internal
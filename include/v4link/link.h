@@ -30,20 +30,97 @@ extern "C"
   /** @brief Maximum payload size */
 #define V4LINK_MAX_PAYLOAD_SIZE 512
 
+  /** @brief Default persistent bytecode arena size */
+#define V4LINK_DEFAULT_ARENA_SIZE 4096
+
+  /** @brief Default number of words the word cache and name index hold */
+#define V4LINK_DEFAULT_MAX_WORDS 64
+
+  /** @brief Protocol version reported in the PING capability block */
+#define V4LINK_PROTOCOL_VERSION 1
+
+  /** @brief PING flag requesting the capability block */
+#define V4LINK_PING_FLAG_CAPABILITIES 0x01
+
+  /** @brief PING flag switching to COBS framing */
+#define V4LINK_PING_FLAG_COBS 0x02
+
+  /** @brief Capability bits (PING capability block CAPS field) */
+#define V4LINK_CAP_WINDOW 0x0001
+#define V4LINK_CAP_COMPRESSION 0x0002
+#define V4LINK_CAP_BATCH 0x0004
+#define V4LINK_CAP_WORD_CACHE 0x0008
+#define V4LINK_CAP_IMAGE 0x0010
+#define V4LINK_CAP_ASYNC_EXEC 0x0020
+#define V4LINK_CAP_STATS 0x0040
+#define V4LINK_CAP_TRACE 0x0080
+#define V4LINK_CAP_PROFILE 0x0100
+#define V4LINK_CAP_COBS 0x0200
+#define V4LINK_CAP_CRC16 0x0400
+#define V4LINK_CAP_CRC32C 0x0800
+
+  /** @brief Frame check types (PING CRC byte, capability block CRC field) */
+#define V4LINK_CRC_CRC8 0x01
+#define V4LINK_CRC_CRC16_CCITT 0x02
+#define V4LINK_CRC_CRC32C 0x03
+
+  /** @brief QUERY_STATS flag resetting the counters after the report */
+#define V4LINK_STATS_FLAG_RESET 0x01
+
+  /** @brief DUMP_TRACE response flag: records remain on the device */
+#define V4LINK_TRACE_FLAG_MORE 0x01
+
+  /** @brief PROFILE_START modes */
+#define V4LINK_PROFILE_SAMPLE 0x00
+#define V4LINK_PROFILE_ENTRY 0x01
+
+  /** @brief Command codes tracked by QUERY_STATS (build-time setting) */
+#ifndef V4LINK_STATS_COMMAND_SLOTS
+#define V4LINK_STATS_COMMAND_SLOTS 24
+#endif
+
   /* ========================================================================= */
   /* Command codes                                                             */
   /* ========================================================================= */
 
   typedef enum
   {
-    V4LINK_CMD_EXEC = 0x10,         /**< Execute bytecode */
-    V4LINK_CMD_PING = 0x20,         /**< Ping command */
-    V4LINK_CMD_QUERY_STACK = 0x30,  /**< Query stack state */
-    V4LINK_CMD_QUERY_MEMORY = 0x40, /**< Query memory dump */
-    V4LINK_CMD_QUERY_WORD = 0x50,   /**< Query word information */
-    V4LINK_CMD_RESET = 0xFF,        /**< Reset VM */
+    V4LINK_CMD_EXEC = 0x10,               /**< Execute bytecode */
+    V4LINK_CMD_BEGIN_UPLOAD = 0x11,       /**< Begin chunked .v4b upload */
+    V4LINK_CMD_CHUNK = 0x12,              /**< Upload chunk */
+    V4LINK_CMD_COMMIT = 0x13,             /**< Commit chunked upload */
+    V4LINK_CMD_SAVE_IMAGE = 0x14,         /**< Save words to persistent storage */
+    V4LINK_CMD_RUN_STATUS = 0x15,         /**< Query the state of the last run */
+    V4LINK_CMD_ABORT = 0x16,              /**< Cancel the current run */
+    V4LINK_CMD_PING = 0x20,               /**< Ping command */
+    V4LINK_CMD_QUERY_STACK = 0x30,        /**< Query stack state */
+    V4LINK_CMD_QUERY_STATS = 0x31,        /**< Query link statistics */
+    V4LINK_CMD_DUMP_TRACE = 0x32,         /**< Drain the event trace */
+    V4LINK_CMD_PROFILE_START = 0x33,      /**< Start the word profile */
+    V4LINK_CMD_PROFILE_STOP = 0x34,       /**< Stop the word profile */
+    V4LINK_CMD_PROFILE_DUMP = 0x35,       /**< Report the word profile */
+    V4LINK_CMD_QUERY_MEMORY = 0x40,       /**< Query memory dump */
+    V4LINK_CMD_READ_MEM_BLOCK = 0x41,     /**< Read a block of VM memory */
+    V4LINK_CMD_WRITE_MEM_BLOCK = 0x42,    /**< Write a block of VM memory */
+    V4LINK_CMD_WATCH_MEMORY = 0x43,       /**< Subscribe to VM memory changes */
+    V4LINK_CMD_QUERY_WORD = 0x50,         /**< Query word information */
+    V4LINK_CMD_HAVE_WORDS = 0x51,         /**< Look up resident words by hash */
+    V4LINK_CMD_QUERY_WORD_BY_NAME = 0x52, /**< Look up a word index by name */
+    V4LINK_CMD_REPLACE_WORD = 0x53,       /**< Swap the code behind a word index */
+    V4LINK_CMD_FORGET_FROM = 0x54,        /**< Forget a word and all later words */
+    V4LINK_CMD_BATCH = 0x60,              /**< Run several commands in one frame */
+    V4LINK_CMD_RESET = 0xFF,              /**< Reset VM */
   } v4link_command_t;
 
+  /* ========================================================================= */
+  /* Event codes                                                               */
+  /* ========================================================================= */
+
+  typedef enum
+  {
+    V4LINK_EVENT_MEMORY_DELTA = 0x80, /**< Changed bytes of a watched region */
+  } v4link_event_t;
+
   /* ========================================================================= */
   /* Error codes                                                               */
   /* ========================================================================= */
@@ -78,6 +155,105 @@ extern "C"
    */
   typedef void (*v4link_uart_write_fn)(void* user, const uint8_t* data, size_t len);
 
+  /** @brief Scatter-gather buffer descriptor */
+  typedef struct
+  {
+    const uint8_t* data; /**< Start of buffer */
+    size_t len;          /**< Number of bytes */
+  } v4link_iovec_t;
+
+  /**
+   * @brief Vectored UART write callback function type
+   *
+   * Receives a response as separate header, payload and CRC buffers,
+   * valid only for the duration of the call.
+   *
+   * @param user   User-defined context pointer
+   * @param iov    Buffer descriptors, in transmission order
+   * @param iovcnt Number of descriptors
+   */
+  typedef void (*v4link_uart_writev_fn)(void* user, const v4link_iovec_t* iov,
+                                        size_t iovcnt);
+
+  /**
+   * @brief Storage write callback function type (SAVE_IMAGE)
+   *
+   * Called first with @p data == NULL and @p len set to the image size to
+   * prepare (erase) the region, then with the image bytes at increasing
+   * offsets; the header at offset 0 is written last.
+   *
+   * @param user   User-defined context pointer
+   * @param offset Byte offset within the storage region
+   * @param data   Bytes to write, or NULL to prepare the region
+   * @param len    Number of bytes to write (or image size)
+   * @return Non-zero on success
+   */
+  typedef int (*v4link_storage_write_fn)(void* user, size_t offset, const uint8_t* data,
+                                         size_t len);
+
+  /** @brief Slice operations passed to v4link_exec_slice_fn */
+#define V4LINK_SLICE_START 0
+#define V4LINK_SLICE_RESUME 1
+#define V4LINK_SLICE_ABORT 2
+
+  /** @brief v4link_exec_slice_fn return value: call again with V4LINK_SLICE_RESUME */
+#define V4LINK_SLICE_YIELD 1
+
+  /**
+   * @brief Bounded VM execution callback function type (async EXEC)
+   *
+   * @param user   User-defined context pointer
+   * @param vm     VM instance
+   * @param entry  Main code word being run
+   * @param op     V4LINK_SLICE_START, V4LINK_SLICE_RESUME or V4LINK_SLICE_ABORT
+   * @param budget Slice budget given to v4link_set_exec_slice()
+   * @return V4 error code (0 when the word returned), or V4LINK_SLICE_YIELD
+   */
+  typedef int (*v4link_exec_slice_fn)(void* user, Vm* vm, Word* entry, int op,
+                                      uint32_t budget);
+
+  /**
+   * @brief Timestamp callback function type (QUERY_STATS handler times, trace)
+   *
+   * @param user User-defined context pointer
+   * @return Free-running counter (cycles, microseconds, ...)
+   */
+  typedef uint32_t (*v4link_timestamp_fn)(void* user);
+
+  /** @brief Number of error codes counted by QUERY_STATS */
+  enum
+  {
+    V4LINK_STATS_ERROR_CODES =
+#define ERR(name, val, msg) 1 +
+#include "v4link/errors.def"
+#undef ERR
+        0
+  };
+
+  /** @brief Counters of one command code */
+  typedef struct
+  {
+    uint8_t cmd;         /**< Command code */
+    uint32_t frames;     /**< Frames handled */
+    uint64_t total_time; /**< Sum of handler times, in timestamp units */
+    uint32_t max_time;   /**< Longest handler time */
+  } v4link_command_stats_t;
+
+  /** @brief Link statistics, as reported by QUERY_STATS */
+  typedef struct
+  {
+    uint32_t rx_bytes;    /**< Bytes received */
+    uint32_t tx_bytes;    /**< Bytes sent */
+    uint32_t rx_dropped;  /**< Bytes skipped while waiting for STX */
+    uint32_t crc_errors;  /**< Frames rejected for a bad CRC */
+    uint32_t rx_overruns; /**< Bytes lost to a full receive ring */
+    uint32_t arena_peak;  /**< Highest bytecode arena usage */
+    uint32_t untracked;   /**< Frames of commands beyond the tracked slots */
+    uint32_t responses[V4LINK_STATS_ERROR_CODES]; /**< Responses per v4link_error_t */
+    size_t command_count;                         /**< Entries used in commands */
+    v4link_command_stats_t commands[V4LINK_STATS_COMMAND_SLOTS]; /**< By first use */
+  } v4link_stats_t;
+
   /* ========================================================================= */
   /* Lifecycle functions                                                       */
   /* ========================================================================= */
@@ -88,11 +264,19 @@ extern "C"
    * @param vm           Pointer to initialized V4 VM instance
    * @param uart_write   UART write callback function
    * @param user         User context pointer (passed to uart_write)
-   * @param buffer_size  Maximum bytecode buffer size (default: 512 bytes)
+   * @param buffer_size  Maximum bytecode buffer size (0: 512 bytes)
+   * @param arena        Caller-provided bytecode arena region, or NULL to
+   *                     allocate @p arena_size bytes during creation
+   * @param arena_size   Bytecode arena size (0: V4LINK_DEFAULT_ARENA_SIZE,
+   *                     only allowed when @p arena is NULL)
+   * @param rx_ring_size Interrupt receive ring size for v4link_isr_push()
+   *                     (0: no ring)
+   * @param max_words    Words tracked until reset (0: V4LINK_DEFAULT_MAX_WORDS)
    * @return Pointer to Link instance, or NULL on allocation failure
    */
   V4Link* v4link_create(Vm* vm, v4link_uart_write_fn uart_write, void* user,
-                        size_t buffer_size);
+                        size_t buffer_size, uint8_t* arena, size_t arena_size,
+                        size_t rx_ring_size, size_t max_words);
 
   /**
    * @brief Destroy Link instance and free resources
@@ -116,16 +300,187 @@ extern "C"
    */
   void v4link_feed_byte(V4Link* link, uint8_t byte);
 
+  /**
+   * @brief Process a block of received bytes
+   *
+   * Equivalent to calling v4link_feed_byte() for each byte, but faster
+   * for DMA or FIFO drivers that deliver several bytes at once.
+   *
+   * @param link Link instance
+   * @param data Received bytes
+   * @param len  Number of bytes
+   */
+  void v4link_feed(V4Link* link, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Advance the receive timeout clock
+   *
+   * Drops a partially received frame (sending an INVALID_FRAME NAK) when
+   * no byte arrived for the timeout set with v4link_set_rx_timeout().
+   *
+   * @param link   Link instance
+   * @param now_us Free-running time in microseconds
+   */
+  void v4link_tick(V4Link* link, uint32_t now_us);
+
+  /**
+   * @brief Set the inter-byte receive timeout used by v4link_tick()
+   *
+   * @param link       Link instance
+   * @param timeout_us Timeout in microseconds (0 disables, the default)
+   */
+  void v4link_set_rx_timeout(V4Link* link, uint32_t timeout_us);
+
+  /**
+   * @brief Queue one received byte from an interrupt or DMA callback
+   *
+   * Lock-free; safe to call from one interrupt context while the main
+   * loop runs v4link_poll(). See Link::isr_push().
+   *
+   * @param link Link instance
+   * @param byte Received byte
+   * @return Non-zero if queued, 0 if the ring was full (byte dropped)
+   */
+  int v4link_isr_push(V4Link* link, uint8_t byte);
+
+  /**
+   * @brief Process the bytes queued by v4link_isr_push()
+   *
+   * Call from the main loop. See Link::poll().
+   *
+   * @param link Link instance
+   * @return Number of bytes processed
+   */
+  size_t v4link_poll(V4Link* link);
+
+  /**
+   * @brief Enable or disable async EXEC
+   *
+   * EXEC and COMMIT then reply before running, and v4link_poll() advances
+   * the run. See Link::set_async_exec().
+   *
+   * @param link   Link instance
+   * @param enable Non-zero to enable
+   */
+  void v4link_set_async_exec(V4Link* link, int enable);
+
+  /**
+   * @brief Install the bounded execution callback used by async EXEC
+   *
+   * @param link       Link instance
+   * @param exec_slice Slice callback (NULL: each run is one vm_exec() call)
+   * @param budget     Budget passed to every slice
+   */
+  void v4link_set_exec_slice(V4Link* link, v4link_exec_slice_fn exec_slice, uint32_t budget);
+
   /**
    * @brief Reset VM to initial state
    *
-   * Calls vm_reset() to clear stacks and dictionary.
-   * Does not reset the frame reception state machine.
+   * Calls vm_reset() to clear stacks and dictionary, and releases all
+   * stored bytecode. Does not reset the frame reception state machine.
    *
    * @param link Link instance
    */
   void v4link_reset(V4Link* link);
 
+  /**
+   * @brief Install a vectored UART write callback
+   *
+   * When set, responses are sent through @p uart_writev instead of the
+   * callback given to v4link_create(). Pass NULL to revert.
+   *
+   * @param link        Link instance
+   * @param uart_writev Vectored write callback (can be NULL)
+   */
+  void v4link_set_uart_writev(V4Link* link, v4link_uart_writev_fn uart_writev);
+
+  /**
+   * @brief Enable or disable execute-in-place for one-shot EXEC code
+   *
+   * Anonymous main code is then run straight from the RX buffer instead of
+   * being copied into the arena. Its word index must not be reused by the
+   * host. See Link::set_exec_in_place().
+   *
+   * @param link   Link instance
+   * @param enable Non-zero to enable
+   */
+  void v4link_set_exec_in_place(V4Link* link, int enable);
+
+  /**
+   * @brief Give block memory transfers direct access to VM memory
+   *
+   * Pass the same region as the VM configuration. See
+   * Link::set_vm_memory().
+   *
+   * @param link Link instance
+   * @param mem  VM memory base (NULL to revert to word accessors)
+   * @param size VM memory size in bytes
+   */
+  void v4link_set_vm_memory(V4Link* link, uint8_t* mem, size_t size);
+
+  /**
+   * @brief Register the storage region for SAVE_IMAGE
+   *
+   * See Link::set_storage().
+   *
+   * @param link          Link instance
+   * @param storage_write Storage write callback (NULL disables SAVE_IMAGE)
+   * @param region        Memory-mapped storage region
+   * @param capacity      Size of the region in bytes
+   */
+  void v4link_set_storage(V4Link* link, v4link_storage_write_fn storage_write,
+                          const uint8_t* region, size_t capacity);
+
+  /**
+   * @brief Register the words of a saved image, executing them in place
+   *
+   * Call at boot on an empty dictionary. @p image must stay mapped and
+   * unchanged while the words are in use. See Link::restore_image().
+   *
+   * @param link  Link instance
+   * @param image Image bytes (e.g. the memory-mapped storage region)
+   * @param len   Number of readable bytes at @p image
+   * @return V4LINK_ERR_OK, V4LINK_ERR_GENERAL_ERROR if no valid image is
+   *         present, or V4LINK_ERR_VM_ERROR if registration failed
+   */
+  v4link_error_t v4link_restore_image(V4Link* link, const uint8_t* image, size_t len);
+
+  /**
+   * @brief Find the newest word registered under a name
+   *
+   * See Link::find_word().
+   *
+   * @param link Link instance
+   * @param name NUL-terminated word name
+   * @return Word index, or -1 if no word has that name
+   */
+  int v4link_find_word(const V4Link* link, const char* name);
+
+  /**
+   * @brief Get the largest READ_MEM_BLOCK / WRITE_MEM_BLOCK length
+   *
+   * @param link Link instance
+   * @return Maximum block size in bytes
+   */
+  size_t v4link_mem_block_max(const V4Link* link);
+
+  /**
+   * @brief Push changes of all WATCH_MEMORY regions now
+   *
+   * See Link::watch_poll().
+   *
+   * @param link Link instance
+   */
+  void v4link_watch_poll(V4Link* link);
+
+  /**
+   * @brief Set the interval at which v4link_tick() polls watched regions
+   *
+   * @param link        Link instance
+   * @param interval_us Interval in microseconds (0 disables, the default)
+   */
+  void v4link_set_watch_interval(V4Link* link, uint32_t interval_us);
+
   /**
    * @brief Get current buffer capacity
    *
@@ -134,6 +489,86 @@ extern "C"
    */
   size_t v4link_buffer_capacity(const V4Link* link);
 
+  /**
+   * @brief Get the largest request LEN accepted, as reported by PING
+   *
+   * @param link Link instance
+   * @return Maximum payload size in bytes
+   */
+  size_t v4link_max_payload(const V4Link* link);
+
+  /**
+   * @brief Get bytes of persistent bytecode currently stored
+   *
+   * @param link Link instance
+   * @return Bytes allocated from the bytecode arena
+   */
+  size_t v4link_arena_used(const V4Link* link);
+
+  /**
+   * @brief Install the timestamp source for per-command handler times
+   *
+   * @param link      Link instance
+   * @param timestamp Timestamp callback (NULL: times are not measured)
+   */
+  void v4link_set_timestamp(V4Link* link, v4link_timestamp_fn timestamp);
+
+  /**
+   * @brief Copy the QUERY_STATS counters
+   *
+   * @param link Link instance
+   * @param out  Filled on success
+   * @return V4LINK_ERR_OK, or V4LINK_ERR_GENERAL_ERROR if the library was
+   *         built with V4LINK_ENABLE_STATS=0
+   */
+  v4link_error_t v4link_get_stats(const V4Link* link, v4link_stats_t* out);
+
+  /**
+   * @brief Reset the QUERY_STATS counters and the arena peak
+   *
+   * @param link Link instance
+   */
+  void v4link_clear_stats(V4Link* link);
+
+  /**
+   * @brief Record timestamped events for DUMP_TRACE
+   *
+   * @param link   Link instance
+   * @param buffer Trace storage, owned by the caller (NULL: tracing off)
+   * @param size   Size of buffer in bytes
+   */
+  void v4link_set_trace_buffer(V4Link* link, uint8_t* buffer, size_t size);
+
+  /**
+   * @brief Count one profile hit for a word (interrupt-safe)
+   *
+   * Call from a timer interrupt with the word the VM is running, or from
+   * a CALL hook of the engine. Ignored unless PROFILE_START is in effect.
+   *
+   * @param link Link instance
+   * @param wid  Word index (negative: no word running)
+   */
+  void v4link_profile_sample(V4Link* link, int wid);
+
+  /* ========================================================================= */
+  /* Platform hooks                                                            */
+  /* ========================================================================= */
+
+  /**
+   * @brief Hardware CRC-8 hook (V4LINK_CRC8_BACKEND=HW only)
+   *
+   * Must be provided by the platform when the library is built with the
+   * HW CRC backend, typically by driving a vendor CRC peripheral
+   * (e.g. STM32 CRC unit, RP2040 DMA sniffer) configured for
+   * polynomial 0x07, no reflection, no final XOR.
+   *
+   * @param crc  Current CRC value (0x00 for a new computation)
+   * @param data Data buffer
+   * @param len  Number of bytes (always > 0)
+   * @return Updated CRC value
+   */
+  uint8_t v4link_crc8_hw_update(uint8_t crc, const uint8_t* data, size_t len);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -16,8 +16,23 @@
 #include <vector>
 
 #include "v4/vm_api.h"
+#include "v4link/internal/arena.hpp"
+#include "v4link/internal/cobs.hpp"
+#include "v4link/internal/lz.hpp"
+#include "v4link/internal/profile.hpp"
+#include "v4link/internal/rx_ring.hpp"
+#include "v4link/internal/stats.hpp"
+#include "v4link/internal/trace.hpp"
 #include "v4link/protocol.hpp"
 
+#ifndef V4LINK_ENABLE_COMPRESSION
+#define V4LINK_ENABLE_COMPRESSION 1
+#endif
+
+#ifndef V4LINK_ENABLE_WIDE_CRC
+#define V4LINK_ENABLE_WIDE_CRC 1
+#endif
+
 namespace v4
 {
 namespace link
@@ -50,6 +65,9 @@ namespace link
  *     link.feed_byte(byte);
  *   }
  * }
+ *
+ * // Or hand over a whole DMA buffer at once
+ * link.feed(dma_buf, dma_len);
  * @endcode
  */
 class Link
@@ -67,6 +85,96 @@ class Link
    */
   using UartWriteFn = void (*)(void* user, const uint8_t*, size_t);
 
+  /**
+   * @brief Scatter-gather buffer descriptor
+   */
+  struct IoVec
+  {
+    const uint8_t* data;  ///< Start of buffer
+    size_t len;           ///< Number of bytes
+  };
+
+  /**
+   * @brief Vectored UART write callback function type
+   *
+   * Optional alternative to UartWriteFn. Responses are handed over as
+   * separate header, payload and CRC buffers so that a DMA driver can
+   * send them without first copying into one contiguous buffer.
+   * All buffers remain valid only for the duration of the call.
+   *
+   * @param user   User context pointer passed during construction
+   * @param iov    Array of buffer descriptors, in transmission order
+   * @param iovcnt Number of descriptors
+   */
+  using UartWriteVFn = void (*)(void* user, const IoVec* iov, size_t iovcnt);
+
+  /**
+   * @brief Storage write callback function type (SAVE_IMAGE)
+   *
+   * Called first with @p data == nullptr and @p len set to the image size,
+   * to prepare (typically erase) the region, then with the image bytes at
+   * increasing offsets. The 16-byte header at offset 0 is written last.
+   *
+   * @param user   User context pointer passed during construction
+   * @param offset Byte offset within the storage region
+   * @param data   Bytes to write, or nullptr to prepare the region
+   * @param len    Number of bytes to write (or image size)
+   * @return true on success
+   */
+  using StorageWriteFn = bool (*)(void* user, size_t offset, const uint8_t* data, size_t len);
+
+  /**
+   * @brief What an ExecSliceFn call is asked to do
+   */
+  enum class SliceOp : uint8_t
+  {
+    START,   ///< Begin running @p entry
+    RESUME,  ///< Continue the run started earlier
+    ABORT,   ///< Discard the run (return value ignored)
+  };
+
+  /**
+   * @brief ExecSliceFn return value: budget used up, call again with RESUME
+   */
+  static constexpr int SLICE_YIELD = 1;
+
+  /**
+   * @brief Bounded VM execution callback for async EXEC
+   *
+   * Runs @p entry for at most @p budget units (instructions, ticks or
+   * microseconds, as the engine defines) and returns. Engines with a
+   * resumable scheduler, such as the V4 task system, plug in here.
+   *
+   * @param user   User context pointer passed during construction
+   * @param vm     VM instance
+   * @param entry  Main code word being run
+   * @param op     Start, resume or discard the run
+   * @param budget Slice budget given to set_exec_slice()
+   * @return V4 error code (0 when the word returned), or SLICE_YIELD
+   */
+  using ExecSliceFn = int (*)(void* user, Vm* vm, Word* entry, SliceOp op, uint32_t budget);
+
+  /**
+   * @brief Timestamp callback function type (QUERY_STATS handler times)
+   *
+   * Returns a free-running counter, e.g. a cycle counter or a microsecond
+   * timer. Only differences are used, so wrap-around is harmless.
+   *
+   * @param user User context pointer passed during construction
+   * @return Current timestamp
+   */
+  using TimestampFn = uint32_t (*)(void* user);
+
+  /**
+   * @brief Default size of the persistent bytecode arena in bytes
+   */
+  static constexpr size_t DEFAULT_ARENA_SIZE = 4096;
+
+  /**
+   * @brief Default number of words the resident word cache and name index hold
+   */
+  static constexpr size_t DEFAULT_MAX_WORDS = 64;
+
   /**
    * @brief Construct Link instance
    *
@@ -74,9 +182,22 @@ class Link
    * @param uart_write   Callback function for UART transmission
    * @param user         User context pointer passed to callback (can be nullptr)
    * @param buffer_size  Maximum bytecode buffer size (default: 512 bytes)
+   * @param arena_size   Persistent bytecode arena size (default: 4096 bytes)
+   * @param arena        Caller-provided arena region of @p arena_size bytes,
+   *                     or nullptr to allocate it once at construction
+   * @param rx_ring_size Interrupt receive ring size for isr_push(), rounded
+   *                     up to a power of 2 (default: 0, no ring)
+   * @param max_words    Words tracked until RESET, and the largest .v4b word
+   *                     table (default: 64)
+   *
+   * Bytecode of every registered word (and EXEC main code) is stored
+   * contiguously in the arena until RESET. The word tables are allocated
+   * once here; a load that would overflow them fails with BUFFER_FULL.
    */
   Link(Vm* vm, UartWriteFn uart_write, void* user = nullptr,
-       size_t buffer_size = MAX_PAYLOAD_SIZE);
+       size_t buffer_size = MAX_PAYLOAD_SIZE, size_t arena_size = DEFAULT_ARENA_SIZE,
+       uint8_t* arena = nullptr, size_t rx_ring_size = 0,
+       size_t max_words = DEFAULT_MAX_WORDS);
 
   /**
    * @brief Process one received byte
@@ -89,14 +210,314 @@ class Link
    */
   void feed_byte(uint8_t byte);
 
+  /**
+   * @brief Process a block of received bytes
+   *
+   * Equivalent to calling feed_byte() for each byte, but scans for STX
+   * and copies payload runs in bulk. Intended for DMA or FIFO drivers
+   * that deliver several bytes at once. In COBS framing (PING_FLAG_COBS)
+   * a buffer ending at a delimiter, as delivered on an idle-line
+   * interrupt, is decoded and handled in one call.
+   *
+   * @param data Pointer to received bytes
+   * @param len  Number of bytes
+   */
+  void feed(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Advance the receive timeout clock
+   *
+   * Call periodically (e.g. from a timer or the main loop) with a
+   * free-running microsecond timestamp. If a frame has been partially
+   * received and no byte arrived for the configured timeout, the frame is
+   * dropped and an INVALID_FRAME NAK is sent, so the host can retransmit
+   * without waiting for its own timeout. Timing resolution is one tick
+   * period. Wraparound of @p now_us is handled.
+   *
+   * @param now_us Current time in microseconds
+   */
+  void tick(uint32_t now_us);
+
+  /**
+   * @brief Queue one received byte from an interrupt or DMA callback
+   *
+   * Lock-free and safe to call from one producer context (e.g. the UART
+   * RX interrupt) concurrently with poll() in the main loop. Bytes keep
+   * arriving into the ring while a frame is being executed, so a long
+   * EXEC no longer overruns the UART.
+   *
+   * @param byte Received byte
+   * @return false if the ring is full or not configured (byte dropped)
+   */
+  bool isr_push(uint8_t byte)
+  {
+    return rx_ring_.push(byte);
+  }
+
+  /**
+   * @brief Queue a block of received bytes (e.g. a DMA half-transfer)
+   *
+   * @param data Received bytes
+   * @param len  Number of bytes
+   * @return Number of bytes queued; the rest were dropped
+   */
+  size_t isr_push(const uint8_t* data, size_t len)
+  {
+    return rx_ring_.push(data, len);
+  }
+
+  /**
+   * @brief Process the bytes queued by isr_push()
+   *
+   * Call from the main loop. Handles the bytes present on entry, as
+   * feed() would; bytes pushed meanwhile are left for the next call, so a
+   * continuous stream cannot keep poll() from returning. Bytes are
+   * released to the producer in small runs, keeping the ring free while a
+   * frame executes. With async EXEC, then runs one slice of the current
+   * run; this part also applies to links fed through feed_byte() or feed().
+   *
+   * @return Number of bytes processed
+   */
+  size_t poll();
+
+  /**
+   * @brief Bytes received since construction
+   */
+  size_t rx_bytes() const
+  {
+    return rx_bytes_;
+  }
+
+  /**
+   * @brief Bytes dropped by isr_push() because the ring was full
+   */
+  size_t rx_overruns() const
+  {
+    return rx_ring_.overruns();
+  }
+
+  /**
+   * @brief Set the inter-byte receive timeout used by tick()
+   *
+   * @param timeout_us Timeout in microseconds (0 disables, the default)
+   */
+  void set_rx_timeout(uint32_t timeout_us)
+  {
+    rx_timeout_us_ = timeout_us;
+  }
+
   /**
    * @brief Reset VM to initial state
    *
-   * Calls vm_reset() to clear stacks and dictionary.
-   * Does not reset the frame reception state machine.
+   * Calls vm_reset() to clear stacks and dictionary, releases all stored
+   * bytecode, and forgets resident words, names and profile counters, as
+   * RESET does. Does not reset the frame reception state machine.
    */
   void reset();
 
+  /**
+   * @brief Install a vectored UART write callback
+   *
+   * When set, responses are sent through @p uart_writev instead of the
+   * UartWriteFn given at construction. Pass nullptr to revert.
+   *
+   * @param uart_writev Vectored write callback (can be nullptr)
+   */
+  void set_uart_writev(UartWriteVFn uart_writev)
+  {
+    uart_writev_ = uart_writev;
+  }
+
+  /**
+   * @brief Enable or disable execute-in-place for one-shot EXEC code
+   *
+   * When enabled, anonymous main code (legacy raw EXEC payloads and the
+   * main code of .v4b images) is relocated and executed directly from the
+   * RX buffer instead of being copied into the arena. Only word
+   * definitions are stored persistently. A second RX buffer is reserved
+   * on first enable so that the next frame can be received while the
+   * executed code stays intact.
+   *
+   * The word index returned for such code is only valid until the RX
+   * buffer is reused; the host must not CALL it later. QUERY_WORD on it
+   * fails with VM_ERROR.
+   *
+   * @param enable true to execute anonymous code in place
+   */
+  void set_exec_in_place(bool enable);
+
+  /**
+   * @brief Enable or disable async EXEC
+   *
+   * When enabled, EXEC and COMMIT reply as soon as the code is loaded and
+   * the run advances one slice per poll() call, so PING, RUN_STATUS and
+   * ABORT are answered while it is in progress. Without an ExecSliceFn
+   * each run is a single vm_exec() call from poll(). Main code is then
+   * always stored in the arena, even with execute-in-place enabled.
+   *
+   * @param enable true to run EXEC code from poll()
+   */
+  void set_async_exec(bool enable)
+  {
+    async_exec_ = enable;
+  }
+
+  /**
+   * @brief Install the bounded execution callback used by async EXEC
+   *
+   * @param exec_slice Slice callback (nullptr: run to completion)
+   * @param budget     Budget passed to every slice
+   */
+  void set_exec_slice(ExecSliceFn exec_slice, uint32_t budget)
+  {
+    exec_slice_ = exec_slice;
+    slice_budget_ = budget;
+  }
+
+  /**
+   * @brief State of the last EXEC or COMMIT run (as reported by RUN_STATUS)
+   */
+  RunState run_state() const
+  {
+    return run_.state;
+  }
+
+  /**
+   * @brief Cancel a RUNNING run, as ABORT does
+   */
+  void abort_run()
+  {
+    run_abort();
+  }
+
+  /**
+   * @brief Give READ_MEM_BLOCK / WRITE_MEM_BLOCK direct access to VM memory
+   *
+   * Pass the same region as VmConfig::mem. Block transfers then copy with
+   * one bounds check per request instead of one vm_mem_read32() or
+   * vm_mem_write32() call per 4 bytes. Pass nullptr to revert.
+   *
+   * @param mem  VM memory base (can be nullptr)
+   * @param size VM memory size in bytes
+   */
+  void set_vm_memory(uint8_t* mem, size_t size)
+  {
+    vm_mem_ = mem;
+    vm_mem_size_ = mem != nullptr ? size : 0;
+  }
+
+  /**
+   * @brief Register the storage region for SAVE_IMAGE
+   *
+   * @p region is the memory-mapped view of the storage (e.g. flash) that
+   * @p storage_write writes to. SAVE_IMAGE refuses to run while words
+   * restored from it are registered, since it would overwrite their code.
+   * Pass nullptr to disable SAVE_IMAGE.
+   *
+   * @param storage_write Storage write callback (can be nullptr)
+   * @param region        Memory-mapped storage region (can be nullptr)
+   * @param capacity      Size of the region in bytes
+   */
+  void set_storage(StorageWriteFn storage_write, const uint8_t* region, size_t capacity)
+  {
+    storage_write_ = storage_write;
+    storage_region_ = region;
+    storage_capacity_ = storage_write != nullptr ? capacity : 0;
+  }
+
+  /**
+   * @brief Register the words of a SAVE_IMAGE image at boot
+   *
+   * Words are registered with their names and code pointing into
+   * @p image, which must stay mapped and unchanged while they are in use
+   * (execute-in-place from flash); nothing is copied to the arena. The
+   * resident word cache is restored with them. The whole image is
+   * validated before any word is registered, and a registration failing
+   * partway resets the link as reset() does, so nothing is left of it.
+   *
+   * @param image Image bytes (e.g. the memory-mapped storage region)
+   * @param len   Number of readable bytes at @p image
+   * @return ErrorCode::OK, GENERAL_ERROR if no valid image is present,
+   *         BUFFER_FULL if the word cache or name index cannot track its
+   *         words, or VM_ERROR if the dictionary is not empty or
+   *         registration failed
+   */
+  ErrorCode restore_image(const uint8_t* image, size_t len);
+
+  /**
+   * @brief VM index of the word registered under @p name
+   *
+   * Uses the name index kept by every registration path (EXEC, COMMIT,
+   * restore_image()), as QUERY_WORD_BY_NAME does. A redefined name
+   * resolves to its newest definition.
+   *
+   * @param name Name bytes (not necessarily NUL-terminated)
+   * @param len  Length of @p name
+   * @return Word index, or -1 if no word has that name
+   */
+  int find_word(const char* name, size_t len) const;
+
+  /**
+   * @brief Push changes of all WATCH_MEMORY regions now
+   *
+   * Compares each watched region with its shadow copy and sends the
+   * changed bytes as Event::MEMORY_DELTA frames. Called automatically
+   * after EXEC and COMMIT, and from tick() when a watch interval is set.
+   * Does nothing if no region is watched.
+   */
+  void watch_poll();
+
+  /**
+   * @brief Set the interval at which tick() calls watch_poll()
+   *
+   * @param interval_us Interval in microseconds (0 disables, the default;
+   *                    watches are then only checked after EXEC/COMMIT)
+   */
+  void set_watch_interval(uint32_t interval_us)
+  {
+    watch_interval_us_ = interval_us;
+  }
+
+  /**
+   * @brief Largest block accepted by READ_MEM_BLOCK / WRITE_MEM_BLOCK
+   *
+   * Derived from the frame buffer size so that a full WRITE_MEM_BLOCK
+   * request, including its SEQ byte in windowed mode, fits one frame.
+   */
+  size_t mem_block_max() const
+  {
+    const size_t rx_max = buffer_.capacity() - 4 - MEM_BLOCK_REQUEST_OVERHEAD;
+    const size_t tx_max = tx_data_capacity() - 2;  // [COUNT][DATA...]
+    return rx_max < tx_max ? rx_max : tx_max;
+  }
+
+  /**
+   * @brief Optional protocol features supported by this build
+   *
+   * @return Capability bits (CAP_*)
+   */
+  static constexpr uint16_t capabilities()
+  {
+    return CAP_WINDOW | CAP_BATCH | CAP_WORD_CACHE | CAP_COBS |
+           (V4LINK_ENABLE_COMPRESSION ? CAP_COMPRESSION : 0) |
+           (V4LINK_ENABLE_STATS ? CAP_STATS : 0) |
+           (V4LINK_ENABLE_PROFILE ? CAP_PROFILE : 0) |
+           (V4LINK_ENABLE_WIDE_CRC ? CAP_CRC16 | CAP_CRC32C : 0);
+  }
+
+  /**
+   * @brief Largest request LEN accepted, as reported by PING
+   *
+   * Grows with the buffer_size given at construction, up to
+   * MAX_FRAME_PAYLOAD. Includes the SEQ byte in windowed mode.
+   */
+  size_t max_payload() const;
+
+  /**
+   * @brief Largest response LEN sent, as reported by PING
+   */
+  size_t max_response() const;
+
   /**
    * @brief Get current buffer capacity
    *
@@ -107,6 +528,85 @@ class Link
     return buffer_.capacity();
   }
 
+  /**
+   * @brief Get bytes of persistent bytecode currently stored
+   */
+  size_t arena_used() const
+  {
+    return arena_.used();
+  }
+
+  /**
+   * @brief Get persistent bytecode arena size in bytes
+   */
+  size_t arena_capacity() const
+  {
+    return arena_.capacity();
+  }
+
+  /**
+   * @brief Highest arena usage since construction or clear_stats()
+   */
+  size_t arena_peak() const
+  {
+    return arena_.peak();
+  }
+
+  /**
+   * @brief Install the timestamp source for per-command handler times
+   *
+   * @param timestamp Timestamp callback (nullptr: times are not measured)
+   */
+  void set_timestamp(TimestampFn timestamp)
+  {
+    timestamp_ = timestamp;
+  }
+
+  /**
+   * @brief Counters reported by QUERY_STATS
+   *
+   * Empty when built with V4LINK_ENABLE_STATS=0.
+   */
+  const internal::LinkStats& stats() const
+  {
+    return stats_;
+  }
+
+  /**
+   * @brief Reset the QUERY_STATS counters and the arena peak
+   */
+  void clear_stats();
+
+  /**
+   * @brief Record timestamped events into @p buffer for DUMP_TRACE
+   *
+   * Frame reception, CRC checks, word registration, relocation, VM runs
+   * and responses are logged as 3-11 byte records; once the buffer is full
+   * the oldest are overwritten. Times come from the timestamp callback.
+   * Does nothing when built with V4LINK_ENABLE_TRACE=0.
+   *
+   * @param buffer Trace storage, owned by the caller (nullptr: tracing off)
+   * @param size   Size of @p buffer in bytes
+   */
+  void set_trace_buffer(uint8_t* buffer, size_t size)
+  {
+    trace_.set_buffer(buffer, size);
+  }
+
+  /**
+   * @brief Count one profile hit for word @p wid
+   *
+   * Call from a timer interrupt with the index of the word the VM is
+   * running (negative if none) to sample where time goes, or from a CALL
+   * hook of the engine to count entries. Ignored unless the host started
+   * a profile with PROFILE_START. Safe against the main loop, like
+   * isr_push(); at most one interrupt handler may call it.
+   */
+  void profile_sample(int wid)
+  {
+    profile_.hit(wid);
+  }
+
  private:
   /**
    * @brief Frame reception state machine
@@ -119,57 +619,567 @@ class Link
     WAIT_CMD,    // Waiting for command byte
     WAIT_DATA,   // Receiving payload data
     WAIT_CRC,    // Waiting for CRC byte
+    WAIT_COBS,   // Receiving a COBS-encoded frame (COBS framing)
   };
 
   /**
-   * @brief Handle complete frame
-   *
-   * Called when a complete frame has been received.
-   * Verifies CRC, dispatches command, and sends response.
+   * @brief Result of feeding one byte to the frame state machine
    */
-  void handle_frame();
+  enum class Step
+  {
+    CONTINUE,  // Frame still incomplete
+    FRAME,     // Complete frame with valid CRC
+    BAD_CRC,   // Complete frame with CRC mismatch
+    TOO_LONG,  // LEN exceeds buffer capacity
+  };
 
   /**
-   * @brief Send ACK/NAK response
-   *
-   * @param code     Error code to send
-   * @param data     Optional payload data (nullptr for standard response)
-   * @param data_len Payload length in bytes (0 for standard response)
+   * @brief Start a new frame after its STX was stored in buffer_
    */
-  void send_ack(ErrorCode code, const uint8_t* data = nullptr, size_t data_len = 0);
+  void begin_frame();
 
   /**
-   * @brief Handle CMD_EXEC command
+   * @brief Advance the frame state machine by one byte
+   *
+   * Updates state and running CRC only; the caller stores the byte.
+   *
+   * @param byte Byte following the bytes already in buffer_
+   * @return Outcome for this byte
    */
-  void handle_cmd_exec();
+  Step advance(uint8_t byte);
 
   /**
-   * @brief Handle CMD_PING command
+   * @brief Rescan a rejected frame for the next STX candidate
+   *
+   * Replays buffered bytes from the first STX at or after @p from through
+   * the state machine, handling any complete frame found among them.
+   *
+   * @param from Index in buffer_ to start scanning at
    */
-  void handle_cmd_ping();
+  void resync(size_t from);
 
   /**
-   * @brief Handle CMD_RESET command
+   * @brief Receive bytes in COBS framing
+   *
+   * Decodes frames into buffer_ as [STX][LEN_L][LEN_H][CMD][DATA...][CRC8]
+   * (STX only as a placeholder) so they are handled like STX frames.
+   *
+   * @return Bytes consumed; less than @p len if a frame switched back to
+   *         STX framing
    */
-  void handle_cmd_reset();
+  size_t feed_cobs(const uint8_t* data, size_t len);
 
   /**
-   * @brief Handle CMD_QUERY_STACK command
+   * @brief Check and handle the frame decoded into buffer_
+   *
+   * @param well_formed false if the delimiter cut a COBS block short
    */
-  void handle_cmd_query_stack();
+  void end_cobs_frame(bool well_formed);
 
   /**
-   * @brief Handle CMD_QUERY_MEMORY command
+   * @brief Handle complete frame
+   *
+   * Called when a complete frame with valid CRC has been received.
+   * Dispatches command and sends response.
    */
-  void handle_cmd_query_memory();
+  void handle_frame();
 
   /**
-   * @brief Handle CMD_QUERY_WORD command
-   */
-  void handle_cmd_query_word();
-
+   * @brief Send ACK/NAK response
+   *
+   * @param code     Error code to send
+   * @param data     Optional payload data (nullptr for standard response)
+   * @param data_len Payload length in bytes (0 for standard response)
+   */
+  void send_ack(ErrorCode code, const uint8_t* data = nullptr, size_t data_len = 0);
+
+  /**
+   * @brief Send a response serialized into the TX buffer
+   *
+   * The first @p data_len bytes of response data must already be written
+   * at tx_data(). An optional @p tail is appended after them; it is passed
+   * to UartWriteVFn as its own buffer, or copied into the TX buffer when
+   * only UartWriteFn is available.
+   *
+   * @param code     Error code to send
+   * @param data_len Bytes already serialized at tx_data()
+   * @param tail     Optional extra payload (nullptr if none)
+   * @param tail_len Extra payload length in bytes
+   */
+  void send_response(ErrorCode code, size_t data_len, const uint8_t* tail = nullptr,
+                     size_t tail_len = 0);
+
+  /**
+   * @brief Send a complete frame from the TX buffer in the current framing
+   *
+   * @param frame Frame starting with STX, at tx_frame()
+   * @param len   Frame length including STX and CRC8
+   */
+  void transmit(uint8_t* frame, size_t len);
+
+  /**
+   * @brief Start of the response frame in the TX buffer
+   *
+   * Preceded by room to COBS-encode the frame in place.
+   */
+  uint8_t* tx_frame();
+
+  /**
+   * @brief Start of the response data area in the TX buffer
+   */
+  uint8_t* tx_data();
+
+  /**
+   * @brief Size of the response data area in the TX buffer
+   */
+  size_t tx_data_capacity() const;
+
+  /**
+   * @brief Most word table entries an EXEC or COMMIT response can list
+   *
+   * Bounded by tx_data_capacity(), the one-byte WORD_COUNT, which also
+   * counts the main code, and the word tables sized at construction.
+   */
+  size_t max_load_words() const;
+
+  /**
+   * @brief Run the handler for @p cmd on rx_payload_
+   */
+  void dispatch(Command cmd);
+
+  /**
+   * @brief Handle CMD_BATCH command
+   */
+  void handle_cmd_batch();
+
+  /**
+   * @brief Largest result data @p cmd can produce inside a BATCH right now
+   *
+   * @param cmd Sub-command
+   * @param len Sub-command data length
+   * @return Bytes to keep free before running it (0: not allowed in a batch)
+   */
+  size_t batch_reserve(Command cmd, size_t len);
+
+  /**
+   * @brief Offset of the current BATCH result in the response data area
+   */
+  size_t batch_offset() const;
+
+  /**
+   * @brief Handle CMD_EXEC command
+   */
+  void handle_cmd_exec();
+
+  /**
+   * @brief Load and run a .v4b image received with EXEC
+   *
+   * The image is validated and its storage reserved before any word is
+   * registered, so a rejected image leaves the VM and arena unchanged.
+   *
+   * @param image .v4b image inside the RX buffer
+   * @param len   Image length in bytes
+   */
+  void handle_exec_v4b(uint8_t* image, size_t len);
+
+  /**
+   * @brief Provide storage for anonymous main code
+   *
+   * Returns @p code itself in execute-in-place mode, otherwise an arena
+   * copy of it.
+   *
+   * @param code Main code inside the RX buffer
+   * @param len  Main code length in bytes
+   * @return Pointer to executable code, or nullptr if the arena is full
+   */
+  uint8_t* place_main_code(uint8_t* code, size_t len);
+
+  /**
+   * @brief Check whether @p ptr points into one of the RX buffers
+   */
+  bool in_rx_buffer(const uint8_t* ptr) const;
+
+  /**
+   * @brief Handle CMD_BEGIN_UPLOAD command
+   */
+  void handle_cmd_begin_upload();
+
+  /**
+   * @brief Handle CMD_CHUNK command
+   */
+  void handle_cmd_chunk();
+
+  /**
+   * @brief Handle CMD_COMMIT command
+   */
+  void handle_cmd_commit();
+
+  /**
+   * @brief Parse the next bytes of a chunked .v4b upload
+   *
+   * @param data Chunk bytes
+   * @param len  Chunk length in bytes
+   * @return ErrorCode::OK, or the error that aborted the upload
+   */
+  ErrorCode upload_parse(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Abort the upload in progress
+   *
+   * Words already registered stay in the VM dictionary, which keeps
+   * referencing their bytecode, but are stubbed to return at once as after
+   * a failed EXEC: their names resolve to the previous definitions and
+   * they leave the word cache. Arena space above them is reclaimed.
+   */
+  void upload_abort();
+
+  /**
+   * @brief Check and strip SEQ of a frame received in windowed mode
+   *
+   * @return true if the frame is the next in sequence and must be handled
+   */
+  bool accept_sequence();
+
+  /**
+   * @brief Reject a frame that was corrupted, oversized or out of sequence
+   *
+   * In windowed mode only the first rejection of a gap is reported, tagged
+   * with the sequence number the host must resend from.
+   *
+   * @param code Error code to send
+   */
+  void reject_frame(ErrorCode code);
+
+  /**
+   * @brief Handle CMD_PING command
+   */
+  void handle_cmd_ping();
+
+  /**
+   * @brief Serialize the PING capability block at @p out
+   *
+   * @param check Frame check the PING switches to
+   * @return CAPABILITY_BLOCK_SIZE
+   */
+  size_t write_capabilities(uint8_t* out, CrcType check) const;
+
+  /**
+   * @brief Handle CMD_RESET command
+   */
+  void handle_cmd_reset();
+
+  /**
+   * @brief State shared by RESET and reset(): the VM, stored bytecode and
+   *        everything indexed by word
+   */
+  void reset_state();
+
+  /**
+   * @brief Handle CMD_QUERY_STACK command
+   */
+  void handle_cmd_query_stack();
+
+  /**
+   * @brief Handle CMD_QUERY_STATS command (link_stats.cpp)
+   */
+  void handle_cmd_query_stats();
+
+  /**
+   * @brief Size of the QUERY_STATS response data with the slots now in use
+   */
+  size_t stats_reply_size() const;
+
+  /**
+   * @brief Current timestamp, or 0 without a timestamp source
+   */
+  uint32_t timestamp() const
+  {
+    return ((V4LINK_ENABLE_STATS || V4LINK_ENABLE_TRACE) && timestamp_ != nullptr)
+               ? timestamp_(user_context_)
+               : 0;
+  }
+
+  /**
+   * @brief Append a trace record if tracing is on
+   */
+  void trace(TraceEvent event, uint32_t arg = 0)
+  {
+    if (trace_.enabled())
+    {
+      trace_.record(event, timestamp(), arg);
+    }
+  }
+
+  /**
+   * @brief vm_register_word(), traced, and indexed by name
+   *
+   * @param name     Name, persistent (arena or image) if indexed, or nullptr
+   * @param name_len Length of @p name, or 0 to keep it out of the index
+   */
+  int register_word(const char* name, size_t name_len, const uint8_t* code, int len);
+
+  /**
+   * @brief register_word() for anonymous main code, recorded as such
+   */
+  int register_main(const uint8_t* code, int len);
+
+  /**
+   * @brief Whether word @p wid was registered as main code
+   *
+   * Only the first MAIN_WORD_BITS indices are recorded; later ones report
+   * false, so they are treated as callable words.
+   */
+  bool is_main_word(int wid) const
+  {
+    return wid >= 0 && static_cast<size_t>(wid) < MAIN_WORD_BITS &&
+           (main_words_[wid / 8] & (1u << (wid % 8))) != 0;
+  }
+
+  /**
+   * @brief Record whether word @p wid is main code
+   */
+  void set_main_word(int wid, bool main);
+
+  /**
+   * @brief Handle CMD_DUMP_TRACE command (link_stats.cpp)
+   */
+  void handle_cmd_dump_trace();
+
+  /**
+   * @brief Handle CMD_PROFILE_START command (link_profile.cpp)
+   */
+  void handle_cmd_profile_start();
+
+  /**
+   * @brief Handle CMD_PROFILE_STOP command (link_profile.cpp)
+   */
+  void handle_cmd_profile_stop();
+
+  /**
+   * @brief Handle CMD_PROFILE_DUMP command (link_profile.cpp)
+   */
+  void handle_cmd_profile_dump();
+
+  /**
+   * @brief Handle CMD_QUERY_MEMORY command
+   */
+  void handle_cmd_query_memory();
+
+  /**
+   * @brief Handle CMD_QUERY_WORD command
+   */
+  void handle_cmd_query_word();
+
+  /**
+   * @brief Handle CMD_HAVE_WORDS command
+   */
+  void handle_cmd_have_words();
+
+  /**
+   * @brief Handle CMD_QUERY_WORD_BY_NAME command
+   */
+  void handle_cmd_query_word_by_name();
+
+  /**
+   * @brief Handle CMD_REPLACE_WORD command (link_redefine.cpp)
+   */
+  void handle_cmd_replace_word();
+
+  /**
+   * @brief Handle CMD_FORGET_FROM command (link_redefine.cpp)
+   */
+  void handle_cmd_forget_from();
+
+  /**
+   * @brief Register words 0 to @p keep - 1 again after vm_reset()
+   *
+   * V4 can neither unregister a word nor change its code, so REPLACE_WORD
+   * and FORGET_FROM rebuild the dictionary with the same indices, names and
+   * code pointers. Word @p wid (if below @p keep) instead gets @p len
+   * bytes copied from @p src to @p dst, which may be its old code. The kept
+   * words are collected in scratch space on top of the arena, with a copy
+   * of any name that has no persistent one (a word registered behind the
+   * link's back); such names stay out of the name index. Fails with
+   * BUFFER_FULL, before anything is changed, if the scratch space does not
+   * fit.
+   */
+  ErrorCode rebuild_words(int keep, int wid = -1, uint8_t* dst = nullptr,
+                          const uint8_t* src = nullptr, size_t len = 0);
+
+  /**
+   * @brief Persistent copy of the name of @p word ("" if unnamed)
+   *
+   * @return The copy, or nullptr if the name is not interned
+   */
+  const char* word_name(const Word* word, size_t* len) const;
+
+  /**
+   * @brief Handle CMD_SAVE_IMAGE command (link_image.cpp)
+   */
+  void handle_cmd_save_image();
+
+  /**
+   * @brief Handle CMD_RUN_STATUS command (link_run.cpp)
+   */
+  void handle_cmd_run_status();
+
+  /**
+   * @brief Handle CMD_ABORT command (link_run.cpp)
+   */
+  void handle_cmd_abort();
+
+  /**
+   * @brief Run freshly registered main code @p wid
+   *
+   * Executes it now, or with async EXEC leaves it to run_slice().
+   */
+  void run_main(int wid);
+
+  /**
+   * @brief Advance the async run by one slice (from poll())
+   */
+  void run_slice();
+
+  /**
+   * @brief Cancel a RUNNING run, discarding its engine state
+   */
+  void run_abort();
+
+  /**
+   * @brief Stop the current run, if any, and forget it (RESET)
+   */
+  void run_clear();
+
+  /**
+   * @brief Whether EXEC or COMMIT must be refused with BUSY
+   */
+  bool run_busy() const
+  {
+    return run_.state == RunState::RUNNING;
+  }
+
+  /**
+   * @brief VM index of the resident word with chain hash @p hash
+   *
+   * @return Word index, or -1 if no loaded word has that hash
+   */
+  int word_cache_find(uint32_t hash) const;
+
+  /**
+   * @brief Whether resident word @p wid is the word table entry about to be
+   *        appended to load_words_
+   *
+   * A matching chain hash alone could be a collision, so the name and
+   * code are compared too. CALL operands are compared as linked: to the
+   * earlier entries' words, or to @p wid itself. Operands naming later
+   * entries are not known yet and are skipped.
+   */
+  bool resident_matches(int wid, const char* name, size_t name_len, const uint8_t* code,
+                        size_t code_len) const;
+
+  /**
+   * @brief Record a fully linked word under its chain hash
+   *
+   * Loads check for room up front; past max_words_ the word is not recorded.
+   */
+  void word_cache_add(uint32_t hash, int wid);
+
+  /**
+   * @brief Persistent copy of a registered name, or nullptr if none
+   */
+  const char* interned_name(const char* name, size_t len) const;
+
+  /**
+   * @brief Index @p name as word @p wid; a redefinition takes over the name
+   *
+   * Loads check for room up front; past max_words_ a new name is not indexed.
+   */
+  void name_index_add(const char* name, size_t len, int wid);
+
+  /**
+   * @brief Give @p name back to its newest definition below @p wid
+   *
+   * Undoes name_index_add() for words from @p wid on that a failed load
+   * stubbed out: the definition the name was taken from, or else the
+   * newest earlier word carrying it. The name is dropped if there is none.
+   */
+  void name_index_revert(const char* name, size_t len, int wid);
+
+  /**
+   * @brief VM index of file-relative word index @p idx in the image being loaded
+   *
+   * Entries of load_words_ map to their VM index; indices past them keep
+   * the plain offset from the last word registered by the load. Such
+   * forward CALLs are only valid if no resident entry lies in between,
+   * which every load path checks.
+   */
+  uint16_t resolve_word(uint16_t idx) const;
+
+  /**
+   * @brief Handle CMD_READ_MEM_BLOCK command
+   */
+  void handle_cmd_read_mem_block();
+
+  /**
+   * @brief Handle CMD_WRITE_MEM_BLOCK command
+   */
+  void handle_cmd_write_mem_block();
+
+  /**
+   * @brief Copy up to @p len bytes of VM memory at @p addr into @p out
+   *
+   * @return Bytes copied; less than @p len if the range leaves VM memory
+   */
+  size_t mem_read(uint32_t addr, uint8_t* out, size_t len);
+
+  /**
+   * @brief Copy up to @p len bytes from @p in into VM memory at @p addr
+   *
+   * @return Bytes copied; less than @p len if the range leaves VM memory
+   */
+  size_t mem_write(uint32_t addr, const uint8_t* in, size_t len);
+
+  /**
+   * @brief Handle CMD_WATCH_MEMORY command
+   */
+  void handle_cmd_watch_memory();
+
+  /**
+   * @brief Cancel watch slot @p id and release its shadow bytes
+   */
+  void watch_remove(uint8_t id);
+
+  /**
+   * @brief Diff one watched region, update its shadow and push the changes
+   */
+  void watch_diff(uint8_t id);
+
+  /**
+   * @brief Append one changed run to the pending MEMORY_DELTA frame
+   *
+   * Flushes the frame and starts a new one for @p id when the run does not
+   * fit, splitting runs longer than a frame.
+   *
+   * @return Event data length after the run
+   */
+  size_t watch_emit(uint8_t id, size_t len, size_t offset, size_t run_len);
+
+  /**
+   * @brief Start of the event data area in the TX buffer
+   */
+  uint8_t* event_data();
+
+  /**
+   * @brief Send an event frame serialized at event_data()
+   */
+  void send_event(Event event, size_t data_len);
+
+  // WRITE_MEM_BLOCK request data ahead of the block: SEQ + ADDR
+  static constexpr size_t MEM_BLOCK_REQUEST_OVERHEAD = 1 + 4;
+
   Vm* vm_;                       ///< V4 VM instance
   UartWriteFn uart_write_;       ///< UART write callback
+  UartWriteVFn uart_writev_;     ///< Optional vectored UART write callback
   void* user_context_;           ///< User context for callback
   std::vector<uint8_t> buffer_;  ///< Frame reception buffer
   size_t pos_;                   ///< Current position in buffer
@@ -177,9 +1187,171 @@ class Link
   State state_;         ///< State machine state
   uint16_t frame_len_;  ///< Expected payload length
   uint8_t cmd_;         ///< Current command code
+  uint8_t rx_crc_;      ///< Running CRC over [LEN_L][LEN_H][CMD][DATA...]
+  CrcType check_;       ///< Negotiated frame check (CRC8 unless set by PING)
+
+  std::vector<uint8_t> tx_buffer_;  ///< Preallocated response frame buffer
+  size_t tx_headroom_;              ///< tx_buffer_ bytes ahead of tx_frame()
+
+  bool cobs_;                      ///< COBS framing negotiated
+  bool cobs_overflow_;             ///< COBS frame exceeds buffer_
+  internal::CobsDecoder cobs_rx_;  ///< COBS receive state
+
+  internal::BytecodeArena arena_;  ///< Persistent bytecode storage for registered words
+
+  std::vector<uint8_t> rx_spare_;  ///< Second RX buffer for execute-in-place mode
+  bool exec_in_place_;             ///< Run anonymous EXEC code from the RX buffer
+
+  uint8_t* vm_mem_;     ///< VM memory for block transfers (nullptr: use vm_mem_*32)
+  size_t vm_mem_size_;  ///< Size of vm_mem_ in bytes
+
+  StorageWriteFn storage_write_;   ///< SAVE_IMAGE storage callback (nullptr: disabled)
+  const uint8_t* storage_region_;  ///< Memory-mapped storage region
+  size_t storage_capacity_;        ///< Size of the storage region in bytes
+
+  /**
+   * @brief One WATCH_MEMORY subscription
+   */
+  struct Watch
+  {
+    uint32_t addr;    ///< Region start in VM memory
+    uint16_t len;     ///< Region length (0: slot unused)
+    uint16_t shadow;  ///< Offset of the shadow copy in watch_shadow_
+    bool primed;      ///< Shadow matches what the host has seen
+  };
+
+  Watch watches_[MAX_WATCH_REGIONS];   ///< Watch slots, indexed by ID
+  std::vector<uint8_t> watch_shadow_;  ///< Shadow copies, reserved on first watch
+  uint32_t watch_interval_us_;         ///< tick() poll interval (0: disabled)
+  uint32_t last_watch_us_;             ///< Time of the last tick() poll
+
+  bool batch_active_;    ///< Responses are collected for a BATCH reply
+  size_t batch_len_;     ///< BATCH result bytes collected so far
+  bool batch_ran_exec_;  ///< BATCH ran an EXEC (watches are polled after it)
+
+  /**
+   * @brief A word identified by its chain hash (see word_hash.hpp)
+   */
+  struct CachedWord
+  {
+    uint32_t hash;  ///< Chain hash of the word table entry
+    int wid;        ///< VM word index (-1: not registered yet)
+  };
+
+  size_t max_words_;                    ///< Capacity of the word tables below
+  std::vector<CachedWord> word_cache_;  ///< Resident .v4b words, sorted by hash
+
+  /**
+   * @brief A registered name; the string is shared by words of that name
+   */
+  struct NamedWord
+  {
+    uint32_t hash;     ///< FNV-1a of the name
+    uint8_t len;       ///< Name length
+    const char* name;  ///< Persistent copy (arena or restored image)
+    int wid;           ///< Newest VM word index with this name
+    int prev_wid;      ///< Definition it took over (-1: none)
+  };
+
+  std::vector<NamedWord> name_index_;   ///< Registered names, sorted by hash
+  std::vector<CachedWord> load_words_;  ///< Word table of the EXEC or upload in progress
+  int load_base_;                       ///< Offset of forward CALLs past that table
+
+  static constexpr size_t MAIN_WORD_BITS = 256;  ///< Word indices is_main_word() covers
+  uint8_t main_words_[MAIN_WORD_BITS / 8];       ///< Bit per word index: main code
+
+  /**
+   * @brief Streaming .v4b parser state for chunked uploads
+   */
+  struct Upload
+  {
+    /**
+     * @brief Field currently being received
+     */
+    enum class Stage : uint8_t
+    {
+      IDLE,              // No upload in progress
+      HEADER,            // 16-byte .v4b header
+      MAIN,              // Main code
+      MAIN_RELOC_COUNT,  // Main code relocation count (v0.3+, 2 bytes)
+      MAIN_RELOC,        // Main code relocation offsets
+      NAME_LEN,          // Word name length (or V4B_WORD_REF, v0.4+)
+      WORD_REF,          // Hash of a resident word (4 bytes)
+      NAME,              // Word name
+      CODE_LEN,          // Word code length (4 bytes)
+      CODE,              // Word code
+      RELOC_COUNT,       // Word relocation count (v0.3+, 2 bytes)
+      RELOC,             // Word relocation offset (2 bytes each)
+      DONE,              // Word table complete, waiting for COMMIT
+    };
+
+    Stage stage;                ///< Current field
+    uint8_t field[16];          ///< Header / code length assembly buffer
+    size_t fill;                ///< Bytes received for the current field
+    uint32_t code_size;         ///< Main code size from header
+    uint32_t word_count;        ///< Word count from header
+    uint32_t words_done;        ///< Word table entries completed so far
+    uint32_t words_added;       ///< Words registered (not resident) so far
+    int first_wid;              ///< VM index of the first registered word (-1: none)
+    uint32_t hash;              ///< Chain hash up to the current word
+    size_t word_mark;           ///< Arena watermark before the current word
+    uint8_t* main_code;         ///< Arena copy of main code
+    char* name_copy;            ///< Arena copy of current word name (NUL-terminated)
+    const char* name;           ///< Name to register: name_copy or an interned copy
+    uint8_t name_len;           ///< Current word name length
+    uint8_t* word_code;         ///< Arena copy of current word code (nullptr: resident)
+    uint32_t word_code_len;     ///< Current word code length
+    bool has_relocs;            ///< Image carries relocation lists (v0.3+)
+    bool has_refs;              ///< Image may reference resident words (v0.4+)
+    uint8_t* main_fixups;       ///< Arena copy of main code relocation offsets
+    uint16_t main_fixup_count;  ///< Entries in main_fixups
+    uint16_t fixups_left;       ///< Relocation entries still to receive
+    uint32_t forward_end;       ///< Entries below this are called ahead, so must be new
+    size_t arena_mark;          ///< Arena watermark at BEGIN_UPLOAD
+#if V4LINK_ENABLE_COMPRESSION
+    bool compressed;         ///< CHUNK data is an LZ stream
+    internal::LzDecoder lz;  ///< Decoder for compressed uploads
+#endif
+  };
+
+  Upload upload_;  ///< Chunked upload in progress
+
+  uint8_t* rx_payload_;    ///< Payload of the frame being handled (after SEQ)
+  size_t rx_payload_len_;  ///< Payload length of the frame being handled
+
+  uint8_t window_size_;   ///< Negotiated window size (0: stop-and-wait, no SEQ)
+  uint8_t expected_seq_;  ///< Next sequence number to accept
+  uint8_t tx_seq_;        ///< Sequence number tagged onto the next response
+  bool nak_sent_;         ///< Gap already reported since last in-order frame
+
+  size_t rx_bytes_;         ///< Total bytes received
+  size_t tick_rx_bytes_;    ///< rx_bytes_ seen by the last tick()
+  uint32_t last_rx_us_;     ///< Time of last observed receive progress
+  uint32_t rx_timeout_us_;  ///< Inter-byte timeout (0: disabled)
+
+  internal::RxRing rx_ring_;  ///< Bytes queued by isr_push() for poll()
+
+  /**
+   * @brief The last EXEC or COMMIT run
+   */
+  struct Run
+  {
+    Word* entry;      ///< Main code word (nullptr: none)
+    uint16_t wid;     ///< Its word index
+    RunState state;   ///< Progress
+    uint32_t slices;  ///< Slices run so far
+    int32_t result;   ///< V4 error code once FAILED
+  };
+
+  Run run_;                 ///< Current or last run
+  bool async_exec_;         ///< EXEC and COMMIT run from poll()
+  ExecSliceFn exec_slice_;  ///< Bounded execution callback (nullptr: vm_exec)
+  uint32_t slice_budget_;   ///< Budget passed to exec_slice_
 
-  std::vector<std::vector<uint8_t>>
-      bytecode_storage_;  ///< Persistent bytecode storage for registered words
+  TimestampFn timestamp_;          ///< Handler and trace time source (nullptr: none)
+  internal::LinkStats stats_;      ///< QUERY_STATS counters
+  internal::TraceRing trace_;      ///< DUMP_TRACE records
+  internal::WordProfile profile_;  ///< PROFILE_* hit counters
 };
 
 }  // namespace link
@@ -35,9 +35,121 @@ constexpr uint8_t STX = 0xA5;
  *
  * Limits the size of DATA field in a single frame.
  * Can be adjusted based on target platform RAM constraints.
+ * This is the default device buffer size and the limit every device
+ * accepts; devices built with a larger buffer report their own limit in
+ * the PING capability block.
  */
 constexpr size_t MAX_PAYLOAD_SIZE = 512;
 
+/**
+ * @brief Largest payload the 16-bit LEN field can describe
+ */
+constexpr size_t MAX_FRAME_PAYLOAD = 0xFFFF;
+
+/**
+ * @brief Protocol version reported in the PING capability block
+ */
+constexpr uint8_t PROTOCOL_VERSION = 1;
+
+/**
+ * @brief Largest window size accepted during PING negotiation
+ *
+ * Kept below half the 8-bit sequence space so that retransmitted frames
+ * can be told apart from new ones.
+ */
+constexpr uint8_t MAX_WINDOW_SIZE = 127;
+
+/**
+ * @brief Number of WATCH_MEMORY slots
+ */
+constexpr uint8_t MAX_WATCH_REGIONS = 4;
+
+/**
+ * @brief Total bytes of VM memory that can be watched at once
+ *
+ * Each watched byte keeps one byte of shadow copy on the device.
+ */
+constexpr size_t MAX_WATCH_BYTES = 2048;
+
+/**
+ * @brief BEGIN_UPLOAD flag: CHUNK data is LZ-compressed
+ */
+constexpr uint8_t UPLOAD_FLAG_COMPRESSED = 0x01;
+
+/**
+ * @brief Optional protocol features (Link::capabilities() bits)
+ */
+enum Capability : uint16_t
+{
+  CAP_WINDOW = 0x0001,       // Windowed transfer mode (PING [WINDOW])
+  CAP_COMPRESSION = 0x0002,  // UPLOAD_FLAG_COMPRESSED
+  CAP_BATCH = 0x0004,        // BATCH command
+  CAP_WORD_CACHE = 0x0008,   // HAVE_WORDS and .v4b v0.4 word references
+  CAP_IMAGE = 0x0010,        // SAVE_IMAGE (storage registered)
+  CAP_ASYNC_EXEC = 0x0020,   // EXEC replies before running; RUN_STATUS, ABORT
+  CAP_STATS = 0x0040,        // QUERY_STATS
+  CAP_TRACE = 0x0080,        // DUMP_TRACE (trace buffer registered)
+  CAP_PROFILE = 0x0100,      // PROFILE_START, PROFILE_STOP, PROFILE_DUMP
+  CAP_COBS = 0x0200,         // COBS framing (PING_FLAG_COBS)
+  CAP_CRC16 = 0x0400,        // CrcType::CRC16_CCITT frame check
+  CAP_CRC32C = 0x0800,       // CrcType::CRC32C frame check
+};
+
+/**
+ * @brief Frame check sequence reported in the PING capability block
+ */
+enum class CrcType : uint8_t
+{
+  CRC8 = 0x01,         // CRC-8, polynomial 0x07
+  CRC16_CCITT = 0x02,  // CRC-16/CCITT-FALSE, 2 bytes little-endian
+  CRC32C = 0x03,       // CRC-32C (Castagnoli), 4 bytes little-endian
+};
+
+/**
+ * @brief PING flag: append the capability block to the response
+ */
+constexpr uint8_t PING_FLAG_CAPABILITIES = 0x01;
+
+/**
+ * @brief PING flag: switch to COBS framing
+ *
+ * Every later frame, in both directions, is sent as
+ * COBS([LEN_L][LEN_H][CMD][SEQ][DATA...][CRC8]) followed by a 0x00
+ * delimiter: the frame without STX, byte-stuffed so that 0x00 only ever
+ * ends a frame. A receiver resynchronizes at the next delimiter, and a
+ * DMA driver with idle-line detection can hand over whole frames. LEN,
+ * SEQ and the CRC are unchanged. A PING with a window but without this
+ * flag returns to STX framing.
+ */
+constexpr uint8_t PING_FLAG_COBS = 0x02;
+
+/**
+ * @brief QUERY_STATS flag: reset the counters after reporting them
+ */
+constexpr uint8_t STATS_FLAG_RESET = 0x01;
+
+/**
+ * @brief DUMP_TRACE response flag: records remain that did not fit
+ */
+constexpr uint8_t TRACE_FLAG_MORE = 0x01;
+
+/**
+ * @brief PING capability block
+ *
+ * [VERSION][CRC][CAPS_L][CAPS_H][MAX_PAYLOAD_L][MAX_PAYLOAD_H]
+ * [MAX_RESPONSE_L][MAX_RESPONSE_H][MAX_WINDOW]
+ * - VERSION: PROTOCOL_VERSION
+ * - CRC: CrcType of the frame check from the next frame on
+ * - CAPS: Capability bits (little-endian u16)
+ * - MAX_PAYLOAD: largest request LEN the device accepts, SEQ included
+ * - MAX_RESPONSE: largest response LEN the device sends
+ * - MAX_WINDOW: largest window accepted (MAX_WINDOW_SIZE)
+ *
+ * Hosts must ignore bytes past the ones they know; later versions may
+ * append fields.
+ */
+constexpr size_t CAPABILITY_BLOCK_SIZE = 9;
+
 /**
  * @brief CRC-8 polynomial
  *
@@ -58,11 +170,45 @@ constexpr uint8_t CRC8_POLY = 0x07;
  * - LEN_L: 1 byte  (payload length low byte, little-endian)
  * - LEN_H: 1 byte  (payload length high byte, little-endian)
  * - CMD:   1 byte  (command code)
- * - DATA:  N bytes (payload, 0 <= N <= MAX_PAYLOAD_SIZE)
+ * - DATA:  N bytes (payload, 0 <= N <= the device's MAX_PAYLOAD)
  * - CRC8:  1 byte  (checksum of [LEN_L][LEN_H][CMD][DATA...])
  *
  * Minimum frame size: 5 bytes (STX + LEN_L + LEN_H + CMD + CRC8)
- * Maximum frame size: 517 bytes (5 + 512)
+ * Maximum frame size: 517 bytes (5 + 512) by default; devices with larger
+ * buffers report their MAX_PAYLOAD in the PING capability block
+ *
+ * Windowed mode (negotiated via PING):
+ *
+ * [STX][LEN_L][LEN_H][CMD][SEQ][DATA...][CRC8]          (host -> device)
+ * [STX][LEN_L][LEN_H][ERR_CODE][SEQ][DATA...][CRC8]     (device -> host)
+ *
+ * - SEQ: 1 byte sequence number, counted in LEN, starting at 0 after PING
+ *
+ * The host may send up to WINDOW frames without waiting for responses.
+ * The device handles frames strictly in order and tags each response with
+ * the SEQ of the frame it answers, which acknowledges all earlier frames.
+ * When a frame is lost (CRC error, oversized, or a SEQ gap), the device
+ * sends a single INVALID_FRAME (or BUFFER_FULL) NAK carrying the SEQ to
+ * resend from, and drops the frames in flight until that SEQ arrives
+ * (go-back-N). A retransmitted frame that was already handled is
+ * acknowledged with ERR_OK and no data, without being executed again.
+ *
+ * Wider frame check (negotiated via PING [WINDOW][FLAGS][CRC]):
+ *
+ * [STX][LEN_L][LEN_H][CMD][SEQ][DATA...][CRC16 or CRC32C]
+ *
+ * The check covers the same bytes as CRC8 and is sent little-endian.
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) and CRC-32C (reflected
+ * poly 0x82F63B78, init and final XOR 0xFFFFFFFF) catch far more errors in
+ * long frames; all other fields are unchanged.
+ *
+ * COBS framing (negotiated via PING_FLAG_COBS, may be combined with a window):
+ *
+ * COBS([LEN_L][LEN_H][CMD][SEQ][DATA...][CRC8])[0x00]
+ *
+ * The bytes and checks are those of the frame above minus STX. A frame cut
+ * short by the delimiter, or whose LEN disagrees with its decoded size,
+ * counts as a CRC error.
  */
 
 /* ========================================================================= */
@@ -84,13 +230,115 @@ enum class Command : uint8_t
    */
   EXEC = 0x10,
 
+  /**
+   * @brief Begin a chunked .v4b upload
+   *
+   * Starts streaming a .v4b image that may be larger than the frame
+   * payload limit, followed by CHUNK frames and a final COMMIT.
+   * Any upload in progress is discarded, and an EXEC or RESET received
+   * before COMMIT also discards the upload.
+   * DATA format (optional):
+   * [FLAGS]
+   * - FLAGS: 1 byte of UPLOAD_FLAG_* bits (0 if omitted)
+   *
+   * With UPLOAD_FLAG_COMPRESSED the CHUNK data together forms one
+   * compressed stream (see v4link/internal/lz.hpp) that is decoded
+   * as it arrives. Only offered when Link::capabilities() has
+   * CAP_COMPRESSION.
+   *
+   * Response: ACK with ERR_OK, or GENERAL_ERROR for unsupported FLAGS
+   */
+  BEGIN_UPLOAD = 0x11,
+
+  /**
+   * @brief Upload chunk
+   *
+   * DATA contains the next bytes of the .v4b image, split at arbitrary
+   * boundaries. The header and word table are parsed as they arrive and each
+   * word is registered as soon as its bytecode is complete.
+   *
+   * Response: ACK with ERR_OK, or error code on failure (aborts the upload)
+   */
+  CHUNK = 0x12,
+
+  /**
+   * @brief Commit chunked upload
+   *
+   * Registers and executes the main code of the uploaded image.
+   * DATA field is ignored (typically empty). An image whose word table
+   * has more entries than this response can list is refused with
+   * BUFFER_FULL by the CHUNK carrying its header.
+   *
+   * Response: same as EXEC (ERR_CODE, WORD_COUNT, WORD_IDX...)
+   */
+  COMMIT = 0x13,
+
+  /**
+   * @brief Save the word dictionary as a persistent image
+   *
+   * Writes every registered word, already relocated, to the storage
+   * registered with Link::set_storage(). Link::restore_image() registers
+   * the words again at boot, executing them in place from the image.
+   * DATA field is ignored (typically empty).
+   *
+   * Response format:
+   * [ERR_CODE][WORD_COUNT_L][WORD_COUNT_H][IMAGE_LEN (4 bytes)]
+   * - ERR_CODE: OK, BUFFER_FULL if the image exceeds the storage capacity,
+   *   or GENERAL_ERROR if no storage is registered, a storage write
+   *   failed, or words restored from the storage region are registered
+   * - WORD_COUNT: 2 bytes (little-endian u16 words saved)
+   * - IMAGE_LEN: 4 bytes (little-endian u32 bytes written)
+   */
+  SAVE_IMAGE = 0x14,
+
+  /**
+   * @brief Query the state of the last EXEC or COMMIT run
+   *
+   * With async EXEC (CAP_ASYNC_EXEC) EXEC and COMMIT reply as soon as the
+   * code is loaded, and the device runs it from Link::poll() in bounded
+   * slices. Until the run ends, further EXEC and COMMIT requests are
+   * answered with BUSY; every other command is served between slices.
+   * DATA field is ignored (typically empty).
+   *
+   * Response format:
+   * [ERR_CODE][STATE][WORD_IDX_L][WORD_IDX_H][SLICES (4 bytes)][RESULT (4 bytes)]
+   * - STATE: 1 byte RunState
+   * - WORD_IDX: 2 bytes (little-endian u16, main code being run)
+   * - SLICES: 4 bytes (little-endian u32, slices run so far)
+   * - RESULT: 4 bytes (little-endian i32 V4 error code once FAILED, else 0)
+   */
+  RUN_STATUS = 0x15,
+
+  /**
+   * @brief Cancel the current run
+   *
+   * A RUNNING run stops before its next slice and becomes ABORTED; other
+   * states are left unchanged. DATA field is ignored (typically empty).
+   *
+   * Response format: [ERR_CODE][STATE]
+   * - STATE: 1 byte RunState after the request
+   */
+  ABORT = 0x16,
+
   /**
    * @brief Ping command
    *
    * Used to verify connection and check if the device is responsive.
-   * DATA field is ignored (typically empty).
+   * DATA format (optional):
+   * [WINDOW][FLAGS][CRC]
+   * - WINDOW: 1 byte, requested window size (0 returns to stop-and-wait)
+   * - FLAGS: 1 byte of PING_FLAG_* bits (optional)
+   * - CRC: 1 byte CrcType for later frames (optional, default CRC8);
+   *   values other than CRC8 need their CAP_CRC* bit, else the PING gets
+   *   GENERAL_ERROR and nothing changes
    *
-   * Response: ACK with ERR_OK (0x00)
+   * Response: ACK with ERR_OK (0x00) for an empty PING, or
+   * [ERR_CODE][WINDOW_ACCEPTED] when a window was requested, followed by
+   * the capability block (CAPABILITY_BLOCK_SIZE bytes) if FLAGS has
+   * PING_FLAG_CAPABILITIES. Devices predating the block ignore FLAGS, so
+   * a reply without it identifies a version 0 device.
+   * WINDOW_ACCEPTED is capped at MAX_WINDOW_SIZE; the framing change,
+   * including PING_FLAG_COBS, takes effect with the next frame.
    */
   PING = 0x20,
 
@@ -109,6 +357,98 @@ enum class Command : uint8_t
    */
   QUERY_STACK = 0x30,
 
+  /**
+   * @brief Query link statistics (CAP_STATS)
+   *
+   * Counters cover the time since boot or the last reset.
+   * DATA format (optional): [FLAGS]
+   * - FLAGS: 1 byte of STATS_FLAG_* bits
+   *
+   * Response format:
+   * [ERR_CODE][RX_BYTES][TX_BYTES][RX_DROPPED][CRC_ERRORS][RX_OVERRUNS]
+   * [ARENA_PEAK][UNTRACKED][ERR_COUNT][RESPONSES...]
+   * [CMD_COUNT]([CMD][FRAMES][TOTAL_TIME (8 bytes)][MAX_TIME])*
+   * - RX_BYTES .. UNTRACKED: 4 bytes each (little-endian u32): bytes
+   *   received, bytes sent, bytes skipped while waiting for STX, frames
+   *   with a bad CRC, bytes lost to a full receive ring, highest arena
+   *   usage, frames of commands beyond the tracked slots
+   * - ERR_COUNT: 1 byte, followed by one u32 response count per error
+   *   code, from ERR_OK up
+   * - CMD_COUNT: 1 byte, followed by one entry per command code seen, in
+   *   order of first appearance (entries that do not fit are left out)
+   * - FRAMES / MAX_TIME: 4 bytes (u32); TOTAL_TIME: 8 bytes (u64). Times
+   *   are handler run times in device timestamp units (0 if the device
+   *   has no timestamp source); BATCH includes its sub-commands
+   *
+   * The request itself is counted once its response has been sent, so it
+   * shows up in the next report.
+   */
+  QUERY_STATS = 0x31,
+
+  /**
+   * @brief Drain the event trace (CAP_TRACE)
+   *
+   * Removes the oldest trace records from the device and returns as many
+   * whole records as fit one response. Repeat while TRACE_FLAG_MORE is
+   * set; records of the DUMP_TRACE frames themselves are included.
+   * DATA field is ignored (typically empty).
+   *
+   * Response format:
+   * [ERR_CODE][FLAGS][BASE_TIME (4 bytes)][LOST (4 bytes)][RECORDS...]
+   * - FLAGS: 1 byte of TRACE_FLAG_* bits
+   * - BASE_TIME: little-endian u32 timestamp the first record's delta is
+   *   relative to
+   * - LOST: records overwritten since the previous DUMP_TRACE because the
+   *   trace buffer was full
+   * - RECORDS: ([EVENT][DELTA][ARG])*, EVENT 1 byte (TraceEvent), DELTA
+   *   and ARG unsigned LEB128 (1-5 bytes each). DELTA is the time since
+   *   the previous record in device timestamp units (0 without a
+   *   timestamp source)
+   */
+  DUMP_TRACE = 0x32,
+
+  /**
+   * @brief Zero the word profile and start counting (CAP_PROFILE)
+   *
+   * DATA format (optional): [MODE]
+   * - MODE: 1 byte ProfileMode (default SAMPLE)
+   *
+   * Hits come from the device firmware: a timer interrupt reporting the
+   * word the VM is running, or a CALL hook of the engine. In ENTRY mode
+   * the device also counts each EXEC/COMMIT run it starts.
+   *
+   * Response format:
+   * [ERR_CODE]
+   * - GENERAL_ERROR for an unknown MODE
+   */
+  PROFILE_START = 0x33,
+
+  /**
+   * @brief Stop counting; the profile is kept for PROFILE_DUMP
+   *
+   * Response format:
+   * [ERR_CODE]
+   */
+  PROFILE_STOP = 0x34,
+
+  /**
+   * @brief Report the word profile, hottest words first
+   *
+   * DATA format (optional): [LIMIT]
+   * - LIMIT: 1 byte, most entries to return (0: as many as fit)
+   *
+   * Response format:
+   * [ERR_CODE][ACTIVE][MODE][TOTAL][OTHER][IDLE][COUNT]
+   * ([WORD_IDX (2 bytes)][HITS][NAME_LEN][NAME...])*
+   * - ACTIVE: 1 if still counting; MODE: ProfileMode of the profile
+   * - TOTAL / OTHER / IDLE / HITS: 4 bytes each (little-endian u32): all
+   *   hits, hits of words too high to have their own counter, samples
+   *   with no word running, and hits of one word
+   * - COUNT: 1 byte, entries that follow; words without hits are left out
+   * - NAME: from the VM dictionary, up to 63 bytes (0 for anonymous words)
+   */
+  PROFILE_DUMP = 0x35,
+
   /**
    * @brief Query memory dump
    *
@@ -125,6 +465,63 @@ enum class Command : uint8_t
    */
   QUERY_MEMORY = 0x40,
 
+  /**
+   * @brief Read a block of VM memory
+   *
+   * DATA format:
+   * [ADDR_L][ADDR_M][ADDR_H][ADDR_X][LEN_L][LEN_H]
+   * - ADDR: 4 bytes (little-endian u32 address)
+   * - LEN: 2 bytes (little-endian u16 length, max Link::mem_block_max())
+   *
+   * Response format:
+   * [ERR_CODE][COUNT_L][COUNT_H][DATA...]
+   * - ERR_CODE: OK if all LEN bytes were read, VM_ERROR if the range runs
+   *   past the end of VM memory
+   * - COUNT: 2 bytes (little-endian u16, bytes actually read)
+   * - DATA: COUNT bytes starting at ADDR
+   *
+   * LEN above the limit is rejected with BUFFER_FULL and no data.
+   */
+  READ_MEM_BLOCK = 0x41,
+
+  /**
+   * @brief Write a block of VM memory
+   *
+   * DATA format:
+   * [ADDR_L][ADDR_M][ADDR_H][ADDR_X][DATA...]
+   * - ADDR: 4 bytes (little-endian u32 address)
+   * - DATA: bytes to write (max Link::mem_block_max())
+   *
+   * Response format:
+   * [ERR_CODE][COUNT_L][COUNT_H]
+   * - ERR_CODE: OK if all bytes were written, VM_ERROR if the range runs
+   *   past the end of VM memory
+   * - COUNT: 2 bytes (little-endian u16, bytes actually written from the
+   *   start of DATA)
+   */
+  WRITE_MEM_BLOCK = 0x42,
+
+  /**
+   * @brief Subscribe to changes of a VM memory region
+   *
+   * DATA format:
+   * [ID][ADDR_L][ADDR_M][ADDR_H][ADDR_X][LEN_L][LEN_H]
+   * - ID: 1 byte watch slot (0 to MAX_WATCH_REGIONS - 1)
+   * - ADDR: 4 bytes (little-endian u32 address)
+   * - LEN: 2 bytes (little-endian u16 length, 0 cancels the slot)
+   *
+   * Response: ACK with ERR_OK, GENERAL_ERROR for a bad ID, VM_ERROR if
+   * the region is not inside VM memory, or BUFFER_FULL if all watches
+   * together would exceed MAX_WATCH_BYTES. A slot that is already in use
+   * is replaced; if the new region is rejected the slot is left unused.
+   *
+   * The device then compares each region with its shadow copy after every
+   * EXEC and COMMIT, and on the Link::tick() watch interval, and pushes
+   * the changed bytes as Event::MEMORY_DELTA frames. The first push after
+   * subscribing carries the whole region.
+   */
+  WATCH_MEMORY = 0x43,
+
   /**
    * @brief Query word information
    *
@@ -143,6 +540,106 @@ enum class Command : uint8_t
    */
   QUERY_WORD = 0x50,
 
+  /**
+   * @brief Ask which words are already resident
+   *
+   * DATA format:
+   * [HASH_0 (4 bytes)][HASH_1 (4 bytes)]...
+   * - HASH: little-endian u32 chain hash of a .v4b word (see
+   *   internal/word_hash.hpp)
+   *
+   * Response format:
+   * [ERR_CODE][WORD_IDX_0 (2 bytes)][WORD_IDX_1 (2 bytes)]...
+   * - WORD_IDX: VM index of the resident word, 0xFFFF if not resident
+   *
+   * Every word loaded from a .v4b image is recorded under its hash until
+   * RESET. A later image may replace resident words with
+   * [0xFF][HASH (4 bytes)] reference entries (v0.4+), and full entries of
+   * resident words are linked to the existing copy instead of being
+   * stored again.
+   */
+  HAVE_WORDS = 0x51,
+
+  /**
+   * @brief Look up a word index by name
+   *
+   * DATA format:
+   * [NAME...]
+   * - NAME: 1-255 bytes, the whole payload (no length byte or terminator)
+   *
+   * Response format:
+   * [ERR_CODE][WORD_IDX (2 bytes)]
+   * - WORD_IDX: little-endian u16 VM index of the newest word with that
+   *   name; VM_ERROR (no data) if none
+   *
+   * Names of words registered by EXEC, COMMIT and restore_image() are
+   * indexed until RESET, so the host need not read the dictionary back.
+   */
+  QUERY_WORD_BY_NAME = 0x52,
+
+  /**
+   * @brief Swap the code behind an existing word index
+   *
+   * DATA format:
+   * [WORD_IDX (2 bytes)][CODE...]
+   * - WORD_IDX: little-endian u16 index of the word to replace
+   * - CODE: new bytecode (at least 1 byte), CALL operands as VM indices
+   *
+   * Response: ACK (OK), VM_ERROR if there is no such word, BUFFER_FULL if
+   * the arena has no room, BUSY while an async run is in progress
+   *
+   * The index and name are kept, so CALLs already linked to the word run
+   * the new code. Code no longer than the old one overwrites it in the
+   * arena; longer code is stored anew and the old copy is reclaimed by
+   * FORGET_FROM or RESET. The dictionary is rebuilt, which clears the
+   * stacks, and resident words from this index on leave the word cache
+   * (HAVE_WORDS) since their chain hashes no longer describe them.
+   */
+  REPLACE_WORD = 0x53,
+
+  /**
+   * @brief Forget a word and every word registered after it
+   *
+   * DATA format:
+   * [WORD_IDX (2 bytes)]
+   * - WORD_IDX: little-endian u16 index of the first word to forget
+   *
+   * Response: ACK (OK), VM_ERROR if there is no such word, BUSY while an
+   * async run is in progress
+   *
+   * The words below WORD_IDX keep their indices; the arena is released
+   * down to the end of their storage, so the next load reuses the space
+   * and the indices. Like REPLACE_WORD, the stacks are cleared.
+   */
+  FORGET_FROM = 0x54,
+
+  /**
+   * @brief Run several commands from one frame
+   *
+   * DATA format:
+   * ([CMD][LEN_L][LEN_H][DATA...])*
+   * - CMD: 1 byte sub-command
+   * - LEN: 2 bytes (little-endian u16 length of its DATA)
+   * - DATA: sub-command data, as in its own frame (no SEQ)
+   *
+   * Sub-commands run in order. EXEC, RUN_STATUS, ABORT, QUERY_STACK,
+   * QUERY_STATS, QUERY_MEMORY, READ_MEM_BLOCK, WRITE_MEM_BLOCK, WATCH_MEMORY, QUERY_WORD,
+   * HAVE_WORDS, QUERY_WORD_BY_NAME, REPLACE_WORD, FORGET_FROM and RESET are
+   * allowed; any other command yields a GENERAL_ERROR result without running.
+   *
+   * Response format:
+   * [ERR_CODE][COUNT]([SUB_ERR][LEN_L][LEN_H][DATA...])*
+   * - ERR_CODE: OK if every sub-command ran, INVALID_FRAME if a
+   *   sub-command header or DATA was truncated, BUFFER_FULL if the reply
+   *   had no room left for the next result
+   * - COUNT: 1 byte, number of results that follow
+   * - SUB_ERR / LEN / DATA: each sub-command's own response
+   *
+   * Processing stops at the first truncated or unanswerable sub-command,
+   * so results always correspond to a prefix of the batch.
+   */
+  BATCH = 0x60,
+
   /**
    * @brief Reset VM
    *
@@ -154,6 +651,74 @@ enum class Command : uint8_t
   RESET = 0xFF,
 };
 
+/* ========================================================================= */
+/* Event codes                                                               */
+/* ========================================================================= */
+
+/**
+ * @brief Codes of device-initiated event frames
+ *
+ * An event frame is sent without a request:
+ * [STX][LEN_L][LEN_H][EVENT][DATA...][CRC8]
+ *
+ * EVENT sits where responses carry ERR_CODE. Event codes have bit 7 set,
+ * which no ErrorCode does. Event frames never carry SEQ and do not
+ * acknowledge anything in windowed mode.
+ */
+enum class Event : uint8_t
+{
+  /**
+   * @brief Changed bytes of a WATCH_MEMORY region
+   *
+   * DATA format:
+   * [ID]([OFFSET_L][OFFSET_H][LEN_L][LEN_H][BYTES...])*
+   * - ID: 1 byte watch slot
+   * - OFFSET: 2 bytes (little-endian u16, offset within the region)
+   * - LEN: 2 bytes (little-endian u16, run length)
+   * - BYTES: new contents of the run
+   *
+   * Changes closer together than one run header are merged into one run.
+   * A region whose changes do not fit one frame is split across several.
+   */
+  MEMORY_DELTA = 0x80,
+};
+
+/**
+ * @brief Trace record types returned by DUMP_TRACE
+ */
+enum class TraceEvent : uint8_t
+{
+  FRAME_START = 0x01,    // STX accepted; ARG 0
+  FRAME_CRC = 0x02,      // Frame check done; ARG 1 if it matched, else 0
+  FRAME_END = 0x03,      // Frame handled; ARG command code
+  WORD_REGISTER = 0x04,  // vm_register_word() returned; ARG word index (or error)
+  RELOCATE = 0x05,       // CALL operands of a load patched; ARG operand count
+  EXEC_START = 0x06,     // vm_exec() or a slice entered; ARG word index
+  EXEC_END = 0x07,       // vm_exec() or a slice returned; ARG V4 error code
+  RESPONSE = 0x08,       // Response frame sent; ARG error code
+};
+
+/**
+ * @brief What a PROFILE_DUMP hit counts
+ */
+enum class ProfileMode : uint8_t
+{
+  SAMPLE = 0x00,  // Timer samples of the running word
+  ENTRY = 0x01,   // Entries into a word
+};
+
+/**
+ * @brief State of the last run, reported by RUN_STATUS
+ */
+enum class RunState : uint8_t
+{
+  IDLE = 0x00,     // Nothing run since construction or RESET
+  RUNNING = 0x01,  // Started, more slices to go (async EXEC only)
+  DONE = 0x02,     // Returned normally
+  FAILED = 0x03,   // Stopped with a VM error (RESULT)
+  ABORTED = 0x04,  // Cancelled by ABORT
+};
+
 /* ========================================================================= */
 /* Response codes                                                            */
 /* ========================================================================= */
@@ -0,0 +1,228 @@
+/**
+ * @file server.hpp
+ * @brief Host-side server running many Link instances on a thread pool
+ *
+ * For simulation farms and load tests on x86: each channel is one Link
+ * with its own VM, fed from its own byte stream (one connection per
+ * channel, so the frame format is unchanged). Channels are scheduled on
+ * worker threads with per-worker queues and work stealing, so a slow
+ * EXEC only occupies the worker running it.
+ *
+ * Not part of the firmware library: build with V4LINK_BUILD_SERVER and
+ * link v4link_server.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+/**
+ * @brief Thread pool multiplexing Link/Vm pairs by channel id
+ *
+ * A channel is handled by at most one worker at a time, so each Link
+ * still sees a single-threaded stream and the Link API is unchanged.
+ * Different channels run in parallel.
+ *
+ * Example usage:
+ * @code
+ * LinkServer server(send_fn, ctx);        // One worker per core
+ * const auto ch = server.add_channel(vm);  // Once per simulated device
+ * server.submit(ch, bytes, len);           // From the connection reader
+ * server.drain();                          // Wait for all responses
+ * @endcode
+ */
+class LinkServer
+{
+ public:
+  using ChannelId = uint32_t;
+
+  /**
+   * @brief Response callback function type
+   *
+   * Called from worker threads with the response bytes of one channel.
+   * Calls for the same channel never overlap; calls for different channels
+   * may run concurrently.
+   *
+   * @param user    User context pointer passed during construction
+   * @param channel Channel that produced the bytes
+   * @param data    Frame bytes, valid only for the duration of the call
+   * @param len     Number of bytes
+   */
+  using SendFn = void (*)(void* user, ChannelId channel, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Start the worker threads
+   *
+   * @param send    Response callback
+   * @param user    User context pointer passed to @p send
+   * @param threads Number of workers (0: one per hardware thread)
+   */
+  LinkServer(SendFn send, void* user = nullptr, size_t threads = 0);
+
+  /**
+   * @brief Stop and join the workers
+   *
+   * Workers stop after the channel they are running: bytes not yet
+   * processed are discarded, and async runs still in progress are aborted.
+   * Call drain() first to keep them.
+   */
+  ~LinkServer();
+
+  LinkServer(const LinkServer&) = delete;
+  LinkServer& operator=(const LinkServer&) = delete;
+
+  /**
+   * @brief Add a channel serving @p vm
+   *
+   * Not thread-safe with submit(): add every channel before submitting
+   * bytes. The VM stays owned by the caller and must outlive the server.
+   *
+   * @param vm          Initialized VM, used only by this channel
+   * @param buffer_size Link buffer size (see Link::Link())
+   * @param arena_size  Link arena size (see Link::Link())
+   * @return Id of the new channel (channels are numbered from 0)
+   */
+  ChannelId add_channel(Vm* vm, size_t buffer_size = MAX_PAYLOAD_SIZE,
+                        size_t arena_size = Link::DEFAULT_ARENA_SIZE);
+
+  /**
+   * @brief Link of @p channel, for configuration before bytes are submitted
+   */
+  Link& link(ChannelId channel)
+  {
+    return channels_[channel]->link;
+  }
+
+  /**
+   * @brief Queue received bytes for @p channel
+   *
+   * Thread-safe. Bytes of one channel are processed in submission order;
+   * frames may be split across calls at any byte.
+   *
+   * @param channel Channel id from add_channel()
+   * @param data    Received bytes (copied)
+   * @param len     Number of bytes
+   */
+  void submit(ChannelId channel, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Wait until every submitted byte has been processed
+   *
+   * Includes runs left RUNNING by async EXEC, which are stepped to the end.
+   */
+  void drain();
+
+  /**
+   * @brief Number of worker threads
+   */
+  size_t thread_count() const
+  {
+    return workers_.size();
+  }
+
+  /**
+   * @brief Channels taken from another worker's queue so far
+   */
+  size_t steals() const
+  {
+    return steals_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /**
+   * @brief One simulated device
+   */
+  struct Channel
+  {
+    Channel(LinkServer* owner, ChannelId channel_id, Vm* vm, size_t buffer_size,
+            size_t arena_size);
+
+    LinkServer* server;          ///< Owner (for the send trampoline)
+    ChannelId id;                ///< Index in channels_
+    Link link;                   ///< Protocol core for this device
+    std::mutex inbox_mutex;      ///< Guards inbox and scheduled
+    std::vector<uint8_t> inbox;  ///< Bytes submitted and not yet taken
+    bool scheduled;              ///< Queued on, or being run by, a worker
+  };
+
+  /**
+   * @brief Per-worker run queue
+   *
+   * The owner takes channels from the front, in submission order; idle
+   * workers steal from the back.
+   */
+  struct WorkQueue
+  {
+    std::mutex mutex;               ///< Guards channels
+    std::deque<Channel*> channels;  ///< Channels waiting to run
+  };
+
+  /**
+   * @brief UartWriteFn of every channel's Link (user: the Channel)
+   */
+  static void send_trampoline(void* user, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Worker thread body: run channels until stopped
+   */
+  void worker_main(size_t index);
+
+  /**
+   * @brief Take a channel from worker @p index's queue, or steal one
+   *
+   * @return Channel to run, or nullptr if every queue is empty
+   */
+  Channel* next_channel(size_t index);
+
+  /**
+   * @brief Feed a channel everything submitted so far, then requeue or idle it
+   */
+  void run_channel(size_t index, Channel* channel, std::vector<uint8_t>& scratch);
+
+  /**
+   * @brief Append @p channel to worker @p index's queue and wake a worker
+   */
+  void enqueue(size_t index, Channel* channel);
+
+  /**
+   * @brief Mark one scheduled channel idle, waking drain() on the last
+   */
+  void finish_one();
+
+  SendFn send_;  ///< Response callback
+  void* user_;   ///< User context for send_
+
+  std::vector<std::unique_ptr<Channel>> channels_;  ///< Indexed by ChannelId
+  std::vector<std::unique_ptr<WorkQueue>> queues_;  ///< One per worker
+  std::vector<std::thread> workers_;                ///< Worker threads
+
+  std::mutex idle_mutex_;               ///< Guards sleeping and waking workers
+  std::condition_variable work_ready_;  ///< Signalled when a channel is queued
+  std::condition_variable drained_;     ///< Signalled when pending_ reaches 0
+  std::atomic<size_t> queued_;          ///< Channels waiting in any queue
+  std::atomic<size_t> pending_;         ///< Channels scheduled (queued or running)
+  std::atomic<size_t> next_queue_;      ///< Round-robin target for submit()
+  std::atomic<size_t> steals_;          ///< Successful steals
+  std::atomic<bool> stop_;              ///< Workers exit (set under idle_mutex_)
+};
+
+}  // namespace link
+}  // namespace v4
@@ -0,0 +1,48 @@
+/**
+ * @file arena.cpp
+ * @brief Bytecode arena implementation
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/internal/arena.hpp"
+
+namespace v4::link::internal
+{
+
+BytecodeArena::BytecodeArena(uint8_t* region, size_t size)
+    : owned_(), base_(region), size_(size), top_(0), peak_(0)
+{
+  if (base_ == nullptr)
+  {
+    owned_.resize(size);
+    base_ = owned_.data();
+  }
+}
+
+uint8_t* BytecodeArena::alloc(size_t len)
+{
+  if (len > size_ - top_)
+  {
+    return nullptr;
+  }
+
+  uint8_t* ptr = base_ + top_;
+  top_ += len;
+  if (top_ > peak_)
+  {
+    peak_ = top_;
+  }
+  return ptr;
+}
+
+void BytecodeArena::release(size_t mark)
+{
+  if (mark < top_)
+  {
+    top_ = mark;
+  }
+}
+
+}  // namespace v4::link::internal
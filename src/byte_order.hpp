@@ -0,0 +1,47 @@
+/**
+ * @file byte_order.hpp
+ * @brief Little-endian load/store helpers (internal)
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace v4
+{
+namespace link
+{
+namespace internal
+{
+
+inline uint16_t load_le16(const uint8_t* in)
+{
+  return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+inline uint32_t load_le32(const uint8_t* in)
+{
+  return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+         (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+inline void store_le16(uint8_t* out, uint16_t value)
+{
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+inline void store_le32(uint8_t* out, uint32_t value)
+{
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+  out[2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+  out[3] = static_cast<uint8_t>((value >> 24) & 0xFF);
+}
+
+}  // namespace internal
+}  // namespace link
+}  // namespace v4
@@ -0,0 +1,40 @@
+/**
+ * @file cobs.cpp
+ * @brief COBS encoder
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/internal/cobs.hpp"
+
+namespace v4::link::internal
+{
+
+size_t cobs_encode(const uint8_t* src, size_t len, uint8_t* dst)
+{
+  // Each byte is read before anything is written at or past its position
+  // when dst starts cobs_overhead(len) bytes early
+  size_t code_at = 0;
+  size_t out = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; ++i)
+  {
+    const uint8_t byte = src[i];
+    if (byte != 0)
+    {
+      dst[out++] = byte;
+      ++code;
+    }
+    if (byte == 0 || code == 0xFF)
+    {
+      dst[code_at] = code;
+      code_at = out++;
+      code = 1;
+    }
+  }
+  dst[code_at] = code;
+  return out;
+}
+
+}  // namespace v4::link::internal
@@ -2,6 +2,12 @@
  * @file crc8.cpp
  * @brief CRC-8 checksum implementation
  *
+ * The backend is selected at build time via V4LINK_CRC8_BACKEND:
+ * - TABLE:   256-entry lookup table (fastest, 256 bytes of flash)
+ * - NIBBLE:  16-entry lookup table (two lookups per byte, 16 bytes of flash)
+ * - BITWISE: shift-and-xor loop (no table)
+ * - HW:      forwards to the platform hook v4link_crc8_hw_update()
+ *
  * @copyright Copyright 2025 Akihito Kirisaki
  * @license Dual-licensed under MIT or Apache-2.0
  */
@@ -10,6 +16,13 @@
 
 #include "v4link/protocol.hpp"
 
+#if defined(V4LINK_CRC8_BACKEND_HW)
+#include "v4link/link.h"
+#elif !defined(V4LINK_CRC8_BACKEND_BITWISE) && !defined(V4LINK_CRC8_BACKEND_NIBBLE) && \
+    !defined(V4LINK_CRC8_BACKEND_TABLE)
+#define V4LINK_CRC8_BACKEND_TABLE
+#endif
+
 namespace v4
 {
 namespace link
@@ -17,10 +30,84 @@ namespace link
 namespace internal
 {
 
-uint8_t calc_crc8(const uint8_t* data, size_t len)
+namespace
+{
+
+#if defined(V4LINK_CRC8_BACKEND_TABLE) || defined(V4LINK_CRC8_BACKEND_NIBBLE)
+
+/**
+ * @brief Shift a CRC value through @p bits zero bits
+ */
+constexpr uint8_t crc8_shift(uint8_t crc, int bits)
+{
+  for (int bit = 0; bit < bits; ++bit)
+  {
+    crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ CRC8_POLY)
+                       : static_cast<uint8_t>(crc << 1);
+  }
+  return crc;
+}
+
+template <size_t N>
+struct Crc8Table
+{
+  uint8_t entries[N];
+};
+
+#endif
+
+#if defined(V4LINK_CRC8_BACKEND_TABLE)
+
+constexpr Crc8Table<256> make_crc8_table()
+{
+  Crc8Table<256> table{};
+  for (size_t i = 0; i < 256; ++i)
+  {
+    table.entries[i] = crc8_shift(static_cast<uint8_t>(i), 8);
+  }
+  return table;
+}
+
+constexpr Crc8Table<256> kCrc8Table = make_crc8_table();
+
+#elif defined(V4LINK_CRC8_BACKEND_NIBBLE)
+
+constexpr Crc8Table<16> make_crc8_nibble_table()
 {
-  uint8_t crc = 0x00;
+  Crc8Table<16> table{};
+  for (size_t i = 0; i < 16; ++i)
+  {
+    table.entries[i] = crc8_shift(static_cast<uint8_t>(i << 4), 4);
+  }
+  return table;
+}
+
+constexpr Crc8Table<16> kCrc8NibbleTable = make_crc8_nibble_table();
+
+#endif
 
+}  // namespace
+
+uint8_t crc8_update(uint8_t crc, const uint8_t* data, size_t len)
+{
+#if defined(V4LINK_CRC8_BACKEND_HW)
+  if (len > 0)
+  {
+    crc = v4link_crc8_hw_update(crc, data, len);
+  }
+#elif defined(V4LINK_CRC8_BACKEND_TABLE)
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = kCrc8Table.entries[crc ^ data[i]];
+  }
+#elif defined(V4LINK_CRC8_BACKEND_NIBBLE)
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc ^= data[i];
+    crc = static_cast<uint8_t>(crc << 4) ^ kCrc8NibbleTable.entries[crc >> 4];
+    crc = static_cast<uint8_t>(crc << 4) ^ kCrc8NibbleTable.entries[crc >> 4];
+  }
+#else
   for (size_t i = 0; i < len; ++i)
   {
     crc ^= data[i];
@@ -37,10 +124,25 @@ uint8_t calc_crc8(const uint8_t* data, size_t len)
       }
     }
   }
+#endif
 
   return crc;
 }
 
+uint8_t crc8_update(uint8_t crc, uint8_t byte)
+{
+#if defined(V4LINK_CRC8_BACKEND_TABLE)
+  return kCrc8Table.entries[crc ^ byte];
+#else
+  return crc8_update(crc, &byte, 1);
+#endif
+}
+
+uint8_t calc_crc8(const uint8_t* data, size_t len)
+{
+  return crc8_finalize(crc8_update(crc8_init(), data, len));
+}
+
 }  // namespace internal
 }  // namespace link
 }  // namespace v4
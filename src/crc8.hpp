@@ -22,6 +22,7 @@ namespace internal
  * @brief Calculate CRC-8 checksum
  *
  * Uses polynomial 0x07 (x^8 + x^2 + x + 1) with initial value 0x00.
+ * Equivalent to crc8_finalize(crc8_update(crc8_init(), data, len)).
  *
  * @param data Pointer to data buffer
  * @param len  Length of data in bytes
@@ -29,6 +30,46 @@ namespace internal
  */
 uint8_t calc_crc8(const uint8_t* data, size_t len);
 
+/* Streaming API: compute a CRC incrementally as data arrives. */
+
+/**
+ * @brief Initial CRC-8 state
+ */
+constexpr uint8_t crc8_init()
+{
+  return 0x00;
+}
+
+/**
+ * @brief Feed one byte into a running CRC-8
+ *
+ * @param crc  Current CRC state
+ * @param byte Next data byte
+ * @return Updated CRC state
+ */
+uint8_t crc8_update(uint8_t crc, uint8_t byte);
+
+/**
+ * @brief Feed a block of bytes into a running CRC-8
+ *
+ * @param crc  Current CRC state
+ * @param data Pointer to data buffer
+ * @param len  Length of data in bytes
+ * @return Updated CRC state
+ */
+uint8_t crc8_update(uint8_t crc, const uint8_t* data, size_t len);
+
+/**
+ * @brief Convert a running CRC-8 state into the checksum value
+ *
+ * CRC-8/0x07 has no final XOR, so this is the identity; it exists so that
+ * callers do not depend on that detail.
+ */
+constexpr uint8_t crc8_finalize(uint8_t crc)
+{
+  return crc;
+}
+
 }  // namespace internal
 }  // namespace link
 }  // namespace v4
@@ -0,0 +1,286 @@
+/**
+ * @file crc_wide.cpp
+ * @brief CRC-16/CCITT-FALSE and CRC-32C implementation
+ *
+ * The software backend is selected at build time via
+ * V4LINK_WIDE_CRC_BACKEND:
+ * - SLICE8:  slicing-by-8, eight bytes per step (12 KiB of tables; host default)
+ * - TABLE:   256-entry lookup tables, one byte per step (1.5 KiB)
+ * - BITWISE: shift-and-xor loops (no tables)
+ *
+ * CRC-32C uses the SSE4.2 or ARMv8 CRC32C instructions instead whenever
+ * the target is compiled for them. x86-64 SLICE8 builds without -msse4.2
+ * also check the CPU at run time, so generic host binaries use them too.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "crc_wide.hpp"
+
+#include <cstring>
+
+#if !defined(V4LINK_WIDE_CRC_BACKEND_SLICE8) && \
+    !defined(V4LINK_WIDE_CRC_BACKEND_TABLE) && !defined(V4LINK_WIDE_CRC_BACKEND_BITWISE)
+#define V4LINK_WIDE_CRC_BACKEND_TABLE
+#endif
+
+#if defined(__x86_64__) && defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define V4LINK_CRC32C_SSE42 1
+#define V4LINK_CRC32C_TARGET
+#elif defined(__x86_64__) && defined(__GNUC__) && defined(V4LINK_WIDE_CRC_BACKEND_SLICE8)
+#include <nmmintrin.h>
+#define V4LINK_CRC32C_SSE42 1
+#define V4LINK_CRC32C_DISPATCH 1
+#define V4LINK_CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_acle.h>
+#define V4LINK_CRC32C_ARM 1
+#endif
+
+// Software CRC-32C: the fallback, unless an instruction always replaces it
+#define V4LINK_CRC32C_SOFTWARE \
+  !(V4LINK_CRC32C_ARM || (V4LINK_CRC32C_SSE42 && !V4LINK_CRC32C_DISPATCH))
+
+namespace v4
+{
+namespace link
+{
+namespace internal
+{
+
+namespace
+{
+
+#if defined(V4LINK_WIDE_CRC_BACKEND_SLICE8)
+constexpr size_t kSlices = 8;
+#elif defined(V4LINK_WIDE_CRC_BACKEND_TABLE)
+constexpr size_t kSlices = 1;
+#endif
+
+/**
+ * @brief Shift a CRC-16 value through eight zero bits
+ */
+constexpr uint16_t crc16_shift(uint16_t crc)
+{
+  for (int bit = 0; bit < 8; ++bit)
+  {
+    crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ CRC16_CCITT_POLY)
+                         : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+}
+
+#if V4LINK_CRC32C_SOFTWARE
+
+/**
+ * @brief Shift a reflected CRC-32C value through eight zero bits
+ */
+constexpr uint32_t crc32c_shift(uint32_t crc)
+{
+  for (int bit = 0; bit < 8; ++bit)
+  {
+    crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+  }
+  return crc;
+}
+
+#endif
+
+#if defined(V4LINK_WIDE_CRC_BACKEND_SLICE8) || defined(V4LINK_WIDE_CRC_BACKEND_TABLE)
+
+/**
+ * @brief entries[k][n]: the CRC of byte n followed by k zero bytes
+ */
+template <typename T, size_t N>
+struct CrcTables
+{
+  T entries[N][256];
+};
+
+constexpr CrcTables<uint16_t, kSlices> make_crc16_tables()
+{
+  CrcTables<uint16_t, kSlices> tables{};
+  for (size_t i = 0; i < 256; ++i)
+  {
+    tables.entries[0][i] = crc16_shift(static_cast<uint16_t>(i << 8));
+  }
+  for (size_t k = 1; k < kSlices; ++k)
+  {
+    for (size_t i = 0; i < 256; ++i)
+    {
+      const uint16_t prev = tables.entries[k - 1][i];
+      tables.entries[k][i] =
+          static_cast<uint16_t>(prev << 8) ^ tables.entries[0][prev >> 8];
+    }
+  }
+  return tables;
+}
+
+#if V4LINK_CRC32C_SOFTWARE
+
+constexpr CrcTables<uint32_t, kSlices> make_crc32c_tables()
+{
+  CrcTables<uint32_t, kSlices> tables{};
+  for (size_t i = 0; i < 256; ++i)
+  {
+    tables.entries[0][i] = crc32c_shift(static_cast<uint32_t>(i));
+  }
+  for (size_t k = 1; k < kSlices; ++k)
+  {
+    for (size_t i = 0; i < 256; ++i)
+    {
+      const uint32_t prev = tables.entries[k - 1][i];
+      tables.entries[k][i] = (prev >> 8) ^ tables.entries[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+constexpr CrcTables<uint32_t, kSlices> kCrc32cTables = make_crc32c_tables();
+
+#endif
+
+constexpr CrcTables<uint16_t, kSlices> kCrc16Tables = make_crc16_tables();
+
+#endif
+
+#if V4LINK_CRC32C_SOFTWARE
+
+uint32_t crc32c_software(uint32_t crc, const uint8_t* data, size_t len)
+{
+#if defined(V4LINK_WIDE_CRC_BACKEND_SLICE8)
+  const auto& t = kCrc32cTables.entries;
+  for (; len >= 8; data += 8, len -= 8)
+  {
+    uint32_t lo = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) |
+                         (static_cast<uint32_t>(data[3]) << 24));
+    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^
+          t[4][lo >> 24] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+#endif
+
+#if defined(V4LINK_WIDE_CRC_BACKEND_BITWISE)
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = crc32c_shift(crc ^ data[i]);
+  }
+#else
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = (crc >> 8) ^ kCrc32cTables.entries[0][(crc ^ data[i]) & 0xFF];
+  }
+#endif
+  return crc;
+}
+
+#endif
+
+#if V4LINK_CRC32C_SSE42
+
+V4LINK_CRC32C_TARGET uint32_t crc32c_sse42(uint32_t crc, const uint8_t* data, size_t len)
+{
+  uint64_t crc64 = crc;
+  for (; len >= 8; data += 8, len -= 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = _mm_crc32_u8(crc, data[i]);
+  }
+  return crc;
+}
+
+#endif
+
+#if V4LINK_CRC32C_DISPATCH
+
+bool have_sse42()
+{
+  static const bool have = []
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+  }();
+  return have;
+}
+
+#endif
+
+#if V4LINK_CRC32C_ARM
+
+uint32_t crc32c_arm(uint32_t crc, const uint8_t* data, size_t len)
+{
+  for (; len >= 4; data += 4, len -= 4)
+  {
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc = __crc32cw(crc, word);
+  }
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = __crc32cb(crc, data[i]);
+  }
+  return crc;
+}
+
+#endif
+
+}  // namespace
+
+uint16_t crc16_update(uint16_t crc, const uint8_t* data, size_t len)
+{
+#if defined(V4LINK_WIDE_CRC_BACKEND_SLICE8)
+  const auto& t = kCrc16Tables.entries;
+  for (; len >= 8; data += 8, len -= 8)
+  {
+    crc = t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xFF)] ^ t[5][data[2]] ^
+          t[4][data[3]] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+#endif
+
+#if defined(V4LINK_WIDE_CRC_BACKEND_BITWISE)
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = crc16_shift(static_cast<uint16_t>(crc ^ (data[i] << 8)));
+  }
+#else
+  for (size_t i = 0; i < len; ++i)
+  {
+    crc = static_cast<uint16_t>(crc << 8) ^ kCrc16Tables.entries[0][(crc >> 8) ^ data[i]];
+  }
+#endif
+  return crc;
+}
+
+uint32_t crc32c_update(uint32_t crc, const uint8_t* data, size_t len)
+{
+#if V4LINK_CRC32C_ARM
+  return crc32c_arm(crc, data, len);
+#elif V4LINK_CRC32C_DISPATCH
+  return have_sse42() ? crc32c_sse42(crc, data, len) : crc32c_software(crc, data, len);
+#elif V4LINK_CRC32C_SSE42
+  return crc32c_sse42(crc, data, len);
+#else
+  return crc32c_software(crc, data, len);
+#endif
+}
+
+uint16_t calc_crc16(const uint8_t* data, size_t len)
+{
+  return crc16_finalize(crc16_update(crc16_init(), data, len));
+}
+
+uint32_t calc_crc32c(const uint8_t* data, size_t len)
+{
+  return crc32c_finalize(crc32c_update(crc32c_init(), data, len));
+}
+
+}  // namespace internal
+}  // namespace link
+}  // namespace v4
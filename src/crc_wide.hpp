@@ -0,0 +1,90 @@
+/**
+ * @file crc_wide.hpp
+ * @brief CRC-16/CCITT-FALSE and CRC-32C frame checks (internal)
+ *
+ * Wider alternatives to CRC-8 for long frames, negotiated via PING (see
+ * CrcType). The streaming API mirrors crc8.hpp.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace v4
+{
+namespace link
+{
+namespace internal
+{
+
+/**
+ * @brief CRC-16/CCITT-FALSE polynomial (x^16 + x^12 + x^5 + 1, MSB first)
+ */
+constexpr uint16_t CRC16_CCITT_POLY = 0x1021;
+
+/**
+ * @brief CRC-32C (Castagnoli) polynomial, bit-reversed
+ */
+constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+/**
+ * @brief Initial CRC-16/CCITT-FALSE state
+ */
+constexpr uint16_t crc16_init()
+{
+  return 0xFFFF;
+}
+
+/**
+ * @brief Feed a block of bytes into a running CRC-16/CCITT-FALSE
+ */
+uint16_t crc16_update(uint16_t crc, const uint8_t* data, size_t len);
+
+/**
+ * @brief Convert a running CRC-16 state into the checksum value (no final XOR)
+ */
+constexpr uint16_t crc16_finalize(uint16_t crc)
+{
+  return crc;
+}
+
+/**
+ * @brief Calculate CRC-16/CCITT-FALSE ("123456789" gives 0x29B1)
+ */
+uint16_t calc_crc16(const uint8_t* data, size_t len);
+
+/**
+ * @brief Initial CRC-32C state
+ */
+constexpr uint32_t crc32c_init()
+{
+  return 0xFFFFFFFF;
+}
+
+/**
+ * @brief Feed a block of bytes into a running CRC-32C
+ *
+ * Uses the SSE4.2 or ARMv8 CRC32C instructions where available.
+ */
+uint32_t crc32c_update(uint32_t crc, const uint8_t* data, size_t len);
+
+/**
+ * @brief Convert a running CRC-32C state into the checksum value
+ */
+constexpr uint32_t crc32c_finalize(uint32_t crc)
+{
+  return crc ^ 0xFFFFFFFF;
+}
+
+/**
+ * @brief Calculate CRC-32C ("123456789" gives 0xE3069283)
+ */
+uint32_t calc_crc32c(const uint8_t* data, size_t len);
+
+}  // namespace internal
+}  // namespace link
+}  // namespace v4
@@ -8,7 +8,11 @@
 
 #include "frame.hpp"
 
+#include <cstring>
+
+#include "byte_order.hpp"
 #include "crc8.hpp"
+#include "crc_wide.hpp"
 
 namespace v4
 {
@@ -17,35 +21,79 @@ namespace link
 namespace internal
 {
 
-bool encode_frame(Command cmd, const uint8_t* data, size_t len, std::vector<uint8_t>& out)
+FrameCheck::FrameCheck(CrcType type)
+    : type_(type),
+      crc_(type == CrcType::CRC32C        ? crc32c_init()
+           : type == CrcType::CRC16_CCITT ? crc16_init()
+                                          : crc8_init())
 {
-  // Check payload size limit
-  if (len > MAX_PAYLOAD_SIZE)
+}
+
+void FrameCheck::update(const uint8_t* data, size_t len)
+{
+  switch (type_)
   {
-    return false;
+    case CrcType::CRC16_CCITT:
+      crc_ = crc16_update(static_cast<uint16_t>(crc_), data, len);
+      break;
+    case CrcType::CRC32C:
+      crc_ = crc32c_update(crc_, data, len);
+      break;
+    default:
+      crc_ = crc8_update(static_cast<uint8_t>(crc_), data, len);
+      break;
   }
+}
 
-  // Calculate total frame size: STX(1) + LEN(2) + CMD(1) + DATA(len) + CRC(1)
-  const size_t frame_size = 5 + len;
-  out.clear();
-  out.reserve(frame_size);
+size_t FrameCheck::finish(uint8_t* out) const
+{
+  switch (type_)
+  {
+    case CrcType::CRC16_CCITT:
+      store_le16(out, crc16_finalize(static_cast<uint16_t>(crc_)));
+      return 2;
+    case CrcType::CRC32C:
+      store_le32(out, crc32c_finalize(crc_));
+      return 4;
+    default:
+      out[0] = crc8_finalize(static_cast<uint8_t>(crc_));
+      return 1;
+  }
+}
 
+size_t write_frame(Command cmd, const uint8_t* data, size_t len, uint8_t* out,
+                   CrcType check)
+{
   // Frame header
-  out.push_back(STX);
-  out.push_back(static_cast<uint8_t>(len & 0xFF));         // LEN_L
-  out.push_back(static_cast<uint8_t>((len >> 8) & 0xFF));  // LEN_H
-  out.push_back(static_cast<uint8_t>(cmd));
+  out[0] = STX;
+  out[1] = static_cast<uint8_t>(len & 0xFF);         // LEN_L
+  out[2] = static_cast<uint8_t>((len >> 8) & 0xFF);  // LEN_H
+  out[3] = static_cast<uint8_t>(cmd);
 
   // Payload
-  if (len > 0 && data != nullptr)
+  if (len > 0 && data != nullptr && data != out + FRAME_HEADER_SIZE)
   {
-    out.insert(out.end(), data, data + len);
+    std::memmove(out + FRAME_HEADER_SIZE, data, len);
   }
 
-  // Calculate CRC over [LEN_L][LEN_H][CMD][DATA...]
-  // CRC input starts at index 1 (after STX) and excludes CRC itself
-  const uint8_t crc = calc_crc8(&out[1], out.size() - 1);
-  out.push_back(crc);
+  // CRC over [LEN_L][LEN_H][CMD][DATA...]
+  FrameCheck crc(check);
+  crc.update(out + 1, 3 + len);
+  return FRAME_HEADER_SIZE + len + crc.finish(out + FRAME_HEADER_SIZE + len);
+}
+
+bool encode_frame(Command cmd, const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                  size_t max_payload, CrcType check)
+{
+  // Check payload size limit
+  if (len > max_payload || len > MAX_FRAME_PAYLOAD)
+  {
+    return false;
+  }
+
+  // Calculate total frame size: STX(1) + LEN(2) + CMD(1) + DATA(len) + CRC(1, 2 or 4)
+  out.resize(FRAME_HEADER_SIZE + len + check_size(check));
+  write_frame(cmd, data, len, out.data(), check);
 
   return true;
 }
@@ -65,19 +113,60 @@ void encode_ack(ErrorCode err_code, std::vector<uint8_t>& out, const uint8_t* da
   out.push_back(static_cast<uint8_t>((payload_len >> 8) & 0xFF));  // LEN_H
   out.push_back(static_cast<uint8_t>(err_code));
 
+  // CRC over [LEN_L][LEN_H][ERR_CODE], continued over [DATA...] below
+  uint8_t crc = crc8_update(crc8_init(), &out[1], 3);
+
   // Append optional data
   if (data_len > 0 && data != nullptr)
   {
     out.insert(out.end(), data, data + data_len);
+    crc = crc8_update(crc, data, data_len);
   }
 
-  // Calculate CRC over [LEN_L][LEN_H][ERR_CODE][DATA...]
-  const uint8_t crc = calc_crc8(&out[1], out.size() - 1);
-  out.push_back(crc);
+  out.push_back(crc8_finalize(crc));
+}
+
+namespace
+{
+
+void write_header(uint8_t code, size_t data_len, uint8_t* out)
+{
+  const size_t payload_len = 1 + data_len;
+
+  out[0] = STX;
+  out[1] = static_cast<uint8_t>(payload_len & 0xFF);         // LEN_L
+  out[2] = static_cast<uint8_t>((payload_len >> 8) & 0xFF);  // LEN_H
+  out[3] = code;
 }
 
-bool verify_frame_crc(const uint8_t* frame, size_t len)
+}  // namespace
+
+void write_ack_header(ErrorCode err_code, size_t data_len, uint8_t* out)
+{
+  write_header(static_cast<uint8_t>(err_code), data_len, out);
+}
+
+void write_event_header(Event event, size_t data_len, uint8_t* out)
+{
+  write_header(static_cast<uint8_t>(event), data_len, out);
+}
+
+bool verify_frame_crc(const uint8_t* frame, size_t len, CrcType check)
 {
+  if (check != CrcType::CRC8)
+  {
+    const size_t n = check_size(check);
+    if (len < FRAME_HEADER_SIZE + n)
+    {
+      return false;
+    }
+    FrameCheck crc(check);
+    crc.update(&frame[1], len - 1 - n);
+    uint8_t calculated[MAX_CHECK_SIZE];
+    crc.finish(calculated);
+    return std::memcmp(calculated, &frame[len - n], n) == 0;
+  }
+
   // Minimum frame: STX + LEN_L + LEN_H + CMD + CRC = 5 bytes
   if (len < 5)
   {
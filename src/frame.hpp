@@ -21,19 +21,88 @@ namespace link
 namespace internal
 {
 
+/**
+ * @brief Frame header size: [STX][LEN_L][LEN_H][CMD or ERR_CODE]
+ */
+constexpr size_t FRAME_HEADER_SIZE = 4;
+
+/**
+ * @brief Per-frame overhead: header plus trailing CRC8
+ */
+constexpr size_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + 1;
+
+/**
+ * @brief Size of the trailing frame check for @p type
+ */
+constexpr size_t check_size(CrcType type)
+{
+  return type == CrcType::CRC32C ? 4 : (type == CrcType::CRC16_CCITT ? 2 : 1);
+}
+
+/**
+ * @brief Largest check_size()
+ */
+constexpr size_t MAX_CHECK_SIZE = 4;
+
+/**
+ * @brief Running frame check of any CrcType
+ *
+ * For frames built in pieces (response data plus a separate tail).
+ */
+class FrameCheck
+{
+ public:
+  explicit FrameCheck(CrcType type);
+
+  void update(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Write the check, little-endian
+   *
+   * @return check_size() of the type
+   */
+  size_t finish(uint8_t* out) const;
+
+ private:
+  CrcType type_;  ///< Check computed
+  uint32_t crc_;  ///< Running state of that check
+};
+
+/**
+ * @brief Write a frame into a caller-owned buffer
+ *
+ * Writes [STX][LEN_L][LEN_H][CMD][DATA...][CRC8] without checking limits;
+ * the caller ensures @p len fits LEN and @p out holds FRAME_HEADER_SIZE +
+ * @p len + check_size(@p check) bytes. @p data may alias @p out +
+ * FRAME_HEADER_SIZE (payload built in place).
+ *
+ * @param cmd   Command code
+ * @param data  Payload data (can be nullptr if len == 0)
+ * @param len   Payload length in bytes
+ * @param out   Output buffer
+ * @param check Frame check sent in place of CRC8
+ * @return Number of bytes written (FRAME_OVERHEAD + @p len for CRC8)
+ */
+size_t write_frame(Command cmd, const uint8_t* data, size_t len, uint8_t* out,
+                   CrcType check = CrcType::CRC8);
+
 /**
  * @brief Encode a frame with command and payload
  *
  * Generates a complete frame: [STX][LEN_L][LEN_H][CMD][DATA...][CRC8]
  *
- * @param cmd     Command code
- * @param data    Payload data (can be nullptr if len == 0)
- * @param len     Payload length in bytes
- * @param out     Output buffer for encoded frame
- * @return true on success, false if payload exceeds MAX_PAYLOAD_SIZE
+ * @param cmd         Command code
+ * @param data        Payload data (can be nullptr if len == 0)
+ * @param len         Payload length in bytes
+ * @param out         Output buffer for encoded frame
+ * @param max_payload Payload limit, e.g. MAX_PAYLOAD from the device's
+ *                    PING capability block (at most MAX_FRAME_PAYLOAD)
+ * @param check       Frame check sent in place of CRC8
+ * @return true on success, false if payload exceeds @p max_payload
  */
 bool encode_frame(Command cmd, const uint8_t* data, size_t len,
-                  std::vector<uint8_t>& out);
+                  std::vector<uint8_t>& out, size_t max_payload = MAX_PAYLOAD_SIZE,
+                  CrcType check = CrcType::CRC8);
 
 /**
  * @brief Encode an ACK/NAK response frame
@@ -49,6 +118,30 @@ bool encode_frame(Command cmd, const uint8_t* data, size_t len,
 void encode_ack(ErrorCode err_code, std::vector<uint8_t>& out,
                 const uint8_t* data = nullptr, size_t data_len = 0);
 
+/**
+ * @brief Write an ACK/NAK header into a caller-owned buffer
+ *
+ * Writes [STX][LEN_L][LEN_H][ERR_CODE], where LEN covers ERR_CODE plus
+ * @p data_len bytes of response data. The caller appends DATA and CRC8.
+ *
+ * @param err_code Error code to send
+ * @param data_len Response data length in bytes (excluding ERR_CODE)
+ * @param out      Output buffer with room for FRAME_HEADER_SIZE bytes
+ */
+void write_ack_header(ErrorCode err_code, size_t data_len, uint8_t* out);
+
+/**
+ * @brief Write a device-initiated event header into a caller-owned buffer
+ *
+ * Writes [STX][LEN_L][LEN_H][EVENT], where LEN covers EVENT plus
+ * @p data_len bytes of event data. The caller appends DATA and CRC8.
+ *
+ * @param event    Event code to send
+ * @param data_len Event data length in bytes (excluding EVENT)
+ * @param out      Output buffer with room for FRAME_HEADER_SIZE bytes
+ */
+void write_event_header(Event event, size_t data_len, uint8_t* out);
+
 /**
  * @brief Verify frame CRC
  *
@@ -57,9 +150,10 @@ void encode_ack(ErrorCode err_code, std::vector<uint8_t>& out,
  *
  * @param frame   Complete frame buffer
  * @param len     Total frame length (including STX and CRC8)
+ * @param check   Frame check at the end in place of CRC8
  * @return true if CRC is valid, false otherwise
  */
-bool verify_frame_crc(const uint8_t* frame, size_t len);
+bool verify_frame_crc(const uint8_t* frame, size_t len, CrcType check = CrcType::CRC8);
 
 }  // namespace internal
 }  // namespace link
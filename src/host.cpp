@@ -0,0 +1,735 @@
+/**
+ * @file host.cpp
+ * @brief Host-side encoders and decoders
+ *
+ * Frames are written with internal::write_frame(), the same encoder the
+ * tests and the device-side helpers use, so both ends agree on layout and
+ * CRC.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/host.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "frame.hpp"
+#include "v4link/internal/cobs.hpp"
+#include "v4link/internal/relocation.hpp"
+#include "v4link/internal/word_hash.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+/* ========================================================================= */
+/* FrameWriter                                                               */
+/* ========================================================================= */
+
+FrameWriter::FrameWriter(uint8_t* buffer, size_t capacity, size_t max_payload)
+    : buffer_(buffer),
+      capacity_(capacity),
+      max_payload_(std::min(max_payload, MAX_FRAME_PAYLOAD)),
+      size_(0),
+      frames_(0),
+      cobs_(false),
+      check_(CrcType::CRC8)
+{
+}
+
+bool FrameWriter::add(Command cmd, const uint8_t* data, size_t len)
+{
+  const size_t overhead = internal::FRAME_HEADER_SIZE + internal::check_size(check_);
+  uint8_t* const frame = len <= max_payload_ ? reserve(overhead + len) : nullptr;
+  if (frame == nullptr)
+  {
+    return false;
+  }
+
+  commit(internal::write_frame(cmd, data, len, frame, check_));
+  return true;
+}
+
+bool FrameWriter::add_seq(Command cmd, uint8_t seq, const uint8_t* data, size_t len)
+{
+  const size_t overhead = internal::FRAME_HEADER_SIZE + internal::check_size(check_);
+  uint8_t* const frame = len + 1 <= max_payload_ ? reserve(overhead + len + 1) : nullptr;
+  if (frame == nullptr)
+  {
+    return false;
+  }
+
+  // Place [SEQ][DATA...] first; write_frame() then encodes it in place
+  uint8_t* const payload = frame + internal::FRAME_HEADER_SIZE;
+  payload[0] = seq;
+  if (len > 0)
+  {
+    std::memmove(payload + 1, data, len);
+  }
+
+  commit(internal::write_frame(cmd, payload, len + 1, frame, check_));
+  return true;
+}
+
+uint8_t* FrameWriter::reserve(size_t frame_len)
+{
+  // A COBS frame is built past the room its encoding grows by, then
+  // encoded into place; STX leaves space for the delimiter
+  const size_t headroom = cobs_ ? internal::cobs_overhead(frame_len - 1) : 0;
+  if (headroom + frame_len > remaining())
+  {
+    return nullptr;
+  }
+  return buffer_ + size_ + headroom;
+}
+
+void FrameWriter::commit(size_t frame_len)
+{
+  frames_++;
+  if (!cobs_)
+  {
+    size_ += frame_len;
+    return;
+  }
+
+  uint8_t* const out = buffer_ + size_;
+  const uint8_t* const frame = out + internal::cobs_overhead(frame_len - 1);
+  size_t n = internal::cobs_encode(frame + 1, frame_len - 1, out);
+  out[n++] = internal::COBS_DELIMITER;
+  size_ += n;
+}
+
+/* ========================================================================= */
+/* V4bBuilder                                                                */
+/* ========================================================================= */
+
+namespace
+{
+
+/**
+ * @brief .v4b header size: [MAGIC][VER_MAJOR][VER_MINOR][FLAGS][CODE_SIZE][WORD_COUNT]
+ */
+constexpr size_t V4B_HEADER_SIZE = 16;
+
+/**
+ * @brief Append @p code and its relocation list [RELOC_COUNT][OFFSET]* to @p out
+ */
+bool put_block(std::vector<uint8_t>& out, const uint8_t* code, size_t len)
+{
+  if (len > 0xFFFF)
+  {
+    return false;  // Offsets are u16
+  }
+
+  const size_t start = out.size();
+  out.insert(out.end(), code, code + len);
+
+  // Scan the copy: for_each_call() takes mutable code but does not write it
+  std::vector<uint16_t> fixups;
+  uint8_t* const block = out.data() + start;
+  const bool ok = internal::for_each_call(block, len,
+                                          [&](uint8_t* operand)
+                                          {
+                                            fixups.push_back(static_cast<uint16_t>(operand - block));
+                                            return true;
+                                          });
+
+  out.resize(out.size() + 2 + fixups.size() * 2);
+  uint8_t* p = out.data() + start + len;
+  internal::store_le16(p, static_cast<uint16_t>(fixups.size()));
+  for (uint16_t at : fixups)
+  {
+    p += 2;
+    internal::store_le16(p, at);
+  }
+  return ok;
+}
+
+}  // namespace
+
+void V4bBuilder::set_main(const uint8_t* code, size_t len)
+{
+  main_.assign(code, code + len);
+}
+
+bool V4bBuilder::add_word(const char* name, const uint8_t* code, size_t len)
+{
+  const size_t name_len = name != nullptr ? std::strlen(name) : 0;
+  if (name_len >= internal::V4B_WORD_REF)
+  {
+    return false;
+  }
+
+  // [NAME_LEN][NAME][CODE_LEN (4 bytes)][CODE]
+  uint8_t head[1 + internal::V4B_WORD_REF + 4];
+  head[0] = static_cast<uint8_t>(name_len);
+  if (name_len > 0)
+  {
+    std::memcpy(head + 1, name, name_len);
+  }
+  internal::store_le32(head + 1 + name_len, static_cast<uint32_t>(len));
+
+  Entry entry;
+  entry.bytes.assign(head, head + 1 + name_len + 4);
+  entry.bytes.insert(entry.bytes.end(), code, code + len);
+
+  const uint32_t prev = words_.empty() ? internal::WORD_HASH_INIT : words_.back().hash;
+  entry.hash = internal::word_hash_update(prev, entry.bytes.data(), entry.bytes.size());
+  entry.ref = false;
+  words_.push_back(std::move(entry));
+  return true;
+}
+
+void V4bBuilder::add_word_ref(uint32_t hash)
+{
+  Entry entry;
+  entry.bytes.resize(internal::V4B_WORD_REF_SIZE);
+  entry.bytes[0] = internal::V4B_WORD_REF;
+  internal::store_le32(entry.bytes.data() + 1, hash);
+  entry.hash = hash;  // The chain continues from the referenced word
+  entry.ref = true;
+  words_.push_back(std::move(entry));
+}
+
+void V4bBuilder::clear()
+{
+  main_.clear();
+  words_.clear();
+}
+
+bool V4bBuilder::build(std::vector<uint8_t>& out) const
+{
+  const bool has_refs =
+      std::any_of(words_.begin(), words_.end(), [](const Entry& entry) { return entry.ref; });
+
+  out.clear();
+  out.resize(V4B_HEADER_SIZE);
+  out[0] = 'V';
+  out[1] = '4';
+  out[2] = 'B';
+  out[3] = 'C';
+  out[4] = 0x00;  // VER_MAJOR
+  out[5] = has_refs ? internal::V4B_MINOR_WORD_REF : internal::V4B_MINOR_RELOC;
+  out[6] = 0x00;  // FLAGS
+  out[7] = 0x00;
+  internal::store_le32(out.data() + 8, static_cast<uint32_t>(main_.size()));
+  internal::store_le32(out.data() + 12, static_cast<uint32_t>(words_.size()));
+
+  if (!put_block(out, main_.data(), main_.size()))
+  {
+    return false;
+  }
+
+  for (const Entry& entry : words_)
+  {
+    if (entry.ref)
+    {
+      out.insert(out.end(), entry.bytes.begin(), entry.bytes.end());
+      continue;
+    }
+
+    // [NAME_LEN][NAME][CODE_LEN], then the code with its relocation list
+    const size_t head_len = 1 + entry.bytes[0] + 4;
+    out.insert(out.end(), entry.bytes.begin(), entry.bytes.begin() + head_len);
+    if (!put_block(out, entry.bytes.data() + head_len, entry.bytes.size() - head_len))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ========================================================================= */
+/* ResponseReader                                                            */
+/* ========================================================================= */
+
+void ResponseReader::push(const uint8_t* data, size_t len)
+{
+  // Drop what has been returned; earlier Response data is no longer needed
+  if (pos_ > 0)
+  {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + pos_);
+    pos_ = 0;
+  }
+  buffer_.insert(buffer_.end(), data, data + len);
+}
+
+bool ResponseReader::next(Response& out)
+{
+  if (cobs_)
+  {
+    return next_cobs(out);
+  }
+
+  for (;;)
+  {
+    const uint8_t* const begin = buffer_.data() + pos_;
+    const size_t avail = buffer_.size() - pos_;
+
+    // Resynchronize on STX
+    const void* const stx = avail > 0 ? std::memchr(begin, STX, avail) : nullptr;
+    if (stx == nullptr)
+    {
+      pos_ = buffer_.size();
+      return false;
+    }
+    pos_ += static_cast<const uint8_t*>(stx) - begin;
+
+    const uint8_t* const frame = buffer_.data() + pos_;
+    if (buffer_.size() - pos_ < 3)
+    {
+      return false;
+    }
+    const size_t len = internal::load_le16(frame + 1);
+    if (len == 0 || len > max_response_)
+    {
+      crc_errors_++;
+      pos_++;  // LEN out of range: not a frame start, skip it unread
+      continue;
+    }
+    // STX, LEN, [CODE][DATA...], CRC
+    const size_t frame_len = 3 + len + internal::check_size(check_);
+    if (buffer_.size() - pos_ < frame_len)
+    {
+      return false;
+    }
+
+    if (!internal::verify_frame_crc(frame, frame_len, check_))
+    {
+      crc_errors_++;
+      pos_++;  // Not a frame start after all; look for the next STX
+      continue;
+    }
+
+    read_frame(frame, len, out);
+    pos_ += frame_len;
+    return true;
+  }
+}
+
+bool ResponseReader::next_cobs(Response& out)
+{
+  for (;;)
+  {
+    const size_t avail = buffer_.size() - pos_;
+    const void* const end =
+        avail > 0 ? std::memchr(buffer_.data() + pos_, internal::COBS_DELIMITER, avail)
+                  : nullptr;
+    if (end == nullptr)
+    {
+      return false;  // Keep the partial frame
+    }
+    const size_t encoded_len =
+        static_cast<size_t>(static_cast<const uint8_t*>(end) - (buffer_.data() + pos_));
+    if (encoded_len == 0)
+    {
+      pos_++;  // Empty frame
+      continue;
+    }
+
+    // Decode in place behind an STX placeholder, so the frame can be checked
+    // like an STX frame; output never overtakes the encoded input
+    uint8_t* const frame = buffer_.data() + pos_;
+    size_t frame_len = 1;
+    internal::CobsDecoder decoder;
+    internal::CobsStatus status;
+    decoder.feed(
+        frame, encoded_len + 1,
+        [frame, &frame_len](const uint8_t* run, size_t n)
+        {
+          std::memmove(frame + frame_len, run, n);
+          frame_len += n;
+        },
+        &status);
+    frame[0] = STX;
+    pos_ += encoded_len + 1;
+
+    const size_t len = frame_len >= 3 ? internal::load_le16(frame + 1) : 0;
+    if (status != internal::CobsStatus::FRAME || len == 0 ||
+        3 + len + internal::check_size(check_) != frame_len ||
+        !internal::verify_frame_crc(frame, frame_len, check_))
+    {
+      crc_errors_++;
+      continue;
+    }
+
+    read_frame(frame, len, out);
+    return true;
+  }
+}
+
+void ResponseReader::read_frame(const uint8_t* frame, size_t len, Response& out) const
+{
+  out.code = frame[3];
+  out.event = out.code >= static_cast<uint8_t>(Event::MEMORY_DELTA);
+  out.has_seq = windowed_ && !out.event && len >= 2;
+  out.seq = out.has_seq ? frame[4] : 0;
+  out.data = frame + internal::FRAME_HEADER_SIZE + (out.has_seq ? 1 : 0);
+  out.len = len - 1 - (out.has_seq ? 1 : 0);
+}
+
+/* ========================================================================= */
+/* Response decoders                                                         */
+/* ========================================================================= */
+
+bool decode_exec(const Response& rsp, ExecResult& out)
+{
+  // [WORD_COUNT][WORD_IDX (2 bytes)]*WORD_COUNT
+  if (rsp.event || rsp.error() != ErrorCode::OK || rsp.len < 1)
+  {
+    return false;
+  }
+  const size_t count = rsp.data[0];
+  if (count == 0 || rsp.len != 1 + count * 2)
+  {
+    return false;
+  }
+
+  out.words.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    out.words[i] = internal::load_le16(rsp.data + 1 + i * 2);
+  }
+  return true;
+}
+
+namespace
+{
+
+/**
+ * @brief Read [DEPTH][VALUES (4 bytes each)...] at @p p
+ *
+ * @return Pointer past the values, or nullptr if they overrun @p end
+ */
+const uint8_t* read_stack(const uint8_t* p, const uint8_t* end, std::vector<int32_t>& out)
+{
+  if (p >= end)
+  {
+    return nullptr;
+  }
+  const size_t depth = *p++;
+  if (static_cast<size_t>(end - p) < depth * 4)
+  {
+    return nullptr;
+  }
+
+  out.resize(depth);
+  for (size_t i = 0; i < depth; ++i)
+  {
+    out[i] = static_cast<int32_t>(internal::load_le32(p + i * 4));
+  }
+  return p + depth * 4;
+}
+
+}  // namespace
+
+bool decode_stack(const Response& rsp, StackDump& out)
+{
+  // [DS_DEPTH][DS_VALUES...][RS_DEPTH][RS_VALUES...]
+  if (rsp.event || rsp.error() != ErrorCode::OK)
+  {
+    return false;
+  }
+  const uint8_t* const end = rsp.data + rsp.len;
+  const uint8_t* p = read_stack(rsp.data, end, out.data);
+  if (p != nullptr)
+  {
+    p = read_stack(p, end, out.ret);
+  }
+  return p == end;
+}
+
+bool decode_profile(const Response& rsp, ProfileReport& out)
+{
+  // [ACTIVE][MODE][TOTAL][OTHER][IDLE][COUNT]([WORD_IDX][HITS][NAME_LEN][NAME...])*
+  if (rsp.event || rsp.error() != ErrorCode::OK || rsp.len < 15)
+  {
+    return false;
+  }
+  out.active = rsp.data[0] != 0;
+  out.mode = static_cast<ProfileMode>(rsp.data[1]);
+  out.total = internal::load_le32(rsp.data + 2);
+  out.other = internal::load_le32(rsp.data + 6);
+  out.idle = internal::load_le32(rsp.data + 10);
+
+  const size_t count = rsp.data[14];
+  const uint8_t* p = rsp.data + 15;
+  const uint8_t* const end = rsp.data + rsp.len;
+  out.words.resize(count);
+  for (ProfileReport::Entry& entry : out.words)
+  {
+    if (end - p < 7 || static_cast<size_t>(end - p - 7) < p[6])
+    {
+      return false;
+    }
+    entry.word = internal::load_le16(p);
+    entry.hits = internal::load_le32(p + 2);
+    entry.name.assign(reinterpret_cast<const char*>(p + 7), p[6]);
+    p += 7 + p[6];
+  }
+  return p == end;
+}
+
+/* ========================================================================= */
+/* Event trace                                                               */
+/* ========================================================================= */
+
+namespace
+{
+
+/**
+ * @brief Read an unsigned LEB128 value at @p p
+ *
+ * @return Pointer past the value, or nullptr if it overruns @p end
+ */
+const uint8_t* read_leb128(const uint8_t* p, const uint8_t* end, uint32_t* out)
+{
+  uint32_t value = 0;
+  for (unsigned shift = 0; shift < 35; shift += 7)
+  {
+    if (p >= end)
+    {
+      return nullptr;
+    }
+    const uint8_t byte = *p++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      *out = value;
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+const char* command_name(uint32_t code)
+{
+  switch (static_cast<Command>(code))
+  {
+    case Command::EXEC:
+      return "EXEC";
+    case Command::BEGIN_UPLOAD:
+      return "BEGIN_UPLOAD";
+    case Command::CHUNK:
+      return "CHUNK";
+    case Command::COMMIT:
+      return "COMMIT";
+    case Command::SAVE_IMAGE:
+      return "SAVE_IMAGE";
+    case Command::RUN_STATUS:
+      return "RUN_STATUS";
+    case Command::ABORT:
+      return "ABORT";
+    case Command::PING:
+      return "PING";
+    case Command::QUERY_STACK:
+      return "QUERY_STACK";
+    case Command::QUERY_STATS:
+      return "QUERY_STATS";
+    case Command::DUMP_TRACE:
+      return "DUMP_TRACE";
+    case Command::PROFILE_START:
+      return "PROFILE_START";
+    case Command::PROFILE_STOP:
+      return "PROFILE_STOP";
+    case Command::PROFILE_DUMP:
+      return "PROFILE_DUMP";
+    case Command::QUERY_MEMORY:
+      return "QUERY_MEMORY";
+    case Command::READ_MEM_BLOCK:
+      return "READ_MEM_BLOCK";
+    case Command::WRITE_MEM_BLOCK:
+      return "WRITE_MEM_BLOCK";
+    case Command::WATCH_MEMORY:
+      return "WATCH_MEMORY";
+    case Command::QUERY_WORD:
+      return "QUERY_WORD";
+    case Command::HAVE_WORDS:
+      return "HAVE_WORDS";
+    case Command::QUERY_WORD_BY_NAME:
+      return "QUERY_WORD_BY_NAME";
+    case Command::REPLACE_WORD:
+      return "REPLACE_WORD";
+    case Command::FORGET_FROM:
+      return "FORGET_FROM";
+    case Command::BATCH:
+      return "BATCH";
+    case Command::RESET:
+      return "RESET";
+  }
+  return "frame";
+}
+
+/**
+ * @brief Append one trace event object to @p json
+ *
+ * @param dur  Slice duration for "X" events (ignored otherwise)
+ * @param args JSON object members, or "" for none
+ */
+void put_event(std::string& json, const char* name, const char* cat, char ph, double ts,
+               double dur, const char* args)
+{
+  char buf[192];
+  int n;
+  if (ph == 'X')
+  {
+    n = std::snprintf(buf, sizeof(buf),
+                      "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+                      "\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{%s}},",
+                      name, cat, ts, dur, args);
+  }
+  else
+  {
+    n = std::snprintf(buf, sizeof(buf),
+                      "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                      "\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{%s}},",
+                      name, cat, ts, args);
+  }
+  if (n > 0)
+  {
+    json.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+  }
+}
+
+}  // namespace
+
+bool TraceDecoder::add(const Response& rsp)
+{
+  // [FLAGS][BASE_TIME (4 bytes)][LOST (4 bytes)]([EVENT][DELTA][ARG])*
+  if (rsp.event || rsp.error() != ErrorCode::OK || rsp.len < 9)
+  {
+    return false;
+  }
+  const uint32_t base = internal::load_le32(rsp.data + 1);
+  const uint32_t lost = internal::load_le32(rsp.data + 5);
+
+  // The base continues from the newest record, modulo 2^32
+  uint64_t time = started_ ? time_ + static_cast<uint32_t>(base - static_cast<uint32_t>(time_))
+                           : base;
+  const size_t first = records_.size();
+  const uint8_t* p = rsp.data + 9;
+  const uint8_t* const end = rsp.data + rsp.len;
+  while (p < end)
+  {
+    const TraceEvent event = static_cast<TraceEvent>(*p++);
+    uint32_t delta;
+    uint32_t arg = 0;
+    p = read_leb128(p, end, &delta);
+    if (p != nullptr)
+    {
+      p = read_leb128(p, end, &arg);
+    }
+    if (p == nullptr)
+    {
+      records_.resize(first);
+      return false;
+    }
+    time += delta;
+    records_.push_back({event, time, arg});
+  }
+
+  time_ = time;
+  started_ = true;
+  lost_ += lost;
+  more_ = (rsp.data[0] & TRACE_FLAG_MORE) != 0;
+  return true;
+}
+
+std::string trace_to_chrome_json(const std::vector<TraceRecord>& records, double ticks_per_us)
+{
+  const double scale = ticks_per_us > 0 ? 1.0 / ticks_per_us : 1.0;
+  std::string json = "{\"traceEvents\":[";
+  char args[64];
+
+  bool frame_open = false;
+  uint64_t frame_start = 0;
+  bool exec_open = false;
+  uint64_t exec_start = 0;
+  uint32_t exec_word = 0;
+
+  for (const TraceRecord& rec : records)
+  {
+    const double ts = static_cast<double>(rec.time) * scale;
+    switch (rec.event)
+    {
+      case TraceEvent::FRAME_START:
+        // A start without an end belongs to a rejected frame
+        frame_open = true;
+        frame_start = rec.time;
+        break;
+
+      case TraceEvent::FRAME_END:
+        std::snprintf(args, sizeof(args), "\"cmd\":%u", static_cast<unsigned>(rec.arg));
+        if (frame_open)
+        {
+          put_event(json, command_name(rec.arg), "frame", 'X',
+                    static_cast<double>(frame_start) * scale,
+                    static_cast<double>(rec.time - frame_start) * scale, args);
+          frame_open = false;
+        }
+        else
+        {
+          put_event(json, command_name(rec.arg), "frame", 'i', ts, 0, args);
+        }
+        break;
+
+      case TraceEvent::EXEC_START:
+        exec_open = true;
+        exec_start = rec.time;
+        exec_word = rec.arg;
+        break;
+
+      case TraceEvent::EXEC_END:
+        if (exec_open)
+        {
+          std::snprintf(args, sizeof(args), "\"word\":%u,\"result\":%d",
+                        static_cast<unsigned>(exec_word), static_cast<int>(rec.arg));
+          put_event(json, "vm_exec", "vm", 'X', static_cast<double>(exec_start) * scale,
+                    static_cast<double>(rec.time - exec_start) * scale, args);
+          exec_open = false;
+        }
+        break;
+
+      case TraceEvent::FRAME_CRC:
+        std::snprintf(args, sizeof(args), "\"ok\":%u", static_cast<unsigned>(rec.arg));
+        put_event(json, "crc", "frame", 'i', ts, 0, args);
+        break;
+
+      case TraceEvent::WORD_REGISTER:
+        std::snprintf(args, sizeof(args), "\"word\":%d", static_cast<int>(rec.arg));
+        put_event(json, "register_word", "vm", 'i', ts, 0, args);
+        break;
+
+      case TraceEvent::RELOCATE:
+        std::snprintf(args, sizeof(args), "\"operands\":%u", static_cast<unsigned>(rec.arg));
+        put_event(json, "relocate", "vm", 'i', ts, 0, args);
+        break;
+
+      case TraceEvent::RESPONSE:
+        std::snprintf(args, sizeof(args), "\"code\":%u", static_cast<unsigned>(rec.arg));
+        put_event(json, "response", "frame", 'i', ts, 0, args);
+        break;
+
+      default:
+        std::snprintf(args, sizeof(args), "\"event\":%u,\"arg\":%u",
+                      static_cast<unsigned>(rec.event), static_cast<unsigned>(rec.arg));
+        put_event(json, "unknown", "trace", 'i', ts, 0, args);
+        break;
+    }
+  }
+
+  if (json.back() == ',')
+  {
+    json.pop_back();
+  }
+  json += "],\"displayTimeUnit\":\"ns\"}";
+  return json;
+}
+
+}  // namespace link
+}  // namespace v4
@@ -8,68 +8,465 @@
 
 #include "v4link/link.hpp"
 
-#include <string>
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
 
+#include "byte_order.hpp"
+#include "crc8.hpp"
 #include "frame.hpp"
 #include "v4/errors.hpp"
 #include "v4/vm_api.h"
 #include "v4link/internal/relocation.hpp"
+#include "v4link/internal/word_hash.hpp"
 
 namespace v4
 {
 namespace link
 {
 
-Link::Link(Vm* vm, UartWriteFn uart_write, void* user, size_t buffer_size)
+namespace
+{
+
+// Largest QUERY_STACK response data: DS_DEPTH + 256 DS values + RS_DEPTH + 64 RS values
+constexpr size_t QUERY_STACK_MAX_DATA = 1 + 256 * 4 + 1 + 64 * 4;
+
+// QUERY_WORD response data overhead: NAME_LEN + NAME (max 63) + CODE_LEN
+constexpr size_t QUERY_WORD_OVERHEAD = 1 + 63 + 2;
+
+// Largest RX buffer whose replies (ERR_CODE + SEQ + data) still fit LEN
+constexpr size_t MAX_BUFFER_SIZE = MAX_FRAME_PAYLOAD - 2 - QUERY_WORD_OVERHEAD;
+
+// BATCH result header: [ERR_CODE][LEN_L][LEN_H]
+constexpr size_t BATCH_RESULT_HEADER_SIZE = 3;
+
+// BATCH sub-command header: [CMD][LEN_L][LEN_H]
+constexpr size_t BATCH_COMMAND_HEADER_SIZE = 3;
+
+// Bytes handed to feed() per step of poll(); the ring holds them until
+// feed() returns, which may include executing a frame
+constexpr size_t POLL_RUN_SIZE = 64;
+
+// V4 RET opcode
+constexpr uint8_t OP_RET = 0x51;
+
+/**
+ * @brief Relocation list of one code block in a .v4b v0.3 image
+ */
+struct Fixups
+{
+  const uint8_t* offsets;  // Little-endian u16 CALL operand offsets
+  size_t count;
+};
+
+/**
+ * @brief Parse [RELOC_COUNT][OFFSET...] at @p p
+ *
+ * @return Pointer past the list, or nullptr if it overruns @p end
+ */
+const uint8_t* read_fixups(const uint8_t* p, const uint8_t* end, Fixups* out)
+{
+  if (end - p < 2)
+  {
+    return nullptr;
+  }
+  out->count = internal::load_le16(p);
+  out->offsets = p + 2;
+  if (static_cast<size_t>(end - out->offsets) < out->count * 2)
+  {
+    return nullptr;
+  }
+  return out->offsets + out->count * 2;
+}
+
+/**
+ * @brief One entry of a .v4b word table
+ */
+struct V4bWord
+{
+  const uint8_t* name;
+  uint8_t name_len;
+  const uint8_t* code;
+  uint32_t code_len;
+  Fixups fixups;  // v0.3+ only
+  uint32_t hash;  // Referenced chain hash (references only)
+  bool ref;       // Reference to a resident word (v0.4+): no code follows
+};
+
+/**
+ * @brief Parse [NAME_LEN][NAME][CODE_LEN][CODE]([RELOCS]) at @p p
+ *
+ * Also parses [V4B_WORD_REF][HASH] references when @p has_refs is set.
+ *
+ * @return Pointer past the entry, or nullptr if it overruns @p end
+ */
+const uint8_t* read_word(const uint8_t* p, const uint8_t* end, bool has_relocs,
+                         bool has_refs, V4bWord* out)
+{
+  if (end - p < 1)
+  {
+    return nullptr;
+  }
+  out->ref = has_refs && *p == internal::V4B_WORD_REF;
+  if (out->ref)
+  {
+    if (static_cast<size_t>(end - p) < internal::V4B_WORD_REF_SIZE)
+    {
+      return nullptr;
+    }
+    out->hash = internal::load_le32(p + 1);
+    out->name_len = 0;
+    out->code_len = 0;
+    out->fixups = {nullptr, 0};
+    return p + internal::V4B_WORD_REF_SIZE;
+  }
+
+  out->name_len = *p++;
+  if (static_cast<size_t>(end - p) < out->name_len + 4u)
+  {
+    return nullptr;
+  }
+  out->name = p;
+  p += out->name_len;
+  out->code_len = internal::load_le32(p);
+  p += 4;
+  if (static_cast<size_t>(end - p) < out->code_len)
+  {
+    return nullptr;
+  }
+  out->code = p;
+  p += out->code_len;
+
+  out->fixups = {nullptr, 0};
+  return has_relocs ? read_fixups(p, end, &out->fixups) : p;
+}
+
+/**
+ * @brief CALL operands of one code block region awaiting relocation
+ *
+ * Operands are recorded as 16-bit offsets from the region base on top of
+ * the arena while an image loads, and released once they have been
+ * patched. Regions lie inside one frame, so offsets always fit. When the
+ * arena has no room left, collection still validates the code but stops
+ * recording, and the caller relinks the region by walking it again.
+ */
+class RelocBatch
+{
+ public:
+  RelocBatch(internal::BytecodeArena& arena, uint8_t* base)
+      : arena_(arena), mark_(arena.mark()), base_(base), slots_(nullptr), count_(0),
+        spilled_(false)
+  {
+  }
+
+  /**
+   * @brief Collect the CALL operands of one code block inside the region
+   *
+   * @param fixups    Relocation list (v0.3+), or nullptr to scan the code
+   * @param cross     First word table entry a CALL may not target: a
+   *                  resident entry after the calling word
+   * @param table_end Number of word table entries
+   * @return VM_ERROR for invalid code or fixups, or a CALL to an entry from
+   *         @p cross up to @p table_end
+   */
+  ErrorCode collect(uint8_t* code, size_t len, const Fixups* fixups, uint32_t cross = 0,
+                    uint32_t table_end = 0)
+  {
+    const auto valid = [cross, table_end](const uint8_t* operand)
+    {
+      const uint32_t idx = internal::load_le16(operand);
+      return idx < cross || idx >= table_end;
+    };
+
+    if (fixups != nullptr)
+    {
+      for (size_t i = 0; i < fixups->count; i++)
+      {
+        const size_t at = internal::load_le16(fixups->offsets + 2 * i);
+        if (!internal::is_call_operand(code, len, at) || !valid(code + at))
+        {
+          return ErrorCode::VM_ERROR;
+        }
+        add(code + at);
+      }
+      return ErrorCode::OK;
+    }
+
+    const bool ok = internal::for_each_call(code, len,
+                                            [this, &valid](uint8_t* operand)
+                                            {
+                                              if (!valid(operand))
+                                              {
+                                                return false;
+                                              }
+                                              add(operand);
+                                              return true;
+                                            });
+    return ok ? ErrorCode::OK : ErrorCode::VM_ERROR;
+  }
+
+  /**
+   * @brief Whether every collected operand was recorded
+   */
+  bool complete() const
+  {
+    return !spilled_;
+  }
+
+  /**
+   * @brief Replace every recorded operand with resolve(operand)
+   */
+  template <typename Fn>
+  void apply(Fn&& resolve)
+  {
+    for (size_t i = 0; i < count_; i++)
+    {
+      internal::relink_operand(base_ + internal::load_le16(slots_ + 2 * i), resolve);
+    }
+  }
+
+  /**
+   * @brief Release the batch storage
+   */
+  void discard()
+  {
+    arena_.release(mark_);
+    count_ = 0;
+  }
+
+ private:
+  void add(uint8_t* operand)
+  {
+    uint8_t* slot = spilled_ ? nullptr : arena_.alloc(2);
+    if (slot == nullptr)
+    {
+      spilled_ = true;
+      return;
+    }
+    if (slots_ == nullptr)
+    {
+      slots_ = slot;  // Later slots follow contiguously
+    }
+    internal::store_le16(slot, static_cast<uint16_t>(operand - base_));
+    count_++;
+  }
+
+  internal::BytecodeArena& arena_;
+  size_t mark_;
+  uint8_t* base_;
+  uint8_t* slots_;
+  size_t count_;
+  bool spilled_;
+};
+
+uint32_t name_hash(const char* name, size_t len)
+{
+  return internal::word_hash_update(internal::WORD_HASH_INIT,
+                                    reinterpret_cast<const uint8_t*>(name), len);
+}
+
+/**
+ * @brief Entry of a sorted name index with @p name, or the index end
+ */
+template <typename Index>
+auto find_name(Index& index, const char* name, size_t len) -> decltype(index.begin())
+{
+  const uint32_t hash = name_hash(name, len);
+  auto it = std::lower_bound(index.begin(), index.end(), hash,
+                             [](const auto& entry, uint32_t h) { return entry.hash < h; });
+  for (; it != index.end() && it->hash == hash; ++it)
+  {
+    if (it->len == len && std::memcmp(it->name, name, len) == 0)
+    {
+      return it;
+    }
+  }
+  return index.end();
+}
+
+}  // namespace
+
+using internal::store_le16;
+using internal::store_le32;
+
+Link::Link(Vm* vm, UartWriteFn uart_write, void* user, size_t buffer_size,
+           size_t arena_size, uint8_t* arena, size_t rx_ring_size, size_t max_words)
     : vm_(vm),
       uart_write_(uart_write),
+      uart_writev_(nullptr),
       user_context_(user),
       buffer_(),
       pos_(0),
       state_(State::WAIT_STX),
       frame_len_(0),
-      cmd_(0)
+      cmd_(0),
+      rx_crc_(internal::crc8_init()),
+      check_(CrcType::CRC8),
+      tx_buffer_(),
+      tx_headroom_(0),
+      cobs_(false),
+      cobs_overflow_(false),
+      cobs_rx_(),
+      arena_(arena, arena_size),
+      rx_spare_(),
+      exec_in_place_(false),
+      vm_mem_(nullptr),
+      vm_mem_size_(0),
+      storage_write_(nullptr),
+      storage_region_(nullptr),
+      storage_capacity_(0),
+      watches_(),
+      watch_shadow_(),
+      watch_interval_us_(0),
+      last_watch_us_(0),
+      batch_active_(false),
+      batch_len_(0),
+      batch_ran_exec_(false),
+      max_words_(max_words),
+      word_cache_(),
+      name_index_(),
+      load_words_(),
+      load_base_(0),
+      main_words_(),
+      upload_(),
+      rx_payload_(nullptr),
+      rx_payload_len_(0),
+      window_size_(0),
+      expected_seq_(0),
+      tx_seq_(0),
+      nak_sent_(false),
+      rx_bytes_(0),
+      tick_rx_bytes_(0),
+      last_rx_us_(0),
+      rx_timeout_us_(0),
+      rx_ring_(rx_ring_size),
+      run_(),
+      async_exec_(false),
+      exec_slice_(nullptr),
+      slice_budget_(0),
+      timestamp_(nullptr),
+      stats_(),
+      trace_(),
+      profile_()
 {
+  // LEN is 16 bits: a larger buffer could never fill, and its largest
+  // replies could not be framed
+  if (buffer_size > MAX_BUFFER_SIZE)
+  {
+    buffer_size = MAX_BUFFER_SIZE;
+  }
   buffer_.reserve(buffer_size + 4);  // Reserve space for header + payload
+
+  // Response data must fit the largest fixed-size reply (QUERY_STACK) as well
+  // as a QUERY_WORD dump of any word uploaded through a full-size EXEC frame
+  size_t tx_data_size = buffer_size + QUERY_WORD_OVERHEAD;
+  if (tx_data_size < QUERY_STACK_MAX_DATA)
+  {
+    tx_data_size = QUERY_STACK_MAX_DATA;
+  }
+  const size_t tx_frame_size =  // + SEQ, and room for the widest check
+      internal::FRAME_HEADER_SIZE + 1 + tx_data_size + internal::MAX_CHECK_SIZE;
+  tx_headroom_ = internal::cobs_overhead(tx_frame_size);
+  tx_buffer_.resize(tx_headroom_ + tx_frame_size + 1);  // + delimiter
+
+  // Word tables never grow past this: loads that would overflow them are refused
+  word_cache_.reserve(max_words_);
+  name_index_.reserve(max_words_);
+  load_words_.reserve(max_load_words());
 }
 
 void Link::feed_byte(uint8_t byte)
 {
-  switch (state_)
+  if (cobs_)
   {
-    case State::WAIT_STX:
-      if (byte == STX)
+    feed_cobs(&byte, 1);
+    return;
+  }
+  ++rx_bytes_;
+
+  if (state_ == State::WAIT_STX)
+  {
+    if (byte == STX)
+    {
+      trace(TraceEvent::FRAME_START);
+      buffer_.clear();
+      buffer_.push_back(byte);
+      begin_frame();
+    }
+    else
+    {
+      stats_.add_dropped(1);
+    }
+    return;
+  }
+
+  buffer_.push_back(byte);
+
+  switch (advance(byte))
+  {
+    case Step::CONTINUE:
+      break;
+
+    case Step::FRAME:
+      trace(TraceEvent::FRAME_CRC, 1);
+      handle_frame();
+      if (exec_in_place_)
       {
-        buffer_.clear();
-        buffer_.push_back(byte);
-        pos_ = 0;
-        state_ = State::WAIT_LEN_L;
+        // Keep code executed in place intact while the next frame arrives
+        buffer_.swap(rx_spare_);
       }
       break;
 
+    case Step::BAD_CRC:
+      trace(TraceEvent::FRAME_CRC, 0);
+      stats_.add_crc_error();
+      reject_frame(ErrorCode::INVALID_FRAME);
+      resync(1);
+      break;
+
+    case Step::TOO_LONG:
+      reject_frame(ErrorCode::BUFFER_FULL);
+      resync(1);
+      break;
+  }
+}
+
+void Link::begin_frame()
+{
+  pos_ = 0;
+  rx_crc_ = internal::crc8_init();
+  state_ = State::WAIT_LEN_L;
+}
+
+Link::Step Link::advance(uint8_t byte)
+{
+  switch (state_)
+  {
+    case State::WAIT_STX:
+      break;
+
     case State::WAIT_LEN_L:
-      buffer_.push_back(byte);
+      rx_crc_ = internal::crc8_update(rx_crc_, byte);
       frame_len_ = byte;
       state_ = State::WAIT_LEN_H;
       break;
 
     case State::WAIT_LEN_H:
-      buffer_.push_back(byte);
+      rx_crc_ = internal::crc8_update(rx_crc_, byte);
       frame_len_ |= (static_cast<uint16_t>(byte) << 8);
 
       // Check if payload exceeds buffer capacity
       if (frame_len_ > buffer_.capacity() - 4)
       {
-        send_ack(ErrorCode::BUFFER_FULL);
         state_ = State::WAIT_STX;
-        break;
+        return Step::TOO_LONG;
       }
 
       state_ = State::WAIT_CMD;
       break;
 
     case State::WAIT_CMD:
-      buffer_.push_back(byte);
+      rx_crc_ = internal::crc8_update(rx_crc_, byte);
       cmd_ = byte;
       pos_ = 0;
 
@@ -85,7 +482,7 @@ void Link::feed_byte(uint8_t byte)
       break;
 
     case State::WAIT_DATA:
-      buffer_.push_back(byte);
+      rx_crc_ = internal::crc8_update(rx_crc_, byte);
       pos_++;
 
       if (pos_ >= frame_len_)
@@ -95,393 +492,1251 @@ void Link::feed_byte(uint8_t byte)
       break;
 
     case State::WAIT_CRC:
-      buffer_.push_back(byte);
+      if (check_ != CrcType::CRC8)
+      {
+        // Wider checks are verified in one pass once all their bytes are in
+        const size_t check_len = internal::check_size(check_);
+        if (++pos_ < frame_len_ + check_len)
+        {
+          break;
+        }
+        state_ = State::WAIT_STX;
+        const size_t n = internal::FRAME_HEADER_SIZE + frame_len_ + check_len;
+        return internal::verify_frame_crc(buffer_.data(), n, check_) ? Step::FRAME
+                                                                     : Step::BAD_CRC;
+      }
+      state_ = State::WAIT_STX;
+      return byte == internal::crc8_finalize(rx_crc_) ? Step::FRAME : Step::BAD_CRC;
+
+    case State::WAIT_COBS:
+      break;  // Decoded by feed_cobs()
+  }
+
+  return Step::CONTINUE;
+}
+
+void Link::resync(size_t from)
+{
+  // buffer_ holds bytes of a rejected frame. A genuine STX may hide among
+  // them (e.g. the rejected frame's header was corrupted), so replay the
+  // bytes from each later STX candidate instead of dropping them. Failures
+  // of these speculative candidates are not reported to the host.
+  while (true)
+  {
+    const size_t n = buffer_.size();
+    const void* hit =
+        from < n ? std::memchr(buffer_.data() + from, STX, n - from) : nullptr;
+    if (hit == nullptr)
+    {
+      buffer_.clear();
+      state_ = State::WAIT_STX;
+      return;
+    }
+
+    const size_t skip = static_cast<size_t>(static_cast<const uint8_t*>(hit) - buffer_.data());
+    buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(skip));
+
+    begin_frame();
+    Step step = Step::CONTINUE;
+    size_t consumed = 1;
+    while (consumed < buffer_.size() && step == Step::CONTINUE)
+    {
+      step = advance(buffer_[consumed++]);
+    }
+
+    if (step == Step::CONTINUE)
+    {
+      return;  // Candidate is incomplete; keep receiving into it
+    }
+
+    if (step == Step::FRAME)
+    {
       handle_frame();
+      from = consumed;  // Continue with the bytes after the recovered frame
+      if (exec_in_place_)
+      {
+        // Move the remainder aside so the executed frame stays intact
+        rx_spare_.assign(buffer_.begin() + static_cast<std::ptrdiff_t>(consumed), buffer_.end());
+        buffer_.swap(rx_spare_);
+        from = 0;
+      }
+    }
+    else
+    {
+      from = 1;  // Not a frame; try the next candidate
+    }
+  }
+}
+
+void Link::tick(uint32_t now_us)
+{
+  if (watch_interval_us_ != 0 &&
+      static_cast<uint32_t>(now_us - last_watch_us_) >= watch_interval_us_)
+  {
+    last_watch_us_ = now_us;
+    watch_poll();
+  }
+
+  // Restart the stall timer whenever bytes arrived since the last tick
+  if (rx_timeout_us_ == 0 || state_ == State::WAIT_STX || rx_bytes_ != tick_rx_bytes_)
+  {
+    tick_rx_bytes_ = rx_bytes_;
+    last_rx_us_ = now_us;
+    return;
+  }
+
+  if (static_cast<uint32_t>(now_us - last_rx_us_) >= rx_timeout_us_)
+  {
+    // Stalled mid-frame: report it instead of letting the host time out
+    reject_frame(ErrorCode::INVALID_FRAME);
+    buffer_.clear();
+    cobs_rx_.reset();
+    state_ = State::WAIT_STX;
+  }
+}
+
+void Link::feed(const uint8_t* data, size_t len)
+{
+  size_t i = 0;
+  while (i < len)
+  {
+    if (cobs_)
+    {
+      i += feed_cobs(data + i, len - i);
+      continue;
+    }
+
+    switch (state_)
+    {
+      case State::WAIT_STX:
+      {
+        // Skip inter-frame noise with a single scan
+        const void* stx = std::memchr(data + i, STX, len - i);
+        if (stx == nullptr)
+        {
+          rx_bytes_ += len - i;
+          stats_.add_dropped(len - i);
+          return;
+        }
+        const size_t at = static_cast<size_t>(static_cast<const uint8_t*>(stx) - data);
+        rx_bytes_ += at - i;
+        stats_.add_dropped(at - i);
+        i = at;
+        feed_byte(data[i++]);
+        break;
+      }
+
+      case State::WAIT_DATA:
+      {
+        // Copy as much of the payload as is available in one run
+        const size_t remaining = frame_len_ - pos_;
+        const size_t run = (len - i < remaining) ? len - i : remaining;
+        buffer_.insert(buffer_.end(), data + i, data + i + run);
+        if (check_ == CrcType::CRC8)
+        {
+          rx_crc_ = internal::crc8_update(rx_crc_, data + i, run);
+        }
+        rx_bytes_ += run;
+        pos_ += run;
+        i += run;
+
+        if (pos_ >= frame_len_)
+        {
+          state_ = State::WAIT_CRC;
+        }
+        break;
+      }
+
+      default:
+        // Header and CRC bytes sit on state boundaries
+        feed_byte(data[i++]);
+        break;
+    }
+  }
+}
+
+size_t Link::feed_cobs(const uint8_t* data, size_t len)
+{
+  // Decoded bytes go straight into buffer_; past its capacity they are
+  // discarded up to the delimiter
+  const size_t limit =
+      max_payload() + internal::FRAME_HEADER_SIZE + internal::check_size(check_);
+  auto sink = [this, limit](const uint8_t* run, size_t n)
+  {
+    if (cobs_overflow_ || buffer_.size() + n > limit)
+    {
+      cobs_overflow_ = true;
+      return;
+    }
+    buffer_.insert(buffer_.end(), run, run + n);
+  };
+
+  size_t i = 0;
+  while (i < len && cobs_)
+  {
+    if (state_ == State::WAIT_STX)
+    {
+      if (data[i] == internal::COBS_DELIMITER)
+      {
+        ++rx_bytes_;
+        ++i;  // Empty frame, e.g. a delimiter sent ahead to flush the line
+        continue;
+      }
+      trace(TraceEvent::FRAME_START);
+      buffer_.clear();
+      buffer_.push_back(STX);
+      cobs_overflow_ = false;
+      state_ = State::WAIT_COBS;
+    }
+
+    internal::CobsStatus status;
+    const size_t used = cobs_rx_.feed(data + i, len - i, sink, &status);
+    rx_bytes_ += used;
+    i += used;
+    if (status != internal::CobsStatus::PARTIAL)
+    {
       state_ = State::WAIT_STX;
-      break;
+      end_cobs_frame(status == internal::CobsStatus::FRAME);
+    }
+  }
+  return i;
+}
+
+void Link::end_cobs_frame(bool well_formed)
+{
+  if (well_formed && cobs_overflow_)
+  {
+    reject_frame(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  const size_t n = buffer_.size();
+  const size_t overhead = internal::FRAME_HEADER_SIZE + internal::check_size(check_);
+  if (!well_formed || n < overhead ||
+      internal::load_le16(buffer_.data() + 1) + overhead != n ||
+      !internal::verify_frame_crc(buffer_.data(), n, check_))
+  {
+    trace(TraceEvent::FRAME_CRC, 0);
+    stats_.add_crc_error();
+    reject_frame(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  frame_len_ = static_cast<uint16_t>(n - overhead);
+  cmd_ = buffer_[internal::FRAME_HEADER_SIZE - 1];
+  trace(TraceEvent::FRAME_CRC, 1);
+  handle_frame();
+  if (exec_in_place_)
+  {
+    // Keep code executed in place intact while the next frame arrives
+    buffer_.swap(rx_spare_);
+  }
+}
+
+size_t Link::poll()
+{
+  const size_t total = rx_ring_.available();
+  size_t left = total;
+  while (left > 0)
+  {
+    size_t len;
+    const uint8_t* data = rx_ring_.peek(len);
+    if (len > left)
+    {
+      len = left;
+    }
+    if (len > POLL_RUN_SIZE)
+    {
+      len = POLL_RUN_SIZE;
+    }
+    feed(data, len);
+    rx_ring_.consume(len);
+    left -= len;
+  }
+
+  if (run_.state == RunState::RUNNING)
+  {
+    run_slice();
+  }
+  return total;
+}
+
+void Link::handle_frame()
+{
+  rx_payload_ = buffer_.data() + internal::FRAME_HEADER_SIZE;
+  rx_payload_len_ = frame_len_;
+
+  if (window_size_ > 0 && !accept_sequence())
+  {
+    return;
+  }
+
+  const Command cmd = static_cast<Command>(cmd_);
+  dispatch(cmd);
+
+  // Report what the executed code changed right after its response
+  if (cmd == Command::EXEC || cmd == Command::COMMIT || batch_ran_exec_)
+  {
+    batch_ran_exec_ = false;
+    watch_poll();
+  }
+  trace(TraceEvent::FRAME_END, cmd_);
+}
+
+void Link::dispatch(Command cmd)
+{
+  const uint32_t start = timestamp();
+
+  switch (cmd)
+  {
+    case Command::EXEC:
+      handle_cmd_exec();
+      break;
+
+    case Command::BEGIN_UPLOAD:
+      handle_cmd_begin_upload();
+      break;
+
+    case Command::CHUNK:
+      handle_cmd_chunk();
+      break;
+
+    case Command::COMMIT:
+      handle_cmd_commit();
+      break;
+
+    case Command::SAVE_IMAGE:
+      handle_cmd_save_image();
+      break;
+
+    case Command::RUN_STATUS:
+      handle_cmd_run_status();
+      break;
+
+    case Command::ABORT:
+      handle_cmd_abort();
+      break;
+
+    case Command::PING:
+      handle_cmd_ping();
+      break;
+
+    case Command::QUERY_STACK:
+      handle_cmd_query_stack();
+      break;
+
+#if V4LINK_ENABLE_STATS
+    case Command::QUERY_STATS:
+      handle_cmd_query_stats();
+      break;
+#endif
+
+#if V4LINK_ENABLE_TRACE
+    case Command::DUMP_TRACE:
+      handle_cmd_dump_trace();
+      break;
+#endif
+
+#if V4LINK_ENABLE_PROFILE
+    case Command::PROFILE_START:
+      handle_cmd_profile_start();
+      break;
+
+    case Command::PROFILE_STOP:
+      handle_cmd_profile_stop();
+      break;
+
+    case Command::PROFILE_DUMP:
+      handle_cmd_profile_dump();
+      break;
+#endif
+
+    case Command::QUERY_MEMORY:
+      handle_cmd_query_memory();
+      break;
+
+    case Command::READ_MEM_BLOCK:
+      handle_cmd_read_mem_block();
+      break;
+
+    case Command::WRITE_MEM_BLOCK:
+      handle_cmd_write_mem_block();
+      break;
+
+    case Command::WATCH_MEMORY:
+      handle_cmd_watch_memory();
+      break;
+
+    case Command::QUERY_WORD:
+      handle_cmd_query_word();
+      break;
+
+    case Command::HAVE_WORDS:
+      handle_cmd_have_words();
+      break;
+
+    case Command::QUERY_WORD_BY_NAME:
+      handle_cmd_query_word_by_name();
+      break;
+
+    case Command::REPLACE_WORD:
+      handle_cmd_replace_word();
+      break;
+
+    case Command::FORGET_FROM:
+      handle_cmd_forget_from();
+      break;
+
+    case Command::BATCH:
+      handle_cmd_batch();
+      break;
+
+    case Command::RESET:
+      handle_cmd_reset();
+      break;
+
+    default:
+      send_ack(ErrorCode::GENERAL_ERROR);
+      break;
+  }
+
+  stats_.add_command(static_cast<uint8_t>(cmd), timestamp() - start);
+}
+
+void Link::handle_cmd_exec()
+{
+  if (run_busy())
+  {
+    send_ack(ErrorCode::BUSY);  // Loading now could free code still running
+    return;
+  }
+
+  // Payload starts at index 4 (after STX, LEN_L, LEN_H, CMD)
+  // EXEC allocates from the arena, which a pending upload relies on
+  upload_abort();
+
+  uint8_t* payload = rx_payload_;
+  const size_t payload_len = rx_payload_len_;
+
+  // Check if payload is a .v4b format (starts with "V4BC" magic)
+  if (payload_len >= 16 && payload[0] == 0x56 && payload[1] == 0x34 &&
+      payload[2] == 0x42 && payload[3] == 0x43)
+  {
+    handle_exec_v4b(payload, payload_len);
+  }
+  else
+  {
+    // Legacy raw bytecode (no .v4b header)
+    const size_t mark = arena_.mark();
+    uint8_t* persistent_bytecode = place_main_code(payload, payload_len);
+    if (persistent_bytecode == nullptr)
+    {
+      send_ack(ErrorCode::BUFFER_FULL);
+      return;
+    }
+
+    const int wid = register_main(persistent_bytecode, static_cast<int>(payload_len));
+
+    if (wid < 0)
+    {
+      arena_.release(mark);
+      send_ack(ErrorCode::VM_ERROR);
+      return;
+    }
+
+    run_main(wid);
+
+    uint8_t* out = tx_data();
+    out[0] = 1;
+    store_le16(out + 1, static_cast<uint16_t>(wid));
+    send_response(ErrorCode::OK, 3);
+  }
+}
+
+void Link::handle_exec_v4b(uint8_t* image, size_t len)
+{
+  // Load pipeline: parse, reserve storage, copy and validate, register, then
+  // relocate. Everything that can fail short of vm_register_word itself is
+  // checked before the first word is registered, so a rejected image leaves
+  // the VM and the arena untouched.
+  const uint8_t version_minor = image[5];
+  const uint32_t code_size = internal::load_le32(image + 8);
+  const uint32_t word_count = version_minor >= 2 ? internal::load_le32(image + 12) : 0;
+  const bool has_relocs = version_minor >= internal::V4B_MINOR_RELOC;
+  const bool has_refs = version_minor >= internal::V4B_MINOR_WORD_REF;
+  const uint8_t* const end = image + len;
+
+  // 1. Parse: validate the whole word table, resolve words that are already
+  // resident, and size the storage of the rest
+  if (code_size > len - 16)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+  if (word_count > max_load_words())
+  {
+    send_ack(ErrorCode::BUFFER_FULL);  // The response could not list them all
+    return;
+  }
+
+  const uint8_t* table = image + 16 + code_size;
+  Fixups main_fixups = {nullptr, 0};
+  if (has_relocs)
+  {
+    table = read_fixups(table, end, &main_fixups);
+    if (table == nullptr)
+    {
+      send_ack(ErrorCode::GENERAL_ERROR);
+      return;
+    }
+  }
+
+  load_words_.clear();
+  load_base_ = 0;
+  size_t names_size = 0;
+  size_t words_size = 0;
+  uint32_t new_words = 0;
+  uint32_t new_names = 0;
+  uint32_t hash = internal::WORD_HASH_INIT;
+  const uint8_t* p = table;
+  V4bWord word;
+  for (uint32_t i = 0; i < word_count; i++)
+  {
+    const uint8_t* const entry = p;
+    p = read_word(p, end, has_relocs, has_refs, &word);
+    if (p == nullptr)
+    {
+      send_ack(ErrorCode::GENERAL_ERROR);
+      return;
+    }
+    hash = word.ref ? word.hash
+                    : internal::word_hash_update(
+                          hash, entry, static_cast<size_t>(word.code + word.code_len - entry));
+
+    int wid = word_cache_find(hash);
+    if (!word.ref && wid >= 0 &&
+        !resident_matches(wid, reinterpret_cast<const char*>(word.name), word.name_len,
+                          word.code, word.code_len))
+    {
+      wid = -1;  // Hash collision: load it as a new word
+    }
+    if (word.ref && wid < 0)
+    {
+      send_ack(ErrorCode::GENERAL_ERROR);  // Unknown reference
+      return;
+    }
+    load_words_.push_back({hash, wid});
+    if (wid < 0)
+    {
+      if (word.name_len > 0 &&
+          interned_name(reinterpret_cast<const char*>(word.name), word.name_len) == nullptr)
+      {
+        names_size += word.name_len + 1u;
+        new_names++;
+      }
+      words_size += word.code_len;
+      new_words++;
+    }
+  }
+  if (new_words > max_words_ - word_cache_.size() ||
+      new_names > max_words_ - name_index_.size())
+  {
+    send_ack(ErrorCode::BUFFER_FULL);  // The word tables could not track them
+    return;
+  }
+
+  // 2. Reserve: names not registered before, word code, then main code, then
+  // the relocation batch on top
+  const size_t load_mark = arena_.mark();
+  char* const names = reinterpret_cast<char*>(arena_.alloc(names_size));
+  uint8_t* const words_code = names != nullptr ? arena_.alloc(words_size) : nullptr;
+  uint8_t* const main_code =
+      words_code != nullptr ? place_main_code(image + 16, code_size) : nullptr;
+  if (main_code == nullptr)
+  {
+    arena_.release(load_mark);
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // 3. Copy and validate: the only copy of the code bytes. CALL operands
+  // are collected now and patched once the word indices are known. Without
+  // words the main code needs no relocation.
+  RelocBatch main_batch(arena_, main_code);
+  RelocBatch words_batch(arena_, words_code);
+  const bool relocate = word_count > 0;
+  ErrorCode err = ErrorCode::OK;
+  if (relocate)
+  {
+    err = main_batch.collect(main_code, code_size, has_relocs ? &main_fixups : nullptr);
+  }
+
+  // Forward CALLs resolve by offset from the calling word, as in chunked
+  // uploads that link each word on arrival, so they may not reach past a
+  // resident entry
+  p = table;
+  uint8_t* dst = words_code;
+  uint32_t cross = 0;
+  for (uint32_t i = 0; i < word_count && err == ErrorCode::OK; i++)
+  {
+    p = read_word(p, end, has_relocs, has_refs, &word);
+    if (load_words_[i].wid >= 0)
+    {
+      continue;  // Resident: its code is already linked
+    }
+    if (cross <= i)
+    {
+      cross = i + 1;
+      while (cross < word_count && load_words_[cross].wid < 0)
+      {
+        cross++;
+      }
+    }
+    std::memcpy(dst, word.code, word.code_len);
+    err = words_batch.collect(dst, word.code_len, has_relocs ? &word.fixups : nullptr,
+                              cross, word_count);
+    dst += word.code_len;
+  }
+
+  if (err != ErrorCode::OK)
+  {
+    arena_.release(load_mark);
+    send_ack(err);
+    return;
+  }
+
+  // 4. Register: new words get consecutive VM indices
+  int first_wid = -1;
+  uint32_t registered = 0;
+  char* next_name = names;
+  p = table;
+  dst = words_code;
+  for (uint32_t i = 0; i < word_count && registered < new_words; i++)
+  {
+    p = read_word(p, end, has_relocs, has_refs, &word);
+    if (load_words_[i].wid >= 0)
+    {
+      continue;
+    }
+    // Each distinct name is stored once; redefinitions share the copy
+    const char* const word_name = reinterpret_cast<const char*>(word.name);
+    const char* name = word.name_len > 0 ? interned_name(word_name, word.name_len) : "";
+    if (name == nullptr)
+    {
+      std::memcpy(next_name, word_name, word.name_len);
+      next_name[word.name_len] = '\0';
+      name = next_name;
+      next_name += word.name_len + 1u;
+    }
+
+    const int wid =
+        register_word(name, word.name_len, dst, static_cast<int>(word.code_len));
+    if (registered == 0)
+    {
+      first_wid = wid;
+    }
+
+    if (wid < 0 || wid != first_wid + static_cast<int>(registered))
+    {
+      // V4 cannot unregister words: keep the storage of those already
+      // registered, but make them return at once since their CALLs were
+      // never linked. The rest of the load is released.
+      const uint32_t stubs = wid < 0 ? registered : registered + 1;
+      uint8_t* code = words_code;
+      p = table;
+      for (uint32_t k = 0, n = 0; n < stubs; k++)
+      {
+        p = read_word(p, end, has_relocs, has_refs, &word);
+        if (load_words_[k].wid >= 0 && load_words_[k].wid < first_wid)
+        {
+          continue;  // Resident, not registered by this load
+        }
+        if (word.code_len > 0)
+        {
+          code[0] = OP_RET;
+        }
+        if (word.name_len > 0)
+        {
+          // Names a stub took over resolve to their previous definitions
+          name_index_revert(reinterpret_cast<const char*>(word.name), word.name_len,
+                            first_wid);
+        }
+        code += word.code_len;
+        n++;
+      }
+      arena_.release(load_mark + names_size + static_cast<size_t>(code - words_code));
+      send_ack(ErrorCode::VM_ERROR);
+      return;
+    }
+    load_words_[i].wid = wid;
+    load_base_ = wid - static_cast<int>(i);
+    registered++;
+    dst += word.code_len;
+  }
+
+  // 5. Relocate: one tight loop over the collected operands, then make the
+  // new words available to later images. Code whose operands did not fit
+  // the arena is walked again instead.
+  if (relocate)
+  {
+    uint32_t operands = 0;
+    const auto resolve = [this, &operands](uint16_t idx)
+    {
+      operands++;
+      return resolve_word(idx);
+    };
+    const auto relink = [has_relocs, &resolve](uint8_t* code, size_t code_len,
+                                               const Fixups& fixups)
+    {
+      if (has_relocs)
+      {
+        internal::relink_fixups(code, code_len, fixups.offsets, fixups.count, resolve);
+      }
+      else
+      {
+        internal::relink_calls(code, code_len, resolve);
+      }
+    };
+
+    if (main_batch.complete())
+    {
+      main_batch.apply(resolve);
+    }
+    else
+    {
+      relink(main_code, code_size, main_fixups);
+    }
+
+    if (words_batch.complete())
+    {
+      words_batch.apply(resolve);
+    }
+    else
+    {
+      p = table;
+      dst = words_code;
+      for (uint32_t i = 0; i < word_count; i++)
+      {
+        p = read_word(p, end, has_relocs, has_refs, &word);
+        if (load_words_[i].wid < first_wid)
+        {
+          continue;  // Resident
+        }
+        relink(dst, word.code_len, word.fixups);
+        dst += word.code_len;
+      }
+    }
+    trace(TraceEvent::RELOCATE, operands);
+  }
+  main_batch.discard();
+
+  if (registered > 0)
+  {
+    for (const CachedWord& loaded : load_words_)
+    {
+      word_cache_add(loaded.hash, loaded.wid);
+    }
+  }
+
+  const int main_wid = register_main(main_code, static_cast<int>(code_size));
+  if (main_wid < 0)
+  {
+    // Words are complete and stay registered; only the main code is dropped
+    arena_.release(load_mark + names_size + words_size);
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
+  // Execute main bytecode
+  run_main(main_wid);
+
+  // Return all word indices
+  uint8_t* out = tx_data();
+  size_t n = 0;
+  out[n++] = static_cast<uint8_t>(word_count + 1);
+  for (uint32_t i = 0; i < word_count; i++)
+  {
+    store_le16(out + n, static_cast<uint16_t>(load_words_[i].wid));
+    n += 2;
+  }
+  store_le16(out + n, static_cast<uint16_t>(main_wid));
+  n += 2;
+  send_response(ErrorCode::OK, n);
+}
+
+int Link::register_word(const char* name, size_t name_len, const uint8_t* code, int len)
+{
+  const int wid = vm_register_word(vm_, name, code, len);
+  trace(TraceEvent::WORD_REGISTER, static_cast<uint32_t>(wid));
+  if (wid >= 0 && name != nullptr && name_len > 0)
+  {
+    name_index_add(name, name_len, wid);
+  }
+  return wid;
+}
+
+int Link::register_main(const uint8_t* code, int len)
+{
+  const int wid = register_word(nullptr, 0, code, len);
+  set_main_word(wid, true);
+  return wid;
+}
+
+void Link::set_main_word(int wid, bool main)
+{
+  if (wid < 0 || static_cast<size_t>(wid) >= MAIN_WORD_BITS)
+  {
+    return;
+  }
+  const uint8_t bit = static_cast<uint8_t>(1u << (wid % 8));
+  main_words_[wid / 8] = main ? main_words_[wid / 8] | bit : main_words_[wid / 8] & ~bit;
+}
+
+uint16_t Link::resolve_word(uint16_t idx) const
+{
+  if (idx < load_words_.size())
+  {
+    return static_cast<uint16_t>(load_words_[idx].wid);
+  }
+  return static_cast<uint16_t>(idx + load_base_);
+}
+
+int Link::word_cache_find(uint32_t hash) const
+{
+  const auto it = std::lower_bound(word_cache_.begin(), word_cache_.end(), hash,
+                                   [](const CachedWord& word, uint32_t h)
+                                   { return word.hash < h; });
+  return it != word_cache_.end() && it->hash == hash ? it->wid : -1;
+}
+
+bool Link::resident_matches(int wid, const char* name, size_t name_len, const uint8_t* code,
+                            size_t code_len) const
+{
+  const Word* word = vm_get_word(vm_, wid);
+  if (word == nullptr || vm_word_get_code_len(word) != static_cast<int>(code_len))
+  {
+    return false;
+  }
+  const char* resident_name = vm_word_get_name(word);
+  if (resident_name == nullptr)
+  {
+    resident_name = "";
+  }
+  if (std::strncmp(resident_name, name, name_len) != 0 || resident_name[name_len] != '\0')
+  {
+    return false;
+  }
+
+  const uint8_t* const resident = vm_word_get_code(word);
+  const size_t idx = load_words_.size();
+  size_t pc = 0;
+  while (pc < code_len)
+  {
+    const internal::OpcodeInfo info = internal::kOpcodeTable.entries[code[pc]];
+    if (info.length == 0 || info.length > code_len - pc)
+    {
+      return false;  // Not decodable: cannot be shown to match
+    }
+    if ((info.flags & internal::OPCODE_CALL) == 0)
+    {
+      if (std::memcmp(code + pc, resident + pc, info.length) != 0)
+      {
+        return false;
+      }
+    }
+    else
+    {
+      const uint16_t target = internal::load_le16(code + pc + 1);
+      const int linked = internal::load_le16(resident + pc + 1);
+      if (resident[pc] != code[pc] || (target < idx && load_words_[target].wid != linked) ||
+          (target == idx && linked != wid))
+      {
+        return false;
+      }
+    }
+    pc += info.length;
+  }
+  return true;
+}
+
+void Link::word_cache_add(uint32_t hash, int wid)
+{
+  const auto it = std::lower_bound(word_cache_.begin(), word_cache_.end(), hash,
+                                   [](const CachedWord& word, uint32_t h)
+                                   { return word.hash < h; });
+  if ((it == word_cache_.end() || it->hash != hash) && word_cache_.size() < max_words_)
+  {
+    word_cache_.insert(it, {hash, wid});
+  }
+}
+
+int Link::find_word(const char* name, size_t len) const
+{
+  const auto it = find_name(name_index_, name, len);
+  return it != name_index_.end() ? it->wid : -1;
+}
+
+const char* Link::interned_name(const char* name, size_t len) const
+{
+  const auto it = find_name(name_index_, name, len);
+  return it != name_index_.end() ? it->name : nullptr;
+}
+
+void Link::name_index_add(const char* name, size_t len, int wid)
+{
+  const auto it = find_name(name_index_, name, len);
+  if (it != name_index_.end())
+  {
+    it->prev_wid = it->wid;
+    it->wid = wid;
+    return;
+  }
+  if (name_index_.size() == max_words_)
+  {
+    return;  // Loads check for room up front
+  }
+  const uint32_t hash = name_hash(name, len);
+  const auto pos = std::lower_bound(name_index_.begin(), name_index_.end(), hash,
+                                    [](const NamedWord& entry, uint32_t h)
+                                    { return entry.hash < h; });
+  name_index_.insert(pos, {hash, static_cast<uint8_t>(len), name, wid, -1});
+}
+
+void Link::name_index_revert(const char* name, size_t len, int wid)
+{
+  const auto it = find_name(name_index_, name, len);
+  if (it == name_index_.end() || it->wid < wid)
+  {
+    return;
+  }
+  if (it->prev_wid < wid)
+  {
+    // Taken over once by the failed load: the definition before it, which
+    // may itself be carried by stubs of earlier failed loads
+    if (it->prev_wid < 0)
+    {
+      name_index_.erase(it);
+      return;
+    }
+    it->wid = it->prev_wid;
+    it->prev_wid = -1;
+    return;
+  }
+  // Redefined more than once by the failed load
+  for (int i = wid - 1; i >= 0; --i)
+  {
+    const char* older = vm_word_get_name(vm_get_word(vm_, i));
+    if (older != nullptr && std::strncmp(older, name, len) == 0 && older[len] == '\0')
+    {
+      it->wid = i;
+      return;
+    }
+  }
+  name_index_.erase(it);
+}
+
+uint8_t* Link::place_main_code(uint8_t* code, size_t len)
+{
+  // Anonymous main code is not referenced once vm_exec returns, so it can run
+  // straight from the RX buffer; an async run outlives the frame
+  if (exec_in_place_ && !async_exec_)
+  {
+    return code;
+  }
+
+  uint8_t* stored = arena_.alloc(len);
+  if (stored != nullptr)
+  {
+    std::memcpy(stored, code, len);
   }
+  return stored;
 }
 
-void Link::handle_frame()
+void Link::set_exec_in_place(bool enable)
 {
-  // Verify CRC
-  if (!internal::verify_frame_crc(buffer_.data(), buffer_.size()))
+  if (enable && rx_spare_.capacity() < buffer_.capacity())
   {
-    send_ack(ErrorCode::INVALID_FRAME);
-    return;
+    rx_spare_.reserve(buffer_.capacity());
   }
+  exec_in_place_ = enable;
+}
 
-  // Dispatch command
-  const Command cmd = static_cast<Command>(cmd_);
+bool Link::in_rx_buffer(const uint8_t* ptr) const
+{
+  for (const std::vector<uint8_t>* rx : {&buffer_, &rx_spare_})
+  {
+    const uint8_t* begin = rx->data();
+    if (begin != nullptr && ptr >= begin && ptr < begin + rx->capacity())
+    {
+      return true;
+    }
+  }
+  return false;
+}
 
-  switch (cmd)
+bool Link::accept_sequence()
+{
+  if (rx_payload_len_ == 0)
   {
-    case Command::EXEC:
-      handle_cmd_exec();
-      break;
+    reject_frame(ErrorCode::INVALID_FRAME);  // No room for SEQ
+    return false;
+  }
 
-    case Command::PING:
-      handle_cmd_ping();
-      break;
+  // Strip SEQ from the payload seen by command handlers
+  const uint8_t seq = rx_payload_[0];
+  ++rx_payload_;
+  --rx_payload_len_;
 
-    case Command::QUERY_STACK:
-      handle_cmd_query_stack();
-      break;
+  const uint8_t ahead = static_cast<uint8_t>(seq - expected_seq_);
+  if (ahead == 0)
+  {
+    tx_seq_ = seq;
+    ++expected_seq_;
+    nak_sent_ = false;
+    return true;
+  }
 
-    case Command::QUERY_MEMORY:
-      handle_cmd_query_memory();
-      break;
+  if (ahead >= 256 - window_size_)
+  {
+    // Retransmission of a frame already processed: acknowledge, don't re-run
+    tx_seq_ = seq;
+    send_ack(ErrorCode::OK);
+    return false;
+  }
 
-    case Command::QUERY_WORD:
-      handle_cmd_query_word();
-      break;
+  // Gap: an earlier frame was lost, so go back to expected_seq_
+  reject_frame(ErrorCode::INVALID_FRAME);
+  return false;
+}
 
-    case Command::RESET:
-      handle_cmd_reset();
-      break;
+void Link::reject_frame(ErrorCode code)
+{
+  if (window_size_ == 0)
+  {
+    send_ack(code);
+    return;
+  }
 
-    default:
-      send_ack(ErrorCode::GENERAL_ERROR);
-      break;
+  // NAK once per gap; frames in flight behind it are dropped silently
+  if (!nak_sent_)
+  {
+    tx_seq_ = expected_seq_;
+    send_ack(code);
+    nak_sent_ = true;
   }
 }
 
-namespace internal
-{
-
-void relocate_calls(uint8_t* code, size_t len, int offset)
+void Link::handle_cmd_ping()
 {
-  if (offset == 0)
-    return;  // No relocation needed
-
-  size_t pc = 0;
-  while (pc < len)
+  if (rx_payload_len_ == 0)
   {
-    uint8_t op = code[pc++];
-
-    switch (op)
-    {
-      // CALL: relocate 16-bit word index
-      case 0x50:  // OP_CALL
-        if (pc + 2 <= len)
-        {
-          uint16_t old_idx = code[pc] | (code[pc + 1] << 8);
-          uint16_t new_idx = old_idx + offset;
-          code[pc] = new_idx & 0xFF;
-          code[pc + 1] = (new_idx >> 8) & 0xFF;
-          pc += 2;
-        }
-        break;
-
-      // No-operand instructions
-      case 0x01:  // DUP
-      case 0x02:  // DROP
-      case 0x03:  // SWAP
-      case 0x04:  // OVER
-      // Arithmetic
-      case 0x10:
-      case 0x11:
-      case 0x12:
-      case 0x13:
-      case 0x14:
-      case 0x15:
-      case 0x16:
-      case 0x17:
-      case 0x18:
-      // Comparison, bitwise
-      case 0x20:
-      case 0x21:
-      case 0x22:
-      case 0x23:
-      case 0x24:
-      case 0x25:
-      case 0x26:
-      case 0x27:
-      case 0x28:
-      case 0x29:
-      case 0x2A:
-      case 0x2B:
-      case 0x2C:
-      case 0x2D:
-      case 0x2E:
-      // Memory access
-      case 0x30:
-      case 0x31:
-      case 0x32:
-      case 0x33:
-      case 0x34:
-      case 0x35:
-      case 0x36:
-      case 0x37:
-      case 0x43:  // SELECT
-      case 0x51:  // RET
-      // Return stack
-      case 0x70:
-      case 0x71:
-      case 0x72:
-      // Compact literals (LIT0, LIT1, LITN1)
-      case 0x73:
-      case 0x74:
-      case 0x75:
-      // Local get/set shortcuts
-      case 0x7C:
-      case 0x7D:
-      case 0x7E:
-      case 0x7F:
-      // Task operations
-      case 0x90:
-      case 0x91:
-      case 0x92:
-      case 0x93:
-      case 0x94:
-      case 0x95:
-      case 0x96:
-      case 0x97:
-      case 0x98:
-      case 0x99:
-      case 0x9A:
-        // No operands, continue
-        break;
-
-      // 8-bit immediate
-      case 0x76:  // LIT_U8
-      case 0x77:  // LIT_I8
-      case 0x79:  // LGET
-      case 0x7A:  // LSET
-      case 0x7B:  // LTEE
-      case 0x80:  // LINC
-      case 0x81:  // LDEC
-        pc += 1;
-        break;
-
-      // 16-bit immediate (relative jump or literal)
-      case 0x40:  // JMP
-      case 0x41:  // JZ
-      case 0x42:  // JNZ
-      case 0x78:  // LIT_I16
-        pc += 2;
-        break;
+    send_ack(ErrorCode::OK);
+    return;
+  }
 
-      // 32-bit immediate
-      case 0x00:  // LIT
-        pc += 4;
-        break;
+  // Window negotiation: [WINDOW]([FLAGS]([CRC]))
+  //   -> [ERR_CODE][WINDOW_ACCEPTED]([CAPS...])
+  const CrcType check =
+      rx_payload_len_ >= 3 ? static_cast<CrcType>(rx_payload_[2]) : CrcType::CRC8;
+  const bool check_ok =
+      check == CrcType::CRC8 ||
+      (check == CrcType::CRC16_CCITT && (capabilities() & CAP_CRC16) != 0) ||
+      (check == CrcType::CRC32C && (capabilities() & CAP_CRC32C) != 0);
+  if (!check_ok)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
 
-      // SYS: special 16-byte struct
-      case 0x60:  // SYS
-        pc += 16;
-        break;
+  uint8_t window = rx_payload_[0];
+  if (window > MAX_WINDOW_SIZE)
+  {
+    window = MAX_WINDOW_SIZE;
+  }
 
-      default:
-        // Unknown opcode - skip 1 byte and continue
-        // (conservative approach to avoid breaking on unknown opcodes)
-        break;
-    }
+  uint8_t* out = tx_data();
+  size_t n = 0;
+  out[n++] = window;
+  if (rx_payload_len_ >= 2 && (rx_payload_[1] & PING_FLAG_CAPABILITIES) != 0)
+  {
+    n += write_capabilities(out + n, check);
   }
+  send_response(ErrorCode::OK, n);
+
+  // New framing applies from the next frame on, starting at SEQ 0
+  window_size_ = window;
+  expected_seq_ = 0;
+  nak_sent_ = false;
+  cobs_ = rx_payload_len_ >= 2 && (rx_payload_[1] & PING_FLAG_COBS) != 0;
+  cobs_rx_.reset();
+  check_ = check;
 }
 
-}  // namespace internal
+size_t Link::write_capabilities(uint8_t* out, CrcType check) const
+{
+  out[0] = PROTOCOL_VERSION;
+  out[1] = static_cast<uint8_t>(check);
+  store_le16(out + 2, static_cast<uint16_t>(capabilities() |
+                                            (storage_write_ != nullptr ? CAP_IMAGE : 0) |
+                                            (async_exec_ ? CAP_ASYNC_EXEC : 0) |
+                                            (trace_.enabled() ? CAP_TRACE : 0)));
+  store_le16(out + 4, static_cast<uint16_t>(max_payload()));
+  store_le16(out + 6, static_cast<uint16_t>(max_response()));
+  out[8] = MAX_WINDOW_SIZE;
+  return CAPABILITY_BLOCK_SIZE;
+}
 
-void Link::handle_cmd_exec()
+size_t Link::max_payload() const
 {
-  // Payload starts at index 4 (after STX, LEN_L, LEN_H, CMD)
-  const uint8_t* payload = buffer_.data() + 4;
-  const size_t payload_len = frame_len_;
+  return buffer_.capacity() - 4;
+}
 
-  // Check if payload is a .v4b format (starts with "V4BC" magic)
-  if (payload_len >= 16 && payload[0] == 0x56 && payload[1] == 0x34 &&
-      payload[2] == 0x42 && payload[3] == 0x43)
+size_t Link::max_response() const
+{
+  return 2 + tx_data_capacity();  // ERR_CODE + SEQ + response data
+}
+
+size_t Link::batch_reserve(Command cmd, size_t len)
+{
+  // Result data of handlers that serialize without checking
+  // tx_data_capacity(); the rest are bounded by it or reply with an ACK
+  switch (cmd)
   {
-    // Parse .v4b header
-    uint8_t version_minor = payload[5];
-    uint32_t code_size =
-        payload[8] | (payload[9] << 8) | (payload[10] << 16) | (payload[11] << 24);
-    uint32_t word_count = 0;
+    case Command::EXEC:
+      // [COUNT] + one index per word (5+ bytes each in .v4b) + main code
+      return 1 + 2 * (len / 5 + 1);
 
-    if (version_minor >= 2)
-    {
-      word_count =
-          payload[12] | (payload[13] << 8) | (payload[14] << 16) | (payload[15] << 24);
-    }
+#if V4LINK_ENABLE_STATS
+    case Command::QUERY_STATS:
+      return stats_reply_size();
+#endif
 
-    // Validate payload size
-    if (16 + code_size > payload_len)
+    case Command::QUERY_STACK:
     {
-      send_ack(ErrorCode::GENERAL_ERROR);
-      return;
+      // Exact for the stacks as they are now, just before the handler runs
+      const int ds = vm_ds_depth_public(vm_);
+      const int rs = vm_rs_depth_public(vm_);
+      const size_t ds_count = ds < 0 ? 0 : (ds < 256 ? ds : 256);
+      const size_t rs_count = rs < 0 ? 0 : (rs < 64 ? rs : 64);
+      return 2 + 4 * (ds_count + rs_count);
     }
 
-    std::vector<int> word_indices;
-
-    // Register word definitions first (v0.2+)
-    if (word_count > 0)
-    {
-      const uint8_t* word_ptr = payload + 16 + code_size;
-      const uint8_t* payload_end = payload + payload_len;
-
-      // First pass: register all words and collect indices
-      int first_word_vm_idx = -1;
-      std::vector<size_t> storage_indices;  // Track bytecode_storage_ indices
-
-      for (uint32_t i = 0; i < word_count; i++)
-      {
-        // Check remaining space
-        if (word_ptr + 1 > payload_end)
-        {
-          send_ack(ErrorCode::GENERAL_ERROR);
-          return;
-        }
-
-        // Read name length
-        uint8_t name_len = *word_ptr++;
-
-        // Read name
-        if (word_ptr + name_len + 4 > payload_end)
-        {
-          send_ack(ErrorCode::GENERAL_ERROR);
-          return;
-        }
-
-        std::string word_name(reinterpret_cast<const char*>(word_ptr), name_len);
-        word_ptr += name_len;
+    case Command::QUERY_MEMORY:
+      return len >= 6 ? 256 : 2;
 
-        // Read code length
-        uint32_t word_code_len =
-            word_ptr[0] | (word_ptr[1] << 8) | (word_ptr[2] << 16) | (word_ptr[3] << 24);
-        word_ptr += 4;
+    case Command::QUERY_WORD:
+      return QUERY_WORD_OVERHEAD;
 
-        // Check code fits
-        if (word_ptr + word_code_len > payload_end)
-        {
-          send_ack(ErrorCode::GENERAL_ERROR);
-          return;
-        }
+    case Command::HAVE_WORDS:
+      return 2 + len / 2;
 
-        // Copy word code to persistent storage
-        std::vector<uint8_t> word_code_copy(word_ptr, word_ptr + word_code_len);
-        bytecode_storage_.push_back(std::move(word_code_copy));
-        storage_indices.push_back(bytecode_storage_.size() - 1);
+    case Command::QUERY_WORD_BY_NAME:
+      return 2;
 
-        const uint8_t* persistent_word_code = bytecode_storage_.back().data();
+    case Command::RUN_STATUS:
+      return 1 + 2 + 4 + 4;
 
-        // Register word with VM
-        const int wid =
-            vm_register_word(vm_, word_name.c_str(), persistent_word_code, word_code_len);
+    case Command::READ_MEM_BLOCK:
+    case Command::WRITE_MEM_BLOCK:
+    case Command::WATCH_MEMORY:
+    case Command::ABORT:
+    case Command::REPLACE_WORD:
+    case Command::FORGET_FROM:
+    case Command::RESET:
+      return 2;
 
-        if (wid < 0)
-        {
-          bytecode_storage_.pop_back();
-          send_ack(ErrorCode::VM_ERROR);
-          return;
-        }
+    default:
+      return 0;  // Not allowed in a batch
+  }
+}
 
-        // Save first word's index for relocation
-        if (first_word_vm_idx < 0)
-        {
-          first_word_vm_idx = wid;
-        }
+void Link::handle_cmd_batch()
+{
+  // Request format: ([CMD][LEN (2 bytes)][DATA...])*
+  uint8_t* const payload = rx_payload_;
+  const size_t payload_len = rx_payload_len_;
 
-        word_indices.push_back(wid);
-        word_ptr += word_code_len;
-      }
+  ErrorCode err = ErrorCode::OK;
+  size_t count = 0;
+  size_t pos = 0;
+  batch_active_ = true;
+  batch_len_ = 0;
 
-      // Second pass: relocate CALL instructions in all registered word bytecodes
-      // bytecode_storage_ contains the live bytecode that VM references
-      for (size_t i = 0; i < storage_indices.size(); i++)
-      {
-        size_t storage_idx = storage_indices[i];
-        uint8_t* code = bytecode_storage_[storage_idx].data();
-        size_t len = bytecode_storage_[storage_idx].size();
-        internal::relocate_calls(code, len, first_word_vm_idx);
-      }
+  while (pos < payload_len)
+  {
+    if (count == 0xFF)
+    {
+      err = ErrorCode::BUFFER_FULL;  // COUNT is one byte
+      break;
     }
-
-    // Register and execute main bytecode
-    const uint8_t* main_code = payload + 16;
-    std::vector<uint8_t> main_code_copy(main_code, main_code + code_size);
-    bytecode_storage_.push_back(std::move(main_code_copy));
-
-    // Relocate CALL instructions in main code
-    // Main code references words that were just registered (starting at word_indices[0])
-    const int main_offset = word_count > 0 ? word_indices[0] : 0;
-    internal::relocate_calls(bytecode_storage_.back().data(), code_size, main_offset);
-
-    const uint8_t* persistent_main_code = bytecode_storage_.back().data();
-
-    const int main_wid = vm_register_word(vm_, nullptr, persistent_main_code, code_size);
-
-    if (main_wid < 0)
+    if (payload_len - pos < BATCH_COMMAND_HEADER_SIZE)
     {
-      bytecode_storage_.pop_back();
-      send_ack(ErrorCode::VM_ERROR);
-      return;
+      err = ErrorCode::INVALID_FRAME;
+      break;
     }
-
-    word_indices.push_back(main_wid);
-
-    // Execute main bytecode
-    Word* entry = vm_get_word(vm_, main_wid);
-    if (entry)
+    const Command cmd = static_cast<Command>(payload[pos]);
+    const size_t len = internal::load_le16(payload + pos + 1);
+    pos += BATCH_COMMAND_HEADER_SIZE;
+    if (len > payload_len - pos)
     {
-      vm_exec(vm_, entry);
+      err = ErrorCode::INVALID_FRAME;
+      break;
     }
 
-    // Return all word indices
-    std::vector<uint8_t> response_data;
-    response_data.push_back(static_cast<uint8_t>(word_indices.size()));
-    for (int wid : word_indices)
+    const size_t reserve = batch_reserve(cmd, len);
+    if (reserve == 0)
     {
-      response_data.push_back(static_cast<uint8_t>(wid & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((wid >> 8) & 0xFF));
+      // PING, uploads and nested batches change link state mid-reply
+      send_ack(ErrorCode::GENERAL_ERROR);
     }
-    send_ack(ErrorCode::OK, response_data.data(), response_data.size());
-  }
-  else
-  {
-    // Legacy raw bytecode (no .v4b header)
-    std::vector<uint8_t> bytecode_copy(payload, payload + payload_len);
-    bytecode_storage_.push_back(std::move(bytecode_copy));
-    const uint8_t* persistent_bytecode = bytecode_storage_.back().data();
-
-    const int wid = vm_register_word(vm_, nullptr, persistent_bytecode, payload_len);
-
-    if (wid < 0)
+    else if (reserve > tx_data_capacity())
     {
-      bytecode_storage_.pop_back();
-      send_ack(ErrorCode::VM_ERROR);
-      return;
+      // Stop rather than skip, so later commands never run out of order
+      err = ErrorCode::BUFFER_FULL;
+      break;
     }
-
-    Word* entry = vm_get_word(vm_, wid);
-    if (entry)
+    else
     {
-      vm_exec(vm_, entry);
+      rx_payload_ = payload + pos;
+      rx_payload_len_ = len;
+      dispatch(cmd);
+      batch_ran_exec_ = batch_ran_exec_ || cmd == Command::EXEC;
     }
 
-    uint8_t response_data[3];
-    response_data[0] = 1;
-    response_data[1] = static_cast<uint8_t>(wid & 0xFF);
-    response_data[2] = static_cast<uint8_t>((wid >> 8) & 0xFF);
-    send_ack(ErrorCode::OK, response_data, sizeof(response_data));
+    pos += len;
+    ++count;
   }
+
+  // Results, already in place after [COUNT], become the reply data
+  batch_active_ = false;
+  uint8_t* out = tx_data();
+  out[0] = static_cast<uint8_t>(count);
+  send_response(err, 1 + batch_len_);
 }
 
-void Link::handle_cmd_ping()
+void Link::handle_cmd_reset()
 {
+  reset_state();
   send_ack(ErrorCode::OK);
 }
 
-void Link::handle_cmd_reset()
+void Link::reset_state()
 {
+  run_clear();
   vm_reset(vm_);
-  bytecode_storage_.clear();  // Free all allocated bytecode
-  send_ack(ErrorCode::OK);
+  arena_.clear();  // Dictionary no longer references stored bytecode
+  word_cache_.clear();
+  name_index_.clear();
+  upload_.stage = Upload::Stage::IDLE;
+  profile_.clear();  // Word indices start over
+  std::memset(main_words_, 0, sizeof(main_words_));
 }
 
 void Link::handle_cmd_query_stack()
 {
   // Response format: [ERR_CODE][DS_DEPTH][DS_VALUES...][RS_DEPTH][RS_VALUES...]
-  std::vector<uint8_t> response_data;
+  uint8_t* out = tx_data();
+  size_t n = 0;
 
   // Get data stack
   int ds_depth = vm_ds_depth_public(vm_);
@@ -491,7 +1746,7 @@ void Link::handle_cmd_query_stack()
     return;
   }
 
-  response_data.push_back(static_cast<uint8_t>(ds_depth));
+  out[n++] = static_cast<uint8_t>(ds_depth);
 
   // Copy data stack values (up to 256 values)
   if (ds_depth > 0)
@@ -501,10 +1756,8 @@ void Link::handle_cmd_query_stack()
     for (int i = 0; i < ds_count; ++i)
     {
       // Little-endian i32
-      response_data.push_back(static_cast<uint8_t>(ds_data[i] & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((ds_data[i] >> 8) & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((ds_data[i] >> 16) & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((ds_data[i] >> 24) & 0xFF));
+      store_le32(out + n, static_cast<uint32_t>(ds_data[i]));
+      n += 4;
     }
   }
 
@@ -516,7 +1769,7 @@ void Link::handle_cmd_query_stack()
     return;
   }
 
-  response_data.push_back(static_cast<uint8_t>(rs_depth));
+  out[n++] = static_cast<uint8_t>(rs_depth);
 
   // Copy return stack values (up to 64 values)
   if (rs_depth > 0)
@@ -526,26 +1779,24 @@ void Link::handle_cmd_query_stack()
     for (int i = 0; i < rs_count; ++i)
     {
       // Little-endian i32
-      response_data.push_back(static_cast<uint8_t>(rs_data[i] & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((rs_data[i] >> 8) & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((rs_data[i] >> 16) & 0xFF));
-      response_data.push_back(static_cast<uint8_t>((rs_data[i] >> 24) & 0xFF));
+      store_le32(out + n, static_cast<uint32_t>(rs_data[i]));
+      n += 4;
     }
   }
 
-  send_ack(ErrorCode::OK, response_data.data(), response_data.size());
+  send_response(ErrorCode::OK, n);
 }
 
 void Link::handle_cmd_query_memory()
 {
   // Request format: [ADDR (4 bytes)][LEN (2 bytes)]
-  if (frame_len_ < 6)
+  if (rx_payload_len_ < 6)
   {
     send_ack(ErrorCode::INVALID_FRAME);
     return;
   }
 
-  const uint8_t* payload = buffer_.data() + 4;
+  const uint8_t* payload = rx_payload_;
 
   // Parse address (little-endian u32)
   uint32_t addr =
@@ -559,7 +1810,8 @@ void Link::handle_cmd_query_memory()
   }
 
   // Response format: [ERR_CODE][DATA...]
-  std::vector<uint8_t> response_data;
+  uint8_t* out = tx_data();
+  size_t n = 0;
 
   // Read memory (assuming vm_mem_read32 is available)
   for (uint16_t i = 0; i < len; i += 4)
@@ -575,23 +1827,23 @@ void Link::handle_cmd_query_memory()
     // Add up to 4 bytes (handle partial read at end)
     for (int j = 0; j < 4 && (i + j) < len; ++j)
     {
-      response_data.push_back(static_cast<uint8_t>((value >> (j * 8)) & 0xFF));
+      out[n++] = static_cast<uint8_t>((value >> (j * 8)) & 0xFF);
     }
   }
 
-  send_ack(ErrorCode::OK, response_data.data(), response_data.size());
+  send_response(ErrorCode::OK, n);
 }
 
 void Link::handle_cmd_query_word()
 {
   // Request format: [WORD_IDX (2 bytes)]
-  if (frame_len_ < 2)
+  if (rx_payload_len_ < 2)
   {
     send_ack(ErrorCode::INVALID_FRAME);
     return;
   }
 
-  const uint8_t* payload = buffer_.data() + 4;
+  const uint8_t* payload = rx_payload_;
 
   // Parse word index (little-endian u16)
   uint16_t word_idx = payload[0] | (payload[1] << 8);
@@ -604,8 +1856,17 @@ void Link::handle_cmd_query_word()
     return;
   }
 
+  // Words executed in place have no persistent bytecode to report
+  const v4_u8* code = vm_word_get_code(word);
+  if (code && in_rx_buffer(code))
+  {
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
   // Response format: [ERR_CODE][NAME_LEN][NAME...][CODE_LEN][CODE...]
-  std::vector<uint8_t> response_data;
+  uint8_t* out = tx_data();
+  size_t n = 0;
 
   // Get word name via API
   const char* name = vm_word_get_name(word);
@@ -618,39 +1879,243 @@ void Link::handle_cmd_query_word()
     ++name_len;
   }
 
-  response_data.push_back(static_cast<uint8_t>(name_len));
-  for (size_t i = 0; i < name_len; ++i)
-  {
-    response_data.push_back(static_cast<uint8_t>(name[i]));
-  }
+  out[n++] = static_cast<uint8_t>(name_len);
+  std::memcpy(out + n, name, name_len);
+  n += name_len;
 
   // Get bytecode via API
   uint16_t code_len = vm_word_get_code_len(word);
-  response_data.push_back(static_cast<uint8_t>(code_len & 0xFF));
-  response_data.push_back(static_cast<uint8_t>((code_len >> 8) & 0xFF));
+  if (!code)
+  {
+    code_len = 0;
+  }
+  store_le16(out + n, code_len);
+  n += 2;
 
-  const v4_u8* code = vm_word_get_code(word);
-  if (code && code_len > 0)
+  // Bytecode is sent straight from VM storage as the response tail
+  send_response(ErrorCode::OK, n, code, code_len);
+}
+
+void Link::handle_cmd_have_words()
+{
+  // Request format: [HASH (4 bytes)]*
+  if (rx_payload_len_ % 4 != 0)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  const size_t count = rx_payload_len_ / 4;
+  if (count * 2 > tx_data_capacity())
+  {
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // Response format: [ERR_CODE][WORD_IDX (2 bytes)]* (0xFFFF: not resident)
+  uint8_t* out = tx_data();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const int wid = word_cache_find(internal::load_le32(rx_payload_ + 4 * i));
+    store_le16(out + 2 * i, static_cast<uint16_t>(wid < 0 ? 0xFFFF : wid));
+  }
+  send_response(ErrorCode::OK, count * 2);
+}
+
+void Link::handle_cmd_query_word_by_name()
+{
+  // Request format: [NAME...]
+  if (rx_payload_len_ == 0)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  const int wid = find_word(reinterpret_cast<const char*>(rx_payload_), rx_payload_len_);
+  if (wid < 0)
+  {
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
+  // Response format: [ERR_CODE][WORD_IDX (2 bytes)]
+  store_le16(tx_data(), static_cast<uint16_t>(wid));
+  send_response(ErrorCode::OK, 2);
+}
+
+void Link::send_ack(ErrorCode code, const uint8_t* data, size_t data_len)
+{
+  send_response(code, 0, data, data_len);
+}
+
+void Link::send_response(ErrorCode code, size_t data_len, const uint8_t* tail,
+                         size_t tail_len)
+{
+  if (tail == nullptr)
+  {
+    tail_len = 0;
+  }
+
+  // Without scatter-gather the tail must be copied next to the serialized data,
+  // as it must for COBS encoding. A gathered tail skips that check, but
+  // ERR_CODE, SEQ and data must still fit LEN.
+  const bool gather = uart_writev_ != nullptr && !cobs_;
+  const size_t seq_len = window_size_ > 0 ? 1 : 0;
+  if (((!gather || batch_active_) && data_len + tail_len > tx_data_capacity()) ||
+      1 + seq_len + data_len + tail_len > MAX_FRAME_PAYLOAD)
+  {
+    code = ErrorCode::BUFFER_FULL;
+    data_len = 0;
+    tail_len = 0;
+  }
+  stats_.add_response(code);
+
+  if (batch_active_)
   {
-    for (uint16_t i = 0; i < code_len; ++i)
+    // Collect [ERR_CODE][LEN][DATA...] in place for the combined BATCH reply
+    uint8_t* data = tx_data();
+    if (tail_len > 0)
     {
-      response_data.push_back(code[i]);
+      std::memcpy(data + data_len, tail, tail_len);
     }
+    uint8_t* head = data - BATCH_RESULT_HEADER_SIZE;
+    head[0] = static_cast<uint8_t>(code);
+    store_le16(head + 1, static_cast<uint16_t>(data_len + tail_len));
+    batch_len_ += BATCH_RESULT_HEADER_SIZE + data_len + tail_len;
+    return;
+  }
+
+  // Windowed mode: [STX][LEN_L][LEN_H][ERR_CODE][SEQ][DATA...][CRC]
+  const size_t head_len = internal::FRAME_HEADER_SIZE + seq_len;
+
+  uint8_t* frame = tx_frame();
+  internal::write_ack_header(code, seq_len + data_len + tail_len, frame);
+  if (seq_len > 0)
+  {
+    frame[internal::FRAME_HEADER_SIZE] = tx_seq_;
+  }
+
+  // CRC over [LEN_L][LEN_H][ERR_CODE][SEQ][DATA...]
+  internal::FrameCheck crc(check_);
+  crc.update(frame + 1, head_len - 1 + data_len);
+  crc.update(tail, tail_len);
+  uint8_t check[internal::MAX_CHECK_SIZE];
+  const size_t check_len = crc.finish(check);
+
+  if (gather)
+  {
+    const IoVec iov[3] = {
+        {frame, head_len + data_len},
+        {tail, tail_len},
+        {check, check_len},
+    };
+    stats_.add_tx(head_len + data_len + tail_len + check_len);
+    uart_writev_(user_context_, iov, 3);
+    trace(TraceEvent::RESPONSE, static_cast<uint8_t>(code));
+    return;
   }
 
-  send_ack(ErrorCode::OK, response_data.data(), response_data.size());
+  size_t frame_len = head_len + data_len;
+  if (tail_len > 0)
+  {
+    std::memcpy(frame + frame_len, tail, tail_len);
+    frame_len += tail_len;
+  }
+  std::memcpy(frame + frame_len, check, check_len);
+  transmit(frame, frame_len + check_len);
+  trace(TraceEvent::RESPONSE, static_cast<uint8_t>(code));
 }
 
-void Link::send_ack(ErrorCode code, const uint8_t* data, size_t data_len)
+void Link::send_event(Event event, size_t data_len)
+{
+  // [STX][LEN_L][LEN_H][EVENT][DATA...][CRC], never tagged with SEQ
+  uint8_t* frame = tx_frame();
+  internal::write_event_header(event, data_len, frame);
+
+  const size_t frame_len = internal::FRAME_HEADER_SIZE + data_len;
+  internal::FrameCheck crc(check_);
+  crc.update(frame + 1, frame_len - 1);
+  uint8_t check[internal::MAX_CHECK_SIZE];
+  const size_t check_len = crc.finish(check);
+
+  if (uart_writev_ != nullptr && !cobs_)
+  {
+    const IoVec iov[2] = {
+        {frame, frame_len},
+        {check, check_len},
+    };
+    stats_.add_tx(frame_len + check_len);
+    uart_writev_(user_context_, iov, 2);
+    return;
+  }
+
+  std::memcpy(frame + frame_len, check, check_len);
+  transmit(frame, frame_len + check_len);
+}
+
+void Link::transmit(uint8_t* frame, size_t len)
+{
+  if (!cobs_)
+  {
+    stats_.add_tx(len);
+    uart_write_(user_context_, frame, len);
+    return;
+  }
+
+  // Encode everything after STX into the headroom ahead of it
+  uint8_t* wire = tx_buffer_.data();
+  size_t wire_len = internal::cobs_encode(frame + 1, len - 1, wire);
+  wire[wire_len++] = internal::COBS_DELIMITER;
+  stats_.add_tx(wire_len);
+  if (uart_writev_ != nullptr)
+  {
+    const IoVec iov = {wire, wire_len};
+    uart_writev_(user_context_, &iov, 1);
+    return;
+  }
+  uart_write_(user_context_, wire, wire_len);
+}
+
+uint8_t* Link::tx_frame()
 {
-  std::vector<uint8_t> ack_frame;
-  internal::encode_ack(code, ack_frame, data, data_len);
-  uart_write_(user_context_, ack_frame.data(), ack_frame.size());
+  return tx_buffer_.data() + tx_headroom_;
+}
+
+uint8_t* Link::event_data()
+{
+  return tx_frame() + internal::FRAME_HEADER_SIZE;
+}
+
+uint8_t* Link::tx_data()
+{
+  return tx_frame() + internal::FRAME_HEADER_SIZE + (window_size_ > 0 ? 1 : 0) +
+         batch_offset();
+}
+
+size_t Link::tx_data_capacity() const
+{
+  // Leaves SEQ, the widest check, and the headroom and delimiter of COBS framing
+  return tx_buffer_.size() - tx_headroom_ - 1 - internal::FRAME_HEADER_SIZE - 1 -
+         internal::MAX_CHECK_SIZE - batch_offset();
+}
+
+size_t Link::max_load_words() const
+{
+  // [WORD_COUNT][WORD_IDX (2 bytes)]*WORD_COUNT, main code last
+  size_t fit = (tx_data_capacity() - 1) / 2 - 1;
+  fit = fit < 254 ? fit : 254;
+  return fit < max_words_ ? fit : max_words_;
+}
+
+size_t Link::batch_offset() const
+{
+  // Inside a BATCH: after [COUNT], the results so far, and the next result header
+  return batch_active_ ? 1 + batch_len_ + BATCH_RESULT_HEADER_SIZE : 0;
 }
 
 void Link::reset()
 {
-  vm_reset(vm_);
+  reset_state();
 }
 
 }  // namespace link
@@ -8,6 +8,8 @@
  * @license Dual-licensed under MIT or Apache-2.0
  */
 
+#include <cstddef>
+#include <cstring>
 #include <new>
 
 #include "v4link/link.h"
@@ -24,12 +26,20 @@ struct V4Link
   Link* cpp_link;
   void* user;
   v4link_uart_write_fn uart_write;
+  v4link_uart_writev_fn uart_writev;
+  v4link_storage_write_fn storage_write;
+  v4link_exec_slice_fn exec_slice;
+  v4link_timestamp_fn timestamp;
 
-  V4Link(Vm* vm, v4link_uart_write_fn write_fn, void* user_ctx, size_t buffer_size)
-      : cpp_link(nullptr), user(user_ctx), uart_write(write_fn)
+  V4Link(Vm* vm, v4link_uart_write_fn write_fn, void* user_ctx, size_t buffer_size,
+         uint8_t* arena, size_t arena_size, size_t rx_ring_size, size_t max_words)
+      : cpp_link(nullptr), user(user_ctx), uart_write(write_fn), uart_writev(nullptr),
+        storage_write(nullptr), exec_slice(nullptr), timestamp(nullptr)
   {
     // Create C++ Link with wrapper function that forwards to C callback
-    cpp_link = new (std::nothrow) Link(vm, uart_write_wrapper, this, buffer_size);
+    cpp_link = new (std::nothrow)
+        Link(vm, uart_write_wrapper, this, buffer_size, arena_size, arena, rx_ring_size,
+             max_words);
   }
 
   ~V4Link()
@@ -46,8 +56,77 @@ struct V4Link
       self->uart_write(self->user, data, len);
     }
   }
+
+  // Static wrapper function that forwards to C vectored callback
+  static void uart_writev_wrapper(void* context, const Link::IoVec* iov, size_t iovcnt)
+  {
+    V4Link* self = static_cast<V4Link*>(context);
+    if (self && self->uart_writev)
+    {
+      self->uart_writev(self->user, reinterpret_cast<const v4link_iovec_t*>(iov),
+                        iovcnt);
+    }
+  }
+
+  static bool storage_write_wrapper(void* context, size_t offset, const uint8_t* data,
+                                    size_t len)
+  {
+    V4Link* self = static_cast<V4Link*>(context);
+    return self && self->storage_write &&
+           self->storage_write(self->user, offset, data, len) != 0;
+  }
+
+  static int exec_slice_wrapper(void* context, Vm* vm, Word* entry, Link::SliceOp op,
+                                uint32_t budget)
+  {
+    V4Link* self = static_cast<V4Link*>(context);
+    return self->exec_slice(self->user, vm, entry, static_cast<int>(op), budget);
+  }
+
+  static uint32_t timestamp_wrapper(void* context)
+  {
+    V4Link* self = static_cast<V4Link*>(context);
+    return self->timestamp(self->user);
+  }
 };
 
+// Link::IoVec is handed to C callbacks as v4link_iovec_t without conversion
+static_assert(sizeof(Link::IoVec) == sizeof(v4link_iovec_t), "IoVec layout mismatch");
+static_assert(offsetof(Link::IoVec, data) == offsetof(v4link_iovec_t, data),
+              "IoVec layout mismatch");
+static_assert(offsetof(Link::IoVec, len) == offsetof(v4link_iovec_t, len),
+              "IoVec layout mismatch");
+
+// C capability constants mirror protocol.hpp
+static_assert(V4LINK_PROTOCOL_VERSION == PROTOCOL_VERSION, "protocol version mismatch");
+static_assert(V4LINK_PING_FLAG_CAPABILITIES == PING_FLAG_CAPABILITIES &&
+                  V4LINK_PING_FLAG_COBS == PING_FLAG_COBS,
+              "PING flag mismatch");
+static_assert(V4LINK_CAP_WINDOW == CAP_WINDOW && V4LINK_CAP_COMPRESSION == CAP_COMPRESSION &&
+                  V4LINK_CAP_BATCH == CAP_BATCH && V4LINK_CAP_WORD_CACHE == CAP_WORD_CACHE &&
+                  V4LINK_CAP_IMAGE == CAP_IMAGE && V4LINK_CAP_ASYNC_EXEC == CAP_ASYNC_EXEC &&
+                  V4LINK_CAP_STATS == CAP_STATS && V4LINK_CAP_TRACE == CAP_TRACE &&
+                  V4LINK_CAP_PROFILE == CAP_PROFILE && V4LINK_CAP_COBS == CAP_COBS &&
+                  V4LINK_CAP_CRC16 == CAP_CRC16 && V4LINK_CAP_CRC32C == CAP_CRC32C,
+              "capability bit mismatch");
+static_assert(V4LINK_CRC_CRC8 == static_cast<int>(CrcType::CRC8) &&
+                  V4LINK_CRC_CRC16_CCITT == static_cast<int>(CrcType::CRC16_CCITT) &&
+                  V4LINK_CRC_CRC32C == static_cast<int>(CrcType::CRC32C),
+              "frame check type mismatch");
+static_assert(V4LINK_STATS_FLAG_RESET == STATS_FLAG_RESET, "QUERY_STATS flag mismatch");
+static_assert(V4LINK_TRACE_FLAG_MORE == TRACE_FLAG_MORE, "DUMP_TRACE flag mismatch");
+static_assert(V4LINK_PROFILE_SAMPLE == static_cast<int>(ProfileMode::SAMPLE) &&
+                  V4LINK_PROFILE_ENTRY == static_cast<int>(ProfileMode::ENTRY),
+              "profile mode mismatch");
+static_assert(V4LINK_STATS_COMMAND_SLOTS == internal::STATS_COMMAND_SLOTS &&
+                  V4LINK_STATS_ERROR_CODES == internal::ERROR_CODE_COUNT,
+              "statistics size mismatch");
+static_assert(V4LINK_SLICE_START == static_cast<int>(Link::SliceOp::START) &&
+                  V4LINK_SLICE_RESUME == static_cast<int>(Link::SliceOp::RESUME) &&
+                  V4LINK_SLICE_ABORT == static_cast<int>(Link::SliceOp::ABORT) &&
+                  V4LINK_SLICE_YIELD == Link::SLICE_YIELD,
+              "slice constant mismatch");
+
 /* ========================================================================= */
 /* Error message strings                                                     */
 /* ========================================================================= */
@@ -71,7 +150,8 @@ const char* v4link_strerror(v4link_error_t err)
 /* ========================================================================= */
 
 V4Link* v4link_create(Vm* vm, v4link_uart_write_fn uart_write, void* user,
-                      size_t buffer_size)
+                      size_t buffer_size, uint8_t* arena, size_t arena_size,
+                      size_t rx_ring_size, size_t max_words)
 {
   if (vm == nullptr || uart_write == nullptr)
   {
@@ -83,7 +163,22 @@ V4Link* v4link_create(Vm* vm, v4link_uart_write_fn uart_write, void* user,
     buffer_size = V4LINK_MAX_PAYLOAD_SIZE;
   }
 
-  V4Link* link = new (std::nothrow) V4Link(vm, uart_write, user, buffer_size);
+  if (arena_size == 0)
+  {
+    if (arena != nullptr)
+    {
+      return nullptr;  // A caller-provided region needs an explicit size
+    }
+    arena_size = V4LINK_DEFAULT_ARENA_SIZE;
+  }
+
+  if (max_words == 0)
+  {
+    max_words = V4LINK_DEFAULT_MAX_WORDS;
+  }
+
+  V4Link* link = new (std::nothrow)
+      V4Link(vm, uart_write, user, buffer_size, arena, arena_size, rx_ring_size, max_words);
   if (link == nullptr || link->cpp_link == nullptr)
   {
     delete link;
@@ -110,6 +205,65 @@ void v4link_feed_byte(V4Link* link, uint8_t byte)
   }
 }
 
+void v4link_feed(V4Link* link, const uint8_t* data, size_t len)
+{
+  if (link && link->cpp_link && data)
+  {
+    link->cpp_link->feed(data, len);
+  }
+}
+
+void v4link_tick(V4Link* link, uint32_t now_us)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->tick(now_us);
+  }
+}
+
+void v4link_set_rx_timeout(V4Link* link, uint32_t timeout_us)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_rx_timeout(timeout_us);
+  }
+}
+
+int v4link_isr_push(V4Link* link, uint8_t byte)
+{
+  if (link && link->cpp_link)
+  {
+    return link->cpp_link->isr_push(byte) ? 1 : 0;
+  }
+  return 0;
+}
+
+size_t v4link_poll(V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    return link->cpp_link->poll();
+  }
+  return 0;
+}
+
+void v4link_set_async_exec(V4Link* link, int enable)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_async_exec(enable != 0);
+  }
+}
+
+void v4link_set_exec_slice(V4Link* link, v4link_exec_slice_fn exec_slice, uint32_t budget)
+{
+  if (link && link->cpp_link)
+  {
+    link->exec_slice = exec_slice;
+    link->cpp_link->set_exec_slice(exec_slice ? V4Link::exec_slice_wrapper : nullptr, budget);
+  }
+}
+
 void v4link_reset(V4Link* link)
 {
   if (link && link->cpp_link)
@@ -118,6 +272,85 @@ void v4link_reset(V4Link* link)
   }
 }
 
+void v4link_set_uart_writev(V4Link* link, v4link_uart_writev_fn uart_writev)
+{
+  if (link && link->cpp_link)
+  {
+    link->uart_writev = uart_writev;
+    link->cpp_link->set_uart_writev(uart_writev ? V4Link::uart_writev_wrapper : nullptr);
+  }
+}
+
+void v4link_set_exec_in_place(V4Link* link, int enable)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_exec_in_place(enable != 0);
+  }
+}
+
+void v4link_set_vm_memory(V4Link* link, uint8_t* mem, size_t size)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_vm_memory(mem, size);
+  }
+}
+
+void v4link_set_storage(V4Link* link, v4link_storage_write_fn storage_write,
+                        const uint8_t* region, size_t capacity)
+{
+  if (link && link->cpp_link)
+  {
+    link->storage_write = storage_write;
+    link->cpp_link->set_storage(storage_write ? V4Link::storage_write_wrapper : nullptr,
+                                region, capacity);
+  }
+}
+
+v4link_error_t v4link_restore_image(V4Link* link, const uint8_t* image, size_t len)
+{
+  if (link && link->cpp_link)
+  {
+    return static_cast<v4link_error_t>(link->cpp_link->restore_image(image, len));
+  }
+  return V4LINK_ERR_GENERAL_ERROR;
+}
+
+int v4link_find_word(const V4Link* link, const char* name)
+{
+  if (link && link->cpp_link && name)
+  {
+    return link->cpp_link->find_word(name, std::strlen(name));
+  }
+  return -1;
+}
+
+size_t v4link_mem_block_max(const V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    return link->cpp_link->mem_block_max();
+  }
+  return 0;
+}
+
+void v4link_watch_poll(V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->watch_poll();
+  }
+}
+
+void v4link_set_watch_interval(V4Link* link, uint32_t interval_us)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_watch_interval(interval_us);
+  }
+}
+
 size_t v4link_buffer_capacity(const V4Link* link)
 {
   if (link && link->cpp_link)
@@ -126,3 +359,90 @@ size_t v4link_buffer_capacity(const V4Link* link)
   }
   return 0;
 }
+
+size_t v4link_max_payload(const V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    return link->cpp_link->max_payload();
+  }
+  return 0;
+}
+
+size_t v4link_arena_used(const V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    return link->cpp_link->arena_used();
+  }
+  return 0;
+}
+
+void v4link_set_timestamp(V4Link* link, v4link_timestamp_fn timestamp)
+{
+  if (link && link->cpp_link)
+  {
+    link->timestamp = timestamp;
+    link->cpp_link->set_timestamp(timestamp ? V4Link::timestamp_wrapper : nullptr);
+  }
+}
+
+v4link_error_t v4link_get_stats(const V4Link* link, v4link_stats_t* out)
+{
+#if V4LINK_ENABLE_STATS
+  if (link && link->cpp_link && out)
+  {
+    const Link& l = *link->cpp_link;
+    const internal::LinkStats& stats = l.stats();
+    out->rx_bytes = stats.rx_bytes(l.rx_bytes());
+    out->tx_bytes = stats.tx_bytes();
+    out->rx_dropped = stats.rx_dropped();
+    out->crc_errors = stats.crc_errors();
+    out->rx_overruns = stats.rx_overruns(l.rx_overruns());
+    out->arena_peak = static_cast<uint32_t>(l.arena_peak());
+    out->untracked = stats.untracked();
+    for (size_t i = 0; i < internal::ERROR_CODE_COUNT; ++i)
+    {
+      out->responses[i] = stats.errors(static_cast<ErrorCode>(i));
+    }
+    out->command_count = stats.command_count();
+    for (size_t i = 0; i < out->command_count; ++i)
+    {
+      const internal::CommandStats& c = stats.command(i);
+      out->commands[i].cmd = stats.command_code(i);
+      out->commands[i].frames = c.frames;
+      out->commands[i].total_time = c.total_time;
+      out->commands[i].max_time = c.max_time;
+    }
+    return V4LINK_ERR_OK;
+  }
+#else
+  (void)link;
+  (void)out;
+#endif
+  return V4LINK_ERR_GENERAL_ERROR;
+}
+
+void v4link_clear_stats(V4Link* link)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->clear_stats();
+  }
+}
+
+void v4link_set_trace_buffer(V4Link* link, uint8_t* buffer, size_t size)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->set_trace_buffer(buffer, size);
+  }
+}
+
+void v4link_profile_sample(V4Link* link, int wid)
+{
+  if (link && link->cpp_link)
+  {
+    link->cpp_link->profile_sample(wid);
+  }
+}
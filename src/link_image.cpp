@@ -0,0 +1,321 @@
+/**
+ * @file link_image.cpp
+ * @brief Persistent word images (SAVE_IMAGE, Link::restore_image())
+ *
+ * SAVE_IMAGE writes every registered word, already relocated, to storage
+ * through the StorageWriteFn. At boot Link::restore_image() registers the
+ * words straight from the memory-mapped image: names and code are used in
+ * place, so restoring copies nothing and needs no RAM for code.
+ *
+ * Image layout (little-endian):
+ *
+ *   [MAGIC "V4LI"][VERSION][0][WORD_COUNT (2)][BODY_LEN (4)][CHECKSUM (4)]
+ *   ([FLAGS][NAME_LEN][CODE_LEN (4)][HASH (4)][NAME...][NUL][CODE...])*
+ *
+ * Words are stored in word index order from index 0, so the saved CALL
+ * operands stay valid once the words are registered again in an empty
+ * dictionary. CHECKSUM is FNV-1a over the body. The header is written
+ * last: an image cut short by power loss has no magic and is ignored.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "v4/vm_api.h"
+#include "v4link/internal/word_hash.hpp"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+namespace
+{
+
+constexpr uint8_t IMAGE_MAGIC[4] = {'V', '4', 'L', 'I'};
+constexpr uint8_t IMAGE_VERSION = 1;
+constexpr size_t IMAGE_HEADER_SIZE = 16;
+
+// [FLAGS][NAME_LEN][CODE_LEN (4 bytes)][HASH (4 bytes)]
+constexpr size_t IMAGE_ENTRY_SIZE = 10;
+
+// Entry FLAGS: HASH is the word's chain hash (word cache entry)
+constexpr uint8_t IMAGE_WORD_HASHED = 0x01;
+// Entry FLAGS: main code, saved as STUB_CODE
+constexpr uint8_t IMAGE_WORD_MAIN = 0x02;
+
+// Main code (EXEC, COMMIT) is never called again; a RET keeps its index
+// taken without saving the code. Unnamed .v4b words are callable and kept.
+constexpr uint8_t STUB_CODE[1] = {0x51};
+
+/**
+ * @brief Buffered sequential writer for the image body
+ */
+class ImageWriter
+{
+ public:
+  ImageWriter(Link::StorageWriteFn write, void* user, uint8_t* buf, size_t cap)
+      : write_(write), user_(user), buf_(buf), cap_(cap), fill_(0),
+        offset_(IMAGE_HEADER_SIZE), checksum_(internal::WORD_HASH_INIT), ok_(true)
+  {
+  }
+
+  void put(const uint8_t* data, size_t len)
+  {
+    checksum_ = internal::word_hash_update(checksum_, data, len);
+    while (len > 0 && ok_)
+    {
+      const size_t run = len < cap_ - fill_ ? len : cap_ - fill_;
+      std::memcpy(buf_ + fill_, data, run);
+      fill_ += run;
+      data += run;
+      len -= run;
+      if (fill_ == cap_)
+      {
+        flush();
+      }
+    }
+  }
+
+  /**
+   * @brief Write out buffered bytes
+   *
+   * @return false if any storage write failed
+   */
+  bool flush()
+  {
+    if (fill_ > 0 && ok_)
+    {
+      ok_ = write_(user_, offset_, buf_, fill_);
+      offset_ += fill_;
+      fill_ = 0;
+    }
+    return ok_;
+  }
+
+  uint32_t checksum() const
+  {
+    return checksum_;
+  }
+
+ private:
+  Link::StorageWriteFn write_;
+  void* user_;
+  uint8_t* buf_;
+  size_t cap_;
+  size_t fill_;
+  size_t offset_;
+  uint32_t checksum_;
+  bool ok_;
+};
+
+// Name length as stored in the image
+size_t image_name_len(const Word* word)
+{
+  const char* name = vm_word_get_name(word);
+  const size_t len = name != nullptr ? std::strlen(name) : 0;
+  return len < 0xFF ? len : 0xFF;
+}
+
+}  // namespace
+
+void Link::handle_cmd_save_image()
+{
+  if (storage_write_ == nullptr)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  // 1. Size the image, and refuse to overwrite code that is still in use
+  size_t body_len = 0;
+  uint32_t count = 0;
+  for (const Word* word; count < 0xFFFF && (word = vm_get_word(vm_, count)) != nullptr;
+       ++count)
+  {
+    const v4_u8* code = vm_word_get_code(word);
+    if (code != nullptr && storage_region_ != nullptr && code >= storage_region_ &&
+        code < storage_region_ + storage_capacity_)
+    {
+      send_ack(ErrorCode::GENERAL_ERROR);  // Restored from the region being written
+      return;
+    }
+
+    const size_t name_len = image_name_len(word);
+    const size_t code_len = is_main_word(static_cast<int>(count))
+                                ? sizeof(STUB_CODE)
+                                : static_cast<size_t>(vm_word_get_code_len(word));
+    body_len += IMAGE_ENTRY_SIZE + name_len + 1 + code_len;
+  }
+
+  const size_t image_len = IMAGE_HEADER_SIZE + body_len;
+  if (image_len > storage_capacity_)
+  {
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // 2. Prepare the region, then stream the body through the TX buffer,
+  // which is idle until the response is built
+  if (!storage_write_(user_context_, 0, nullptr, image_len))
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  ImageWriter writer(storage_write_, user_context_, tx_data(), tx_data_capacity());
+  for (uint32_t wid = 0; wid < count; ++wid)
+  {
+    const Word* word = vm_get_word(vm_, wid);
+    const size_t name_len = image_name_len(word);
+    const bool main = is_main_word(static_cast<int>(wid));
+    const v4_u8* code = main ? STUB_CODE : vm_word_get_code(word);
+    const size_t code_len =
+        main ? sizeof(STUB_CODE) : static_cast<size_t>(vm_word_get_code_len(word));
+
+    uint32_t hash = 0;
+    uint8_t flags = main ? IMAGE_WORD_MAIN : 0;
+    for (const CachedWord& cached : word_cache_)
+    {
+      if (cached.wid == static_cast<int>(wid))
+      {
+        hash = cached.hash;
+        flags |= IMAGE_WORD_HASHED;
+        break;
+      }
+    }
+
+    uint8_t entry[IMAGE_ENTRY_SIZE];
+    entry[0] = flags;
+    entry[1] = static_cast<uint8_t>(name_len);
+    internal::store_le32(entry + 2, static_cast<uint32_t>(code_len));
+    internal::store_le32(entry + 6, hash);
+    writer.put(entry, sizeof(entry));
+
+    const uint8_t nul = 0;
+    writer.put(reinterpret_cast<const uint8_t*>(vm_word_get_name(word)), name_len);
+    writer.put(&nul, 1);
+    if (code_len > 0)
+    {
+      writer.put(code, code_len);
+    }
+  }
+
+  // 3. Header last: only a complete image becomes valid
+  uint8_t header[IMAGE_HEADER_SIZE] = {0};
+  std::memcpy(header, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  header[4] = IMAGE_VERSION;
+  internal::store_le16(header + 6, static_cast<uint16_t>(count));
+  internal::store_le32(header + 8, static_cast<uint32_t>(body_len));
+  internal::store_le32(header + 12, writer.checksum());
+  if (!writer.flush() || !storage_write_(user_context_, 0, header, sizeof(header)))
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  // Response format: [ERR_CODE][WORD_COUNT (2 bytes)][IMAGE_LEN (4 bytes)]
+  uint8_t* out = tx_data();
+  internal::store_le16(out, static_cast<uint16_t>(count));
+  internal::store_le32(out + 2, static_cast<uint32_t>(image_len));
+  send_response(ErrorCode::OK, 6);
+}
+
+ErrorCode Link::restore_image(const uint8_t* image, size_t len)
+{
+  if (image == nullptr || len < IMAGE_HEADER_SIZE ||
+      std::memcmp(image, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || image[4] != IMAGE_VERSION)
+  {
+    return ErrorCode::GENERAL_ERROR;
+  }
+
+  const uint32_t count = internal::load_le16(image + 6);
+  const uint32_t body_len = internal::load_le32(image + 8);
+  if (body_len > len - IMAGE_HEADER_SIZE)
+  {
+    return ErrorCode::GENERAL_ERROR;
+  }
+
+  const uint8_t* const body = image + IMAGE_HEADER_SIZE;
+  if (internal::word_hash_update(internal::WORD_HASH_INIT, body, body_len) !=
+      internal::load_le32(image + 12))
+  {
+    return ErrorCode::GENERAL_ERROR;
+  }
+
+  // Validate every entry before registering anything
+  const uint8_t* const end = body + body_len;
+  const uint8_t* p = body;
+  size_t hashed = 0;
+  size_t named = 0;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (static_cast<size_t>(end - p) < IMAGE_ENTRY_SIZE)
+    {
+      return ErrorCode::GENERAL_ERROR;
+    }
+    if (p[0] & IMAGE_WORD_HASHED)
+    {
+      hashed++;
+    }
+    const size_t name_len = p[1];
+    const size_t code_len = internal::load_le32(p + 2);
+    if (name_len > 0)
+    {
+      named++;
+    }
+    p += IMAGE_ENTRY_SIZE;
+    if (static_cast<size_t>(end - p) < name_len + 1 ||
+        static_cast<size_t>(end - p) - name_len - 1 < code_len || p[name_len] != 0)
+    {
+      return ErrorCode::GENERAL_ERROR;
+    }
+    p += name_len + 1 + code_len;
+  }
+  if (hashed > max_words_ - word_cache_.size() || named > max_words_ - name_index_.size())
+  {
+    return ErrorCode::BUFFER_FULL;
+  }
+
+  // Saved CALL operands hold the original word indices
+  if (vm_get_word(vm_, 0) != nullptr)
+  {
+    return ErrorCode::VM_ERROR;
+  }
+
+  p = body;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const uint8_t flags = p[0];
+    const size_t name_len = p[1];
+    const uint32_t code_len = internal::load_le32(p + 2);
+    const uint32_t hash = internal::load_le32(p + 6);
+    const char* name = reinterpret_cast<const char*>(p + IMAGE_ENTRY_SIZE);
+    const uint8_t* code = p + IMAGE_ENTRY_SIZE + name_len + 1;
+
+    // Name and code are used in place: nothing is copied to RAM
+    const int wid =
+        register_word(name_len > 0 ? name : nullptr, name_len, code, static_cast<int>(code_len));
+    if (wid != static_cast<int>(i))
+    {
+      // The dictionary was empty: going back to that undoes the words so far
+      reset_state();
+      return ErrorCode::VM_ERROR;
+    }
+    if (flags & IMAGE_WORD_HASHED)
+    {
+      word_cache_add(hash, wid);
+    }
+    set_main_word(wid, (flags & IMAGE_WORD_MAIN) != 0);
+    p = code + code_len;
+  }
+
+  return ErrorCode::OK;
+}
+
+}  // namespace link
+}  // namespace v4
@@ -0,0 +1,352 @@
+/**
+ * @file link_memory.cpp
+ * @brief VM memory block transfers and watches (READ_MEM_BLOCK,
+ *        WRITE_MEM_BLOCK, WATCH_MEMORY)
+ *
+ * With the VM memory region registered through Link::set_vm_memory() a
+ * transfer is a single bounds check and memcpy. Without it the V4 word
+ * accessors are used, which cost one call and bounds check per 4 bytes.
+ *
+ * Watched regions keep a shadow copy; a poll pushes only the runs that
+ * differ from it and then brings it up to date.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "v4/errors.hpp"
+#include "v4/vm_api.h"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+namespace
+{
+
+// Bytes of [addr, addr + len) that lie inside a memory of @p size bytes
+size_t clamp_range(size_t size, uint32_t addr, size_t len)
+{
+  if (addr >= size)
+  {
+    return 0;
+  }
+  const size_t avail = size - addr;
+  return len < avail ? len : avail;
+}
+
+// MEMORY_DELTA run header: [OFFSET (2 bytes)][LEN (2 bytes)]
+constexpr size_t RUN_HEADER_SIZE = 4;
+
+// Bytes read per vm_mem_read32() pass when diffing without direct access
+constexpr size_t WATCH_CHUNK_SIZE = 32;
+
+}  // namespace
+
+size_t Link::mem_read(uint32_t addr, uint8_t* out, size_t len)
+{
+  if (vm_mem_ != nullptr)
+  {
+    const size_t n = clamp_range(vm_mem_size_, addr, len);
+    std::memcpy(out, vm_mem_ + addr, n);
+    return n;
+  }
+
+  // The word accessor fails for any word not wholly inside memory, so a
+  // range ending in the last 1-3 bytes of memory reads short
+  size_t n = 0;
+  while (n < len)
+  {
+    const uint32_t at = addr + static_cast<uint32_t>(n);
+    v4_u32 value = 0;
+    if (at < addr || vm_mem_read32(vm_, at, &value) != V4_OK)
+    {
+      break;
+    }
+    uint8_t word[4];
+    internal::store_le32(word, value);
+    const size_t take = len - n < 4 ? len - n : 4;
+    std::memcpy(out + n, word, take);
+    n += take;
+  }
+  return n;
+}
+
+size_t Link::mem_write(uint32_t addr, const uint8_t* in, size_t len)
+{
+  if (vm_mem_ != nullptr)
+  {
+    const size_t n = clamp_range(vm_mem_size_, addr, len);
+    std::memcpy(vm_mem_ + addr, in, n);
+    return n;
+  }
+
+  size_t n = 0;
+  while (n < len)
+  {
+    const uint32_t at = addr + static_cast<uint32_t>(n);
+    uint8_t word[4];
+    const size_t take = len - n < 4 ? len - n : 4;
+    if (at < addr)
+    {
+      break;  // Address wrapped
+    }
+    if (take < 4)
+    {
+      // Read-modify-write the trailing partial word
+      v4_u32 old = 0;
+      if (vm_mem_read32(vm_, at, &old) != V4_OK)
+      {
+        break;
+      }
+      internal::store_le32(word, old);
+    }
+    std::memcpy(word, in + n, take);
+    if (vm_mem_write32(vm_, at, internal::load_le32(word)) != V4_OK)
+    {
+      break;
+    }
+    n += take;
+  }
+  return n;
+}
+
+void Link::handle_cmd_read_mem_block()
+{
+  // Request format: [ADDR (4 bytes)][LEN (2 bytes)]
+  if (rx_payload_len_ < 6)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  const uint32_t addr = internal::load_le32(rx_payload_);
+  const uint16_t len = internal::load_le16(rx_payload_ + 4);
+  if (len > mem_block_max())
+  {
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // Response format: [ERR_CODE][COUNT (2 bytes)][DATA...]
+  uint8_t* out = tx_data();
+  const size_t n = mem_read(addr, out + 2, len);
+  internal::store_le16(out, static_cast<uint16_t>(n));
+  send_response(n == len ? ErrorCode::OK : ErrorCode::VM_ERROR, 2 + n);
+}
+
+void Link::handle_cmd_write_mem_block()
+{
+  // Request format: [ADDR (4 bytes)][DATA...]
+  if (rx_payload_len_ < 4)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  const uint32_t addr = internal::load_le32(rx_payload_);
+  const size_t len = rx_payload_len_ - 4;
+  if (len > mem_block_max())
+  {
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // Response format: [ERR_CODE][COUNT (2 bytes)]
+  const size_t n = mem_write(addr, rx_payload_ + 4, len);
+  uint8_t* out = tx_data();
+  internal::store_le16(out, static_cast<uint16_t>(n));
+  send_response(n == len ? ErrorCode::OK : ErrorCode::VM_ERROR, 2);
+}
+
+void Link::handle_cmd_watch_memory()
+{
+  // Request format: [ID][ADDR (4 bytes)][LEN (2 bytes)]
+  if (rx_payload_len_ < 7)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+
+  const uint8_t id = rx_payload_[0];
+  const uint32_t addr = internal::load_le32(rx_payload_ + 1);
+  const uint16_t len = internal::load_le16(rx_payload_ + 5);
+  if (id >= MAX_WATCH_REGIONS)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  watch_remove(id);
+  if (len == 0)
+  {
+    send_ack(ErrorCode::OK);
+    return;
+  }
+
+  const size_t shadow = watch_shadow_.size();
+  if (len > MAX_WATCH_BYTES - shadow)
+  {
+    send_ack(ErrorCode::BUFFER_FULL);
+    return;
+  }
+
+  // Reserve the whole shadow area once so later watches never reallocate
+  watch_shadow_.reserve(MAX_WATCH_BYTES);
+  watch_shadow_.resize(shadow + len);
+
+  // Reading the region both validates it and seeds the shadow
+  if (mem_read(addr, watch_shadow_.data() + shadow, len) != len)
+  {
+    watch_shadow_.resize(shadow);
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
+  watches_[id] = {addr, len, static_cast<uint16_t>(shadow), false};
+  send_ack(ErrorCode::OK);
+}
+
+void Link::watch_remove(uint8_t id)
+{
+  Watch& watch = watches_[id];
+  if (watch.len == 0)
+  {
+    return;
+  }
+
+  // Keep shadow copies packed so the free space stays contiguous
+  const auto first = watch_shadow_.begin() + watch.shadow;
+  watch_shadow_.erase(first, first + watch.len);
+  for (Watch& other : watches_)
+  {
+    if (other.len != 0 && other.shadow > watch.shadow)
+    {
+      other.shadow = static_cast<uint16_t>(other.shadow - watch.len);
+    }
+  }
+  watch = Watch{};
+}
+
+void Link::watch_poll()
+{
+  for (uint8_t id = 0; id < MAX_WATCH_REGIONS; ++id)
+  {
+    if (watches_[id].len != 0)
+    {
+      watch_diff(id);
+    }
+  }
+}
+
+void Link::watch_diff(uint8_t id)
+{
+  Watch& watch = watches_[id];
+  uint8_t* const shadow = watch_shadow_.data() + watch.shadow;
+
+  // Unchanged regions cost one memcmp with direct memory access
+  if (vm_mem_ != nullptr && watch.primed &&
+      std::memcmp(vm_mem_ + watch.addr, shadow, watch.len) == 0)
+  {
+    return;
+  }
+
+  size_t len = 0;  // Event data pending at event_data() (0: no frame open)
+  size_t run_start = 0;
+  size_t run_end = 0;  // 0: no run open (runs are never empty)
+
+  uint8_t chunk[WATCH_CHUNK_SIZE];
+  size_t base = 0;
+  while (base < watch.len)
+  {
+    const uint8_t* cur;
+    size_t n;
+    if (vm_mem_ != nullptr)
+    {
+      cur = vm_mem_ + watch.addr;
+      n = watch.len;
+    }
+    else
+    {
+      n = watch.len - base < WATCH_CHUNK_SIZE ? watch.len - base : WATCH_CHUNK_SIZE;
+      if (mem_read(watch.addr + static_cast<uint32_t>(base), chunk, n) != n)
+      {
+        break;
+      }
+      cur = chunk;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      const size_t at = base + i;
+      if (watch.primed && cur[i] == shadow[at])
+      {
+        continue;
+      }
+      shadow[at] = cur[i];
+
+      // A gap of at least one run header is cheaper to send as a new run
+      if (run_end != 0 && at - run_end >= RUN_HEADER_SIZE)
+      {
+        len = watch_emit(id, len, run_start, run_end - run_start);
+        run_end = 0;
+      }
+      if (run_end == 0)
+      {
+        run_start = at;
+      }
+      run_end = at + 1;
+    }
+    base += n;
+  }
+
+  if (run_end != 0)
+  {
+    len = watch_emit(id, len, run_start, run_end - run_start);
+  }
+  if (len > 0)
+  {
+    send_event(Event::MEMORY_DELTA, len);
+  }
+  watch.primed = true;
+}
+
+size_t Link::watch_emit(uint8_t id, size_t len, size_t offset, size_t run_len)
+{
+  const uint8_t* const shadow = watch_shadow_.data() + watches_[id].shadow;
+  const size_t capacity = tx_data_capacity();
+  uint8_t* const data = event_data();
+
+  while (run_len > 0)
+  {
+    if (len == 0)
+    {
+      data[0] = id;  // Every MEMORY_DELTA frame starts with the watch ID
+      len = 1;
+    }
+    if (capacity - len <= RUN_HEADER_SIZE)
+    {
+      send_event(Event::MEMORY_DELTA, len);
+      len = 0;
+      continue;
+    }
+
+    const size_t room = capacity - len - RUN_HEADER_SIZE;
+    const size_t n = run_len < room ? run_len : room;
+    internal::store_le16(data + len, static_cast<uint16_t>(offset));
+    internal::store_le16(data + len + 2, static_cast<uint16_t>(n));
+    std::memcpy(data + len + RUN_HEADER_SIZE, shadow + offset, n);
+    len += RUN_HEADER_SIZE + n;
+    offset += n;
+    run_len -= n;
+  }
+  return len;
+}
+
+}  // namespace link
+}  // namespace v4
@@ -0,0 +1,136 @@
+/**
+ * @file link_profile.cpp
+ * @brief Word profile commands (PROFILE_START, PROFILE_STOP, PROFILE_DUMP)
+ *
+ * Hits are counted by internal::WordProfile from Link::profile_sample()
+ * and, in ENTRY mode, from run_main(). The report is sorted on the device
+ * so that a short response still carries the hottest words.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "v4/vm_api.h"
+#include "v4link/link.hpp"
+
+#if V4LINK_ENABLE_PROFILE
+
+namespace v4
+{
+namespace link
+{
+
+namespace
+{
+
+// [ACTIVE][MODE][TOTAL][OTHER][IDLE][COUNT]
+constexpr size_t PROFILE_HEADER_SIZE = 1 + 1 + 4 * 3 + 1;
+
+// [WORD_IDX (2 bytes)][HITS (4 bytes)][NAME_LEN], then the name
+constexpr size_t PROFILE_ENTRY_SIZE = 2 + 4 + 1;
+
+// Same limit as QUERY_WORD
+constexpr size_t PROFILE_NAME_MAX = 63;
+
+}  // namespace
+
+void Link::handle_cmd_profile_start()
+{
+  const uint8_t mode = rx_payload_len_ >= 1 ? rx_payload_[0] : 0;
+  if (mode > static_cast<uint8_t>(ProfileMode::ENTRY))
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  profile_.start(static_cast<ProfileMode>(mode));
+  send_ack(ErrorCode::OK);
+}
+
+void Link::handle_cmd_profile_stop()
+{
+  profile_.stop();
+  send_ack(ErrorCode::OK);
+}
+
+void Link::handle_cmd_profile_dump()
+{
+  // Snapshot the counters and order the words with hits, hottest first
+  // (ties by index); they keep changing while a profile is active.
+  uint32_t hits[internal::PROFILE_WORDS];
+  uint16_t order[internal::PROFILE_WORDS];
+  size_t count = 0;
+  uint32_t total = 0;
+  for (size_t wid = 0; wid < internal::PROFILE_WORDS; ++wid)
+  {
+    hits[wid] = profile_.hits(wid);
+    total += hits[wid];
+    if (hits[wid] == 0)
+    {
+      continue;
+    }
+    size_t i = count++;
+    while (i > 0 && hits[order[i - 1]] < hits[wid])
+    {
+      order[i] = order[i - 1];
+      --i;
+    }
+    order[i] = static_cast<uint16_t>(wid);
+  }
+  const uint32_t other = profile_.other();
+  const uint32_t idle = profile_.idle();
+  total += other + idle;
+
+  const size_t limit = rx_payload_len_ >= 1 && rx_payload_[0] != 0 ? rx_payload_[0] : 0xFF;
+  if (count > limit)
+  {
+    count = limit;
+  }
+
+  // Response format: [ERR_CODE][ACTIVE][MODE][TOTAL][OTHER][IDLE][COUNT]
+  //                  ([WORD_IDX][HITS][NAME_LEN][NAME...])*
+  uint8_t* out = tx_data();
+  out[0] = profile_.active() ? 1 : 0;
+  out[1] = static_cast<uint8_t>(profile_.mode());
+  internal::store_le32(out + 2, total);
+  internal::store_le32(out + 6, other);
+  internal::store_le32(out + 10, idle);
+  size_t n = PROFILE_HEADER_SIZE;
+
+  size_t entries = 0;
+  for (; entries < count; ++entries)
+  {
+    const uint16_t wid = order[entries];
+    const Word* word = vm_get_word(vm_, wid);
+    const char* name = word != nullptr ? vm_word_get_name(word) : nullptr;
+    size_t name_len = 0;
+    while (name != nullptr && name[name_len] != '\0' && name_len < PROFILE_NAME_MAX)
+    {
+      ++name_len;
+    }
+    if (n + PROFILE_ENTRY_SIZE + name_len > tx_data_capacity())
+    {
+      break;  // Colder words are left out
+    }
+
+    internal::store_le16(out + n, wid);
+    internal::store_le32(out + n + 2, hits[wid]);
+    out[n + 6] = static_cast<uint8_t>(name_len);
+    if (name_len > 0)
+    {
+      std::memcpy(out + n + PROFILE_ENTRY_SIZE, name, name_len);
+    }
+    n += PROFILE_ENTRY_SIZE + name_len;
+  }
+  out[PROFILE_HEADER_SIZE - 1] = static_cast<uint8_t>(entries);
+
+  send_response(ErrorCode::OK, n);
+}
+
+}  // namespace link
+}  // namespace v4
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file link_redefine.cpp
+ * @brief Incremental redefinition (REPLACE_WORD, FORGET_FROM)
+ *
+ * V4 words keep the code pointer and length they were registered with,
+ * and the dictionary only grows. Both commands therefore rebuild it:
+ * vm_reset(), then every kept word is registered again from its existing
+ * storage, in order, so it gets its old index back. Names are taken from
+ * the interned copies (see Link::find_word()), which outlive the VM's own;
+ * names of words registered behind the link's back are copied to scratch
+ * space on top of the arena until they are registered again.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "v4/vm_api.h"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+namespace
+{
+
+/**
+ * @brief A word about to be registered again
+ */
+struct KeptWord
+{
+  const char* name;
+  size_t name_len;
+  const uint8_t* code;
+  int code_len;
+  bool indexed;
+};
+
+}  // namespace
+
+const char* Link::word_name(const Word* word, size_t* len) const
+{
+  const char* name = vm_word_get_name(word);
+  size_t n = 0;
+  while (name != nullptr && name[n] != '\0' && n < 0xFF)
+  {
+    ++n;
+  }
+  *len = n;
+  return n > 0 ? interned_name(name, n) : "";
+}
+
+ErrorCode Link::rebuild_words(int keep, int wid, uint8_t* dst, const uint8_t* src,
+                              size_t len)
+{
+  // Collect everything first: the VM's names and words go with vm_reset().
+  // Entries are copied in and out of the scratch space, which has no alignment.
+  const size_t scratch = arena_.mark();
+  uint8_t* const kept = arena_.alloc(static_cast<size_t>(keep) * sizeof(KeptWord));
+  if (kept == nullptr && keep > 0)
+  {
+    return ErrorCode::BUFFER_FULL;
+  }
+  for (int i = 0; i < keep; ++i)
+  {
+    const Word* word = vm_get_word(vm_, i);
+    KeptWord entry = {nullptr, 0, nullptr, 0, true};
+    entry.name = word_name(word, &entry.name_len);
+    if (entry.name == nullptr)
+    {
+      // Not registered through the link: keep the VM's name until then
+      char* copy = reinterpret_cast<char*>(arena_.alloc(entry.name_len + 1));
+      if (copy == nullptr)
+      {
+        arena_.release(scratch);
+        return ErrorCode::BUFFER_FULL;
+      }
+      std::memcpy(copy, vm_word_get_name(word), entry.name_len);
+      copy[entry.name_len] = '\0';
+      entry.name = copy;
+      entry.indexed = false;
+    }
+    entry.code = i == wid ? dst : vm_word_get_code(word);
+    entry.code_len = i == wid ? static_cast<int>(len) : vm_word_get_code_len(word);
+    std::memcpy(kept + static_cast<size_t>(i) * sizeof(KeptWord), &entry, sizeof(entry));
+  }
+
+  // Nothing has changed so far; the new code may overwrite the old now
+  if (dst != nullptr)
+  {
+    std::memcpy(dst, src, len);
+  }
+  vm_reset(vm_);
+  name_index_.clear();
+  ErrorCode err = ErrorCode::OK;
+  for (int i = 0; i < keep; ++i)
+  {
+    KeptWord entry;
+    std::memcpy(&entry, kept + static_cast<size_t>(i) * sizeof(KeptWord), sizeof(entry));
+    const int registered =
+        register_word(entry.name_len > 0 ? entry.name : nullptr,
+                      entry.indexed ? entry.name_len : 0, entry.code, entry.code_len);
+    if (registered != i)
+    {
+      err = ErrorCode::VM_ERROR;
+      break;
+    }
+  }
+  arena_.release(scratch);  // The VM holds its own copies of scratch names
+  return err;
+}
+
+void Link::handle_cmd_replace_word()
+{
+  // Request format: [WORD_IDX (2 bytes)][CODE...]
+  if (rx_payload_len_ < 3)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+  if (run_busy())
+  {
+    send_ack(ErrorCode::BUSY);  // The run may be inside the word
+    return;
+  }
+  upload_abort();
+
+  const uint16_t wid = internal::load_le16(rx_payload_);
+  const uint8_t* const code = rx_payload_ + 2;
+  const size_t len = rx_payload_len_ - 2;
+
+  Word* word = vm_get_word(vm_, wid);
+  if (word == nullptr)
+  {
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
+  // Overwrite the old copy if it is ours and large enough
+  const v4_u8* old_code = vm_word_get_code(word);
+  const size_t old_len = static_cast<size_t>(vm_word_get_code_len(word));
+  const size_t mark = arena_.mark();
+  uint8_t* dst = nullptr;
+  if (old_code != nullptr && arena_.contains(old_code) && len <= old_len)
+  {
+    dst = const_cast<uint8_t*>(old_code);
+  }
+  else
+  {
+    dst = arena_.alloc(len);
+    if (dst == nullptr)
+    {
+      send_ack(ErrorCode::BUFFER_FULL);
+      return;
+    }
+  }
+
+  // Count the dictionary: the rebuild keeps every word
+  int count = wid + 1;
+  while (vm_get_word(vm_, count) != nullptr)
+  {
+    ++count;
+  }
+
+  const ErrorCode err = rebuild_words(count, wid, dst, code, len);
+  if (err != ErrorCode::OK)
+  {
+    arena_.release(mark);
+    send_ack(err);
+    return;
+  }
+
+  // Later words may call this one, so their chain hashes are stale too
+  word_cache_.erase(std::remove_if(word_cache_.begin(), word_cache_.end(),
+                                   [wid](const CachedWord& cached)
+                                   { return cached.wid >= wid; }),
+                    word_cache_.end());
+  send_ack(ErrorCode::OK);
+}
+
+void Link::handle_cmd_forget_from()
+{
+  // Request format: [WORD_IDX (2 bytes)]
+  if (rx_payload_len_ < 2)
+  {
+    send_ack(ErrorCode::INVALID_FRAME);
+    return;
+  }
+  if (run_busy())
+  {
+    send_ack(ErrorCode::BUSY);  // Loading now could free code still running
+    return;
+  }
+
+  const uint16_t wid = internal::load_le16(rx_payload_);
+  if (vm_get_word(vm_, wid) == nullptr)
+  {
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+  upload_abort();
+
+  // The arena can go back to the end of the last storage still in use: the
+  // kept words' code and names. Replaced words may sit above forgotten ones.
+  size_t keep_mark = 0;
+  for (int i = 0; i < wid; ++i)
+  {
+    const Word* word = vm_get_word(vm_, i);
+    const v4_u8* code = vm_word_get_code(word);
+    const size_t code_len = static_cast<size_t>(vm_word_get_code_len(word));
+    if (code != nullptr && arena_.contains(code))
+    {
+      keep_mark = std::max(keep_mark, arena_.end_of(code, code_len));
+    }
+    size_t name_len;
+    const char* name = word_name(word, &name_len);
+    const uint8_t* stored = reinterpret_cast<const uint8_t*>(name);
+    if (name_len > 0 && stored != nullptr && arena_.contains(stored))
+    {
+      keep_mark = std::max(keep_mark, arena_.end_of(stored, name_len + 1));
+    }
+  }
+
+  const ErrorCode err = rebuild_words(wid);
+  if (err != ErrorCode::OK)
+  {
+    send_ack(err);
+    return;
+  }
+
+  if (keep_mark < arena_.mark())
+  {
+    arena_.release(keep_mark);
+  }
+  word_cache_.erase(std::remove_if(word_cache_.begin(), word_cache_.end(),
+                                   [wid](const CachedWord& cached)
+                                   { return cached.wid >= wid; }),
+                    word_cache_.end());
+  profile_.clear();  // Forgotten indices will be reused
+  for (size_t i = wid; i < MAIN_WORD_BITS; ++i)
+  {
+    set_main_word(static_cast<int>(i), false);
+  }
+  send_ack(ErrorCode::OK);
+}
+
+}  // namespace link
+}  // namespace v4
@@ -0,0 +1,117 @@
+/**
+ * @file link_run.cpp
+ * @brief EXEC runs and their supervision (RUN_STATUS, ABORT)
+ *
+ * Every EXEC and COMMIT records its main code as the current run. By
+ * default it is executed at once, inside the frame handler. With async
+ * EXEC the reply goes out first and poll() advances the run one slice at
+ * a time, through the ExecSliceFn when one is installed, so the link keeps
+ * answering between slices.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "byte_order.hpp"
+#include "v4/vm_api.h"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+void Link::run_main(int wid)
+{
+  run_ = Run{vm_get_word(vm_, wid), static_cast<uint16_t>(wid), RunState::RUNNING, 0, 0};
+  if (run_.entry == nullptr)
+  {
+    run_.state = RunState::FAILED;
+    return;
+  }
+  if (profile_.mode() == ProfileMode::ENTRY)
+  {
+    profile_.hit(wid);
+  }
+
+  if (!async_exec_)
+  {
+    trace(TraceEvent::EXEC_START, run_.wid);
+    const v4_err err = vm_exec(vm_, run_.entry);
+    trace(TraceEvent::EXEC_END, static_cast<uint32_t>(err));
+    run_.slices = 1;
+    run_.result = static_cast<int32_t>(err);
+    run_.state = err == 0 ? RunState::DONE : RunState::FAILED;
+  }
+}
+
+void Link::run_slice()
+{
+  int err;
+  trace(TraceEvent::EXEC_START, run_.wid);
+  if (exec_slice_ != nullptr)
+  {
+    const SliceOp op = run_.slices == 0 ? SliceOp::START : SliceOp::RESUME;
+    err = exec_slice_(user_context_, vm_, run_.entry, op, slice_budget_);
+  }
+  else
+  {
+    err = vm_exec(vm_, run_.entry);
+  }
+  ++run_.slices;
+  trace(TraceEvent::EXEC_END, static_cast<uint32_t>(err));
+
+  if (exec_slice_ != nullptr && err == SLICE_YIELD)
+  {
+    return;
+  }
+  run_.result = static_cast<int32_t>(err);
+  run_.state = err == 0 ? RunState::DONE : RunState::FAILED;
+
+  // The EXEC reply went out before the code ran; report its changes now
+  watch_poll();
+}
+
+void Link::run_abort()
+{
+  if (run_.state != RunState::RUNNING)
+  {
+    return;
+  }
+  // A run that has not started holds no engine state
+  if (exec_slice_ != nullptr && run_.slices > 0)
+  {
+    exec_slice_(user_context_, vm_, run_.entry, SliceOp::ABORT, 0);
+  }
+  run_.state = RunState::ABORTED;
+}
+
+void Link::run_clear()
+{
+  run_abort();
+  run_ = Run{};
+}
+
+void Link::handle_cmd_run_status()
+{
+  // Response format: [ERR_CODE][STATE][WORD_IDX (2 bytes)][SLICES (4 bytes)][RESULT (4 bytes)]
+  uint8_t* out = tx_data();
+  out[0] = static_cast<uint8_t>(run_.state);
+  internal::store_le16(out + 1, run_.wid);
+  internal::store_le32(out + 3, run_.slices);
+  internal::store_le32(out + 7, static_cast<uint32_t>(run_.result));
+  send_response(ErrorCode::OK, 11);
+}
+
+void Link::handle_cmd_abort()
+{
+  run_abort();
+
+  // Response format: [ERR_CODE][STATE]
+  uint8_t* out = tx_data();
+  out[0] = static_cast<uint8_t>(run_.state);
+  send_response(ErrorCode::OK, 1);
+}
+
+}  // namespace link
+}  // namespace v4
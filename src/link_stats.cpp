@@ -0,0 +1,122 @@
+/**
+ * @file link_stats.cpp
+ * @brief Link statistics and event trace (QUERY_STATS, DUMP_TRACE)
+ *
+ * The counters themselves are cheap inline updates in
+ * internal::LinkStats, and trace records are appended by
+ * internal::TraceRing; this file only serializes and resets them.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "byte_order.hpp"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+void Link::clear_stats()
+{
+  stats_.clear(rx_bytes_, rx_ring_.overruns());
+  arena_.reset_peak();
+}
+
+#if V4LINK_ENABLE_STATS
+
+namespace
+{
+
+// [RX_BYTES][TX_BYTES][RX_DROPPED][CRC_ERRORS][RX_OVERRUNS][ARENA_PEAK][UNTRACKED]
+constexpr size_t STATS_TOTALS_SIZE = 7 * 4;
+
+// [CMD][FRAMES (4 bytes)][TOTAL_TIME (8 bytes)][MAX_TIME (4 bytes)]
+constexpr size_t STATS_COMMAND_ENTRY_SIZE = 1 + 4 + 8 + 4;
+
+}  // namespace
+
+size_t Link::stats_reply_size() const
+{
+  return STATS_TOTALS_SIZE + 1 + 4 * internal::ERROR_CODE_COUNT + 1 +
+         STATS_COMMAND_ENTRY_SIZE * stats_.command_count();
+}
+
+void Link::handle_cmd_query_stats()
+{
+  // Response format: [ERR_CODE][TOTALS (7 x 4 bytes)][ERR_COUNT][RESPONSES...]
+  //                  [CMD_COUNT]([CMD][FRAMES][TOTAL_TIME][MAX_TIME])*
+  uint8_t* out = tx_data();
+  size_t n = 0;
+
+  const uint32_t totals[] = {
+      stats_.rx_bytes(rx_bytes_),
+      stats_.tx_bytes(),
+      stats_.rx_dropped(),
+      stats_.crc_errors(),
+      stats_.rx_overruns(rx_ring_.overruns()),
+      static_cast<uint32_t>(arena_.peak()),
+      stats_.untracked(),
+  };
+  for (uint32_t value : totals)
+  {
+    internal::store_le32(out + n, value);
+    n += 4;
+  }
+
+  out[n++] = static_cast<uint8_t>(internal::ERROR_CODE_COUNT);
+  for (size_t i = 0; i < internal::ERROR_CODE_COUNT; ++i)
+  {
+    internal::store_le32(out + n, stats_.errors(static_cast<ErrorCode>(i)));
+    n += 4;
+  }
+
+  // Small TX buffers get the entries that fit
+  size_t count = stats_.command_count();
+  const size_t room = (tx_data_capacity() - (n + 1)) / STATS_COMMAND_ENTRY_SIZE;
+  if (count > room)
+  {
+    count = room;
+  }
+  out[n++] = static_cast<uint8_t>(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const internal::CommandStats& c = stats_.command(i);
+    out[n++] = stats_.command_code(i);
+    internal::store_le32(out + n, c.frames);
+    internal::store_le32(out + n + 4, static_cast<uint32_t>(c.total_time));
+    internal::store_le32(out + n + 8, static_cast<uint32_t>(c.total_time >> 32));
+    internal::store_le32(out + n + 12, c.max_time);
+    n += 16;
+  }
+
+  send_response(ErrorCode::OK, n);
+
+  if (rx_payload_len_ >= 1 && (rx_payload_[0] & STATS_FLAG_RESET) != 0)
+  {
+    clear_stats();
+  }
+}
+
+#endif
+
+#if V4LINK_ENABLE_TRACE
+
+void Link::handle_cmd_dump_trace()
+{
+  // Response format: [ERR_CODE][FLAGS][BASE_TIME (4 bytes)][LOST (4 bytes)][RECORDS...]
+  uint8_t* out = tx_data();
+  uint32_t base_time;
+  uint32_t lost;
+  const size_t n = trace_.drain(out + 9, tx_data_capacity() - 9, &base_time, &lost);
+  out[0] = trace_.used() > 0 ? TRACE_FLAG_MORE : 0;
+  internal::store_le32(out + 1, base_time);
+  internal::store_le32(out + 5, lost);
+  send_response(ErrorCode::OK, 9 + n);
+}
+
+#endif
+
+}  // namespace link
+}  // namespace v4
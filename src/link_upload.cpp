@@ -0,0 +1,599 @@
+/**
+ * @file link_upload.cpp
+ * @brief Chunked .v4b upload (BEGIN_UPLOAD / CHUNK / COMMIT)
+ *
+ * The image is parsed as it streams in: the header and word table are
+ * decoded incrementally and each word is copied straight into the bytecode
+ * arena and registered as soon as its code is complete. Peak RAM is one
+ * chunk in the RX buffer, independent of the image size. Compressed
+ * uploads add only the fixed decoder window. Words that are already
+ * resident (same chain hash) are linked to the existing copy and their
+ * arena space is given back at once.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "v4/vm_api.h"
+#include "v4link/internal/relocation.hpp"
+#include "v4link/internal/word_hash.hpp"
+#include "v4link/link.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+namespace
+{
+
+constexpr size_t V4B_HEADER_SIZE = 16;
+constexpr uint8_t OP_RET = 0x51;
+
+inline size_t min_size(size_t a, size_t b)
+{
+  return a < b ? a : b;
+}
+
+}  // namespace
+
+void Link::handle_cmd_begin_upload()
+{
+  upload_abort();
+
+  const uint8_t flags = rx_payload_len_ > 0 ? rx_payload_[0] : 0;
+  constexpr uint8_t supported = V4LINK_ENABLE_COMPRESSION ? UPLOAD_FLAG_COMPRESSED : 0;
+  if ((flags & ~supported) != 0)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  upload_.stage = Upload::Stage::HEADER;
+  upload_.fill = 0;
+  upload_.code_size = 0;
+  upload_.word_count = 0;
+  upload_.words_done = 0;
+  upload_.words_added = 0;
+  upload_.first_wid = -1;
+  upload_.hash = internal::WORD_HASH_INIT;
+  upload_.main_code = nullptr;
+  upload_.has_relocs = false;
+  upload_.has_refs = false;
+  upload_.main_fixups = nullptr;
+  upload_.main_fixup_count = 0;
+  upload_.fixups_left = 0;
+  upload_.forward_end = 0;
+  upload_.arena_mark = arena_.mark();
+  load_words_.clear();
+  load_base_ = 0;
+#if V4LINK_ENABLE_COMPRESSION
+  upload_.compressed = (flags & UPLOAD_FLAG_COMPRESSED) != 0;
+  upload_.lz.reset();
+#endif
+
+  send_ack(ErrorCode::OK);
+}
+
+void Link::handle_cmd_chunk()
+{
+  if (upload_.stage == Upload::Stage::IDLE)
+  {
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+#if V4LINK_ENABLE_COMPRESSION
+  // Decoded bytes are parsed straight out of the decoder window
+  const ErrorCode err =
+      upload_.compressed
+          ? upload_.lz.feed(rx_payload_, rx_payload_len_, [this](const uint8_t* data, size_t len)
+                            { return upload_parse(data, len); })
+          : upload_parse(rx_payload_, rx_payload_len_);
+#else
+  const ErrorCode err = upload_parse(rx_payload_, rx_payload_len_);
+#endif
+  if (err != ErrorCode::OK)
+  {
+    upload_abort();
+  }
+  send_ack(err);
+}
+
+void Link::handle_cmd_commit()
+{
+  if (run_busy())
+  {
+    send_ack(ErrorCode::BUSY);  // The upload stays ready for a later COMMIT
+    return;
+  }
+
+  if (upload_.stage != Upload::Stage::DONE)
+  {
+    // Nothing uploaded, or the image is incomplete
+    upload_abort();
+    send_ack(ErrorCode::GENERAL_ERROR);
+    return;
+  }
+
+  // Main code references the uploaded and resident words
+  uint32_t operands = 0;
+  const auto resolve = [this, &operands](uint16_t idx)
+  {
+    operands++;
+    return resolve_word(idx);
+  };
+  const bool relocated =
+      upload_.has_relocs
+          ? internal::relink_fixups(upload_.main_code, upload_.code_size, upload_.main_fixups,
+                                    upload_.main_fixup_count, resolve)
+          : internal::relink_calls(upload_.main_code, upload_.code_size, resolve);
+  if (!relocated)
+  {
+    upload_abort();
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+  trace(TraceEvent::RELOCATE, operands);
+
+  const int main_wid = register_main(upload_.main_code, upload_.code_size);
+  if (main_wid < 0)
+  {
+    upload_abort();
+    send_ack(ErrorCode::VM_ERROR);
+    return;
+  }
+
+  upload_.stage = Upload::Stage::IDLE;
+
+  run_main(main_wid);
+
+  // Response matches EXEC: all word indices, main code last
+  uint8_t* out = tx_data();
+  size_t n = 0;
+  out[n++] = static_cast<uint8_t>(upload_.words_done + 1);
+  for (uint32_t i = 0; i < upload_.words_done; ++i)
+  {
+    internal::store_le16(out + n, static_cast<uint16_t>(load_words_[i].wid));
+    n += 2;
+  }
+  internal::store_le16(out + n, static_cast<uint16_t>(main_wid));
+  n += 2;
+  send_response(ErrorCode::OK, n);
+}
+
+ErrorCode Link::upload_parse(const uint8_t* data, size_t len)
+{
+  Upload& up = upload_;
+  const auto resolve = [this, &up](uint16_t idx)
+  {
+    // Entries called ahead must turn out to be new words as well
+    if (idx >= up.words_done && idx < up.word_count && idx >= up.forward_end)
+    {
+      up.forward_end = idx + 1u;
+    }
+    return resolve_word(idx);
+  };
+  size_t i = 0;
+
+  while (i < len)
+  {
+    const size_t avail = len - i;
+
+    switch (up.stage)
+    {
+      case Upload::Stage::IDLE:
+        return ErrorCode::GENERAL_ERROR;
+
+      case Upload::Stage::HEADER:
+      {
+        const size_t run = min_size(avail, V4B_HEADER_SIZE - up.fill);
+        std::memcpy(up.field + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill < V4B_HEADER_SIZE)
+        {
+          break;
+        }
+
+        // Check "V4BC" magic
+        if (up.field[0] != 0x56 || up.field[1] != 0x34 || up.field[2] != 0x42 ||
+            up.field[3] != 0x43)
+        {
+          return ErrorCode::GENERAL_ERROR;
+        }
+
+        const uint8_t version_minor = up.field[5];
+        up.code_size = internal::load_le32(up.field + 8);
+        up.word_count = version_minor >= 2 ? internal::load_le32(up.field + 12) : 0;
+        up.has_relocs = version_minor >= internal::V4B_MINOR_RELOC;
+        up.has_refs = version_minor >= internal::V4B_MINOR_WORD_REF;
+        if (up.word_count > max_load_words())
+        {
+          return ErrorCode::BUFFER_FULL;  // COMMIT could not list them all
+        }
+
+        up.main_code = arena_.alloc(up.code_size);
+        if (up.main_code == nullptr)
+        {
+          return ErrorCode::BUFFER_FULL;
+        }
+
+        up.fill = 0;
+        if (up.code_size > 0)
+        {
+          up.stage = Upload::Stage::MAIN;
+        }
+        else if (up.has_relocs)
+        {
+          up.stage = Upload::Stage::MAIN_RELOC_COUNT;
+        }
+        else
+        {
+          up.stage = up.word_count > 0 ? Upload::Stage::NAME_LEN : Upload::Stage::DONE;
+        }
+        break;
+      }
+
+      case Upload::Stage::MAIN:
+      {
+        const size_t run = min_size(avail, up.code_size - up.fill);
+        std::memcpy(up.main_code + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill == up.code_size)
+        {
+          up.fill = 0;
+          if (up.has_relocs)
+          {
+            up.stage = Upload::Stage::MAIN_RELOC_COUNT;
+          }
+          else
+          {
+            up.stage = up.word_count > 0 ? Upload::Stage::NAME_LEN : Upload::Stage::DONE;
+          }
+        }
+        break;
+      }
+
+      case Upload::Stage::MAIN_RELOC_COUNT:
+      {
+        const size_t run = min_size(avail, 2 - up.fill);
+        std::memcpy(up.field + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill < 2)
+        {
+          break;
+        }
+
+        // Kept until COMMIT, when the main code offset is known
+        up.main_fixup_count = internal::load_le16(up.field);
+        up.main_fixups = arena_.alloc(up.main_fixup_count * 2u);
+        if (up.main_fixups == nullptr)
+        {
+          return ErrorCode::BUFFER_FULL;
+        }
+        up.fill = 0;
+        if (up.main_fixup_count > 0)
+        {
+          up.stage = Upload::Stage::MAIN_RELOC;
+        }
+        else
+        {
+          up.stage = up.word_count > 0 ? Upload::Stage::NAME_LEN : Upload::Stage::DONE;
+        }
+        break;
+      }
+
+      case Upload::Stage::MAIN_RELOC:
+      {
+        const size_t run = min_size(avail, up.main_fixup_count * 2u - up.fill);
+        std::memcpy(up.main_fixups + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill == up.main_fixup_count * 2u)
+        {
+          up.fill = 0;
+          up.stage = up.word_count > 0 ? Upload::Stage::NAME_LEN : Upload::Stage::DONE;
+        }
+        break;
+      }
+
+      case Upload::Stage::NAME_LEN:
+        if (up.has_refs && data[i] == internal::V4B_WORD_REF)
+        {
+          i++;
+          up.fill = 0;
+          up.stage = Upload::Stage::WORD_REF;
+          break;
+        }
+        up.hash = internal::word_hash_update(up.hash, data + i, 1);
+        up.name_len = data[i++];
+        up.word_mark = arena_.mark();
+        up.name_copy = reinterpret_cast<char*>(arena_.alloc(up.name_len + 1));
+        if (up.name_copy == nullptr)
+        {
+          return ErrorCode::BUFFER_FULL;
+        }
+        up.name_copy[up.name_len] = '\0';
+        up.name = up.name_copy;
+        up.fill = 0;
+        up.stage = up.name_len > 0 ? Upload::Stage::NAME : Upload::Stage::CODE_LEN;
+        break;
+
+      case Upload::Stage::WORD_REF:
+      {
+        const size_t run = min_size(avail, 4 - up.fill);
+        std::memcpy(up.field + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill < 4)
+        {
+          break;
+        }
+
+        up.hash = internal::load_le32(up.field);
+        const int wid = word_cache_find(up.hash);
+        if (wid < 0)
+        {
+          return ErrorCode::GENERAL_ERROR;  // Unknown reference
+        }
+        if (up.words_done < up.forward_end)
+        {
+          return ErrorCode::VM_ERROR;  // A forward CALL crosses this entry
+        }
+        load_words_.push_back({up.hash, wid});
+        up.words_done++;
+        up.fill = 0;
+        up.stage = up.words_done < up.word_count ? Upload::Stage::NAME_LEN
+                                                 : Upload::Stage::DONE;
+        break;
+      }
+
+      case Upload::Stage::NAME:
+      {
+        const size_t run = min_size(avail, up.name_len - up.fill);
+        up.hash = internal::word_hash_update(up.hash, data + i, run);
+        std::memcpy(up.name_copy + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill == up.name_len)
+        {
+          // A name registered before is stored once: drop this copy, which
+          // is still on top of the arena
+          const char* interned = interned_name(up.name_copy, up.name_len);
+          if (interned != nullptr)
+          {
+            arena_.release(up.word_mark);
+            up.name = interned;
+          }
+          up.fill = 0;
+          up.stage = Upload::Stage::CODE_LEN;
+        }
+        break;
+      }
+
+      case Upload::Stage::CODE_LEN:
+      {
+        const size_t run = min_size(avail, 4 - up.fill);
+        up.hash = internal::word_hash_update(up.hash, data + i, run);
+        std::memcpy(up.field + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill < 4)
+        {
+          break;
+        }
+
+        up.word_code_len = internal::load_le32(up.field);
+        up.word_code = arena_.alloc(up.word_code_len);
+        if (up.word_code == nullptr)
+        {
+          return ErrorCode::BUFFER_FULL;
+        }
+        up.fill = 0;
+        up.stage = Upload::Stage::CODE;
+        break;
+      }
+
+      case Upload::Stage::CODE:
+      {
+        const size_t run = min_size(avail, up.word_code_len - up.fill);
+        up.hash = internal::word_hash_update(up.hash, data + i, run);
+        std::memcpy(up.word_code + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+        break;
+      }
+
+      case Upload::Stage::RELOC_COUNT:
+      case Upload::Stage::RELOC:
+      {
+        const size_t run = min_size(avail, 2 - up.fill);
+        std::memcpy(up.field + up.fill, data + i, run);
+        up.fill += run;
+        i += run;
+
+        if (up.fill < 2)
+        {
+          break;
+        }
+        up.fill = 0;
+
+        if (up.stage == Upload::Stage::RELOC_COUNT)
+        {
+          up.fixups_left = internal::load_le16(up.field);
+          up.stage = Upload::Stage::RELOC;
+        }
+        else
+        {
+          // The word's code is already in the arena: patch each CALL as
+          // listed (a resident word is linked already)
+          const size_t at = internal::load_le16(up.field);
+          if (up.word_code != nullptr)
+          {
+            if (!internal::is_call_operand(up.word_code, up.word_code_len, at))
+            {
+              return ErrorCode::VM_ERROR;
+            }
+            internal::relink_operand(up.word_code + at, resolve);
+          }
+          up.fixups_left--;
+        }
+
+        if (up.fixups_left == 0)
+        {
+          word_cache_add(load_words_.back().hash, load_words_.back().wid);
+          up.stage = up.words_done < up.word_count ? Upload::Stage::NAME_LEN
+                                                   : Upload::Stage::DONE;
+        }
+        break;
+      }
+
+      case Upload::Stage::DONE:
+        // Trailing bytes after the word table are ignored (as in EXEC)
+        return ErrorCode::OK;
+    }
+
+    // Register a word as soon as its code is complete
+    if (up.stage == Upload::Stage::CODE && up.fill == up.word_code_len)
+    {
+      int wid = word_cache_find(up.hash);
+      if (wid >= 0 &&
+          !resident_matches(wid, up.name, up.name_len, up.word_code, up.word_code_len))
+      {
+        wid = -1;  // Hash collision: load it as a new word
+      }
+      if (wid >= 0)
+      {
+        if (up.words_done < up.forward_end)
+        {
+          return ErrorCode::VM_ERROR;  // A forward CALL crosses this entry
+        }
+        // Already resident: link to that copy and drop this one
+        arena_.release(up.word_mark);
+        up.word_code = nullptr;
+      }
+      else
+      {
+        const bool new_name = up.name_len > 0 && up.name == up.name_copy;
+        if (word_cache_.size() >= max_words_ ||
+            (new_name && name_index_.size() >= max_words_))
+        {
+          return ErrorCode::BUFFER_FULL;  // The word tables could not track it
+        }
+        wid = register_word(up.name, up.name_len, up.word_code, up.word_code_len);
+        if (wid < 0)
+        {
+          return ErrorCode::VM_ERROR;
+        }
+
+        up.words_added++;
+        if (up.words_added == 1)
+        {
+          up.first_wid = wid;
+        }
+        else if (wid != up.first_wid + static_cast<int>(up.words_added - 1))
+        {
+          // Indices past the word table assume consecutive VM indices
+          load_words_.push_back({up.hash, wid});  // Stubbed by upload_abort()
+          return ErrorCode::VM_ERROR;
+        }
+        // Entries called ahead follow this word (see resolve_word())
+        load_base_ = wid - static_cast<int>(up.words_done);
+      }
+      load_words_.push_back({up.hash, wid});
+      up.words_done++;
+
+      up.fill = 0;
+      if (up.has_relocs)
+      {
+        up.stage = Upload::Stage::RELOC_COUNT;
+      }
+      else
+      {
+        if (up.word_code != nullptr &&
+            !internal::relink_calls(up.word_code, up.word_code_len, resolve))
+        {
+          return ErrorCode::VM_ERROR;
+        }
+        word_cache_add(up.hash, wid);
+        up.stage = up.words_done < up.word_count ? Upload::Stage::NAME_LEN
+                                                 : Upload::Stage::DONE;
+      }
+    }
+  }
+
+  return ErrorCode::OK;
+}
+
+void Link::upload_abort()
+{
+  if (upload_.stage == Upload::Stage::IDLE)
+  {
+    return;
+  }
+  upload_.stage = Upload::Stage::IDLE;
+  if (upload_.words_added == 0)
+  {
+    arena_.release(upload_.arena_mark);
+    return;
+  }
+
+  // V4 cannot unregister words: keep the storage of those already
+  // registered, but make them return at once since CALLs to later entries
+  // were never linked, as a failed EXEC does. The rest is released.
+  size_t keep_mark = upload_.arena_mark;
+  for (const CachedWord& loaded : load_words_)
+  {
+    if (loaded.wid < upload_.first_wid)
+    {
+      continue;  // Resident, not registered by this upload
+    }
+    const Word* word = vm_get_word(vm_, loaded.wid);
+    const v4_u8* code = vm_word_get_code(word);
+    const int code_len = vm_word_get_code_len(word);
+    if (code != nullptr && code_len > 0 && arena_.contains(code))
+    {
+      const_cast<v4_u8*>(code)[0] = OP_RET;
+      keep_mark = std::max(keep_mark, arena_.end_of(code, static_cast<size_t>(code_len)));
+    }
+    const char* name = vm_word_get_name(word);
+    const size_t name_len = name != nullptr ? std::strlen(name) : 0;
+    if (name_len > 0)
+    {
+      // The index may keep the copy for an older word of that name
+      const char* copy = interned_name(name, name_len);
+      const uint8_t* stored = reinterpret_cast<const uint8_t*>(copy);
+      if (stored != nullptr && arena_.contains(stored))
+      {
+        keep_mark = std::max(keep_mark, arena_.end_of(stored, name_len + 1));
+      }
+      // Names a stub took over resolve to their previous definitions
+      name_index_revert(name, name_len, upload_.first_wid);
+    }
+  }
+  if (keep_mark < arena_.mark())
+  {
+    arena_.release(keep_mark);
+  }
+  word_cache_.erase(std::remove_if(word_cache_.begin(), word_cache_.end(),
+                                   [this](const CachedWord& cached)
+                                   { return cached.wid >= upload_.first_wid; }),
+                    word_cache_.end());
+}
+
+}  // namespace link
+}  // namespace v4
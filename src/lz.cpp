@@ -0,0 +1,80 @@
+/**
+ * @file lz.cpp
+ * @brief LZ77 encoder for compressed uploads
+ *
+ * Kept in its own translation unit so that firmware, which only decodes,
+ * does not link it in.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/internal/lz.hpp"
+
+namespace v4::link::internal
+{
+
+namespace
+{
+
+void put_literals(const uint8_t* in, size_t from, size_t to, std::vector<uint8_t>& out)
+{
+  while (from < to)
+  {
+    const size_t run = to - from < LZ_MAX_LITERALS ? to - from : LZ_MAX_LITERALS;
+    out.push_back(static_cast<uint8_t>(run - 1));
+    out.insert(out.end(), in + from, in + from + run);
+    from += run;
+  }
+}
+
+}  // namespace
+
+void lz_compress(const uint8_t* in, size_t len, std::vector<uint8_t>& out)
+{
+  out.clear();
+
+  size_t literal_start = 0;
+  size_t pos = 0;
+  while (pos < len)
+  {
+    // Longest match within the window; an exhaustive scan is fine on a host
+    size_t best_len = 0;
+    size_t best_dist = 0;
+    const size_t max_len = len - pos < LZ_MAX_MATCH ? len - pos : LZ_MAX_MATCH;
+    const size_t max_dist = pos < LZ_WINDOW_SIZE ? pos : LZ_WINDOW_SIZE;
+    for (size_t dist = 1; dist <= max_dist; ++dist)
+    {
+      size_t n = 0;
+      while (n < max_len && in[pos + n] == in[pos + n - dist])
+      {
+        ++n;
+      }
+      if (n > best_len)
+      {
+        best_len = n;
+        best_dist = dist;
+        if (n == max_len)
+        {
+          break;
+        }
+      }
+    }
+
+    if (best_len < LZ_MIN_MATCH)
+    {
+      ++pos;
+      continue;
+    }
+
+    put_literals(in, literal_start, pos, out);
+    out.push_back(static_cast<uint8_t>(0x80 | (best_len - LZ_MIN_MATCH)));
+    out.push_back(static_cast<uint8_t>(best_dist - 1));
+    pos += best_len;
+    literal_start = pos;
+  }
+
+  put_literals(in, literal_start, len, out);
+}
+
+}  // namespace v4::link::internal
@@ -0,0 +1,41 @@
+/**
+ * @file relocation.cpp
+ * @brief CALL relocation for runtime linking of .v4b images
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/internal/relocation.hpp"
+
+namespace v4::link::internal
+{
+
+bool relocate_calls(uint8_t* code, size_t len, int offset)
+{
+  if (offset == 0)
+    return true;  // No relocation needed
+
+  return for_each_call(code, len,
+                       [offset](uint8_t* operand)
+                       {
+                         relocate_operand(operand, offset);
+                         return true;
+                       });
+}
+
+bool relocate_fixups(uint8_t* code, size_t len, const uint8_t* fixups, size_t count,
+                     int offset)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t at = fixups[2 * i] | (fixups[2 * i + 1] << 8);
+    if (!relocate_fixup(code, len, at, offset))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace v4::link::internal
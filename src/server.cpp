@@ -0,0 +1,234 @@
+/**
+ * @file server.cpp
+ * @brief Host-side LinkServer implementation
+ *
+ * A channel with queued bytes is scheduled exactly once: the submitter
+ * that finds it idle queues it. The worker running it feeds everything
+ * that has arrived and then either marks the channel idle or, if more
+ * bytes came in or an async run is still going, queues it again at the
+ * back of its own queue so that other channels get their turn.
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/server.hpp"
+
+namespace v4
+{
+namespace link
+{
+
+LinkServer::Channel::Channel(LinkServer* owner, ChannelId channel_id, Vm* vm,
+                             size_t buffer_size, size_t arena_size)
+    : server(owner),
+      id(channel_id),
+      link(vm, LinkServer::send_trampoline, this, buffer_size, arena_size),
+      inbox_mutex(),
+      inbox(),
+      scheduled(false)
+{
+}
+
+LinkServer::LinkServer(SendFn send, void* user, size_t threads)
+    : send_(send),
+      user_(user),
+      channels_(),
+      queues_(),
+      workers_(),
+      idle_mutex_(),
+      work_ready_(),
+      drained_(),
+      queued_(0),
+      pending_(0),
+      next_queue_(0),
+      steals_(0),
+      stop_(false)
+{
+  if (threads == 0)
+  {
+    threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+    {
+      threads = 1;
+    }
+  }
+
+  for (size_t i = 0; i < threads; ++i)
+  {
+    queues_.push_back(std::make_unique<WorkQueue>());
+  }
+  for (size_t i = 0; i < threads; ++i)
+  {
+    workers_.emplace_back(&LinkServer::worker_main, this, i);
+  }
+}
+
+LinkServer::~LinkServer()
+{
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+  for (std::thread& worker : workers_)
+  {
+    worker.join();
+  }
+
+  // Runs left RUNNING would never be stepped again
+  for (const auto& channel : channels_)
+  {
+    channel->link.abort_run();
+  }
+}
+
+LinkServer::ChannelId LinkServer::add_channel(Vm* vm, size_t buffer_size, size_t arena_size)
+{
+  const ChannelId id = static_cast<ChannelId>(channels_.size());
+  channels_.push_back(std::make_unique<Channel>(this, id, vm, buffer_size, arena_size));
+  return id;
+}
+
+void LinkServer::submit(ChannelId channel, const uint8_t* data, size_t len)
+{
+  Channel* const ch = channels_[channel].get();
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> lock(ch->inbox_mutex);
+    ch->inbox.insert(ch->inbox.end(), data, data + len);
+    schedule = !ch->scheduled;
+    ch->scheduled = true;
+  }
+
+  if (schedule)
+  {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    enqueue(next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size(), ch);
+  }
+}
+
+void LinkServer::drain()
+{
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  drained_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+void LinkServer::send_trampoline(void* user, const uint8_t* data, size_t len)
+{
+  Channel* const ch = static_cast<Channel*>(user);
+  ch->server->send_(ch->server->user_, ch->id, data, len);
+}
+
+void LinkServer::enqueue(size_t index, Channel* channel)
+{
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->channels.push_back(channel);
+  }
+  queued_.fetch_add(1);
+
+  // Taking the lock orders this against a worker about to sleep
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+  }
+  work_ready_.notify_one();
+}
+
+LinkServer::Channel* LinkServer::next_channel(size_t index)
+{
+  const size_t count = queues_.size();
+  for (size_t k = 0; k < count; ++k)
+  {
+    WorkQueue& queue = *queues_[(index + k) % count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.channels.empty())
+    {
+      continue;
+    }
+
+    Channel* ch;
+    if (k == 0)
+    {
+      ch = queue.channels.front();
+      queue.channels.pop_front();
+    }
+    else
+    {
+      ch = queue.channels.back();
+      queue.channels.pop_back();
+      steals_.fetch_add(1, std::memory_order_relaxed);
+    }
+    queued_.fetch_sub(1);
+    return ch;
+  }
+  return nullptr;
+}
+
+void LinkServer::worker_main(size_t index)
+{
+  std::vector<uint8_t> scratch;
+  for (;;)
+  {
+    // Queued channels are dropped: a run that keeps yielding would never let go
+    if (stop_.load())
+    {
+      return;
+    }
+    Channel* const ch = next_channel(index);
+    if (ch != nullptr)
+    {
+      run_channel(index, ch, scratch);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    work_ready_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+    if (stop_)
+    {
+      return;
+    }
+  }
+}
+
+void LinkServer::run_channel(size_t index, Channel* channel, std::vector<uint8_t>& scratch)
+{
+  // Swap buffers so submit() can keep appending while the frames run
+  scratch.clear();
+  {
+    std::lock_guard<std::mutex> lock(channel->inbox_mutex);
+    scratch.swap(channel->inbox);
+  }
+
+  channel->link.feed(scratch.data(), scratch.size());
+  channel->link.poll();  // One slice of an async EXEC, if any
+
+  const bool running = channel->link.run_state() == RunState::RUNNING;
+  bool requeue;
+  {
+    std::lock_guard<std::mutex> lock(channel->inbox_mutex);
+    requeue = running || !channel->inbox.empty();
+    channel->scheduled = requeue;
+  }
+
+  if (requeue)
+  {
+    enqueue(index, channel);
+  }
+  else
+  {
+    finish_one();
+  }
+}
+
+void LinkServer::finish_one()
+{
+  if (pending_.fetch_sub(1) == 1)
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    drained_.notify_all();
+  }
+}
+
+}  // namespace link
+}  // namespace v4
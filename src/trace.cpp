@@ -0,0 +1,126 @@
+/**
+ * @file trace.cpp
+ * @brief Event trace ring implementation
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#include "v4link/internal/trace.hpp"
+
+#if V4LINK_ENABLE_TRACE
+
+namespace v4::link::internal
+{
+
+namespace
+{
+
+size_t put_leb128(uint8_t* out, uint32_t value)
+{
+  size_t n = 0;
+  while (value >= 0x80)
+  {
+    out[n++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = static_cast<uint8_t>(value);
+  return n;
+}
+
+}  // namespace
+
+void TraceRing::set_buffer(uint8_t* buffer, size_t size)
+{
+  const bool usable = buffer != nullptr && size >= TRACE_RECORD_MAX;
+  data_ = usable ? buffer : nullptr;
+  size_ = usable ? size : 0;
+  tail_ = 0;
+  used_ = 0;
+  base_time_ = last_time_;
+  lost_ = 0;
+}
+
+void TraceRing::write(TraceEvent event, uint32_t now, uint32_t arg)
+{
+  uint8_t rec[TRACE_RECORD_MAX];
+  size_t n = 0;
+  rec[n++] = static_cast<uint8_t>(event);
+  n += put_leb128(rec + n, now - last_time_);
+  n += put_leb128(rec + n, arg);
+
+  // Make room by dropping the oldest records
+  while (size_ - used_ < n)
+  {
+    uint32_t delta;
+    const size_t len = peek(&delta);
+    base_time_ += delta;
+    tail_ = tail_ + len < size_ ? tail_ + len : tail_ + len - size_;
+    used_ -= len;
+    lost_++;
+  }
+
+  size_t head = tail_ + used_;
+  if (head >= size_)
+  {
+    head -= size_;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    data_[head] = rec[i];
+    head = head + 1 < size_ ? head + 1 : 0;
+  }
+  used_ += n;
+  last_time_ = now;
+}
+
+size_t TraceRing::peek(uint32_t* delta) const
+{
+  // [EVENT][DELTA][ARG]; LEB128 bytes have the top bit set except the last
+  size_t n = 1;
+  uint32_t value = 0;
+  for (unsigned shift = 0;; shift += 7)
+  {
+    const uint8_t byte = at(n++);
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      break;
+    }
+  }
+  while ((at(n++) & 0x80) != 0)
+  {
+  }
+  *delta = value;
+  return n;
+}
+
+size_t TraceRing::drain(uint8_t* out, size_t capacity, uint32_t* base_time, uint32_t* lost)
+{
+  *base_time = base_time_;
+  *lost = lost_;
+  lost_ = 0;
+
+  size_t n = 0;
+  while (used_ > 0)
+  {
+    uint32_t delta;
+    const size_t len = peek(&delta);
+    if (n + len > capacity)
+    {
+      break;
+    }
+    for (size_t i = 0; i < len; ++i)
+    {
+      out[n++] = at(i);
+    }
+    base_time_ += delta;
+    tail_ = tail_ + len < size_ ? tail_ + len : tail_ + len - size_;
+    used_ -= len;
+  }
+  return n;
+}
+
+}  // namespace v4::link::internal
+
+#endif
@@ -0,0 +1,526 @@
+/**
+ * @file test_host.cpp
+ * @brief Unit tests for the host-side encoders and decoders
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "frame.hpp"
+#include "v4/vm_api.h"
+#include "v4link/host.hpp"
+#include "v4link/internal/relocation.hpp"
+#include "v4link/internal/word_hash.hpp"
+#include "v4link/link.hpp"
+
+using namespace v4::link;
+
+namespace
+{
+
+void test_uart_write(void* user, const uint8_t* data, size_t len)
+{
+  auto* output = static_cast<std::vector<uint8_t>*>(user);
+  output->insert(output->end(), data, data + len);
+}
+
+uint32_t test_clock;
+
+uint32_t test_timestamp(void*)
+{
+  test_clock += 100;
+  return test_clock;
+}
+
+// DUP MUL RET
+const uint8_t kSquare[] = {0x01, 0x12, 0x51};
+
+// LIT value, CALL 0, RET
+std::vector<uint8_t> call_square(uint8_t value)
+{
+  return {0x00, value, 0, 0, 0, 0x50, 0x00, 0x00, 0x51};
+}
+
+}  // namespace
+
+TEST_CASE("FrameWriter encodes frames back to back")
+{
+  uint8_t buf[64];
+  FrameWriter writer(buf, sizeof(buf), 16);
+  const uint8_t code[] = {0x00, 7, 0, 0, 0, 0x51};  // LIT 7, RET
+
+  REQUIRE(writer.add(Command::PING));
+  REQUIRE(writer.add(Command::EXEC, code, sizeof(code)));
+  REQUIRE(writer.add_seq(Command::QUERY_STACK, 9));
+  CHECK(writer.frames() == 3);
+
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> frame;
+  internal::encode_frame(Command::PING, nullptr, 0, frame);
+  expected.insert(expected.end(), frame.begin(), frame.end());
+  internal::encode_frame(Command::EXEC, code, sizeof(code), frame);
+  expected.insert(expected.end(), frame.begin(), frame.end());
+  const uint8_t seq = 9;
+  internal::encode_frame(Command::QUERY_STACK, &seq, 1, frame);
+  expected.insert(expected.end(), frame.begin(), frame.end());
+  CHECK(std::vector<uint8_t>(writer.data(), writer.data() + writer.size()) == expected);
+
+  SUBCASE("Oversized payload and full buffer are refused")
+  {
+    const uint8_t big[17] = {0};
+    CHECK_FALSE(writer.add(Command::EXEC, big, sizeof(big)));
+    CHECK_FALSE(writer.add_seq(Command::EXEC, 0, big, 16));
+    while (writer.add(Command::PING))
+    {
+    }
+    CHECK(writer.remaining() < internal::FRAME_OVERHEAD);
+    CHECK(writer.size() == sizeof(buf) - writer.remaining());
+  }
+
+  SUBCASE("Device handles the whole buffer")
+  {
+    uint8_t vm_memory[1024] = {0};
+    VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+    Vm* vm = vm_create(&cfg);
+    REQUIRE(vm != nullptr);
+    std::vector<uint8_t> uart_output;
+    Link link(vm, test_uart_write, &uart_output);
+
+    writer.clear();
+    REQUIRE(writer.add(Command::EXEC, code, sizeof(code)));
+    REQUIRE(writer.add(Command::QUERY_STACK));
+    link.feed(writer.data(), writer.size());
+
+    ResponseReader reader;
+    reader.push(uart_output.data(), uart_output.size());
+    Response rsp;
+    ExecResult exec;
+    StackDump stack;
+    REQUIRE(reader.next(rsp));
+    REQUIRE(decode_exec(rsp, exec));
+    CHECK(exec.words.size() == 1);
+    REQUIRE(reader.next(rsp));
+    REQUIRE(decode_stack(rsp, stack));
+    CHECK(stack.data == std::vector<int32_t>{7});
+    CHECK(stack.ret.empty());
+    CHECK_FALSE(reader.next(rsp));
+
+    vm_destroy(vm);
+  }
+}
+
+TEST_CASE("ResponseReader skips a stray STX with an oversized LEN")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  uint8_t buf[16];
+  FrameWriter writer(buf, sizeof(buf));
+  REQUIRE(writer.add(Command::PING));
+  link.feed(writer.data(), writer.size());
+
+  // The noise claims more than the device ever sends
+  const uint8_t noise[] = {STX, 0x00, 0xF0};
+  Response rsp;
+  ResponseReader unbounded;
+  unbounded.push(noise, sizeof(noise));
+  unbounded.push(uart_output.data(), uart_output.size());
+  CHECK_FALSE(unbounded.next(rsp));  // Waits for 0xF000 bytes of LEN
+
+  SUBCASE("Limit given up front")
+  {
+    ResponseReader reader(link.max_response());
+    reader.push(noise, sizeof(noise));
+    reader.push(uart_output.data(), uart_output.size());
+    REQUIRE(reader.next(rsp));
+    CHECK(rsp.error() == ErrorCode::OK);
+    CHECK(reader.crc_errors() == 1);
+    CHECK(reader.pending() == 0);
+  }
+
+  SUBCASE("Limit negotiated later")
+  {
+    unbounded.set_max_response(link.max_response());
+    REQUIRE(unbounded.next(rsp));
+    CHECK(rsp.error() == ErrorCode::OK);
+    CHECK(unbounded.crc_errors() == 1);
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("FrameWriter and ResponseReader in COBS framing")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  uint8_t buf[64];
+  FrameWriter writer(buf, sizeof(buf));
+  ResponseReader reader;
+  Response rsp;
+
+  const uint8_t req[] = {2, PING_FLAG_COBS};
+  REQUIRE(writer.add(Command::PING, req, sizeof(req)));
+  link.feed(writer.data(), writer.size());
+  reader.push(uart_output.data(), uart_output.size());
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.error() == ErrorCode::OK);
+  writer.set_cobs(true);
+  reader.set_cobs(true);
+  reader.set_windowed(true);
+
+  // LIT 0, RET and a zero SEQ: nothing but delimiters may be 0x00 on the wire
+  const uint8_t code[] = {0x00, 0, 0, 0, 0, 0x51};
+  writer.clear();
+  REQUIRE(writer.add_seq(Command::EXEC, 0, code, sizeof(code)));
+  REQUIRE(writer.add_seq(Command::QUERY_STACK, 1));
+  CHECK(std::count(writer.data(), writer.data() + writer.size(), 0) == 2);
+  CHECK(writer.data()[writer.size() - 1] == 0);
+
+  uart_output.clear();
+  link.feed(writer.data(), writer.size());
+  CHECK(std::count(uart_output.begin(), uart_output.end(), 0) == 2);
+
+  // Garbage ahead of the responses costs one frame; pieces arrive split
+  const uint8_t noise[] = {0x07, 0x31, 0x00};
+  reader.push(noise, sizeof(noise));
+  reader.push(uart_output.data(), 3);
+  CHECK_FALSE(reader.next(rsp));
+  CHECK(reader.crc_errors() == 1);
+  reader.push(uart_output.data() + 3, uart_output.size() - 3);
+
+  ExecResult exec;
+  StackDump stack;
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.has_seq);
+  CHECK(rsp.seq == 0);
+  REQUIRE(decode_exec(rsp, exec));
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.seq == 1);
+  REQUIRE(decode_stack(rsp, stack));
+  CHECK(stack.data == std::vector<int32_t>{0});
+  CHECK_FALSE(reader.next(rsp));
+  CHECK(reader.pending() == 0);
+
+  SUBCASE("Space for the encoding overhead is required")
+  {
+    FrameWriter small(buf, internal::FRAME_OVERHEAD);
+    small.set_cobs(true);
+    CHECK_FALSE(small.add(Command::PING));
+    FrameWriter fits(buf, internal::FRAME_OVERHEAD + 1);
+    fits.set_cobs(true);
+    CHECK(fits.add(Command::PING));
+    CHECK(fits.size() == internal::FRAME_OVERHEAD + 1);
+  }
+
+  vm_destroy(vm);
+}
+
+#if V4LINK_ENABLE_WIDE_CRC
+TEST_CASE("FrameWriter and ResponseReader with a wide frame check")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  uint8_t buf[64];
+  FrameWriter writer(buf, sizeof(buf));
+  ResponseReader reader;
+  Response rsp;
+
+  const uint8_t req[] = {2, 0, static_cast<uint8_t>(CrcType::CRC32C)};
+  REQUIRE(writer.add(Command::PING, req, sizeof(req)));
+  link.feed(writer.data(), writer.size());
+  reader.push(uart_output.data(), uart_output.size());
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.error() == ErrorCode::OK);
+  writer.set_check(CrcType::CRC32C);
+  reader.set_check(CrcType::CRC32C);
+  reader.set_windowed(true);
+
+  const uint8_t code[] = {0x00, 9, 0, 0, 0, 0x51};  // LIT 9, RET
+  writer.clear();
+  REQUIRE(writer.add_seq(Command::EXEC, 0, code, sizeof(code)));
+  REQUIRE(writer.add_seq(Command::QUERY_STACK, 1));
+  CHECK(writer.size() == 2 * (internal::FRAME_HEADER_SIZE + 4 + 1) + sizeof(code));
+
+  uart_output.clear();
+  link.feed(writer.data(), writer.size());
+  reader.push(uart_output.data(), uart_output.size());
+
+  StackDump stack;
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.seq == 0);
+  CHECK(rsp.error() == ErrorCode::OK);
+  REQUIRE(reader.next(rsp));
+  CHECK(rsp.seq == 1);
+  REQUIRE(decode_stack(rsp, stack));
+  CHECK(stack.data == std::vector<int32_t>{9});
+  CHECK(reader.crc_errors() == 0);
+
+  // A CRC-8 reader sees none of these frames
+  ResponseReader narrow;
+  narrow.push(uart_output.data(), uart_output.size());
+  CHECK_FALSE(narrow.next(rsp));
+  CHECK(narrow.crc_errors() > 0);
+
+  vm_destroy(vm);
+}
+#endif
+
+TEST_CASE("V4bBuilder images and response decoding")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  V4bBuilder v4b;
+  REQUIRE(v4b.add_word("sq", kSquare, sizeof(kSquare)));
+  const auto main_code = call_square(3);
+  v4b.set_main(main_code.data(), main_code.size());
+  std::vector<uint8_t> image;
+  REQUIRE(v4b.build(image));
+  CHECK(image[5] == internal::V4B_MINOR_RELOC);
+
+  uint8_t buf[256];
+  FrameWriter writer(buf, sizeof(buf));
+  REQUIRE(writer.add(Command::EXEC, image.data(), image.size()));
+  REQUIRE(writer.add(Command::QUERY_STACK));
+  link.feed(writer.data(), writer.size());
+
+  // Responses arrive one byte at a time, after some line noise
+  ResponseReader reader;
+  const uint8_t noise[] = {0x00, STX, 0x01, 0x00, 0x00, 0x00};  // Bad CRC
+  reader.push(noise, sizeof(noise));
+  Response rsp;
+  ExecResult exec;
+  StackDump stack;
+  size_t count = 0;
+  for (uint8_t byte : uart_output)
+  {
+    reader.push(&byte, 1);
+    while (reader.next(rsp))
+    {
+      if (count++ == 0)
+      {
+        REQUIRE(decode_exec(rsp, exec));
+      }
+      else
+      {
+        REQUIRE(decode_stack(rsp, stack));
+      }
+    }
+  }
+  CHECK(count == 2);
+  CHECK(reader.crc_errors() == 1);
+  CHECK(reader.pending() == 0);
+
+  REQUIRE(exec.words.size() == 2);
+  CHECK(exec.words[0] == 0);
+  CHECK(exec.main_word() == 1);
+  CHECK(stack.data == std::vector<int32_t>{9});
+
+  SUBCASE("Word reference to the resident word")
+  {
+    V4bBuilder next;
+    next.add_word_ref(v4b.word_hash(0));
+    const auto main4 = call_square(4);
+    next.set_main(main4.data(), main4.size());
+    REQUIRE(next.build(image));
+    CHECK(image[5] == internal::V4B_MINOR_WORD_REF);
+
+    uart_output.clear();
+    writer.clear();
+    REQUIRE(writer.add(Command::EXEC, image.data(), image.size()));
+    link.feed(writer.data(), writer.size());
+    reader.push(uart_output.data(), uart_output.size());
+    REQUIRE(reader.next(rsp));
+    REQUIRE(decode_exec(rsp, exec));
+    REQUIRE(exec.words.size() == 2);
+    CHECK(exec.words[0] == 0);  // Resident, not uploaded again
+    CHECK(vm_ds_peek_public(vm, 0) == 16);
+  }
+
+  SUBCASE("Errors are not decoded")
+  {
+    uint8_t bad[] = {'V', '4', 'B', 'C', 0x00, 0x03, 0x00, 0x00, 0xFF, 0, 0, 0, 0, 0, 0, 0};
+    uart_output.clear();
+    writer.clear();
+    REQUIRE(writer.add(Command::EXEC, bad, sizeof(bad)));
+    link.feed(writer.data(), writer.size());
+    reader.push(uart_output.data(), uart_output.size());
+    REQUIRE(reader.next(rsp));
+    CHECK(rsp.error() == ErrorCode::GENERAL_ERROR);
+    CHECK_FALSE(decode_exec(rsp, exec));
+    CHECK_FALSE(decode_stack(rsp, stack));
+  }
+
+  SUBCASE("Unknown opcode stops the build")
+  {
+    const uint8_t unknown[] = {0xEE, 0x51};
+    V4bBuilder broken;
+    broken.set_main(unknown, sizeof(unknown));
+    CHECK_FALSE(broken.build(image));
+  }
+
+  vm_destroy(vm);
+}
+
+#if V4LINK_ENABLE_TRACE
+TEST_CASE("TraceDecoder and Chrome trace JSON")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  uint8_t trace_buffer[512];
+  link.set_trace_buffer(trace_buffer, sizeof(trace_buffer));
+  link.set_timestamp(test_timestamp);
+  test_clock = 0xFFFFF000u;  // Wraps during the test
+
+  V4bBuilder v4b;
+  REQUIRE(v4b.add_word("sq", kSquare, sizeof(kSquare)));
+  const auto main_code = call_square(5);
+  v4b.set_main(main_code.data(), main_code.size());
+  std::vector<uint8_t> image;
+  REQUIRE(v4b.build(image));
+
+  // Two rounds of EXECs, each drained; the second round's timeline
+  // continues the first across the 32-bit wrap
+  uint8_t buf[256];
+  FrameWriter writer(buf, sizeof(buf));
+  TraceDecoder trace;
+  ResponseReader reader;
+  Response rsp;
+  for (int round = 0; round < 2; ++round)
+  {
+    writer.clear();
+    REQUIRE(writer.add(Command::EXEC, image.data(), image.size()));
+    for (int i = 0; i < 20; ++i)
+    {
+      link.feed(writer.data(), writer.size());
+    }
+
+    do
+    {
+      uart_output.clear();
+      writer.clear();
+      REQUIRE(writer.add(Command::DUMP_TRACE));
+      link.feed(writer.data(), writer.size());
+      reader.push(uart_output.data(), uart_output.size());
+      REQUIRE(reader.next(rsp));
+    } while (trace.add(rsp) && trace.more());
+  }
+
+  CHECK(trace.lost() > 0);  // 20 EXECs overflow 512 bytes
+  const auto& records = trace.records();
+  REQUIRE(records.size() > 20);
+  for (size_t i = 1; i < records.size(); ++i)
+  {
+    CHECK(records[i].time > records[i - 1].time);  // Across the 32-bit wrap
+  }
+  CHECK(records.back().time > 0xFFFFFFFFull);
+
+  const std::string json = trace_to_chrome_json(records, 48.0);
+  CHECK(json.rfind("{\"traceEvents\":[{", 0) == 0);
+  CHECK(json.find("\"name\":\"EXEC\",\"cat\":\"frame\",\"ph\":\"X\"") != std::string::npos);
+  CHECK(json.find("\"name\":\"vm_exec\"") != std::string::npos);
+  CHECK(json.find("\"name\":\"relocate\"") != std::string::npos);
+  CHECK(json.find(",]") == std::string::npos);
+  CHECK(json.substr(json.size() - 2) == "\"}");
+
+  SUBCASE("Errors and truncated records are rejected")
+  {
+    const size_t count = records.size();
+    const uint8_t truncated[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0x06, 0x80};
+    Response bad = {static_cast<uint8_t>(ErrorCode::OK), false, false, 0, truncated,
+                    sizeof(truncated)};
+    CHECK_FALSE(trace.add(bad));
+    bad.code = static_cast<uint8_t>(ErrorCode::GENERAL_ERROR);
+    bad.len = 9;
+    CHECK_FALSE(trace.add(bad));
+    CHECK(trace.records().size() == count);
+  }
+
+  vm_destroy(vm);
+}
+#endif
+
+#if V4LINK_ENABLE_PROFILE
+TEST_CASE("Profile report decoding")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  V4bBuilder v4b;
+  REQUIRE(v4b.add_word("sq", kSquare, sizeof(kSquare)));
+  const auto main_code = call_square(2);
+  v4b.set_main(main_code.data(), main_code.size());
+  std::vector<uint8_t> image;
+  REQUIRE(v4b.build(image));
+
+  uint8_t buf[256];
+  FrameWriter writer(buf, sizeof(buf));
+  REQUIRE(writer.add(Command::EXEC, image.data(), image.size()));
+  REQUIRE(writer.add(Command::PROFILE_START));
+  link.feed(writer.data(), writer.size());
+  link.profile_sample(1);
+  link.profile_sample(0);
+  link.profile_sample(0);
+  link.profile_sample(-1);
+
+  uart_output.clear();
+  writer.clear();
+  REQUIRE(writer.add(Command::PROFILE_DUMP));
+  link.feed(writer.data(), writer.size());
+  ResponseReader reader;
+  reader.push(uart_output.data(), uart_output.size());
+  Response rsp;
+  REQUIRE(reader.next(rsp));
+
+  ProfileReport report;
+  REQUIRE(decode_profile(rsp, report));
+  CHECK(report.active);
+  CHECK(report.mode == ProfileMode::SAMPLE);
+  CHECK(report.total == 4);
+  CHECK(report.idle == 1);
+  REQUIRE(report.words.size() == 2);
+  CHECK(report.words[0].word == 0);
+  CHECK(report.words[0].hits == 2);
+  CHECK(report.words[0].name == "sq");
+  CHECK(report.words[1].word == 1);
+  CHECK(report.words[1].name.empty());  // Main code
+
+  rsp.len--;  // Truncated name
+  CHECK_FALSE(decode_profile(rsp, report));
+
+  vm_destroy(vm);
+}
+#endif
@@ -9,13 +9,21 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
 
+#include <algorithm>
 #include <cstring>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "byte_order.hpp"
 #include "crc8.hpp"
+#include "crc_wide.hpp"
 #include "frame.hpp"
 #include "v4/task.h"
 #include "v4/vm_api.h"
+#include "v4link/internal/cobs.hpp"
+#include "v4link/internal/lz.hpp"
+#include "v4link/internal/word_hash.hpp"
 #include "v4link/link.hpp"
 #include "v4link/protocol.hpp"
 
@@ -49,6 +57,50 @@ TEST_CASE("CRC8 calculation")
     CHECK(crc == 0xF4);
   }
 
+  SUBCASE("Matches bitwise reference")
+  {
+    // Reference shift-and-xor implementation, independent of the backend
+    auto reference = [](const uint8_t* data, size_t len)
+    {
+      uint8_t crc = 0x00;
+      for (size_t i = 0; i < len; ++i)
+      {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ CRC8_POLY)
+                             : static_cast<uint8_t>(crc << 1);
+        }
+      }
+      return crc;
+    };
+
+    uint8_t data[256];
+    for (size_t i = 0; i < sizeof(data); ++i)
+    {
+      data[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    for (size_t len = 0; len <= sizeof(data); len += 17)
+    {
+      CHECK(internal::calc_crc8(data, len) == reference(data, len));
+    }
+  }
+
+  SUBCASE("Streaming update matches one-shot")
+  {
+    const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+    uint8_t crc = internal::crc8_init();
+    crc = internal::crc8_update(crc, data[0]);
+    crc = internal::crc8_update(crc, &data[1], 4);
+    for (size_t i = 5; i < sizeof(data); ++i)
+    {
+      crc = internal::crc8_update(crc, data[i]);
+    }
+
+    CHECK(internal::crc8_finalize(crc) == 0xF4);
+  }
+
   SUBCASE("Different data produces different CRC")
   {
     const uint8_t data1[] = {0x01, 0x02, 0x03};
@@ -59,6 +111,108 @@ TEST_CASE("CRC8 calculation")
   }
 }
 
+TEST_CASE("Wide CRC calculation")
+{
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+  SUBCASE("Known test vectors")
+  {
+    CHECK(internal::calc_crc16(check, sizeof(check)) == 0x29B1);
+    CHECK(internal::calc_crc32c(check, sizeof(check)) == 0xE3069283);
+    CHECK(internal::calc_crc16(nullptr, 0) == 0xFFFF);
+    CHECK(internal::calc_crc32c(nullptr, 0) == 0x00000000);
+  }
+
+  SUBCASE("Matches bitwise reference")
+  {
+    // Reference shift-and-xor implementations, independent of the backend
+    auto crc16_reference = [](const uint8_t* data, size_t len)
+    {
+      uint16_t crc = 0xFFFF;
+      for (size_t i = 0; i < len; ++i)
+      {
+        crc ^= static_cast<uint16_t>(data[i] << 8);
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                               : static_cast<uint16_t>(crc << 1);
+        }
+      }
+      return crc;
+    };
+    auto crc32c_reference = [](const uint8_t* data, size_t len)
+    {
+      uint32_t crc = 0xFFFFFFFF;
+      for (size_t i = 0; i < len; ++i)
+      {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+      }
+      return crc ^ 0xFFFFFFFF;
+    };
+
+    // Every length around the 8-byte steps, then long runs from odd offsets
+    uint8_t data[1024];
+    for (size_t i = 0; i < sizeof(data); ++i)
+    {
+      data[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    for (size_t len = 0; len <= 40; ++len)
+    {
+      CHECK(internal::calc_crc16(data, len) == crc16_reference(data, len));
+      CHECK(internal::calc_crc32c(data, len) == crc32c_reference(data, len));
+    }
+    for (size_t offset = 1; offset < 8; offset += 3)
+    {
+      const size_t len = sizeof(data) - offset;
+      CHECK(internal::calc_crc16(data + offset, len) ==
+            crc16_reference(data + offset, len));
+      CHECK(internal::calc_crc32c(data + offset, len) ==
+            crc32c_reference(data + offset, len));
+    }
+  }
+
+  SUBCASE("Streaming update matches one-shot")
+  {
+    uint16_t crc16 = internal::crc16_init();
+    uint32_t crc32c = internal::crc32c_init();
+    for (size_t i = 0; i < sizeof(check); i += 2)
+    {
+      const size_t n = std::min<size_t>(2, sizeof(check) - i);
+      crc16 = internal::crc16_update(crc16, check + i, n);
+      crc32c = internal::crc32c_update(crc32c, check + i, n);
+    }
+    CHECK(internal::crc16_finalize(crc16) == 0x29B1);
+    CHECK(internal::crc32c_finalize(crc32c) == 0xE3069283);
+  }
+
+  SUBCASE("Frames carry the check little-endian")
+  {
+    const uint8_t data[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    std::vector<uint8_t> frame;
+
+    REQUIRE(internal::encode_frame(Command::EXEC, data, sizeof(data), frame,
+                                   MAX_PAYLOAD_SIZE, CrcType::CRC16_CCITT));
+    REQUIRE(frame.size() == internal::FRAME_HEADER_SIZE + sizeof(data) + 2);
+    CHECK(internal::load_le16(frame.data() + 8) ==
+          internal::calc_crc16(frame.data() + 1, 7));
+    CHECK(internal::verify_frame_crc(frame.data(), frame.size(), CrcType::CRC16_CCITT));
+    CHECK_FALSE(internal::verify_frame_crc(frame.data(), frame.size()));
+
+    REQUIRE(internal::encode_frame(Command::EXEC, data, sizeof(data), frame,
+                                   MAX_PAYLOAD_SIZE, CrcType::CRC32C));
+    REQUIRE(frame.size() == internal::FRAME_HEADER_SIZE + sizeof(data) + 4);
+    CHECK(internal::load_le32(frame.data() + 8) ==
+          internal::calc_crc32c(frame.data() + 1, 7));
+    CHECK(internal::verify_frame_crc(frame.data(), frame.size(), CrcType::CRC32C));
+    frame[5] ^= 0x01;
+    CHECK_FALSE(internal::verify_frame_crc(frame.data(), frame.size(), CrcType::CRC32C));
+  }
+}
+
 /* ========================================================================= */
 /* Frame Encoding/Decoding Tests                                            */
 /* ========================================================================= */
@@ -151,6 +305,224 @@ TEST_CASE("Frame CRC verification")
   }
 }
 
+/* ========================================================================= */
+/* LZ Codec Tests                                                            */
+/* ========================================================================= */
+
+// Decode a whole stream, feeding it @p step bytes at a time
+static ErrorCode lz_decode(const std::vector<uint8_t>& packed, size_t step,
+                           std::vector<uint8_t>& out)
+{
+  internal::LzDecoder dec;
+  dec.reset();
+  out.clear();
+  auto sink = [&out](const uint8_t* data, size_t len)
+  {
+    out.insert(out.end(), data, data + len);
+    return ErrorCode::OK;
+  };
+  for (size_t off = 0; off < packed.size(); off += step)
+  {
+    const size_t n = std::min(step, packed.size() - off);
+    const ErrorCode err = dec.feed(packed.data() + off, n, sink);
+    if (err != ErrorCode::OK)
+    {
+      return err;
+    }
+  }
+  return ErrorCode::OK;
+}
+
+TEST_CASE("LZ codec")
+{
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> out;
+
+  SUBCASE("Repetitive bytecode round-trips and shrinks")
+  {
+    // LIT/CALL sequences and zero-padded SYS operands, as emitted by V4-front
+    std::vector<uint8_t> code;
+    for (int i = 0; i < 200; ++i)
+    {
+      const uint8_t chunk[] = {0x00, static_cast<uint8_t>(i & 7), 0, 0, 0,
+                               0x50, static_cast<uint8_t>(i % 3), 0x00,
+                               0x60, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+      code.insert(code.end(), chunk, chunk + sizeof(chunk));
+    }
+
+    internal::lz_compress(code.data(), code.size(), packed);
+    CHECK(packed.size() < code.size() / 4);
+
+    for (const size_t step : {packed.size(), size_t{1}, size_t{7}, size_t{300}})
+    {
+      CAPTURE(step);
+      REQUIRE(lz_decode(packed, step, out) == ErrorCode::OK);
+      CHECK(out == code);
+    }
+  }
+
+  SUBCASE("Incompressible data round-trips")
+  {
+    std::vector<uint8_t> noise(1000);
+    uint32_t x = 12345;
+    for (auto& b : noise)
+    {
+      x = x * 1103515245u + 12345u;
+      b = static_cast<uint8_t>(x >> 24);
+    }
+    internal::lz_compress(noise.data(), noise.size(), packed);
+    REQUIRE(lz_decode(packed, 13, out) == ErrorCode::OK);
+    CHECK(out == noise);
+  }
+
+  SUBCASE("Overlapping match repeats a pattern")
+  {
+    packed = {0x01, 0xAB, 0xCD, 0x80 | 7, 1};  // "AB CD", then 10 bytes from 2 back
+    REQUIRE(lz_decode(packed, 1, out) == ErrorCode::OK);
+    REQUIRE(out.size() == 12);
+    CHECK(out[10] == 0xAB);
+    CHECK(out[11] == 0xCD);
+  }
+
+  SUBCASE("Match before the start of output is rejected")
+  {
+    packed = {0x00, 0x11, 0x80, 1};  // Distance 2 after one byte
+    CHECK(lz_decode(packed, packed.size(), out) == ErrorCode::GENERAL_ERROR);
+  }
+}
+
+/* ========================================================================= */
+/* COBS Codec Tests                                                          */
+/* ========================================================================= */
+
+static std::vector<uint8_t> cobs_encode(const std::vector<uint8_t>& raw)
+{
+  std::vector<uint8_t> out(raw.size() + internal::cobs_overhead(raw.size()));
+  out.resize(internal::cobs_encode(raw.data(), raw.size(), out.data()));
+  return out;
+}
+
+// Decode one delimited frame, feeding it @p step bytes at a time
+static internal::CobsStatus cobs_decode(const std::vector<uint8_t>& encoded, size_t step,
+                                        std::vector<uint8_t>& out)
+{
+  std::vector<uint8_t> wire = encoded;
+  wire.push_back(internal::COBS_DELIMITER);
+  internal::CobsDecoder dec;
+  out.clear();
+  auto sink = [&out](const uint8_t* data, size_t len)
+  { out.insert(out.end(), data, data + len); };
+  internal::CobsStatus status = internal::CobsStatus::PARTIAL;
+  for (size_t off = 0; off < wire.size() && status == internal::CobsStatus::PARTIAL;)
+  {
+    const size_t n = std::min(step, wire.size() - off);
+    off += dec.feed(wire.data() + off, n, sink, &status);
+  }
+  return status;
+}
+
+TEST_CASE("COBS codec")
+{
+  std::vector<uint8_t> out;
+
+  SUBCASE("Reference vectors")
+  {
+    CHECK(cobs_encode({}) == std::vector<uint8_t>{0x01});
+    CHECK(cobs_encode({0x00}) == std::vector<uint8_t>{0x01, 0x01});
+    CHECK(cobs_encode({0x00, 0x00}) == std::vector<uint8_t>{0x01, 0x01, 0x01});
+    CHECK(cobs_encode({0x11, 0x22, 0x00, 0x33}) ==
+          std::vector<uint8_t>{0x03, 0x11, 0x22, 0x02, 0x33});
+    CHECK(cobs_encode({0x11, 0x00, 0x00, 0x00}) ==
+          std::vector<uint8_t>{0x02, 0x11, 0x01, 0x01, 0x01});
+  }
+
+  SUBCASE("Long runs split into 254-byte blocks")
+  {
+    std::vector<uint8_t> raw(600);
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+      raw[i] = static_cast<uint8_t>(i % 255 + 1);
+    }
+    raw[300] = 0;
+    const auto encoded = cobs_encode(raw);
+    CHECK(encoded.size() <= raw.size() + internal::cobs_overhead(raw.size()));
+    CHECK(encoded[0] == 0xFF);
+    CHECK(std::find(encoded.begin(), encoded.end(), 0) == encoded.end());
+
+    for (const size_t step : {encoded.size() + 1, size_t{1}, size_t{100}})
+    {
+      CAPTURE(step);
+      REQUIRE(cobs_decode(encoded, step, out) == internal::CobsStatus::FRAME);
+      CHECK(out == raw);
+    }
+  }
+
+  SUBCASE("Encoding in place with headroom")
+  {
+    std::vector<uint8_t> raw(400, 0x5A);
+    raw[0] = 0;
+    raw[399] = 0;
+    const size_t headroom = internal::cobs_overhead(raw.size());
+    std::vector<uint8_t> buf(headroom);
+    buf.insert(buf.end(), raw.begin(), raw.end());
+    const size_t n = internal::cobs_encode(buf.data() + headroom, raw.size(), buf.data());
+    CHECK(std::vector<uint8_t>(buf.begin(), buf.begin() + n) == cobs_encode(raw));
+  }
+
+  SUBCASE("Delimiter inside a block is malformed")
+  {
+    // Block claims 3 more bytes; the delimiter comes after one
+    const uint8_t wire[] = {0x04, 0x11, 0x00, 0x02, 0x22, 0x00};
+    internal::CobsDecoder dec;
+    auto sink = [&out](const uint8_t* data, size_t len)
+    { out.insert(out.end(), data, data + len); };
+    internal::CobsStatus status;
+    size_t used = dec.feed(wire, sizeof(wire), sink, &status);
+    CHECK(status == internal::CobsStatus::MALFORMED);
+    CHECK(used == 3);
+
+    // The decoder starts over after it
+    out.clear();
+    used += dec.feed(wire + used, sizeof(wire) - used, sink, &status);
+    CHECK(status == internal::CobsStatus::FRAME);
+    CHECK(used == sizeof(wire));
+    CHECK(out == std::vector<uint8_t>{0x22});
+  }
+}
+
+// Encode a frame for COBS framing: everything after STX, then the delimiter
+static std::vector<uint8_t> cobs_frame(const std::vector<uint8_t>& frame)
+{
+  std::vector<uint8_t> wire =
+      cobs_encode(std::vector<uint8_t>(frame.begin() + 1, frame.end()));
+  wire.push_back(internal::COBS_DELIMITER);
+  return wire;
+}
+
+// Split COBS output into decoded frames, with STX put back in front
+static std::vector<std::vector<uint8_t>> cobs_frames(const std::vector<uint8_t>& out)
+{
+  std::vector<std::vector<uint8_t>> frames;
+  size_t start = 0;
+  for (size_t i = 0; i < out.size(); ++i)
+  {
+    if (out[i] != internal::COBS_DELIMITER)
+    {
+      continue;
+    }
+    std::vector<uint8_t> decoded;
+    const std::vector<uint8_t> encoded(out.begin() + start, out.begin() + i);
+    REQUIRE(cobs_decode(encoded, encoded.size() + 1, decoded) ==
+            internal::CobsStatus::FRAME);
+    decoded.insert(decoded.begin(), STX);
+    CHECK(internal::verify_frame_crc(decoded.data(), decoded.size()));
+    frames.push_back(decoded);
+    start = i + 1;
+  }
+  CHECK(start == out.size());  // Every frame is delimited
+  return frames;
+}
+
 /* ========================================================================= */
 /* Link Class Tests                                                          */
 /* ========================================================================= */
@@ -162,6 +534,75 @@ static void test_uart_write(void* user, const uint8_t* data, size_t len)
   output->insert(output->end(), data, data + len);
 }
 
+// Word definition for build_v4b()
+struct TestWord
+{
+  const char* name;
+  std::vector<uint8_t> code;
+  std::vector<uint16_t> fixups = {};  // CALL operand offsets (v0.3 images)
+};
+
+// Build a .v4b image: header, main code, word table. With relocs, a v0.3
+// image with a relocation list after each code block; otherwise v0.2.
+static std::vector<uint8_t> build_v4b(const std::vector<uint8_t>& main_code,
+                                      const std::vector<TestWord>& words = {},
+                                      bool relocs = false,
+                                      const std::vector<uint16_t>& main_fixups = {})
+{
+  auto put_u32 = [](std::vector<uint8_t>& out, uint32_t v)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      out.push_back(static_cast<uint8_t>((v >> (i * 8)) & 0xFF));
+    }
+  };
+  auto put_fixups = [](std::vector<uint8_t>& out, const std::vector<uint16_t>& fixups)
+  {
+    out.push_back(static_cast<uint8_t>(fixups.size() & 0xFF));
+    out.push_back(static_cast<uint8_t>(fixups.size() >> 8));
+    for (uint16_t at : fixups)
+    {
+      out.push_back(static_cast<uint8_t>(at & 0xFF));
+      out.push_back(static_cast<uint8_t>(at >> 8));
+    }
+  };
+
+  const uint8_t minor = relocs ? 0x03 : 0x02;
+  std::vector<uint8_t> image = {'V', '4', 'B', 'C', 0x00, minor, 0x00, 0x00};
+  put_u32(image, static_cast<uint32_t>(main_code.size()));
+  put_u32(image, static_cast<uint32_t>(words.size()));
+  image.insert(image.end(), main_code.begin(), main_code.end());
+  if (relocs)
+  {
+    put_fixups(image, main_fixups);
+  }
+  for (const auto& word : words)
+  {
+    const size_t name_len = strlen(word.name);
+    image.push_back(static_cast<uint8_t>(name_len));
+    image.insert(image.end(), word.name, word.name + name_len);
+    put_u32(image, static_cast<uint32_t>(word.code.size()));
+    image.insert(image.end(), word.code.begin(), word.code.end());
+    if (relocs)
+    {
+      put_fixups(image, word.fixups);
+    }
+  }
+  return image;
+}
+
+// Send one frame and return the response frame(s) written back
+static std::vector<uint8_t> transact(Link& link, std::vector<uint8_t>& uart_output,
+                                     Command cmd, const uint8_t* data = nullptr,
+                                     size_t len = 0)
+{
+  std::vector<uint8_t> frame;
+  internal::encode_frame(cmd, data, len, frame);
+  uart_output.clear();
+  link.feed(frame.data(), frame.size());
+  return uart_output;
+}
+
 TEST_CASE("Link basic functionality")
 {
   // Create VM
@@ -276,6 +717,22 @@ TEST_CASE("Link basic functionality")
     CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
   }
 
+  SUBCASE("Corrupted payload byte")
+  {
+    const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), frame);
+    frame[5] ^= 0x01;  // Flip a bit inside the payload
+
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+
+    // Should be rejected without executing
+    REQUIRE(uart_output.size() == 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(vm_ds_depth_public(vm) == 0);
+  }
+
   SUBCASE("Buffer overflow protection")
   {
     // Create frame with payload larger than buffer
@@ -339,6 +796,3020 @@ TEST_CASE("Link state machine robustness")
   vm_destroy(vm);
 }
 
+TEST_CASE("Link bulk feed")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+  std::vector<uint8_t> exec_frame;
+  internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), exec_frame);
+
+  SUBCASE("Whole frame in one call")
+  {
+    uart_output.clear();
+    link.feed(exec_frame.data(), exec_frame.size());
+
+    REQUIRE(uart_output.size() == 8);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 42);
+  }
+
+  SUBCASE("Garbage and several frames in one call")
+  {
+    std::vector<uint8_t> ping_frame;
+    internal::encode_frame(Command::PING, nullptr, 0, ping_frame);
+
+    std::vector<uint8_t> stream = {0x00, 0x12, 0x34};
+    stream.insert(stream.end(), exec_frame.begin(), exec_frame.end());
+    stream.insert(stream.end(), ping_frame.begin(), ping_frame.end());
+
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+
+    REQUIRE(uart_output.size() == 8 + 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(uart_output[8 + 3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Frame split across calls")
+  {
+    for (size_t split = 1; split < exec_frame.size(); ++split)
+    {
+      uart_output.clear();
+      link.feed(exec_frame.data(), split);
+      CHECK(uart_output.empty());
+      link.feed(exec_frame.data() + split, exec_frame.size() - split);
+      REQUIRE(uart_output.size() == 8);
+      CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link interrupt receive ring")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+  std::vector<uint8_t> exec_frame;
+  internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), exec_frame);
+
+  SUBCASE("Queued bytes are handled by poll()")
+  {
+    // 20 rounds up to 32: frames wrap around the end of the ring
+    Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE,
+              Link::DEFAULT_ARENA_SIZE, nullptr, 20);
+    for (int i = 0; i < 10; ++i)
+    {
+      uart_output.clear();
+      for (uint8_t byte : exec_frame)
+      {
+        REQUIRE(link.isr_push(byte));
+      }
+      CHECK(uart_output.empty());
+      CHECK(link.poll() == exec_frame.size());
+      REQUIRE(uart_output.size() == 8);
+      CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+    CHECK(link.poll() == 0);
+    CHECK(link.rx_overruns() == 0);
+  }
+
+  SUBCASE("Bytes arriving during execution wait for the next poll()")
+  {
+    struct Context
+    {
+      Link* link;
+      std::vector<uint8_t> next;
+      size_t responses;
+    };
+    static Context ctx;
+    ctx = Context{nullptr, exec_frame, 0};
+
+    // The next frame "arrives" while the current one is being answered
+    Link link(
+        vm,
+        [](void*, const uint8_t*, size_t) {
+          ++ctx.responses;
+          ctx.link->isr_push(ctx.next.data(), ctx.next.size());
+          ctx.next.clear();
+        },
+        nullptr, MAX_PAYLOAD_SIZE, Link::DEFAULT_ARENA_SIZE, nullptr, 64);
+    ctx.link = &link;
+
+    CHECK(link.isr_push(exec_frame.data(), exec_frame.size()) == exec_frame.size());
+    CHECK(link.poll() == exec_frame.size());
+    CHECK(ctx.responses == 1);
+    CHECK(link.poll() == exec_frame.size());
+    CHECK(ctx.responses == 2);
+    CHECK(vm_ds_depth_public(vm) == 2);
+  }
+
+  SUBCASE("Full ring drops bytes")
+  {
+    Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE,
+              Link::DEFAULT_ARENA_SIZE, nullptr, 8);
+    CHECK(link.isr_push(exec_frame.data(), exec_frame.size()) == 8);
+    CHECK_FALSE(link.isr_push(0x00));
+    CHECK(link.rx_overruns() == exec_frame.size() - 8 + 1);
+
+    Link no_ring(vm, test_uart_write, &uart_output);
+    CHECK_FALSE(no_ring.isr_push(0x00));
+    CHECK(no_ring.poll() == 0);
+  }
+
+  vm_destroy(vm);
+}
+
+// ExecSliceFn that yields until its slice count runs out, then runs the word
+struct TestSlicer
+{
+  int slices_left;
+  bool aborted;
+};
+
+static TestSlicer test_slicer;
+
+static int test_exec_slice(void*, Vm* vm, Word* entry, Link::SliceOp op, uint32_t budget)
+{
+  if (op == Link::SliceOp::ABORT)
+  {
+    test_slicer.aborted = true;
+    return 0;
+  }
+  CHECK(budget == 100);
+  if (--test_slicer.slices_left > 0)
+  {
+    return Link::SLICE_YIELD;
+  }
+  return vm_exec(vm, entry);
+}
+
+TEST_CASE("Link async exec")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  test_slicer = TestSlicer{3, false};
+
+  const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+
+  // [STATE, SLICES] from RUN_STATUS
+  const auto run_status = [&]()
+  {
+    const auto resp = transact(link, uart_output, Command::RUN_STATUS);
+    REQUIRE(resp.size() == 4 + 11 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    return std::make_pair(static_cast<RunState>(resp[4]),
+                          static_cast<uint32_t>(resp[7] | (resp[8] << 8)));
+  };
+
+  SUBCASE("Synchronous EXEC reports a finished run")
+  {
+    CHECK(run_status().first == RunState::IDLE);
+    transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    CHECK(run_status() == std::make_pair(RunState::DONE, 1u));
+  }
+
+  SUBCASE("Runs advance one slice per poll()")
+  {
+    link.set_async_exec(true);
+    link.set_exec_slice(test_exec_slice, 100);
+
+    auto resp = transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    REQUIRE(resp.size() == 4 + 3 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_depth_public(vm) == 0);  // Replied before running
+    CHECK(run_status() == std::make_pair(RunState::RUNNING, 0u));
+
+    // Busy, but still answering
+    resp = transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUSY));
+    resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    link.poll();
+    link.poll();
+    CHECK(run_status() == std::make_pair(RunState::RUNNING, 2u));
+    link.poll();
+    CHECK(run_status() == std::make_pair(RunState::DONE, 3u));
+    CHECK(vm_ds_peek_public(vm, 0) == 42);
+    CHECK_FALSE(test_slicer.aborted);
+  }
+
+  SUBCASE("ABORT cancels the run")
+  {
+    link.set_async_exec(true);
+    link.set_exec_slice(test_exec_slice, 100);
+    transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    link.poll();
+
+    auto resp = transact(link, uart_output, Command::ABORT);
+    REQUIRE(resp.size() == 4 + 1 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == static_cast<uint8_t>(RunState::ABORTED));
+    CHECK(test_slicer.aborted);
+
+    link.poll();
+    CHECK(run_status() == std::make_pair(RunState::ABORTED, 1u));
+    CHECK(vm_ds_depth_public(vm) == 0);
+
+    resp = transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Deferred run without a slice callback")
+  {
+    link.set_async_exec(true);
+    transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    CHECK(vm_ds_depth_public(vm) == 0);
+    link.poll();
+    CHECK(run_status() == std::make_pair(RunState::DONE, 1u));
+    CHECK(vm_ds_peek_public(vm, 0) == 42);
+
+    transact(link, uart_output, Command::EXEC, bytecode, sizeof(bytecode));
+    transact(link, uart_output, Command::RESET);
+    CHECK(run_status().first == RunState::IDLE);
+  }
+
+  vm_destroy(vm);
+}
+
+static void test_uart_writev(void* user, const Link::IoVec* iov, size_t iovcnt)
+{
+  auto* output = static_cast<std::vector<std::vector<uint8_t>>*>(user);
+  for (size_t i = 0; i < iovcnt; ++i)
+  {
+    output->emplace_back(iov[i].data, iov[i].data + iov[i].len);
+  }
+}
+
+TEST_CASE("Link vectored UART write")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<std::vector<uint8_t>> iov_output;
+  Link link(vm, nullptr, &iov_output);
+  link.set_uart_writev(test_uart_writev);
+
+  // Register a word so that QUERY_WORD has bytecode to return
+  const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+  std::vector<uint8_t> exec_frame;
+  internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), exec_frame);
+  link.feed(exec_frame.data(), exec_frame.size());
+
+  REQUIRE(iov_output.size() == 3);
+  const uint8_t wid_l = iov_output[0][5];
+  const uint8_t wid_h = iov_output[0][6];
+
+  SUBCASE("Header, payload and CRC are separate buffers")
+  {
+    const uint8_t query[] = {wid_l, wid_h};
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::QUERY_WORD, query, sizeof(query), frame);
+
+    iov_output.clear();
+    link.feed(frame.data(), frame.size());
+
+    REQUIRE(iov_output.size() == 3);
+    // Header + NAME_LEN + CODE_LEN
+    REQUIRE(iov_output[0].size() == 4 + 1 + 2);
+    CHECK(iov_output[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+    // Bytecode passed through as its own buffer
+    CHECK(iov_output[1] == std::vector<uint8_t>(bytecode, bytecode + sizeof(bytecode)));
+    REQUIRE(iov_output[2].size() == 1);
+
+    // Reassembled frame carries a valid CRC
+    std::vector<uint8_t> response;
+    for (const auto& part : iov_output)
+    {
+      response.insert(response.end(), part.begin(), part.end());
+    }
+    CHECK(internal::verify_frame_crc(response.data(), response.size()));
+  }
+
+  SUBCASE("A tail past the 16-bit LEN is refused")
+  {
+    // A word the link never stored, with code just short of 64 KiB
+    std::vector<uint8_t> big(0xFFFA, 0x51);
+    const int wid = vm_register_word(vm, "big", big.data(), static_cast<int>(big.size()));
+    REQUIRE(wid >= 0);
+
+    const uint8_t query[] = {static_cast<uint8_t>(wid), static_cast<uint8_t>(wid >> 8)};
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::QUERY_WORD, query, sizeof(query), frame);
+
+    iov_output.clear();
+    link.feed(frame.data(), frame.size());
+
+    REQUIRE(iov_output.size() == 3);
+    REQUIRE(iov_output[0].size() == 4);
+    CHECK(internal::load_le16(iov_output[0].data() + 1) == 1);  // ERR_CODE only
+    CHECK(iov_output[0][3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(iov_output[1].empty());
+  }
+
+  SUBCASE("COBS framing sends each frame as one buffer")
+  {
+    const uint8_t req[] = {0, PING_FLAG_COBS};
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::PING, req, sizeof(req), frame);
+    link.feed(frame.data(), frame.size());
+
+    const uint8_t query[] = {wid_l, wid_h};
+    internal::encode_frame(Command::QUERY_WORD, query, sizeof(query), frame);
+    const auto wire = cobs_frame(frame);
+    iov_output.clear();
+    link.feed(wire.data(), wire.size());
+
+    REQUIRE(iov_output.size() == 1);
+    const auto frames = cobs_frames(iov_output[0]);
+    REQUIRE(frames.size() == 1);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(std::search(frames[0].begin(), frames[0].end(), bytecode,
+                      bytecode + sizeof(bytecode)) != frames[0].end());
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link bytecode arena")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  uint8_t arena[16] = {0};
+  Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE, sizeof(arena), arena);
+  CHECK(link.arena_capacity() == sizeof(arena));
+
+  const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+  std::vector<uint8_t> exec_frame;
+  internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), exec_frame);
+
+  SUBCASE("Bytecode is stored in the caller-provided region")
+  {
+    uart_output.clear();
+    link.feed(exec_frame.data(), exec_frame.size());
+
+    REQUIRE(uart_output.size() == 8);
+    REQUIRE(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(link.arena_used() == sizeof(bytecode));
+
+    const int wid = uart_output[5] | (uart_output[6] << 8);
+    Word* word = vm_get_word(vm, wid);
+    REQUIRE(word != nullptr);
+    CHECK(vm_word_get_code(word) == arena);
+  }
+
+  SUBCASE("Arena exhaustion is reported as BUFFER_FULL")
+  {
+    link.feed(exec_frame.data(), exec_frame.size());
+    link.feed(exec_frame.data(), exec_frame.size());
+    CHECK(link.arena_used() == 2 * sizeof(bytecode));
+
+    // Third copy does not fit into 16 bytes
+    uart_output.clear();
+    link.feed(exec_frame.data(), exec_frame.size());
+    REQUIRE(uart_output.size() == 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(link.arena_used() == 2 * sizeof(bytecode));
+
+    // RESET releases the arena
+    std::vector<uint8_t> reset_frame;
+    internal::encode_frame(Command::RESET, nullptr, 0, reset_frame);
+    link.feed(reset_frame.data(), reset_frame.size());
+    CHECK(link.arena_used() == 0);
+
+    uart_output.clear();
+    link.feed(exec_frame.data(), exec_frame.size());
+    REQUIRE(uart_output.size() == 8);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link execute-in-place")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  link.set_exec_in_place(true);
+
+  SUBCASE("Raw bytecode runs without arena copy")
+  {
+    const uint8_t bytecode[] = {0x00, 42, 0x00, 0x00, 0x00, 0x51};  // LIT 42, RET
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::EXEC, bytecode, sizeof(bytecode), frame);
+
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+
+    REQUIRE(uart_output.size() == 8);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 42);
+    CHECK(link.arena_used() == 0);
+
+    // Transient code cannot be queried
+    const uint8_t query[] = {uart_output[5], uart_output[6]};
+    internal::encode_frame(Command::QUERY_WORD, query, sizeof(query), frame);
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+    REQUIRE(uart_output.size() == 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+  }
+
+  SUBCASE("Only word definitions are copied")
+  {
+    // : sq dup * ;  7 sq
+    const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};  // DUP MUL RET
+    const std::vector<uint8_t> main_code = {
+        0x00, 7, 0x00, 0x00, 0x00,  // LIT 7
+        0x50, 0x00, 0x00,           // CALL 0
+        0x51                        // RET
+    };
+    const auto image = build_v4b(main_code, {{"sq", sq}});
+    std::vector<uint8_t> frame;
+    internal::encode_frame(Command::EXEC, image.data(), image.size(), frame);
+
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+
+    REQUIRE(uart_output.size() == 10);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(uart_output[4] == 2);  // sq + main
+    CHECK(vm_ds_peek_public(vm, 0) == 49);
+    CHECK(link.arena_used() == sizeof("sq") + sq.size());
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link chunked upload")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  // RX buffer deliberately smaller than the image
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output, 8);
+
+  // : sq dup * ;  : quad sq sq ;  3 quad
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+  REQUIRE(image.size() > link.buffer_capacity());
+
+  SUBCASE("Image streamed in small chunks")
+  {
+    auto resp = transact(link, uart_output, Command::BEGIN_UPLOAD);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    for (size_t off = 0; off < image.size(); off += 5)
+    {
+      const size_t n = std::min<size_t>(5, image.size() - off);
+      resp = transact(link, uart_output, Command::CHUNK, image.data() + off, n);
+      REQUIRE(resp.size() == 5);
+      REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+
+    resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 3);  // sq, quad, main
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+    CHECK(link.arena_used() == main_code.size() + sq.size() + quad.size() + 3 + 5);
+  }
+
+  SUBCASE("Word tables too long to report are refused")
+  {
+    // v0.2 header claiming 0x10000 words, e.g. WORD_REF entries that
+    // never register a word but still take a response slot each
+    std::vector<uint8_t> header = {0x56, 0x34, 0x42, 0x43, 0, 2, 0, 0, 0, 0, 0, 0};
+    header.insert(header.end(), {0x00, 0x00, 0x01, 0x00});
+
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    auto resp = transact(link, uart_output, Command::CHUNK, header.data(), 8);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    resp = transact(link, uart_output, Command::CHUNK, header.data() + 8, 8);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(link.arena_used() == 0);
+
+    Link wide(vm, test_uart_write, &uart_output);
+    resp = transact(wide, uart_output, Command::EXEC, header.data(), header.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+  }
+
+#if V4LINK_ENABLE_COMPRESSION
+  SUBCASE("Compressed image streamed in small chunks")
+  {
+    REQUIRE((Link::capabilities() & CAP_COMPRESSION) != 0);
+    std::vector<uint8_t> packed;
+    internal::lz_compress(image.data(), image.size(), packed);
+
+    const uint8_t flags = UPLOAD_FLAG_COMPRESSED;
+    auto resp = transact(link, uart_output, Command::BEGIN_UPLOAD, &flags, 1);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    for (size_t off = 0; off < packed.size(); off += 3)
+    {
+      const size_t n = std::min<size_t>(3, packed.size() - off);
+      resp = transact(link, uart_output, Command::CHUNK, packed.data() + off, n);
+      REQUIRE(resp.size() == 5);
+      REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+
+    resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+  }
+
+  SUBCASE("Corrupt compressed stream aborts the upload")
+  {
+    const uint8_t flags = UPLOAD_FLAG_COMPRESSED;
+    transact(link, uart_output, Command::BEGIN_UPLOAD, &flags, 1);
+    const uint8_t bad[] = {0x80, 0x00};  // Match with no prior output
+    auto resp = transact(link, uart_output, Command::CHUNK, bad, sizeof(bad));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(link.arena_used() == 0);
+  }
+#endif
+
+  SUBCASE("Unknown upload flags are rejected")
+  {
+    const uint8_t flags = 0x80;
+    const auto resp = transact(link, uart_output, Command::BEGIN_UPLOAD, &flags, 1);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+  }
+
+  SUBCASE("CHUNK without BEGIN_UPLOAD is rejected")
+  {
+    const auto resp = transact(link, uart_output, Command::CHUNK, image.data(), 4);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+  }
+
+  SUBCASE("Incomplete image is not committed")
+  {
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    transact(link, uart_output, Command::CHUNK, image.data(), 8);
+    transact(link, uart_output, Command::CHUNK, image.data() + 8, 8);
+
+    const auto resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(link.arena_used() == 0);
+  }
+
+  SUBCASE("Bad magic aborts the upload")
+  {
+    std::vector<uint8_t> bad = image;
+    bad[0] = 'X';
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    transact(link, uart_output, Command::CHUNK, bad.data(), 8);
+    const auto resp = transact(link, uart_output, Command::CHUNK, bad.data() + 8, 8);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link .v4b relocation table")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  // Occupy word 0 so file-relative CALL indices need relocation
+  const uint8_t ret = 0x51;
+  transact(link, uart_output, Command::EXEC, &ret, 1);
+
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+
+  SUBCASE("EXEC applies listed fixups")
+  {
+    const auto image =
+        build_v4b(main_code, {{"sq", sq}, {"quad", quad, {1, 4}}}, true, {6});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 1);  // sq registered at VM index 1
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+  }
+
+  SUBCASE("Fixup not pointing at a CALL operand is rejected")
+  {
+    const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad, {1, 5}}}, true, {6});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+  }
+
+  SUBCASE("Truncated relocation list is rejected")
+  {
+    auto image = build_v4b(main_code, {{"sq", sq}}, true, {6});
+    image.resize(image.size() - 1);
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+  }
+
+  SUBCASE("Unknown opcode stops the v0.2 scan")
+  {
+    const std::vector<uint8_t> odd = {0xEE, 0x50, 0x00, 0x00, 0x51};
+    const auto image = build_v4b(main_code, {{"odd", odd}});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+  }
+
+  SUBCASE("Chunked upload applies fixups as they arrive")
+  {
+    const auto image =
+        build_v4b(main_code, {{"sq", sq}, {"quad", quad, {1, 4}}}, true, {6});
+
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    for (size_t off = 0; off < image.size(); off += 3)
+    {
+      const size_t n = std::min<size_t>(3, image.size() - off);
+      const auto resp = transact(link, uart_output, Command::CHUNK, image.data() + off, n);
+      REQUIRE(resp.size() == 5);
+      REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+
+    const auto resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link transactional .v4b load")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  // Word names are interned in the arena with their terminators
+  const size_t stored = sizeof("sq") + sizeof("quad") + sq.size() + quad.size() + main_code.size();
+
+  SUBCASE("Relocation batch is released after loading")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+    CHECK(link.arena_used() == stored);
+  }
+
+  SUBCASE("Invalid code in a later word registers nothing")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const std::vector<uint8_t> odd = {0xEE, 0x51};
+    const auto image = build_v4b(main_code, {{"sq", sq}, {"odd", odd}});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+    CHECK(vm_get_word(vm, 0) == nullptr);
+    CHECK(link.arena_used() == 0);
+  }
+
+  SUBCASE("Truncated word table registers nothing")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+    image.resize(image.size() - 2);
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(vm_get_word(vm, 0) == nullptr);
+    CHECK(link.arena_used() == 0);
+  }
+
+  SUBCASE("An image filling the arena loads without room for the batch")
+  {
+    // Fits the code, and none or one of the three collected CALL operands;
+    // the rest are relinked from the code or from the relocation lists
+    const std::vector<uint8_t> images[] = {
+        build_v4b(main_code, {{"sq", sq}, {"quad", quad}}),
+        build_v4b(main_code, {{"sq", sq}, {"quad", quad, {1, 4}}}, true, {6}),
+    };
+    for (const auto& image : images)
+    {
+      for (const size_t spare : {size_t{0}, size_t{2}})
+      {
+        vm_reset(vm);
+        std::vector<uint8_t> arena(stored + spare);
+        Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE, arena.size(),
+                  arena.data());
+        const auto resp =
+            transact(link, uart_output, Command::EXEC, image.data(), image.size());
+        REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+        CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+        CHECK(vm_ds_peek_public(vm, 0) == 81);
+        CHECK(link.arena_used() == stored);
+      }
+    }
+  }
+
+  SUBCASE("No room for the code registers nothing")
+  {
+    std::vector<uint8_t> arena(stored - 1);
+    Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE, arena.size(),
+              arena.data());
+    const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+    const auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(vm_get_word(vm, 0) == nullptr);
+    CHECK(link.arena_used() == 0);
+  }
+
+  vm_destroy(vm);
+}
+
+// Chain hashes of a word table, as the device computes them (word_hash.hpp)
+static std::vector<uint32_t> chain_hashes(const std::vector<TestWord>& words)
+{
+  std::vector<uint32_t> hashes;
+  uint32_t hash = internal::WORD_HASH_INIT;
+  for (const auto& word : words)
+  {
+    std::vector<uint8_t> entry = {static_cast<uint8_t>(strlen(word.name))};
+    entry.insert(entry.end(), word.name, word.name + strlen(word.name));
+    const uint32_t len = static_cast<uint32_t>(word.code.size());
+    for (int i = 0; i < 4; ++i)
+    {
+      entry.push_back(static_cast<uint8_t>((len >> (i * 8)) & 0xFF));
+    }
+    entry.insert(entry.end(), word.code.begin(), word.code.end());
+    hash = internal::word_hash_update(hash, entry.data(), entry.size());
+    hashes.push_back(hash);
+  }
+  return hashes;
+}
+
+// Build a v0.4 image (relocation lists as in v0.3) whose word table starts
+// with references to resident words
+static std::vector<uint8_t> build_v4b_refs(const std::vector<uint8_t>& main_code,
+                                           const std::vector<uint16_t>& main_fixups,
+                                           const std::vector<uint32_t>& refs,
+                                           const std::vector<TestWord>& words = {})
+{
+  auto image = build_v4b(main_code, words, true, main_fixups);
+  image[5] = internal::V4B_MINOR_WORD_REF;
+  image[12] = static_cast<uint8_t>(refs.size() + words.size());
+
+  std::vector<uint8_t> table;
+  for (uint32_t hash : refs)
+  {
+    table.push_back(internal::V4B_WORD_REF);
+    for (int i = 0; i < 4; ++i)
+    {
+      table.push_back(static_cast<uint8_t>((hash >> (i * 8)) & 0xFF));
+    }
+  }
+  const size_t at = 16 + main_code.size() + 2 + 2 * main_fixups.size();
+  image.insert(image.begin() + at, table.begin(), table.end());
+  return image;
+}
+
+// Send HAVE_WORDS and return the reported word indices
+static std::vector<uint16_t> have_words(Link& link, std::vector<uint8_t>& uart_output,
+                                        const std::vector<uint32_t>& hashes)
+{
+  std::vector<uint8_t> req;
+  for (uint32_t hash : hashes)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      req.push_back(static_cast<uint8_t>((hash >> (i * 8)) & 0xFF));
+    }
+  }
+  const auto resp = transact(link, uart_output, Command::HAVE_WORDS, req.data(), req.size());
+  std::vector<uint16_t> wids;
+  if (resp.size() == 4 + 2 * hashes.size() + 1 &&
+      resp[3] == static_cast<uint8_t>(ErrorCode::OK))
+  {
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+      wids.push_back(static_cast<uint16_t>(resp[4 + 2 * i] | (resp[5 + 2 * i] << 8)));
+    }
+  }
+  return wids;
+}
+
+TEST_CASE("Link resident word cache")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  // : sq dup * ;  : quad sq sq ;  3 quad
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  const std::vector<TestWord> library = {{"sq", sq}, {"quad", quad}};
+  const auto hashes = chain_hashes(library);
+  const auto image = build_v4b(main_code, library);
+  REQUIRE((Link::capabilities() & CAP_WORD_CACHE) != 0);
+
+  SUBCASE("Re-sent words link to the resident copy")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    const size_t used = link.arena_used();
+    CHECK(have_words(link, uart_output, {hashes[0], hashes[1], 0xDEADBEEF}) ==
+          std::vector<uint16_t>{0, 1, 0xFFFF});
+
+    resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 0);  // sq
+    CHECK(resp[7] == 1);  // quad
+    CHECK(resp[9] == 3);  // New main code
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+    CHECK(link.arena_used() == used + main_code.size());
+  }
+
+  SUBCASE("References replace resident words")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    const size_t used = link.arena_used();
+
+    // : oct quad ;  2 oct
+    const std::vector<uint8_t> oct = {0x50, 0x01, 0x00, 0x51};
+    const std::vector<uint8_t> main2 = {
+        0x00, 2, 0x00, 0x00, 0x00,  // LIT 2
+        0x50, 0x02, 0x00,           // CALL 2 (oct)
+        0x51                        // RET
+    };
+    const auto refs = build_v4b_refs(main2, {6}, hashes, {{"oct", oct, {1}}});
+    auto resp = transact(link, uart_output, Command::EXEC, refs.data(), refs.size());
+    REQUIRE(resp.size() == 4 + 1 + 4 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 0);
+    CHECK(resp[7] == 1);
+    CHECK(resp[9] == 3);  // oct follows the first main code
+    CHECK(vm_ds_peek_public(vm, 0) == 16);
+    CHECK(link.arena_used() == used + sizeof("oct") + oct.size() + main2.size());
+  }
+
+  SUBCASE("An unknown reference loads nothing")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const auto refs = build_v4b_refs(main_code, {6}, {hashes[0]});
+    const auto resp = transact(link, uart_output, Command::EXEC, refs.data(), refs.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(vm_get_word(vm, 0) == nullptr);
+    CHECK(link.arena_used() == 0);
+  }
+
+  SUBCASE("The same code after different words is a different word")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+    const std::vector<uint8_t> nop = {0x51};
+    const auto other = build_v4b(main_code, {{"nop", nop}, {"sq", sq}, {"quad", quad}});
+    const auto resp = transact(link, uart_output, Command::EXEC, other.data(), other.size());
+    REQUIRE(resp.size() == 4 + 1 + 4 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[7] == 4);  // sq registered again after nop (3)
+  }
+
+  SUBCASE("A matching hash with different code loads the word anew")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+    // Stand in for a colliding hash: the resident sq no longer matches
+    uint8_t* code = const_cast<uint8_t*>(vm_word_get_code(vm_get_word(vm, 0)));
+    code[1] = 0x10;  // ADD
+    auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 3);  // sq loaded again
+    CHECK(resp[7] == 4);  // quad calls the new sq, so it is loaded again too
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+
+    // The cache still names the first copy, which chunked uploads check too
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    transact(link, uart_output, Command::CHUNK, image.data(), image.size());
+    resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 6);
+    CHECK(resp[7] == 7);
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+  }
+
+  SUBCASE("Chunked uploads use and fill the cache")
+  {
+    Link link(vm, test_uart_write, &uart_output, 8);
+    auto upload = [&](const std::vector<uint8_t>& data)
+    {
+      transact(link, uart_output, Command::BEGIN_UPLOAD);
+      for (size_t off = 0; off < data.size(); off += 5)
+      {
+        const size_t n = std::min<size_t>(5, data.size() - off);
+        transact(link, uart_output, Command::CHUNK, data.data() + off, n);
+      }
+      return transact(link, uart_output, Command::COMMIT);
+    };
+
+    auto resp = upload(image);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    const size_t used = link.arena_used();
+    CHECK(have_words(link, uart_output, {hashes[0], hashes[1]}) ==
+          std::vector<uint16_t>{0, 1});
+
+    // Full copies are dropped as soon as they are recognized
+    resp = upload(image);
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[7] == 1);
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+    CHECK(link.arena_used() == used + main_code.size());
+
+    resp = upload(build_v4b_refs(main_code, {6}, hashes));
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(vm, 0) == 81);
+  }
+
+  // : fwd cube ;  : cube dup sq * ;  2 fwd
+  const std::vector<uint8_t> fwd = {0x50, 0x03, 0x00, 0x51};  // CALL 3 (cube)
+  const std::vector<uint8_t> cube = {0x01, 0x50, 0x00, 0x00, 0x12, 0x51};
+  const std::vector<uint8_t> main_fwd = {
+      0x00, 2, 0x00, 0x00, 0x00,  // LIT 2
+      0x50, 0x02, 0x00,           // CALL 2 (fwd)
+      0x51                        // RET
+  };
+  auto upload_whole = [&](Link& link, const std::vector<uint8_t>& data)
+  {
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    const auto chunk = transact(link, uart_output, Command::CHUNK, data.data(), data.size());
+    REQUIRE(chunk.size() == 5);
+    if (chunk[3] != static_cast<uint8_t>(ErrorCode::OK))
+    {
+      return chunk;
+    }
+    return transact(link, uart_output, Command::COMMIT);
+  };
+
+  SUBCASE("Forward CALLs after resident words link the same in every load path")
+  {
+    const auto image2 = build_v4b(
+        main_fwd, {{"sq", sq}, {"quad", quad}, {"fwd", fwd, {1}}, {"cube", cube, {2}}}, true,
+        {6});
+    for (const bool chunked : {false, true})
+    {
+      vm_reset(vm);
+      Link link(vm, test_uart_write, &uart_output);
+      transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+      // sq and quad are resident, fwd and cube become 3 and 4
+      const auto resp = chunked ? upload_whole(link, image2)
+                                : transact(link, uart_output, Command::EXEC, image2.data(),
+                                           image2.size());
+      REQUIRE(resp.size() == 4 + 1 + 5 * 2 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(resp[5] == 0);
+      CHECK(resp[7] == 1);
+      CHECK(resp[9] == 3);
+      CHECK(resp[11] == 4);
+      CHECK(vm_word_get_code(vm_get_word(vm, 3))[1] == 4);  // fwd calls cube
+      CHECK(vm_ds_peek_public(vm, 0) == 8);
+    }
+  }
+
+  SUBCASE("A forward CALL past a resident entry is refused")
+  {
+    // : fwd cube ;  sq (reference)  : cube dup sq * ;
+    const std::vector<uint8_t> cross = {0x50, 0x02, 0x00, 0x51};  // CALL 2 (cube)
+    auto image2 = build_v4b(main_fwd, {{"fwd", cross, {1}}, {"cube", cube, {2}}}, true, {6});
+    image2[5] = internal::V4B_MINOR_WORD_REF;
+    image2[12] = 3;
+    std::vector<uint8_t> ref = {internal::V4B_WORD_REF};
+    for (int i = 0; i < 4; ++i)
+    {
+      ref.push_back(static_cast<uint8_t>((hashes[0] >> (i * 8)) & 0xFF));
+    }
+    const size_t after_fwd =
+        16 + main_fwd.size() + 2 + 2 + (1 + 3 + 4 + cross.size() + 2 + 2);
+    image2.insert(image2.begin() + after_fwd, ref.begin(), ref.end());
+
+    for (const bool chunked : {false, true})
+    {
+      vm_reset(vm);
+      Link link(vm, test_uart_write, &uart_output);
+      transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+      const auto resp = chunked ? upload_whole(link, image2)
+                                : transact(link, uart_output, Command::EXEC, image2.data(),
+                                           image2.size());
+      REQUIRE(resp.size() == 5);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+    }
+  }
+
+  SUBCASE("A full word cache refuses new words")
+  {
+    Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE,
+              Link::DEFAULT_ARENA_SIZE, nullptr, 0, 2);
+    auto resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    // Resident words still link
+    resp = transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    const size_t used = link.arena_used();
+
+    const std::vector<uint8_t> ret = {0x51};
+    const auto extra = build_v4b(ret, {{"nop", ret}});
+    const auto longer = build_v4b(ret, {{"sq", sq}, {"quad", quad}, {"nop", ret}});
+    for (const auto* refused : {&extra, &longer})
+    {
+      for (const bool chunked : {false, true})
+      {
+        resp = chunked ? upload_whole(link, *refused)
+                       : transact(link, uart_output, Command::EXEC, refused->data(),
+                                  refused->size());
+        REQUIRE(resp.size() == 5);
+        CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+        CHECK(vm_get_word(vm, 4) == nullptr);
+        CHECK(link.arena_used() == used);
+      }
+    }
+  }
+
+  SUBCASE("RESET forgets resident words")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    transact(link, uart_output, Command::RESET);
+    CHECK(have_words(link, uart_output, {hashes[0]}) == std::vector<uint16_t>{0xFFFF});
+  }
+
+  SUBCASE("Malformed HAVE_WORDS")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const uint8_t req[] = {1, 2, 3};
+    const auto resp = transact(link, uart_output, Command::HAVE_WORDS, req, sizeof(req));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+  }
+
+  vm_destroy(vm);
+}
+
+// Send QUERY_WORD_BY_NAME and return the word index (-1: not found)
+static int word_by_name(Link& link, std::vector<uint8_t>& uart_output, const char* name)
+{
+  const auto resp = transact(link, uart_output, Command::QUERY_WORD_BY_NAME,
+                             reinterpret_cast<const uint8_t*>(name), strlen(name));
+  if (resp.size() == 4 + 2 + 1 && resp[3] == static_cast<uint8_t>(ErrorCode::OK))
+  {
+    return resp[4] | (resp[5] << 8);
+  }
+  return -1;
+}
+
+TEST_CASE("Link word name index")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+
+  // : sq dup + ;  3 sq
+  const std::vector<uint8_t> sq2 = {0x01, 0x10, 0x51};
+  const std::vector<uint8_t> main2 = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x00, 0x00,           // CALL 0 (sq)
+      0x51                        // RET
+  };
+  const auto redefine = build_v4b(main2, {{"sq", sq2}});
+
+  SUBCASE("Names of loaded words resolve to their indices")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    CHECK(word_by_name(link, uart_output, "sq") == 0);
+    CHECK(word_by_name(link, uart_output, "quad") == 1);
+    CHECK(link.find_word("quad", 4) == 1);
+    CHECK(link.find_word("qua", 3) == -1);
+
+    auto resp = transact(link, uart_output, Command::QUERY_WORD_BY_NAME,
+                         reinterpret_cast<const uint8_t*>("cube"), 4);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+
+    resp = transact(link, uart_output, Command::QUERY_WORD_BY_NAME);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+  }
+
+  SUBCASE("A redefinition takes over the name and shares its storage")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    const size_t used = link.arena_used();
+
+    const auto resp =
+        transact(link, uart_output, Command::EXEC, redefine.data(), redefine.size());
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 3);  // New sq after the first main code
+    CHECK(vm_ds_peek_public(vm, 0) == 6);
+    CHECK(link.arena_used() == used + sq2.size() + main2.size());
+    CHECK(word_by_name(link, uart_output, "sq") == 3);
+
+    // The old definition keeps its name for QUERY_WORD
+    const uint8_t idx[] = {0, 0};
+    const auto word = transact(link, uart_output, Command::QUERY_WORD, idx, sizeof(idx));
+    REQUIRE(word.size() > 6);
+    CHECK(word[4] == 2);
+    CHECK(std::memcmp(&word[5], "sq", 2) == 0);
+  }
+
+  SUBCASE("A load failing midway gives the names back")
+  {
+    // Measure the dictionary, then leave one free slot after the first image
+    static const uint8_t ret[] = {0x51};
+    int limit = 0;
+    while (vm_register_word(vm, nullptr, ret, 1) >= 0)
+    {
+      ++limit;
+    }
+    vm_reset(vm);
+
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    for (int wid = 3; wid < limit - 1; ++wid)
+    {
+      REQUIRE(vm_register_word(vm, nullptr, ret, 1) == wid);
+    }
+
+    // The new sq takes the last slot and becomes a stub when cube does not fit
+    const auto failing = build_v4b(main2, {{"sq", sq2}, {"cube", {0x51}}});
+    const auto resp =
+        transact(link, uart_output, Command::EXEC, failing.data(), failing.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+    CHECK(word_by_name(link, uart_output, "sq") == 0);
+    CHECK(link.find_word("cube", 4) == -1);
+    CHECK(link.find_word("quad", 4) == 1);
+    const Word* stub = vm_get_word(vm, limit - 1);
+    REQUIRE(stub != nullptr);
+    CHECK(vm_word_get_code_len(stub) == static_cast<int>(sq2.size()));
+    CHECK(vm_word_get_code(stub)[0] == 0x51);
+  }
+
+  SUBCASE("Chunked uploads drop the copy of a known name")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    const size_t used = link.arena_used();
+
+    transact(link, uart_output, Command::BEGIN_UPLOAD);
+    transact(link, uart_output, Command::CHUNK, redefine.data(), redefine.size());
+    const auto resp = transact(link, uart_output, Command::COMMIT);
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(link.arena_used() == used + sq2.size() + main2.size());
+    CHECK(link.find_word("sq", 2) == 3);
+  }
+
+  SUBCASE("An upload failing after its first word gives the name back")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    const size_t used = link.arena_used();
+
+    // : sq cube ;  : cube ... ;  sq is registered before cube arrives
+    const std::vector<uint8_t> fwd = {0x50, 0x01, 0x00, 0x51};
+    const auto upload = build_v4b(main2, {{"sq", fwd}, {"cube", {0x01, 0x12, 0x51}}});
+    const size_t first_word = 16 + main2.size() + 1 + 2 + 4 + fwd.size();
+    std::vector<uint8_t> rest(upload.begin() + first_word, upload.end());
+    internal::store_le32(rest.data() + 1 + 4, 0x00FFFFFF);  // cube CODE_LEN
+
+    for (const bool abandoned : {false, true})
+    {
+      transact(link, uart_output, Command::BEGIN_UPLOAD);
+      auto resp = transact(link, uart_output, Command::CHUNK, upload.data(), first_word);
+      REQUIRE(resp.size() == 5);
+      REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+      REQUIRE(link.find_word("sq", 2) >= 3);
+      const int wid = link.find_word("sq", 2);
+
+      if (abandoned)
+      {
+        transact(link, uart_output, Command::BEGIN_UPLOAD);
+      }
+      else
+      {
+        resp = transact(link, uart_output, Command::CHUNK, rest.data(), rest.size());
+        REQUIRE(resp.size() == 5);
+        CHECK(resp[3] != static_cast<uint8_t>(ErrorCode::OK));
+      }
+      CHECK(word_by_name(link, uart_output, "sq") == 0);
+      CHECK(link.find_word("cube", 4) == -1);
+      const Word* stub = vm_get_word(vm, wid);
+      REQUIRE(stub != nullptr);
+      CHECK(vm_word_get_code(stub)[0] == 0x51);
+      // Main code and the stub are kept, as for every upload before
+      CHECK(link.arena_used() ==
+            used + static_cast<size_t>(wid - 2) * (main2.size() + fwd.size()));
+    }
+  }
+
+  SUBCASE("A full name index refuses new names")
+  {
+    Link link(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE,
+              Link::DEFAULT_ARENA_SIZE, nullptr, 0, 2);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+    // Rebuilt words leave the word cache but keep their names
+    const std::vector<uint8_t> replace = {0x00, 0x00, 0x01, 0x10, 0x51};
+    auto resp =
+        transact(link, uart_output, Command::REPLACE_WORD, replace.data(), replace.size());
+    REQUIRE(resp.size() == 5);
+    REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    const size_t used = link.arena_used();
+
+    const std::vector<uint8_t> ret = {0x51};
+    const auto extra = build_v4b(ret, {{"nop", ret}});
+    for (const bool chunked : {false, true})
+    {
+      if (chunked)
+      {
+        transact(link, uart_output, Command::BEGIN_UPLOAD);
+        resp = transact(link, uart_output, Command::CHUNK, extra.data(), extra.size());
+      }
+      else
+      {
+        resp = transact(link, uart_output, Command::EXEC, extra.data(), extra.size());
+      }
+      REQUIRE(resp.size() == 5);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+      CHECK(vm_get_word(vm, 3) == nullptr);
+      CHECK(link.arena_used() == used);
+      CHECK(link.find_word("nop", 3) == -1);
+    }
+
+    // Known names still load
+    resp = transact(link, uart_output, Command::EXEC, redefine.data(), redefine.size());
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(link.find_word("sq", 2) == 3);
+  }
+
+  SUBCASE("RESET forgets all names")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    transact(link, uart_output, Command::RESET);
+    CHECK(word_by_name(link, uart_output, "sq") == -1);
+    CHECK(link.find_word("quad", 4) == -1);
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link word redefinition")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  // : sq dup * ;  : quad sq sq ;  3 quad
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  const std::vector<TestWord> library = {{"sq", sq}, {"quad", quad}};
+  const auto image = build_v4b(main_code, library);
+  transact(link, uart_output, Command::EXEC, image.data(), image.size());
+  REQUIRE(vm_ds_peek_public(vm, 0) == 81);
+  const size_t loaded = link.arena_used();
+
+  // Run 3 quad again as raw code, returning the top of the stack
+  auto run_quad = [&]()
+  {
+    const auto resp =
+        transact(link, uart_output, Command::EXEC, main_code.data(), main_code.size());
+    REQUIRE(resp.size() == 4 + 3 + 1);
+    REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    return vm_ds_peek_public(vm, 0);
+  };
+  auto replace = [&](uint16_t wid, const std::vector<uint8_t>& code)
+  {
+    std::vector<uint8_t> req = {static_cast<uint8_t>(wid & 0xFF),
+                                static_cast<uint8_t>(wid >> 8)};
+    req.insert(req.end(), code.begin(), code.end());
+    const auto resp =
+        transact(link, uart_output, Command::REPLACE_WORD, req.data(), req.size());
+    REQUIRE(resp.size() == 5);
+    return static_cast<ErrorCode>(resp[3]);
+  };
+  auto forget_from = [&](uint16_t wid)
+  {
+    const uint8_t req[] = {static_cast<uint8_t>(wid & 0xFF), static_cast<uint8_t>(wid >> 8)};
+    const auto resp = transact(link, uart_output, Command::FORGET_FROM, req, sizeof(req));
+    REQUIRE(resp.size() == 5);
+    return static_cast<ErrorCode>(resp[3]);
+  };
+
+  // : sq dup + ;
+  const std::vector<uint8_t> twice = {0x01, 0x10, 0x51};
+  // : sq 1 + dup + ;
+  const std::vector<uint8_t> inc_twice = {
+      0x00, 1, 0x00, 0x00, 0x00,  // LIT 1
+      0x10, 0x01, 0x10, 0x51      // ADD DUP ADD RET
+  };
+
+  SUBCASE("Code that fits replaces the old copy in place")
+  {
+    CHECK(replace(0, twice) == ErrorCode::OK);
+    CHECK(link.arena_used() == loaded);
+    CHECK(run_quad() == 12);  // quad still calls word 0
+    CHECK(link.find_word("sq", 2) == 0);
+    CHECK(vm_word_get_code_len(vm_get_word(vm, 0)) == 3);
+  }
+
+  SUBCASE("Longer code is stored anew")
+  {
+    CHECK(replace(0, inc_twice) == ErrorCode::OK);
+    CHECK(link.arena_used() == loaded + inc_twice.size());
+    CHECK(run_quad() == 18);
+    CHECK(vm_word_get_code_len(vm_get_word(vm, 0)) == static_cast<int>(inc_twice.size()));
+  }
+
+  SUBCASE("Replaced words and their callers leave the word cache")
+  {
+    const auto hashes = chain_hashes(library);
+    CHECK(replace(1, {0x50, 0x00, 0x00, 0x51}) == ErrorCode::OK);
+    CHECK(have_words(link, uart_output, hashes) == std::vector<uint16_t>{0, 0xFFFF});
+    CHECK(run_quad() == 9);
+  }
+
+  SUBCASE("FORGET_FROM releases later words and reuses their indices")
+  {
+    // : cube dup dup * * ;
+    const std::vector<uint8_t> cube = {0x01, 0x01, 0x12, 0x12, 0x51};
+    const std::vector<uint8_t> main2 = {
+        0x00, 2, 0x00, 0x00, 0x00,  // LIT 2
+        0x50, 0x00, 0x00,           // CALL 0 (cube)
+        0x51                        // RET
+    };
+    const auto extra = build_v4b(main2, {{"cube", cube}});
+    auto resp = transact(link, uart_output, Command::EXEC, extra.data(), extra.size());
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    CHECK(resp[5] == 3);
+    CHECK(vm_ds_peek_public(vm, 0) == 8);
+
+    CHECK(forget_from(3) == ErrorCode::OK);
+    CHECK(link.arena_used() == loaded);
+    CHECK(vm_get_word(vm, 3) == nullptr);
+    CHECK(link.find_word("cube", 4) == -1);
+    CHECK(link.find_word("quad", 4) == 1);
+    CHECK(run_quad() == 81);  // Registered as word 3 again
+
+    resp = transact(link, uart_output, Command::EXEC, extra.data(), extra.size());
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    CHECK(resp[5] == 4);
+  }
+
+  SUBCASE("FORGET_FROM keeps the new code of a replaced word")
+  {
+    CHECK(replace(0, inc_twice) == ErrorCode::OK);
+    const size_t replaced = link.arena_used();
+    run_quad();  // Word 3, stored above the new sq
+    CHECK(forget_from(3) == ErrorCode::OK);
+    CHECK(link.arena_used() == replaced);
+    CHECK(run_quad() == 18);
+  }
+
+  SUBCASE("Words registered behind the link's back keep their names")
+  {
+    static const v4_u8 ext_code[] = {0x51};
+    REQUIRE(vm_register_word(vm, "ext", ext_code, sizeof(ext_code)) == 3);
+    CHECK(replace(0, twice) == ErrorCode::OK);
+    CHECK(link.arena_used() == loaded);
+    CHECK(std::strcmp(vm_word_get_name(vm_get_word(vm, 3)), "ext") == 0);
+    CHECK(vm_word_get_code(vm_get_word(vm, 3)) == ext_code);
+    CHECK(link.find_word("ext", 3) == -1);
+    CHECK(link.find_word("sq", 2) == 0);
+
+    CHECK(forget_from(1) == ErrorCode::OK);
+    CHECK(link.arena_used() < loaded);
+    CHECK(vm_get_word(vm, 1) == nullptr);
+  }
+
+  SUBCASE("A rebuild without scratch space changes nothing")
+  {
+    vm_reset(vm);
+    Link tight(vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE, loaded);
+    transact(tight, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(tight.arena_used() == loaded);
+
+    const std::vector<uint8_t> req = {0x00, 0x00, 0x01, 0x10, 0x51};  // : sq dup + ;
+    const auto resp =
+        transact(tight, uart_output, Command::REPLACE_WORD, req.data(), req.size());
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(vm_word_get_code(vm_get_word(vm, 0))[1] == 0x12);
+    CHECK(vm_get_word(vm, 2) != nullptr);
+    CHECK(tight.find_word("quad", 4) == 1);
+  }
+
+  SUBCASE("Unknown or malformed requests change nothing")
+  {
+    CHECK(replace(7, twice) == ErrorCode::VM_ERROR);
+    CHECK(forget_from(7) == ErrorCode::VM_ERROR);
+    const uint8_t short_req[] = {0};
+    auto resp =
+        transact(link, uart_output, Command::FORGET_FROM, short_req, sizeof(short_req));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    resp =
+        transact(link, uart_output, Command::REPLACE_WORD, short_req, sizeof(short_req));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(link.arena_used() == loaded);
+    CHECK(run_quad() == 81);
+  }
+
+  vm_destroy(vm);
+}
+
+// Memory-mapped flash for SAVE_IMAGE tests
+struct TestFlash
+{
+  std::vector<uint8_t> bytes;
+  size_t fail_after = SIZE_MAX;  // Writes accepted before failing
+};
+
+static TestFlash test_flash;
+
+static bool test_storage_write(void*, size_t offset, const uint8_t* data, size_t len)
+{
+  if (data == nullptr)
+  {
+    std::fill(test_flash.bytes.begin(), test_flash.bytes.end(), 0xFF);  // Erase
+    return len <= test_flash.bytes.size();
+  }
+  if (test_flash.fail_after == 0 || offset + len > test_flash.bytes.size())
+  {
+    return false;
+  }
+  --test_flash.fail_after;
+  std::copy(data, data + len, test_flash.bytes.begin() + offset);
+  return true;
+}
+
+TEST_CASE("Link persistent word image")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  uint8_t boot_memory[1024] = {0};
+  VmConfig boot_cfg = {boot_memory, sizeof(boot_memory), nullptr, 0, nullptr};
+  Vm* boot_vm = vm_create(&boot_cfg);
+  REQUIRE(boot_vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  test_flash = TestFlash{};
+  test_flash.bytes.assign(1024, 0xFF);
+
+  // : sq dup * ;  : quad sq sq ;  3 quad
+  const std::vector<uint8_t> sq = {0x01, 0x12, 0x51};
+  const std::vector<uint8_t> quad = {0x50, 0x00, 0x00, 0x50, 0x00, 0x00, 0x51};
+  const std::vector<uint8_t> main_code = {
+      0x00, 3, 0x00, 0x00, 0x00,  // LIT 3
+      0x50, 0x01, 0x00,           // CALL 1 (quad)
+      0x51                        // RET
+  };
+  const auto image = build_v4b(main_code, {{"sq", sq}, {"quad", quad}});
+
+  Link link(vm, test_uart_write, &uart_output);
+  transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+  SUBCASE("Restored words run from flash")
+  {
+    link.set_storage(test_storage_write, test_flash.bytes.data(), test_flash.bytes.size());
+    auto resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 4 + 6 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK((resp[4] | (resp[5] << 8)) == 3);
+    const size_t image_len = resp[6] | (resp[7] << 8);
+    CHECK(image_len > 16);
+    CHECK(image_len <= test_flash.bytes.size());
+
+    Link boot(boot_vm, test_uart_write, &uart_output);
+    boot.set_storage(test_storage_write, test_flash.bytes.data(), test_flash.bytes.size());
+    REQUIRE(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+            ErrorCode::OK);
+    CHECK(boot.arena_used() == 0);
+    const v4_u8* code = vm_word_get_code(vm_get_word(boot_vm, 1));
+    CHECK(code >= test_flash.bytes.data());
+    CHECK(code < test_flash.bytes.data() + image_len);
+    CHECK(std::string(vm_word_get_name(vm_get_word(boot_vm, 1))) == "quad");
+
+    // The word cache comes back too: re-sent words link to the flash copies
+    resp = transact(boot, uart_output, Command::EXEC, image.data(), image.size());
+    REQUIRE(resp.size() == 4 + 1 + 3 * 2 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[5] == 0);
+    CHECK(resp[7] == 1);
+    CHECK(resp[9] == 3);
+    CHECK(vm_ds_peek_public(boot_vm, 0) == 81);
+    CHECK(boot.arena_used() == main_code.size());
+
+    // Saving over code in use is refused
+    resp = transact(boot, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+
+    // Only an empty dictionary can be restored into
+    CHECK(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+          ErrorCode::VM_ERROR);
+  }
+
+  SUBCASE("Unnamed words are saved, main code is stubbed")
+  {
+    // An unnamed word (3), CALLed by the main code after it (4)
+    const std::vector<TestWord> unnamed = {
+        {"", {0x00, 1, 0x00, 0x00, 0x00, 0x10, 0x51}}};  // LIT 1 ADD RET
+    const std::vector<uint8_t> main2 = {
+        0x00, 4, 0x00, 0x00, 0x00,  // LIT 4
+        0x50, 0x00, 0x00,           // CALL 0 (unnamed)
+        0x51                        // RET
+    };
+    const auto image2 = build_v4b(main2, unnamed);
+    auto resp = transact(link, uart_output, Command::EXEC, image2.data(), image2.size());
+    REQUIRE(resp.size() == 4 + 1 + 2 * 2 + 1);
+    REQUIRE(resp[5] == 3);
+    REQUIRE(vm_ds_peek_public(vm, 0) == 5);
+
+    link.set_storage(test_storage_write, test_flash.bytes.data(), test_flash.bytes.size());
+    resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 4 + 6 + 1);
+    CHECK((resp[4] | (resp[5] << 8)) == 5);
+
+    Link boot(boot_vm, test_uart_write, &uart_output);
+    REQUIRE(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+            ErrorCode::OK);
+    CHECK(vm_word_get_code_len(vm_get_word(boot_vm, 2)) == 1);  // Main code stubs
+    CHECK(vm_word_get_code_len(vm_get_word(boot_vm, 4)) == 1);
+    CHECK(vm_word_get_code_len(vm_get_word(boot_vm, 3)) ==
+          static_cast<int>(unnamed[0].code.size()));
+    CHECK(have_words(boot, uart_output, chain_hashes(unnamed)) == std::vector<uint16_t>{3});
+
+    const std::vector<uint8_t> call = {
+        0x00, 4, 0x00, 0x00, 0x00,  // LIT 4
+        0x50, 0x03, 0x00,           // CALL 3 (unnamed)
+        0x51                        // RET
+    };
+    resp = transact(boot, uart_output, Command::EXEC, call.data(), call.size());
+    REQUIRE(resp.size() == 4 + 3 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_ds_peek_public(boot_vm, 0) == 5);
+  }
+
+  SUBCASE("Invalid images are not restored")
+  {
+    Link boot(boot_vm, test_uart_write, &uart_output);
+    CHECK(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+          ErrorCode::GENERAL_ERROR);
+
+    // Interrupted save: the header is never written
+    link.set_storage(test_storage_write, test_flash.bytes.data(), test_flash.bytes.size());
+    test_flash.fail_after = 1;
+    auto resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+          ErrorCode::GENERAL_ERROR);
+
+    // Corrupted body fails the checksum
+    test_flash.fail_after = SIZE_MAX;
+    resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 4 + 6 + 1);
+    test_flash.bytes[20] ^= 0x01;
+    CHECK(boot.restore_image(test_flash.bytes.data(), test_flash.bytes.size()) ==
+          ErrorCode::GENERAL_ERROR);
+    CHECK(vm_get_word(boot_vm, 0) == nullptr);
+  }
+
+  SUBCASE("A registration failing partway leaves nothing behind")
+  {
+    static const uint8_t ret[] = {0x51};
+    uint32_t limit = 0;
+    while (vm_register_word(boot_vm, nullptr, ret, 1) >= 0)
+    {
+      ++limit;
+    }
+    vm_reset(boot_vm);
+
+    // One word more than the dictionary holds; the first is named and hashed
+    std::vector<uint8_t> body;
+    for (uint32_t i = 0; i <= limit; ++i)
+    {
+      const bool first = i == 0;
+      body.insert(body.end(), {static_cast<uint8_t>(first ? 0x01 : 0x00),
+                               static_cast<uint8_t>(first ? 1 : 0), 1, 0, 0, 0,
+                               0x78, 0x56, 0x34, 0x12});
+      if (first)
+      {
+        body.push_back('a');
+      }
+      body.insert(body.end(), {0x00, 0x51});
+    }
+    std::vector<uint8_t> saved = {'V', '4', 'L', 'I', 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    internal::store_le16(saved.data() + 6, static_cast<uint16_t>(limit + 1));
+    internal::store_le32(saved.data() + 8, static_cast<uint32_t>(body.size()));
+    internal::store_le32(saved.data() + 12,
+                         internal::word_hash_update(internal::WORD_HASH_INIT, body.data(),
+                                                    body.size()));
+    saved.insert(saved.end(), body.begin(), body.end());
+
+    Link boot(boot_vm, test_uart_write, &uart_output, MAX_PAYLOAD_SIZE,
+              Link::DEFAULT_ARENA_SIZE, nullptr, 0, limit + 1);
+    CHECK(boot.restore_image(saved.data(), saved.size()) == ErrorCode::VM_ERROR);
+    CHECK(vm_get_word(boot_vm, 0) == nullptr);
+    CHECK(boot.find_word("a", 1) == -1);
+    CHECK(have_words(boot, uart_output, {0x12345678}) == std::vector<uint16_t>{0xFFFF});
+  }
+
+  SUBCASE("SAVE_IMAGE without room")
+  {
+    auto resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));  // No storage
+
+    link.set_storage(test_storage_write, test_flash.bytes.data(), 32);
+    resp = transact(link, uart_output, Command::SAVE_IMAGE);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+  }
+
+  vm_destroy(boot_vm);
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link memory block transfers")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  for (const bool direct : {true, false})
+  {
+    CAPTURE(direct);
+    Link link(vm, test_uart_write, &uart_output);
+    if (direct)
+    {
+      link.set_vm_memory(vm_memory, sizeof(vm_memory));
+    }
+    std::memset(vm_memory, 0, sizeof(vm_memory));
+
+    SUBCASE("Write then read back an unaligned block")
+    {
+      std::vector<uint8_t> req = {0x07, 0x01, 0x00, 0x00};  // ADDR 0x107
+      for (int i = 0; i < 11; ++i)
+      {
+        req.push_back(static_cast<uint8_t>(0xA0 + i));
+      }
+      auto resp = transact(link, uart_output, Command::WRITE_MEM_BLOCK, req.data(),
+                           req.size());
+      REQUIRE(resp.size() == 4 + 2 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(resp[4] == 11);
+      CHECK(vm_memory[0x106] == 0);
+      CHECK(vm_memory[0x107] == 0xA0);
+      CHECK(vm_memory[0x111] == 0xAA);
+      CHECK(vm_memory[0x112] == 0);
+
+      const uint8_t read[] = {0x07, 0x01, 0x00, 0x00, 11, 0x00};
+      resp = transact(link, uart_output, Command::READ_MEM_BLOCK, read, sizeof(read));
+      REQUIRE(resp.size() == 4 + 2 + 11 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(resp[4] == 11);
+      CHECK(resp[5] == 0);
+      CHECK(std::equal(resp.begin() + 6, resp.begin() + 17, req.begin() + 4));
+    }
+
+    SUBCASE("Read past the end returns the in-range prefix")
+    {
+      vm_memory[1020] = 0x5A;
+      const uint8_t read[] = {0xFC, 0x03, 0x00, 0x00, 16, 0x00};  // ADDR 1020
+      const auto resp =
+          transact(link, uart_output, Command::READ_MEM_BLOCK, read, sizeof(read));
+      REQUIRE(resp.size() == 4 + 2 + 4 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+      CHECK(resp[4] == 4);
+      CHECK(resp[6] == 0x5A);
+    }
+
+    SUBCASE("Write past the end stops at the end of memory")
+    {
+      const uint8_t req[] = {0xFE, 0x03, 0x00, 0x00, 1, 2, 3, 4, 5, 6};  // ADDR 1022
+      const auto resp =
+          transact(link, uart_output, Command::WRITE_MEM_BLOCK, req, sizeof(req));
+      REQUIRE(resp.size() == 4 + 2 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+      // The word accessor cannot reach the last 2 bytes
+      CHECK(resp[4] == (direct ? 2 : 0));
+      CHECK(vm_memory[1023] == (direct ? 2 : 0));
+    }
+
+    SUBCASE("Address outside memory transfers nothing")
+    {
+      const uint8_t read[] = {0x00, 0x00, 0x01, 0x00, 4, 0x00};  // ADDR 0x10000
+      const auto resp =
+          transact(link, uart_output, Command::READ_MEM_BLOCK, read, sizeof(read));
+      REQUIRE(resp.size() == 4 + 2 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::VM_ERROR));
+      CHECK(resp[4] == 0);
+    }
+
+    SUBCASE("Block larger than a frame is rejected")
+    {
+      const size_t len = link.mem_block_max() + 1;
+      const uint8_t read[] = {0x00, 0x00, 0x00, 0x00, static_cast<uint8_t>(len & 0xFF),
+                              static_cast<uint8_t>(len >> 8)};
+      auto resp = transact(link, uart_output, Command::READ_MEM_BLOCK, read, sizeof(read));
+      REQUIRE(resp.size() == 5);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+
+      // A full-size block fits both the request and the response frame
+      std::vector<uint8_t> req(4 + link.mem_block_max(), 0x33);
+      std::fill(req.begin(), req.begin() + 4, 0);
+      resp = transact(link, uart_output, Command::WRITE_MEM_BLOCK, req.data(), req.size());
+      REQUIRE(resp.size() == 4 + 2 + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+      const uint8_t full[] = {0x00, 0x00, 0x00, 0x00, static_cast<uint8_t>(len - 1),
+                              static_cast<uint8_t>((len - 1) >> 8)};
+      resp = transact(link, uart_output, Command::READ_MEM_BLOCK, full, sizeof(full));
+      REQUIRE(resp.size() == 4 + 2 + link.mem_block_max() + 1);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    }
+
+    SUBCASE("Truncated request")
+    {
+      const uint8_t read[] = {0x00, 0x00, 0x00, 0x00, 4};
+      const auto resp =
+          transact(link, uart_output, Command::READ_MEM_BLOCK, read, sizeof(read));
+      REQUIRE(resp.size() == 5);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    }
+  }
+
+  vm_destroy(vm);
+}
+
+// Split UART output into frames using their LEN fields
+static std::vector<std::vector<uint8_t>> split_frames(const std::vector<uint8_t>& out)
+{
+  std::vector<std::vector<uint8_t>> frames;
+  size_t i = 0;
+  while (i + 5 <= out.size())
+  {
+    const size_t len = out[i + 1] | (out[i + 2] << 8);
+    const size_t end = i + 3 + len + 1;
+    if (end > out.size())
+    {
+      break;
+    }
+    frames.emplace_back(out.begin() + i, out.begin() + end);
+    i = end;
+  }
+  return frames;
+}
+
+TEST_CASE("Link memory watch")
+{
+  uint8_t vm_memory[4096] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  const uint8_t delta = static_cast<uint8_t>(Event::MEMORY_DELTA);
+
+  auto watch = [&](Link& link, uint8_t id, uint32_t addr, uint16_t len)
+  {
+    const uint8_t req[] = {id,
+                           static_cast<uint8_t>(addr),
+                           static_cast<uint8_t>(addr >> 8),
+                           static_cast<uint8_t>(addr >> 16),
+                           static_cast<uint8_t>(addr >> 24),
+                           static_cast<uint8_t>(len),
+                           static_cast<uint8_t>(len >> 8)};
+    const auto resp = transact(link, uart_output, Command::WATCH_MEMORY, req, sizeof(req));
+    REQUIRE(resp.size() == 5);
+    return static_cast<ErrorCode>(resp[3]);
+  };
+
+  for (const bool direct : {true, false})
+  {
+    CAPTURE(direct);
+    Link link(vm, test_uart_write, &uart_output);
+    if (direct)
+    {
+      link.set_vm_memory(vm_memory, sizeof(vm_memory));
+    }
+    std::memset(vm_memory, 0, sizeof(vm_memory));
+
+    SUBCASE("First poll sends the region, later polls only changed runs")
+    {
+      vm_memory[0x100] = 0x11;
+      REQUIRE(watch(link, 0, 0x100, 64) == ErrorCode::OK);
+
+      uart_output.clear();
+      link.watch_poll();
+      auto frames = split_frames(uart_output);
+      REQUIRE(frames.size() == 1);
+      REQUIRE(frames[0].size() == 4 + 1 + 4 + 64 + 1);
+      CHECK(internal::verify_frame_crc(frames[0].data(), frames[0].size()));
+      CHECK(frames[0][3] == delta);
+      CHECK(frames[0][4] == 0);  // ID
+      CHECK(frames[0][5] == 0);  // OFFSET
+      CHECK(frames[0][7] == 64);  // LEN
+      CHECK(frames[0][9] == 0x11);
+
+      uart_output.clear();
+      link.watch_poll();
+      CHECK(uart_output.empty());
+
+      // 0x105 and 0x107 merge across a 1-byte gap; 0x130 is a separate run
+      vm_memory[0x105] = 1;
+      vm_memory[0x107] = 2;
+      vm_memory[0x130] = 3;
+      link.watch_poll();
+      frames = split_frames(uart_output);
+      REQUIRE(frames.size() == 1);
+      const std::vector<uint8_t> expected = {
+          delta, 0,                 // EVENT, ID
+          5,     0, 3, 0, 1, 0, 2,  // OFFSET 5, LEN 3
+          0x30,  0, 1, 0, 3         // OFFSET 0x30, LEN 1
+      };
+      REQUIRE(frames[0].size() == 3 + expected.size() + 1);
+      CHECK(std::equal(expected.begin(), expected.end(), frames[0].begin() + 3));
+    }
+
+    SUBCASE("EXEC pushes changes after its response")
+    {
+      REQUIRE(watch(link, 1, 0x200, 16) == ErrorCode::OK);
+      link.watch_poll();
+
+      vm_memory[0x20F] = 0x7E;
+      const uint8_t code[] = {0x51};  // RET
+      const auto out = transact(link, uart_output, Command::EXEC, code, sizeof(code));
+      const auto frames = split_frames(out);
+      REQUIRE(frames.size() == 2);
+      CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(frames[1][3] == delta);
+      CHECK(frames[1][4] == 1);
+      CHECK(frames[1][5] == 15);
+      CHECK(frames[1][9] == 0x7E);
+    }
+
+    SUBCASE("tick() polls at the watch interval")
+    {
+      REQUIRE(watch(link, 0, 0, 8) == ErrorCode::OK);
+      link.set_watch_interval(1000);
+
+      uart_output.clear();
+      link.tick(500);
+      CHECK(uart_output.empty());
+      link.tick(1000);
+      CHECK(split_frames(uart_output).size() == 1);
+    }
+
+    SUBCASE("Large changes are split across frames")
+    {
+      REQUIRE(watch(link, 2, 0, static_cast<uint16_t>(MAX_WATCH_BYTES)) == ErrorCode::OK);
+      uart_output.clear();
+      link.watch_poll();
+      const auto frames = split_frames(uart_output);
+      REQUIRE(frames.size() == 2);
+      size_t total = 0;
+      for (const auto& frame : frames)
+      {
+        CHECK(internal::verify_frame_crc(frame.data(), frame.size()));
+        CHECK(frame[3] == delta);
+        CHECK(frame[4] == 2);
+        total += frame[7] | (frame[8] << 8);
+      }
+      CHECK(total == MAX_WATCH_BYTES);
+      CHECK((frames[1][5] | (frames[1][6] << 8)) == (frames[0][7] | (frames[0][8] << 8)));
+    }
+
+    SUBCASE("Invalid subscriptions")
+    {
+      CHECK(watch(link, MAX_WATCH_REGIONS, 0, 8) == ErrorCode::GENERAL_ERROR);
+      CHECK(watch(link, 0, sizeof(vm_memory) - 4, 8) == ErrorCode::VM_ERROR);
+      CHECK(watch(link, 0, 0, static_cast<uint16_t>(MAX_WATCH_BYTES)) == ErrorCode::OK);
+      CHECK(watch(link, 1, 0, 1) == ErrorCode::BUFFER_FULL);
+
+      // Cancelling frees the shadow bytes for other slots
+      CHECK(watch(link, 0, 0, 0) == ErrorCode::OK);
+      CHECK(watch(link, 1, 0, 1) == ErrorCode::OK);
+
+      const uint8_t short_req[] = {0, 0, 0, 0, 0, 8};
+      const auto resp = transact(link, uart_output, Command::WATCH_MEMORY, short_req,
+                                 sizeof(short_req));
+      REQUIRE(resp.size() == 5);
+      CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    }
+
+    SUBCASE("Cancelled slot stops pushing, others keep their shadow")
+    {
+      REQUIRE(watch(link, 0, 0x000, 8) == ErrorCode::OK);
+      REQUIRE(watch(link, 1, 0x100, 8) == ErrorCode::OK);
+      link.watch_poll();
+      REQUIRE(watch(link, 0, 0, 0) == ErrorCode::OK);
+
+      vm_memory[0x000] = 1;
+      vm_memory[0x101] = 2;
+      uart_output.clear();
+      link.watch_poll();
+      const auto frames = split_frames(uart_output);
+      REQUIRE(frames.size() == 1);
+      CHECK(frames[0][4] == 1);
+      CHECK(frames[0][5] == 1);
+      CHECK(frames[0][9] == 2);
+    }
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link capability negotiation")
+{
+  uint8_t vm_memory[4096] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+
+  SUBCASE("Empty PING is a plain ACK")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const auto resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Capability block in stop-and-wait mode")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const uint8_t req[] = {0, PING_FLAG_CAPABILITIES};
+    auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+    REQUIRE(resp.size() == 4 + 1 + CAPABILITY_BLOCK_SIZE + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 0);  // WINDOW_ACCEPTED
+
+    const uint8_t* caps = resp.data() + 5;
+    CHECK(caps[0] == PROTOCOL_VERSION);
+    CHECK(caps[1] == static_cast<uint8_t>(CrcType::CRC8));
+    CHECK((caps[2] | (caps[3] << 8)) == Link::capabilities());
+    CHECK((caps[4] | (caps[5] << 8)) == MAX_PAYLOAD_SIZE);
+    CHECK((caps[6] | (caps[7] << 8)) == link.max_response());
+    CHECK(caps[8] == MAX_WINDOW_SIZE);
+
+    // Still stop-and-wait: the next response carries no SEQ
+    resp = transact(link, uart_output, Command::PING);
+    CHECK(resp.size() == 5);
+  }
+
+  SUBCASE("Capability block alongside a window request")
+  {
+    Link link(vm, test_uart_write, &uart_output);
+    const uint8_t req[] = {4, PING_FLAG_CAPABILITIES};
+    const auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+    REQUIRE(resp.size() == 4 + 1 + CAPABILITY_BLOCK_SIZE + 1);
+    CHECK(resp[4] == 4);
+    CHECK((resp[5 + 2] & CAP_WINDOW) != 0);  // CAPS_L
+  }
+
+  SUBCASE("Larger buffers advertise and accept larger frames")
+  {
+    Link link(vm, test_uart_write, &uart_output, 4096);
+    const uint8_t req[] = {0, PING_FLAG_CAPABILITIES};
+    auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+    REQUIRE(resp.size() == 4 + 1 + CAPABILITY_BLOCK_SIZE + 1);
+    const size_t max_payload = resp[9] | (resp[10] << 8);
+    CHECK(max_payload == 4096);
+
+    std::vector<uint8_t> data(4 + 3000, 0x5C);
+    std::fill(data.begin(), data.begin() + 4, 0);
+    std::vector<uint8_t> frame;
+    CHECK_FALSE(internal::encode_frame(Command::WRITE_MEM_BLOCK, data.data(), data.size(),
+                                       frame));
+    REQUIRE(internal::encode_frame(Command::WRITE_MEM_BLOCK, data.data(), data.size(),
+                                   frame, max_payload));
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+    REQUIRE(uart_output.size() == 4 + 2 + 1);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(vm_memory[2999] == 0x5C);
+  }
+
+  SUBCASE("Buffers beyond the LEN field are clamped")
+  {
+    Link link(vm, test_uart_write, &uart_output, 100000);
+    CHECK(link.max_payload() <= MAX_FRAME_PAYLOAD);
+    CHECK(link.max_response() <= MAX_FRAME_PAYLOAD);
+  }
+
+  vm_destroy(vm);
+}
+
+// Append one [CMD][LEN (2 bytes)][DATA...] BATCH sub-command
+static void put_sub(std::vector<uint8_t>& batch, Command cmd, std::vector<uint8_t> data = {})
+{
+  batch.push_back(static_cast<uint8_t>(cmd));
+  batch.push_back(static_cast<uint8_t>(data.size() & 0xFF));
+  batch.push_back(static_cast<uint8_t>(data.size() >> 8));
+  batch.insert(batch.end(), data.begin(), data.end());
+}
+
+TEST_CASE("Link batch command")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  link.set_vm_memory(vm_memory, sizeof(vm_memory));
+  CHECK((Link::capabilities() & CAP_BATCH) != 0);
+
+  SUBCASE("Sub-commands run in order with one combined response")
+  {
+    std::vector<uint8_t> batch;
+    put_sub(batch, Command::EXEC, {0x00, 42, 0x00, 0x00, 0x00, 0x51});  // LIT 42 RET
+    put_sub(batch, Command::QUERY_STACK);
+    put_sub(batch, Command::WRITE_MEM_BLOCK, {0x10, 0x00, 0x00, 0x00, 0xBE, 0xEF});
+    put_sub(batch, Command::READ_MEM_BLOCK, {0x10, 0x00, 0x00, 0x00, 2, 0});
+
+    const auto resp = transact(link, uart_output, Command::BATCH, batch.data(), batch.size());
+    REQUIRE(resp.size() == split_frames(resp)[0].size());  // A single frame
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 4);  // COUNT
+
+    // EXEC: [COUNT][WORD_IDX]
+    size_t at = 5;
+    CHECK(resp[at] == static_cast<uint8_t>(ErrorCode::OK));
+    REQUIRE((resp[at + 1] | (resp[at + 2] << 8)) == 3);
+    CHECK(resp[at + 3] == 1);
+    at += 3 + 3;
+
+    // QUERY_STACK sees what EXEC pushed
+    CHECK(resp[at] == static_cast<uint8_t>(ErrorCode::OK));
+    REQUIRE((resp[at + 1] | (resp[at + 2] << 8)) == 1 + 4 + 1);
+    CHECK(resp[at + 3] == 1);
+    CHECK(resp[at + 4] == 42);
+    at += 3 + 6;
+
+    // WRITE_MEM_BLOCK then READ_MEM_BLOCK of the same bytes
+    CHECK(resp[at] == static_cast<uint8_t>(ErrorCode::OK));
+    REQUIRE((resp[at + 1] | (resp[at + 2] << 8)) == 2);
+    CHECK(resp[at + 3] == 2);
+    at += 3 + 2;
+    CHECK(resp[at] == static_cast<uint8_t>(ErrorCode::OK));
+    REQUIRE((resp[at + 1] | (resp[at + 2] << 8)) == 2 + 2);
+    CHECK(resp[at + 5] == 0xBE);
+    CHECK(resp[at + 6] == 0xEF);
+    at += 3 + 4;
+
+    CHECK(at + 1 == resp.size());  // Only the CRC remains
+  }
+
+  SUBCASE("Failures are per sub-command")
+  {
+    std::vector<uint8_t> batch;
+    put_sub(batch, Command::PING);                    // Not allowed in a batch
+    put_sub(batch, Command::READ_MEM_BLOCK, {0x00});  // Too short
+    put_sub(batch, Command::QUERY_STACK);
+
+    const auto resp = transact(link, uart_output, Command::BATCH, batch.data(), batch.size());
+    REQUIRE(resp.size() >= 4 + 1 + 3 * 3 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 3);
+    CHECK(resp[5] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+    CHECK(resp[8] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(resp[11] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("A truncated sub-command stops the batch")
+  {
+    std::vector<uint8_t> batch;
+    put_sub(batch, Command::QUERY_STACK);
+    put_sub(batch, Command::RESET);
+    batch.push_back(static_cast<uint8_t>(Command::QUERY_STACK));
+    batch.push_back(10);  // LEN runs past the frame
+    batch.push_back(0);
+
+    const auto resp = transact(link, uart_output, Command::BATCH, batch.data(), batch.size());
+    REQUIRE(resp.size() > 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(resp[4] == 2);  // Results before the bad header are kept
+  }
+
+  SUBCASE("A full response stops the batch")
+  {
+    std::vector<uint8_t> batch;
+    for (int i = 0; i < 8; ++i)
+    {
+      put_sub(batch, Command::QUERY_MEMORY, {0x00, 0x00, 0x00, 0x00, 0x00, 0x01});
+    }
+
+    const auto resp = transact(link, uart_output, Command::BATCH, batch.data(), batch.size());
+    REQUIRE(resp.size() > 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    const size_t count = resp[4];
+    CHECK(count > 0);
+    CHECK(count < 8);
+    CHECK(resp.size() == 4 + 1 + count * (3 + 256) + 1);
+  }
+
+  SUBCASE("Empty batch")
+  {
+    const auto resp = transact(link, uart_output, Command::BATCH);
+    REQUIRE(resp.size() == 4 + 1 + 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 0);
+  }
+
+  vm_destroy(vm);
+}
+
+// Encode a windowed-mode frame: SEQ prepended to DATA
+static std::vector<uint8_t> encode_seq_frame(Command cmd, uint8_t seq,
+                                             const std::vector<uint8_t>& data = {})
+{
+  std::vector<uint8_t> payload = {seq};
+  payload.insert(payload.end(), data.begin(), data.end());
+  std::vector<uint8_t> frame;
+  internal::encode_frame(cmd, payload.data(), payload.size(), frame);
+  return frame;
+}
+
+TEST_CASE("Link windowed mode")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  // Negotiate a window of 4 frames
+  const uint8_t window = 4;
+  auto resp = transact(link, uart_output, Command::PING, &window, 1);
+  REQUIRE(resp.size() == 6);
+  CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  CHECK(resp[4] == 4);
+
+  const std::vector<uint8_t> lit1 = {0x00, 1, 0x00, 0x00, 0x00, 0x51};  // LIT 1, RET
+
+  SUBCASE("Pipelined frames are answered in order with SEQ")
+  {
+    std::vector<uint8_t> stream;
+    for (uint8_t seq = 0; seq < 3; ++seq)
+    {
+      const auto frame = encode_seq_frame(Command::EXEC, seq, lit1);
+      stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+
+    // Each EXEC response: header + SEQ + count + idx + CRC = 9 bytes
+    REQUIRE(uart_output.size() == 3 * 9);
+    for (uint8_t seq = 0; seq < 3; ++seq)
+    {
+      const uint8_t* r = uart_output.data() + seq * 9;
+      CHECK(r[3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(r[4] == seq);
+      CHECK(internal::verify_frame_crc(r, 9));
+    }
+    CHECK(vm_ds_depth_public(vm) == 3);
+  }
+
+  SUBCASE("Lost frame triggers a single NAK and go-back-N")
+  {
+    auto f0 = encode_seq_frame(Command::EXEC, 0, lit1);
+    auto f1 = encode_seq_frame(Command::EXEC, 1, lit1);
+    auto f2 = encode_seq_frame(Command::EXEC, 2, lit1);
+    auto bad0 = f0;
+    REQUIRE(!bad0.empty());
+    bad0.back() ^= 0xFF;
+
+    std::vector<uint8_t> stream = bad0;
+    stream.insert(stream.end(), f1.begin(), f1.end());
+    stream.insert(stream.end(), f2.begin(), f2.end());
+
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+
+    // One NAK asking to resend from SEQ 0; f1/f2 dropped
+    REQUIRE(uart_output.size() == 6);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(uart_output[4] == 0);
+    CHECK(vm_ds_depth_public(vm) == 0);
+
+    // Host goes back to SEQ 0
+    stream = f0;
+    stream.insert(stream.end(), f1.begin(), f1.end());
+    stream.insert(stream.end(), f2.begin(), f2.end());
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+    REQUIRE(uart_output.size() == 3 * 9);
+    CHECK(uart_output[2 * 9 + 4] == 2);
+    CHECK(vm_ds_depth_public(vm) == 3);
+
+    // Duplicate of SEQ 2 is acknowledged but not executed again
+    uart_output.clear();
+    link.feed(f2.data(), f2.size());
+    REQUIRE(uart_output.size() == 6);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(uart_output[4] == 2);
+    CHECK(vm_ds_depth_public(vm) == 3);
+  }
+
+  SUBCASE("PING with window 0 returns to stop-and-wait")
+  {
+    const auto frame = encode_seq_frame(Command::PING, 0, {0});
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+    REQUIRE(uart_output.size() == 7);
+    CHECK(uart_output[5] == 0);
+
+    resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link resync and receive timeout")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+
+  std::vector<uint8_t> ping;
+  internal::encode_frame(Command::PING, nullptr, 0, ping);
+
+  SUBCASE("Frame hidden inside a corrupted frame is recovered")
+  {
+    // Corrupted header claims 5 payload bytes, swallowing a whole PING
+    std::vector<uint8_t> stream = {0xA5, 0x05, 0x00, 0x10};
+    stream.insert(stream.end(), ping.begin(), ping.end());
+    stream.push_back(0x00);  // Bogus CRC
+
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+
+    REQUIRE(uart_output.size() == 10);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(uart_output[8] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Partial frame after a rejected one keeps receiving")
+  {
+    // Rejected frame's payload and CRC are the start of a PING
+    std::vector<uint8_t> stream = {0xA5, 0x02, 0x00, 0x10};
+    stream.insert(stream.end(), ping.begin(), ping.begin() + 3);
+
+    uart_output.clear();
+    for (uint8_t byte : stream)
+    {
+      link.feed_byte(byte);
+    }
+    REQUIRE(uart_output.size() == 5);  // NAK only
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+
+    uart_output.clear();
+    link.feed(ping.data() + 3, ping.size() - 3);
+    REQUIRE(uart_output.size() == 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Oversized LEN resyncs to the next frame")
+  {
+    std::vector<uint8_t> stream = {0xA5, 0xFF, 0xFF};
+    stream.insert(stream.end(), ping.begin(), ping.end());
+
+    uart_output.clear();
+    link.feed(stream.data(), stream.size());
+    REQUIRE(uart_output.size() == 10);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+    CHECK(uart_output[8] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Stalled frame times out")
+  {
+    link.set_rx_timeout(1000);
+    link.tick(0);
+
+    uart_output.clear();
+    link.feed(ping.data(), 2);
+    link.tick(500);
+    link.tick(1400);
+    CHECK(uart_output.empty());  // Progress at 500 restarted the timer
+
+    link.tick(2600);
+    REQUIRE(uart_output.size() == 5);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+
+    // Idle link never times out; next frame is handled normally
+    link.tick(100000);
+    const auto resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Timer wraparound")
+  {
+    link.set_rx_timeout(1000);
+    link.feed(ping.data(), 2);
+    link.tick(0xFFFFFF00u);
+    uart_output.clear();
+    link.tick(0x00000100u);  // 512 us later
+    CHECK(uart_output.empty());
+    link.tick(0x00000400u);
+    CHECK(uart_output.size() == 5);
+  }
+
+  vm_destroy(vm);
+}
+
+TEST_CASE("Link COBS framing")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  CHECK((Link::capabilities() & CAP_COBS) != 0);
+
+  // The switch is answered in STX framing
+  const uint8_t req[] = {0, PING_FLAG_COBS};
+  auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+  REQUIRE(resp.size() == 6);
+  CHECK(resp[0] == STX);
+  CHECK(resp[4] == 0);
+
+  std::vector<uint8_t> frame;
+  internal::encode_frame(Command::PING, nullptr, 0, frame);
+  const auto ping = cobs_frame(frame);
+
+  SUBCASE("Frames and responses are COBS-encoded")
+  {
+    // LIT 0, LIT 0xA5, RET: zeros and STX inside the payload
+    const uint8_t code[] = {0x00, 0, 0, 0, 0, 0x00, 0xA5, 0, 0, 0, 0x51};
+    internal::encode_frame(Command::EXEC, code, sizeof(code), frame);
+    std::vector<uint8_t> wire = cobs_frame(frame);
+    internal::encode_frame(Command::QUERY_STACK, nullptr, 0, frame);
+    const auto query = cobs_frame(frame);
+    wire.insert(wire.end(), query.begin(), query.end());
+
+    uart_output.clear();
+    link.feed(wire.data(), wire.size());
+    const auto frames = cobs_frames(uart_output);
+    REQUIRE(frames.size() == 2);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+    REQUIRE(frames[1].size() == 4 + 1 + 8 + 1 + 1);
+    CHECK(frames[1][4] == 2);                              // DS_DEPTH
+    CHECK(internal::load_le32(frames[1].data() + 5) == 0);  // Bottom first
+    CHECK(internal::load_le32(frames[1].data() + 9) == 0xA5);
+  }
+
+  SUBCASE("Byte-at-a-time reception")
+  {
+    uart_output.clear();
+    for (const uint8_t byte : ping)
+    {
+      link.feed_byte(byte);
+    }
+    const auto frames = cobs_frames(uart_output);
+    REQUIRE(frames.size() == 1);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Corruption resyncs at the next delimiter")
+  {
+    std::vector<uint8_t> wire = {0x00, 0x00};  // Idle delimiters are ignored
+    std::vector<uint8_t> bad = ping;
+    bad[2] ^= 0x40;  // CRC mismatch
+    wire.insert(wire.end(), bad.begin(), bad.end());
+    wire.insert(wire.end(), {0x05, 0xA5, 0x00});  // Cut short by the delimiter
+    wire.insert(wire.end(), ping.begin(), ping.end());
+
+    uart_output.clear();
+    link.feed(wire.data(), wire.size());
+    const auto frames = cobs_frames(uart_output);
+    REQUIRE(frames.size() == 3);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(frames[1][3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+    CHECK(frames[2][3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Oversized frame is refused")
+  {
+    std::vector<uint8_t> data(MAX_PAYLOAD_SIZE + 8, 0x11);
+    std::vector<uint8_t> raw = {STX, 0, 0, static_cast<uint8_t>(Command::PING)};
+    raw.insert(raw.end(), data.begin(), data.end());
+    raw.push_back(0);
+    const auto wire = cobs_frame(raw);
+
+    uart_output.clear();
+    link.feed(wire.data(), wire.size());
+    auto frames = cobs_frames(uart_output);
+    REQUIRE(frames.size() == 1);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::BUFFER_FULL));
+
+    uart_output.clear();
+    link.feed(ping.data(), ping.size());
+    frames = cobs_frames(uart_output);
+    REQUIRE(frames.size() == 1);
+    CHECK(frames[0][3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("Windowed mode and the way back to STX framing")
+  {
+    const uint8_t windowed[] = {4, PING_FLAG_COBS};
+    internal::encode_frame(Command::PING, windowed, sizeof(windowed), frame);
+    std::vector<uint8_t> wire = cobs_frame(frame);
+    const uint8_t seq = 0;
+    internal::encode_frame(Command::PING, &seq, 1, frame);
+    const auto seq_ping = cobs_frame(frame);
+    wire.insert(wire.end(), seq_ping.begin(), seq_ping.end());
+
+    // Back to STX framing, sent in the same buffer as the plain PING after it
+    const uint8_t legacy[] = {1, 0, 0};  // [SEQ][WINDOW][FLAGS]
+    internal::encode_frame(Command::PING, legacy, sizeof(legacy), frame);
+    const auto back = cobs_frame(frame);
+    wire.insert(wire.end(), back.begin(), back.end());
+    internal::encode_frame(Command::PING, nullptr, 0, frame);
+    wire.insert(wire.end(), frame.begin(), frame.end());
+
+    uart_output.clear();
+    link.feed(wire.data(), wire.size());
+    const size_t legacy_start = uart_output.size() - 5;
+    const auto frames = cobs_frames(
+        std::vector<uint8_t>(uart_output.begin(), uart_output.begin() + legacy_start));
+    REQUIRE(frames.size() == 3);
+    CHECK(frames[1].size() == 4 + 1 + 1);  // [ERR_CODE][SEQ]
+    CHECK(frames[1][4] == 0);
+    CHECK(frames[2][4] == 1);
+    CHECK(uart_output[legacy_start] == STX);
+    CHECK(uart_output[legacy_start + 3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  vm_destroy(vm);
+}
+
+#if V4LINK_ENABLE_WIDE_CRC
+TEST_CASE("Link wide frame check")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  CHECK((Link::capabilities() & (CAP_CRC16 | CAP_CRC32C)) == (CAP_CRC16 | CAP_CRC32C));
+
+  std::vector<uint8_t> frame;
+  auto send = [&](Command cmd, const uint8_t* data, size_t len, CrcType check)
+  {
+    internal::encode_frame(cmd, data, len, frame, MAX_PAYLOAD_SIZE, check);
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+  };
+
+  SUBCASE("CRC-16 from the frame after the PING")
+  {
+    // The switch is answered with CRC-8 and reports the new check
+    const uint8_t req[] = {0, PING_FLAG_CAPABILITIES,
+                           static_cast<uint8_t>(CrcType::CRC16_CCITT)};
+    auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+    REQUIRE(resp.size() == 4 + 1 + CAPABILITY_BLOCK_SIZE + 1);
+    CHECK(internal::verify_frame_crc(resp.data(), resp.size()));
+    CHECK(resp[5 + 1] == static_cast<uint8_t>(CrcType::CRC16_CCITT));
+
+    send(Command::PING, nullptr, 0, CrcType::CRC16_CCITT);
+    REQUIRE(uart_output.size() == 4 + 2);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(internal::verify_frame_crc(uart_output.data(), uart_output.size(),
+                                     CrcType::CRC16_CCITT));
+
+    // Byte-at-a-time reception of a frame with a payload
+    const uint8_t code[] = {0x00, 7, 0, 0, 0, 0x51};  // LIT 7, RET
+    internal::encode_frame(Command::EXEC, code, sizeof(code), frame, MAX_PAYLOAD_SIZE,
+                           CrcType::CRC16_CCITT);
+    uart_output.clear();
+    for (const uint8_t byte : frame)
+    {
+      link.feed_byte(byte);
+    }
+    REQUIRE(uart_output.size() >= 4 + 2);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    // A CRC-8 frame no longer passes: one byte short, then a mismatch
+    resp = transact(link, uart_output, Command::PING);
+    CHECK(resp.empty());
+    const uint8_t pad = 0;
+    link.feed(&pad, 1);
+    REQUIRE(uart_output.size() == 4 + 2);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+  }
+
+  SUBCASE("CRC-32C in windowed mode")
+  {
+    const uint8_t req[] = {4, 0, static_cast<uint8_t>(CrcType::CRC32C)};
+    transact(link, uart_output, Command::PING, req, sizeof(req));
+
+    const uint8_t seq = 0;
+    send(Command::PING, &seq, 1, CrcType::CRC32C);
+    REQUIRE(uart_output.size() == 4 + 1 + 4);  // [ERR_CODE][SEQ]
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(internal::verify_frame_crc(uart_output.data(), uart_output.size(),
+                                     CrcType::CRC32C));
+
+    // One flipped payload bit is refused
+    const uint8_t next = 1;
+    internal::encode_frame(Command::PING, &next, 1, frame, MAX_PAYLOAD_SIZE,
+                           CrcType::CRC32C);
+    frame[4] ^= 0x80;
+    uart_output.clear();
+    link.feed(frame.data(), frame.size());
+    REQUIRE(uart_output.size() >= 4 + 4);
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::INVALID_FRAME));
+  }
+
+  SUBCASE("CRC-32C under COBS framing")
+  {
+    const uint8_t req[] = {0, PING_FLAG_COBS, static_cast<uint8_t>(CrcType::CRC32C)};
+    transact(link, uart_output, Command::PING, req, sizeof(req));
+
+    internal::encode_frame(Command::PING, nullptr, 0, frame, MAX_PAYLOAD_SIZE,
+                           CrcType::CRC32C);
+    const auto wire = cobs_frame(frame);
+    uart_output.clear();
+    link.feed(wire.data(), wire.size());
+    REQUIRE(!uart_output.empty());
+    CHECK(uart_output.back() == internal::COBS_DELIMITER);
+
+    const std::vector<uint8_t> encoded(uart_output.begin(), uart_output.end() - 1);
+    std::vector<uint8_t> decoded;
+    REQUIRE(cobs_decode(encoded, encoded.size() + 1, decoded) ==
+            internal::CobsStatus::FRAME);
+    decoded.insert(decoded.begin(), STX);
+    REQUIRE(decoded.size() == 4 + 4);
+    CHECK(decoded[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(internal::verify_frame_crc(decoded.data(), decoded.size(), CrcType::CRC32C));
+  }
+
+  SUBCASE("Unknown check types are refused")
+  {
+    const uint8_t req[] = {4, 0, 0x7F};
+    auto resp = transact(link, uart_output, Command::PING, req, sizeof(req));
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+
+    // Nothing changed: still stop-and-wait with CRC-8
+    resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  SUBCASE("A PING without the CRC byte returns to CRC-8")
+  {
+    const uint8_t req[] = {0, 0, static_cast<uint8_t>(CrcType::CRC16_CCITT)};
+    transact(link, uart_output, Command::PING, req, sizeof(req));
+
+    const uint8_t window = 0;
+    send(Command::PING, &window, 1, CrcType::CRC16_CCITT);
+    REQUIRE(uart_output.size() == 4 + 1 + 2);  // Still CRC-16
+    CHECK(uart_output[3] == static_cast<uint8_t>(ErrorCode::OK));
+
+    const auto resp = transact(link, uart_output, Command::PING);
+    REQUIRE(resp.size() == 5);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  }
+
+  vm_destroy(vm);
+}
+#endif
+
+#if V4LINK_ENABLE_STATS || V4LINK_ENABLE_TRACE
+static uint32_t test_clock;
+
+// Every call advances the clock, so each handler takes 10 ticks
+static uint32_t test_timestamp(void*)
+{
+  test_clock += 10;
+  return test_clock;
+}
+#endif
+
+#if V4LINK_ENABLE_STATS
+TEST_CASE("Link statistics")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  link.set_timestamp(test_timestamp);
+
+  // Line noise, a frame with a bad CRC, two PINGs and an EXEC
+  std::vector<uint8_t> stream = {0x00, 0x11};
+  std::vector<uint8_t> frame;
+  internal::encode_frame(Command::PING, nullptr, 0, frame);
+  frame.back() ^= 0xFF;
+  stream.insert(stream.end(), frame.begin(), frame.end());
+  internal::encode_frame(Command::PING, nullptr, 0, frame);
+  stream.insert(stream.end(), frame.begin(), frame.end());
+  stream.insert(stream.end(), frame.begin(), frame.end());
+  const uint8_t code[] = {0x00, 7, 0, 0, 0, 0x51};  // LIT 7, RET
+  internal::encode_frame(Command::EXEC, code, sizeof(code), frame);
+  stream.insert(stream.end(), frame.begin(), frame.end());
+  link.feed(stream.data(), stream.size());
+  const size_t tx_total = uart_output.size();
+
+  auto resp = transact(link, uart_output, Command::QUERY_STATS);
+  REQUIRE(resp.size() >= 5);
+  REQUIRE(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  const uint8_t* p = resp.data() + 4;
+  const auto u32 = [&p]()
+  {
+    const uint32_t value = internal::load_le32(p);
+    p += 4;
+    return value;
+  };
+
+  CHECK(u32() == stream.size() + 5);  // QUERY_STATS frame included
+  CHECK(u32() == tx_total);
+  CHECK(u32() == 2);  // RX_DROPPED
+  CHECK(u32() == 1);  // CRC_ERRORS
+  CHECK(u32() == 0);  // RX_OVERRUNS
+  CHECK(u32() == link.arena_peak());
+  CHECK(link.arena_peak() > 0);
+  CHECK(u32() == 0);  // UNTRACKED
+
+  REQUIRE(*p++ == internal::ERROR_CODE_COUNT);
+  CHECK(u32() == 3);  // OK
+  u32();
+  CHECK(u32() == 1);  // INVALID_FRAME
+  p += 4 * (internal::ERROR_CODE_COUNT - 3);
+
+  // [CMD][FRAMES][TOTAL_TIME (8 bytes)][MAX_TIME], in order of first use
+  REQUIRE(*p++ == 2);
+  CHECK(*p++ == static_cast<uint8_t>(Command::PING));
+  CHECK(u32() == 2);
+  CHECK(u32() == 20);
+  CHECK(u32() == 0);
+  CHECK(u32() == 10);
+  CHECK(*p++ == static_cast<uint8_t>(Command::EXEC));
+  CHECK(u32() == 1);
+  CHECK(u32() == 10);
+  p += 8;
+  CHECK(p == resp.data() + resp.size() - 1);
+
+  SUBCASE("Reset flag clears after the report")
+  {
+    const uint8_t flags = STATS_FLAG_RESET;
+    transact(link, uart_output, Command::QUERY_STATS, &flags, 1);
+    CHECK(link.stats().tx_bytes() == 0);
+
+    resp = transact(link, uart_output, Command::QUERY_STATS);
+    p = resp.data() + 4;
+    CHECK(u32() == 5);  // This request only
+    CHECK(u32() == 0);
+    CHECK(u32() == 0);
+    CHECK(u32() == 0);
+    p += 4 * 3 + 1 + 4 * internal::ERROR_CODE_COUNT;
+    REQUIRE(*p++ == 1);  // The resetting request
+    CHECK(*p++ == static_cast<uint8_t>(Command::QUERY_STATS));
+    CHECK(u32() == 1);
+  }
+
+  vm_destroy(vm);
+}
+#endif
+
+#if V4LINK_ENABLE_TRACE
+TEST_CASE("Link event trace")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  link.set_timestamp(test_timestamp);
+  test_clock = 0;
+
+  // LIT 3, CALL sq, RET with sq = DUP MUL RET
+  const auto image = build_v4b({0x00, 3, 0, 0, 0, 0x50, 0x00, 0x00, 0x51},
+                               {{"sq", {0x01, 0x12, 0x51}}});
+  struct Expected
+  {
+    TraceEvent event;
+    uint32_t arg;
+  };
+  const Expected exec_trace[] = {
+      {TraceEvent::FRAME_START, 0},   {TraceEvent::FRAME_CRC, 1},
+      {TraceEvent::WORD_REGISTER, 0}, {TraceEvent::RELOCATE, 1},
+      {TraceEvent::WORD_REGISTER, 1}, {TraceEvent::EXEC_START, 1},
+      {TraceEvent::EXEC_END, 0},      {TraceEvent::RESPONSE, 0},
+      {TraceEvent::FRAME_END, static_cast<uint8_t>(Command::EXEC)},
+      {TraceEvent::FRAME_START, 0},   {TraceEvent::FRAME_CRC, 1},  // DUMP_TRACE
+  };
+
+  // Every value here is below 0x80, so each record is 3 bytes
+  const auto check_dump = [](const std::vector<uint8_t>& resp, const Expected* expected,
+                             size_t count, uint32_t lost)
+  {
+    REQUIRE(resp.size() == 5 + 9 + 3 * count);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+    CHECK(resp[4] == 0);  // Drained; its own response comes after the check
+    CHECK(internal::load_le32(resp.data() + 9) == lost);
+    uint32_t time = internal::load_le32(resp.data() + 5);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const uint8_t* rec = resp.data() + 13 + 3 * i;
+      CHECK(rec[0] == static_cast<uint8_t>(expected[i].event));
+      CHECK(rec[2] == expected[i].arg);
+      time += rec[1];
+    }
+    CHECK(time <= test_clock);
+  };
+
+  SUBCASE("Off without a buffer")
+  {
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    const auto resp = transact(link, uart_output, Command::DUMP_TRACE);
+    REQUIRE(resp.size() == 5 + 9);
+    CHECK(resp[4] == 0);
+  }
+
+  SUBCASE("Load and run of one EXEC")
+  {
+    uint8_t buffer[256];
+    link.set_trace_buffer(buffer, sizeof(buffer));
+
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    check_dump(transact(link, uart_output, Command::DUMP_TRACE), exec_trace, 11, 0);
+
+    // Next dump continues with the end of the previous one
+    const auto resp = transact(link, uart_output, Command::DUMP_TRACE);
+    REQUIRE(resp.size() == 5 + 9 + 3 * 4);
+    CHECK(resp[13] == static_cast<uint8_t>(TraceEvent::RESPONSE));
+    CHECK(resp[16] == static_cast<uint8_t>(TraceEvent::FRAME_END));
+    CHECK(resp[18] == static_cast<uint8_t>(Command::DUMP_TRACE));
+  }
+
+  SUBCASE("Full buffer keeps the newest records")
+  {
+    uint8_t buffer[16];
+    link.set_trace_buffer(buffer, sizeof(buffer));
+
+    transact(link, uart_output, Command::EXEC, image.data(), image.size());
+    check_dump(transact(link, uart_output, Command::DUMP_TRACE), exec_trace + 6, 5, 6);
+  }
+
+  vm_destroy(vm);
+}
+#endif
+
+#if V4LINK_ENABLE_PROFILE
+TEST_CASE("Link word profile")
+{
+  uint8_t vm_memory[1024] = {0};
+  VmConfig cfg = {vm_memory, sizeof(vm_memory), nullptr, 0, nullptr};
+  Vm* vm = vm_create(&cfg);
+  REQUIRE(vm != nullptr);
+
+  std::vector<uint8_t> uart_output;
+  Link link(vm, test_uart_write, &uart_output);
+  CHECK((Link::capabilities() & CAP_PROFILE) != 0);
+
+  // Words 0 and 1, main code 2
+  const auto image = build_v4b({0x51}, {{"sq", {0x01, 0x12, 0x51}}, {"inc", {0x51}}});
+  transact(link, uart_output, Command::EXEC, image.data(), image.size());
+
+  link.profile_sample(0);  // Not started: ignored
+  auto resp = transact(link, uart_output, Command::PROFILE_START);
+  REQUIRE(resp.size() == 5);
+  CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::OK));
+  const int samples[] = {1, 0, 1, -1, 1, 0, 1, 200, 0, -1, 1};
+  for (int wid : samples)
+  {
+    link.profile_sample(wid);
+  }
+
+  // [ACTIVE][MODE][TOTAL][OTHER][IDLE][COUNT]([WORD_IDX][HITS][NAME_LEN][NAME])*
+  resp = transact(link, uart_output, Command::PROFILE_DUMP);
+  REQUIRE(resp.size() == 5 + 15 + (7 + 3) + (7 + 2));
+  const uint8_t* p = resp.data() + 4;
+  CHECK(p[0] == 1);
+  CHECK(p[1] == static_cast<uint8_t>(ProfileMode::SAMPLE));
+  CHECK(internal::load_le32(p + 2) == 11);
+  CHECK(internal::load_le32(p + 6) == 1);
+  CHECK(internal::load_le32(p + 10) == 2);
+  REQUIRE(p[14] == 2);
+  p += 15;
+  CHECK(internal::load_le16(p) == 1);  // Hottest first
+  CHECK(internal::load_le32(p + 2) == 5);
+  CHECK(std::string(reinterpret_cast<const char*>(p + 7), p[6]) == "inc");
+  p += 7 + 3;
+  CHECK(internal::load_le16(p) == 0);
+  CHECK(internal::load_le32(p + 2) == 3);
+  CHECK(std::string(reinterpret_cast<const char*>(p + 7), p[6]) == "sq");
+
+  SUBCASE("LIMIT keeps the hottest words")
+  {
+    const uint8_t limit = 1;
+    resp = transact(link, uart_output, Command::PROFILE_DUMP, &limit, 1);
+    REQUIRE(resp.size() == 5 + 15 + 7 + 3);
+    CHECK(resp[4 + 14] == 1);
+    CHECK(resp[4 + 15] == 1);
+  }
+
+  SUBCASE("Stopped profile is kept, RESET clears it")
+  {
+    transact(link, uart_output, Command::PROFILE_STOP);
+    link.profile_sample(1);
+    resp = transact(link, uart_output, Command::PROFILE_DUMP);
+    CHECK(resp[4] == 0);
+    CHECK(internal::load_le32(resp.data() + 6) == 11);
+
+    transact(link, uart_output, Command::RESET);
+    resp = transact(link, uart_output, Command::PROFILE_DUMP);
+    REQUIRE(resp.size() == 5 + 15);
+    CHECK(internal::load_le32(resp.data() + 6) == 0);
+  }
+
+  SUBCASE("reset() clears it like RESET")
+  {
+    link.reset();
+    resp = transact(link, uart_output, Command::PROFILE_DUMP);
+    REQUIRE(resp.size() == 5 + 15);
+    CHECK(internal::load_le32(resp.data() + 6) == 0);
+    CHECK(resp[4 + 14] == 0);
+  }
+
+  SUBCASE("ENTRY mode counts runs")
+  {
+    const uint8_t mode = static_cast<uint8_t>(ProfileMode::ENTRY);
+    transact(link, uart_output, Command::PROFILE_START, &mode, 1);
+    const uint8_t code[] = {0x51};
+    transact(link, uart_output, Command::EXEC, code, sizeof(code));  // Word 3
+    resp = transact(link, uart_output, Command::PROFILE_DUMP);
+    REQUIRE(resp.size() == 5 + 15 + 7);
+    CHECK(resp[5] == static_cast<uint8_t>(ProfileMode::ENTRY));
+    CHECK(internal::load_le32(resp.data() + 6) == 1);
+    CHECK(internal::load_le16(resp.data() + 19) == 3);
+
+    const uint8_t bad = 7;
+    resp = transact(link, uart_output, Command::PROFILE_START, &bad, 1);
+    CHECK(resp[3] == static_cast<uint8_t>(ErrorCode::GENERAL_ERROR));
+  }
+
+  vm_destroy(vm);
+}
+#endif
+
 TEST_CASE("Link with task system integration")
 {
   uint8_t vm_memory[4096] = {0};
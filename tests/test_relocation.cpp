@@ -299,3 +299,76 @@ TEST_CASE("Relocation: Real-world LED shadowing scenario")
     CHECK(test_code[5] == 0);
   }
 }
+
+/* ========================================================================= */
+/* Opcode Table                                                              */
+/* ========================================================================= */
+
+TEST_CASE("Relocation: Opcode table")
+{
+  CHECK(kOpcodeTable.entries[0x00].length == 5);   // LIT
+  CHECK(kOpcodeTable.entries[0x50].length == 3);   // CALL
+  CHECK((kOpcodeTable.entries[0x50].flags & OPCODE_CALL) != 0);
+  CHECK((kOpcodeTable.entries[0x40].flags & OPCODE_BRANCH) != 0);  // JMP
+  CHECK(kOpcodeTable.entries[0x60].length == 17);  // SYS
+  CHECK(kOpcodeTable.entries[0x76].length == 2);   // LIT_U8
+  CHECK(kOpcodeTable.entries[0xEE].length == 0);   // Unknown
+}
+
+TEST_CASE("Relocation: Unknown opcode stops the scan")
+{
+  uint8_t code[] = {
+      0x50, 0x00, 0x00,  // CALL 0
+      0xEE,              // Unknown
+      0x50, 0x01, 0x00   // CALL 1
+  };
+
+  CHECK_FALSE(relocate_calls(code, 7, 5));
+  CHECK(code[1] == 5);  // Relocated before the unknown opcode
+  CHECK(code[5] == 1);  // Left alone after it
+}
+
+TEST_CASE("Relocation: Truncated instruction is reported")
+{
+  uint8_t code[] = {0x00, 0x01, 0x00};  // LIT missing two operand bytes
+  CHECK_FALSE(relocate_calls(code, 3, 5));
+}
+
+/* ========================================================================= */
+/* Relocation Table (.v4b v0.3)                                              */
+/* ========================================================================= */
+
+TEST_CASE("Relocation: Fixup list")
+{
+  uint8_t code[] = {
+      0x00, 0x50, 0x00, 0x00, 0x00,  // LIT 0x50 (looks like CALL to a scanner)
+      0x50, 0x02, 0x00,              // CALL 2
+      0x51                           // RET
+  };
+
+  SUBCASE("Listed operands are relocated")
+  {
+    const uint8_t fixups[] = {0x06, 0x00};
+    CHECK(relocate_fixups(code, sizeof(code), fixups, 1, 10));
+    CHECK(code[6] == 12);
+    CHECK(code[1] == 0x50);  // LIT operand untouched
+  }
+
+  SUBCASE("Offset outside a CALL operand is rejected")
+  {
+    const uint8_t fixups[] = {0x03, 0x00};
+    CHECK_FALSE(relocate_fixups(code, sizeof(code), fixups, 1, 10));
+  }
+
+  SUBCASE("Offset past the end is rejected")
+  {
+    const uint8_t fixups[] = {0x08, 0x00};
+    CHECK_FALSE(relocate_fixups(code, sizeof(code), fixups, 1, 10));
+  }
+
+  SUBCASE("Empty list")
+  {
+    CHECK(relocate_fixups(code, sizeof(code), nullptr, 0, 10));
+    CHECK(code[6] == 2);
+  }
+}
@@ -0,0 +1,234 @@
+/**
+ * @file test_server.cpp
+ * @brief Unit tests for the host-side LinkServer
+ *
+ * @copyright Copyright 2025 Akihito Kirisaki
+ * @license Dual-licensed under MIT or Apache-2.0
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "frame.hpp"
+#include "v4/vm_api.h"
+#include "v4link/server.hpp"
+
+using namespace v4::link;
+
+namespace
+{
+
+// One VM with its own memory per simulated device
+struct TestDevice
+{
+  uint8_t memory[1024] = {0};
+  Vm* vm = nullptr;
+
+  TestDevice()
+  {
+    VmConfig cfg = {memory, sizeof(memory), nullptr, 0, nullptr};
+    vm = vm_create(&cfg);
+  }
+
+  ~TestDevice()
+  {
+    vm_destroy(vm);
+  }
+};
+
+// Responses per channel; each channel is written by one worker at a time
+struct TestOutputs
+{
+  std::vector<std::vector<uint8_t>> bytes;
+  std::atomic<size_t> frames_after_first{0};  // Responses from channels other than 0
+};
+
+void test_send(void* user, LinkServer::ChannelId channel, const uint8_t* data, size_t len)
+{
+  auto* out = static_cast<TestOutputs*>(user);
+  out->bytes[channel].insert(out->bytes[channel].end(), data, data + len);
+  if (channel != 0)
+  {
+    out->frames_after_first.fetch_add(1);
+  }
+}
+
+std::vector<uint8_t> exec_frame(int32_t value)
+{
+  const uint8_t code[] = {0x00,
+                          static_cast<uint8_t>(value),
+                          static_cast<uint8_t>(value >> 8),
+                          static_cast<uint8_t>(value >> 16),
+                          static_cast<uint8_t>(value >> 24),
+                          0x51};  // LIT value, RET
+  std::vector<uint8_t> frame;
+  internal::encode_frame(Command::EXEC, code, sizeof(code), frame);
+  return frame;
+}
+
+std::atomic<bool> slow_release{false};
+
+// Holds its worker until slow_release is set
+int slow_slice(void*, Vm* vm, Word* entry, Link::SliceOp op, uint32_t)
+{
+  if (op == Link::SliceOp::ABORT)
+  {
+    return 0;
+  }
+  while (!slow_release.load())
+  {
+    std::this_thread::yield();
+  }
+  return vm_exec(vm, entry);
+}
+
+std::atomic<int> endless_slices{0};
+std::atomic<int> endless_aborts{0};
+
+// Never finishes: every slice yields
+int endless_slice(void*, Vm*, Word*, Link::SliceOp op, uint32_t)
+{
+  if (op == Link::SliceOp::ABORT)
+  {
+    endless_aborts.fetch_add(1);
+    return 0;
+  }
+  endless_slices.fetch_add(1);
+  return Link::SLICE_YIELD;
+}
+
+}  // namespace
+
+TEST_CASE("LinkServer routes frames by channel")
+{
+  constexpr size_t CHANNELS = 16;
+  std::vector<std::unique_ptr<TestDevice>> devices;
+  TestOutputs out;
+  out.bytes.resize(CHANNELS);
+
+  LinkServer server(test_send, &out, 4);
+  CHECK(server.thread_count() == 4);
+  for (size_t i = 0; i < CHANNELS; ++i)
+  {
+    devices.push_back(std::make_unique<TestDevice>());
+    REQUIRE(devices.back()->vm != nullptr);
+    CHECK(server.add_channel(devices.back()->vm) == i);
+  }
+
+  SUBCASE("Frames split across submissions")
+  {
+    for (size_t i = 0; i < CHANNELS; ++i)
+    {
+      const auto frame = exec_frame(static_cast<int32_t>(100 + i));
+      server.submit(static_cast<LinkServer::ChannelId>(i), frame.data(), 3);
+      server.submit(static_cast<LinkServer::ChannelId>(i), frame.data() + 3, frame.size() - 3);
+    }
+    server.drain();
+
+    for (size_t i = 0; i < CHANNELS; ++i)
+    {
+      REQUIRE(out.bytes[i].size() == 8);
+      CHECK(out.bytes[i][3] == static_cast<uint8_t>(ErrorCode::OK));
+      CHECK(vm_ds_peek_public(devices[i]->vm, 0) == static_cast<v4_i32>(100 + i));
+    }
+  }
+
+  SUBCASE("Frames of one channel run in order")
+  {
+    constexpr int FRAMES = 50;
+    for (int n = 0; n < FRAMES; ++n)
+    {
+      for (size_t i = 0; i < CHANNELS; ++i)
+      {
+        const auto frame = exec_frame(n);
+        server.submit(static_cast<LinkServer::ChannelId>(i), frame.data(), frame.size());
+      }
+    }
+    server.drain();
+
+    for (size_t i = 0; i < CHANNELS; ++i)
+    {
+      CHECK(out.bytes[i].size() == 8 * FRAMES);
+      REQUIRE(vm_ds_depth_public(devices[i]->vm) == FRAMES);
+      for (int n = 0; n < FRAMES; ++n)
+      {
+        CHECK(vm_ds_peek_public(devices[i]->vm, n) == FRAMES - 1 - n);
+      }
+    }
+  }
+}
+
+TEST_CASE("LinkServer keeps serving while one channel is busy")
+{
+  constexpr size_t CHANNELS = 8;
+  std::vector<std::unique_ptr<TestDevice>> devices;
+  TestOutputs out;
+  out.bytes.resize(CHANNELS);
+  slow_release = false;
+
+  LinkServer server(test_send, &out, 2);
+  for (size_t i = 0; i < CHANNELS; ++i)
+  {
+    devices.push_back(std::make_unique<TestDevice>());
+    server.add_channel(devices.back()->vm);
+  }
+  server.link(0).set_async_exec(true);
+  server.link(0).set_exec_slice(slow_slice, 1);
+
+  for (size_t i = 0; i < CHANNELS; ++i)
+  {
+    const auto frame = exec_frame(static_cast<int32_t>(i));
+    server.submit(static_cast<LinkServer::ChannelId>(i), frame.data(), frame.size());
+  }
+
+  // Channel 0 holds one worker; the other must pick up, and steal, the rest
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (out.frames_after_first.load() < CHANNELS - 1 &&
+         std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(out.frames_after_first.load() == CHANNELS - 1);
+  CHECK(server.steals() > 0);
+
+  slow_release = true;
+  server.drain();
+  CHECK(server.link(0).run_state() == RunState::DONE);
+  CHECK(vm_ds_peek_public(devices[0]->vm, 0) == 0);
+}
+
+TEST_CASE("LinkServer stops with a run that never finishes")
+{
+  TestDevice devices[2];
+  TestOutputs out;
+  out.bytes.resize(2);
+  endless_slices = 0;
+  endless_aborts = 0;
+
+  {
+    LinkServer server(test_send, &out, 1);
+    server.add_channel(devices[0].vm);
+    server.add_channel(devices[1].vm);
+    server.link(0).set_async_exec(true);
+    server.link(0).set_exec_slice(endless_slice, 1);
+
+    const auto frame = exec_frame(1);
+    server.submit(0, frame.data(), frame.size());
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (endless_slices.load() < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(endless_slices.load() >= 2);
+    server.submit(1, frame.data(), frame.size());  // Still queued when the server stops
+  }
+
+  // The destructor returned, and the run was aborted rather than left behind
+  CHECK(endless_aborts.load() == 1);
+}